@@ -13,25 +13,175 @@
 // See the GNU Lesser General Public License for more details.
 //
 
+#include <algorithm>
+
 #include "ByteArray.h"
 
 
-void ByteArray::setDataFromBuffer(const void *ptr, unsigned int length)
+ByteArray::Chunk *ByteArray::createChunk(char *data)
+{
+    Chunk *chunk = new Chunk;
+    chunk->refCount = 0;
+    chunk->data = data;
+    return chunk;
+}
+
+void ByteArray::releaseChunk(Chunk *chunk)
 {
-    if (length != data_arraysize)
+    ASSERT(chunk->refCount > 0);
+    if (--chunk->refCount == 0)
     {
-        delete [] data_var;
-        data_var = length ? new char[length] : NULL;
-        data_arraysize = length;
+        delete [] chunk->data;
+        delete chunk;
+    }
+}
+
+void ByteArray::releaseSlices()
+{
+    for (SliceVector::iterator i = slices.begin(); i != slices.end(); ++i)
+        releaseChunk(i->chunk);
+    slices.clear();
+    length = 0;
+    lastSlice = lastSliceStart = 0;
+}
+
+void ByteArray::copy(const ByteArray& other)
+{
+    slices = other.slices;
+    for (SliceVector::iterator i = slices.begin(); i != slices.end(); ++i)
+        i->chunk->refCount++;
+    length = other.length;
+    lastSlice = lastSliceStart = 0;
+}
+
+ByteArray& ByteArray::operator=(const ByteArray& other)
+{
+    if (this == &other)
+        return *this;
+    ByteArray_Base::operator=(other);
+    releaseSlices();
+    copy(other);
+    return *this;
+}
+
+void ByteArray::appendSlice(Chunk *chunk, unsigned int offset, unsigned int length)
+{
+    if (length == 0)
+        return;
+
+    // a slice continuing the last one, e.g. the two halves of a split, is merged into it
+    if (!slices.empty() && slices.back().chunk == chunk && slices.back().offset + slices.back().length == offset)
+    {
+        slices.back().length += length;
+    }
+    else
+    {
+        Slice slice;
+        slice.chunk = chunk;
+        slice.offset = offset;
+        slice.length = length;
+        slices.push_back(slice);
+        chunk->refCount++;
+    }
+    this->length += length;
+}
+
+unsigned int ByteArray::findSlice(unsigned int k) const
+{
+    ASSERT(k < length);
+
+    unsigned int i = 0, start = 0;
+    if (lastSlice < slices.size() && lastSliceStart <= k)
+    {
+        i = lastSlice;
+        start = lastSliceStart;
+    }
+    while (k >= start + slices[i].length)
+        start += slices[i++].length;
+
+    lastSlice = i;
+    lastSliceStart = start;
+    return i;
+}
+
+void ByteArray::parsimPack(cCommBuffer *b)
+{
+    ByteArray_Base::parsimPack(b);
+    b->pack(length);
+    for (SliceVector::const_iterator i = slices.begin(); i != slices.end(); ++i)
+        b->pack(i->chunk->data + i->offset, i->length);
+}
+
+void ByteArray::parsimUnpack(cCommBuffer *b)
+{
+    ByteArray_Base::parsimUnpack(b);
+    unsigned int length;
+    b->unpack(length);
+    char *buffer = length ? new char[length] : NULL;
+    b->unpack(buffer, length);
+    assignBuffer(buffer, length);
+}
+
+void ByteArray::setDataArraySize(unsigned int size)
+{
+    if (size < length)
+    {
+        truncateData(0, length - size);
+    }
+    else if (size > length)
+    {
+        unsigned int n = size - length;
+        char *buffer = new char[n];
+        memset(buffer, 0, n);
+        appendSlice(createChunk(buffer), 0, n);
     }
-    if (length)
-        memcpy(data_var, ptr, length);
+}
+
+char ByteArray::getData(unsigned int k) const
+{
+    if (k >= length)
+        throw cRuntimeError("Array of size %d indexed by %d", length, k);
+
+    const Slice& slice = slices[findSlice(k)];
+    return slice.chunk->data[slice.offset + k - lastSliceStart];
+}
+
+void ByteArray::setData(unsigned int k, char data)
+{
+    if (k >= length)
+        throw cRuntimeError("Array of size %d indexed by %d", length, k);
+
+    Slice& slice = slices[findSlice(k)];
+
+    // copy on write: only the shared slice being modified is copied
+    if (slice.chunk->refCount > 1)
+    {
+        char *buffer = new char[slice.length];
+        memcpy(buffer, slice.chunk->data + slice.offset, slice.length);
+        releaseChunk(slice.chunk);
+        slice.chunk = createChunk(buffer);
+        slice.chunk->refCount = 1;
+        slice.offset = 0;
+    }
+    slice.chunk->data[slice.offset + k - lastSliceStart] = data;
+}
+
+void ByteArray::setDataFromBuffer(const void *ptr, unsigned int length)
+{
+    releaseSlices();
+    addDataFromBuffer(ptr, length);
 }
 
 void ByteArray::setDataFromByteArray(const ByteArray& other, unsigned int srcOffs, unsigned int length)
 {
-    ASSERT(srcOffs+length <= other.data_arraysize);
-    setDataFromBuffer(other.data_var+srcOffs, length);
+    ASSERT(srcOffs+length <= other.length);
+
+    // other may be this
+    ByteArray data;
+    data.addDataFromByteArray(other, srcOffs, length);
+    releaseSlices();
+    slices.swap(data.slices);
+    this->length = length;
 }
 
 void ByteArray::addDataFromBuffer(const void *ptr, unsigned int length)
@@ -39,48 +189,101 @@ void ByteArray::addDataFromBuffer(const void *ptr, unsigned int length)
     if (0 == length)
         return;
 
-    unsigned int nlength = data_arraysize + length;
-    char *ndata_var = new char[nlength];
-    if (data_arraysize)
-        memcpy(ndata_var, data_var, data_arraysize);
-    memcpy(ndata_var, data_var + data_arraysize, length);
-    delete [] data_var;
-    data_var = ndata_var;
+    char *buffer = new char[length];
+    memcpy(buffer, ptr, length);
+    appendSlice(createChunk(buffer), 0, length);
+}
+
+void ByteArray::addDataFromByteArray(const ByteArray& other, unsigned int srcOffs, unsigned int length)
+{
+    ASSERT(srcOffs+length <= other.length);
+
+    if (this == &other)
+    {
+        ByteArray copy(other);
+        addDataFromByteArray(copy, srcOffs, length);
+        return;
+    }
+
+    for (SliceVector::const_iterator i = other.slices.begin(); length > 0 && i != other.slices.end(); ++i)
+    {
+        if (srcOffs >= i->length)
+        {
+            srcOffs -= i->length;
+            continue;
+        }
+        unsigned int n = std::min(i->length - srcOffs, length);
+        appendSlice(i->chunk, i->offset + srcOffs, n);
+        length -= n;
+        srcOffs = 0;
+    }
 }
 
 unsigned int ByteArray::copyDataToBuffer(void *ptr, unsigned int length, unsigned int srcOffs) const
 {
-    if (srcOffs >= data_arraysize)
+    if (srcOffs >= this->length)
         return 0;
 
-    if (srcOffs + length > data_arraysize)
-        length = data_arraysize - srcOffs;
-    memcpy(ptr, data_var+srcOffs, length);
+    if (srcOffs + length > this->length)
+        length = this->length - srcOffs;
+
+    unsigned int copied = 0;
+    for (SliceVector::const_iterator i = slices.begin(); copied < length; ++i)
+    {
+        if (srcOffs >= i->length)
+        {
+            srcOffs -= i->length;
+            continue;
+        }
+        unsigned int n = std::min(i->length - srcOffs, length - copied);
+        memcpy((char *)ptr + copied, i->chunk->data + i->offset + srcOffs, n);
+        copied += n;
+        srcOffs = 0;
+    }
     return length;
 }
 
 void ByteArray::assignBuffer(void *ptr, unsigned int length)
 {
-    delete [] data_var;
-    data_var = (char *)ptr;
-    data_arraysize = length;
+    releaseSlices();
+    if (length)
+        appendSlice(createChunk((char *)ptr), 0, length);
+    else
+        delete [] (char *)ptr;
 }
 
 void ByteArray::truncateData(unsigned int truncleft, unsigned int truncright)
 {
-    ASSERT(data_arraysize >= (truncleft + truncright));
+    ASSERT(length >= (truncleft + truncright));
+
+    if (truncleft == 0 && truncright == 0)
+        return;
 
-    if ((truncleft || truncright))
+    length -= truncleft + truncright;
+    lastSlice = lastSliceStart = 0;
+
+    // drop or shorten the slices at the beginning...
+    SliceVector::iterator i = slices.begin();
+    while (truncleft > 0 && truncleft >= i->length)
     {
-        unsigned int nlength = data_arraysize - (truncleft + truncright);
-        char *ndata_var = NULL;
-        if (nlength)
-        {
-            ndata_var = new char[nlength];
-            memcpy(ndata_var, data_var+truncleft, nlength);
-        }
-        delete [] data_var;
-        data_var = ndata_var;
-        data_arraysize = nlength;
+        truncleft -= i->length;
+        releaseChunk(i->chunk);
+        ++i;
+    }
+    i = slices.erase(slices.begin(), i);
+    if (truncleft > 0)
+    {
+        i->offset += truncleft;
+        i->length -= truncleft;
+    }
+
+    // ...and at the end
+    while (truncright > 0 && truncright >= slices.back().length)
+    {
+        truncright -= slices.back().length;
+        releaseChunk(slices.back().chunk);
+        slices.pop_back();
     }
+    if (truncright > 0)
+        slices.back().length -= truncright;
 }
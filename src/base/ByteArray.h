@@ -16,34 +16,106 @@
 #ifndef __INET_BYTEARRAY_H
 #define __INET_BYTEARRAY_H
 
+#include <vector>
+
 #include "ByteArray_m.h"
 
 /**
  * Class that carries raw bytes.
+ *
+ * The bytes live in reference counted chunks shared by all ByteArrays
+ * that contain them. A ByteArray is a list of slices of such chunks, so
+ * copying it, taking a part of it or appending another ByteArray to it
+ * only copies slice descriptors. The bytes are copied only when they are
+ * written out with copyDataToBuffer() or during parallel simulation packing,
+ * and a chunk shared with another ByteArray is copied before it is modified
+ * with setData().
  */
 class ByteArray : public ByteArray_Base
 {
+  protected:
+    /** A block of bytes, deleted when the last slice referring to it goes away */
+    struct Chunk
+    {
+        int refCount;
+        char *data;
+    };
+
+    /** The bytes [offset, offset+length) of a chunk */
+    struct Slice
+    {
+        Chunk *chunk;
+        unsigned int offset;
+        unsigned int length;
+    };
+
+    typedef std::vector<Slice> SliceVector;
+    SliceVector slices;
+    unsigned int length;       // total length of the slices
+
+    // getData() caches the slice of the last byte accessed, so a byte by byte walk is linear
+    mutable unsigned int lastSlice;
+    mutable unsigned int lastSliceStart;
+
+  private:
+    void copy(const ByteArray& other);
+
+  protected:
+    static Chunk *createChunk(char *data);
+    static void releaseChunk(Chunk *chunk);
+    void releaseSlices();
+    void appendSlice(Chunk *chunk, unsigned int offset, unsigned int length);
+    unsigned int findSlice(unsigned int k) const;
+
   public:
     /**
      * Constructor
      */
-    ByteArray() : ByteArray_Base() {}
+    ByteArray() : ByteArray_Base(), length(0), lastSlice(0), lastSliceStart(0) {}
 
     /**
-     * Copy constructor
+     * Copy constructor; the copy shares the bytes with other
      */
-    ByteArray(const ByteArray& other) : ByteArray_Base(other) { }
+    ByteArray(const ByteArray& other) : ByteArray_Base(other), length(0) {copy(other);}
 
     /**
      * operator =
      */
-    ByteArray& operator=(const ByteArray& other) {ByteArray_Base::operator=(other); return *this;}
+    ByteArray& operator=(const ByteArray& other);
+
+    /**
+     * Destructor
+     */
+    virtual ~ByteArray() {releaseSlices();}
 
     /**
      * Creates and returns an exact copy of this object.
      */
     virtual ByteArray *dup() const {return new ByteArray(*this);}
 
+    virtual void parsimPack(cCommBuffer *b);
+    virtual void parsimUnpack(cCommBuffer *b);
+
+    /**
+     * Resizes the array. Bytes beyond the old length are zero.
+     */
+    virtual void setDataArraySize(unsigned int size);
+
+    /**
+     * Returns the number of bytes.
+     */
+    virtual unsigned int getDataArraySize() const {return length;}
+
+    /**
+     * Returns the kth byte.
+     */
+    virtual char getData(unsigned int k) const;
+
+    /**
+     * Sets the kth byte. The chunk holding it is copied first if it is shared.
+     */
+    virtual void setData(unsigned int k, char data);
+
     /**
      * Copy data from buffer
      * @param ptr: pointer to buffer
@@ -52,7 +124,7 @@ class ByteArray : public ByteArray_Base
     virtual void setDataFromBuffer(const void *ptr, unsigned int length);
 
     /**
-     * Copy data from other ByteArray
+     * Set content to a part of other ByteArray, without copying the bytes
      * @param other: reference to other ByteArray
      * @param offset: skipped first bytes from other
      * @param length: length of data
@@ -66,6 +138,14 @@ class ByteArray : public ByteArray_Base
      */
     virtual void addDataFromBuffer(const void *ptr, unsigned int length);
 
+    /**
+     * Add a part of other ByteArray to the end of existing content, without copying the bytes
+     * @param other: reference to other ByteArray
+     * @param offset: skipped first bytes from other
+     * @param length: length of data
+     */
+    virtual void addDataFromByteArray(const ByteArray& other, unsigned int offset, unsigned int length);
+
     /**
      * Copy data content to buffer
      * @param ptr: pointer to output buffer
@@ -76,7 +156,7 @@ class ByteArray : public ByteArray_Base
     virtual unsigned int copyDataToBuffer(void *ptr, unsigned int length, unsigned int srcOffs = 0) const;
 
     /**
-     * Set buffer pointer and buffer length
+     * Set buffer pointer and buffer length. The buffer is taken over, not copied.
      * @param ptr: pointer to new buffer, must created by `buffer = new char[length1];` where length1>=length
      * @param length: length of buffer
      */
@@ -89,6 +169,11 @@ class ByteArray : public ByteArray_Base
      * Generate assert when not have enough bytes for truncation
      */
     virtual void truncateData(unsigned int truncleft, unsigned int truncright = 0);
+
+    /**
+     * Returns the number of chunk slices the content is made of.
+     */
+    unsigned int getNumSlices() const {return slices.size();}
 };
 
 #endif //  __INET_BYTEARRAY_H
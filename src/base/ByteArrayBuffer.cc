@@ -15,10 +15,7 @@
 #include "ByteArrayBuffer.h"
 
 ByteArrayBuffer::ByteArrayBuffer()
- :
-    dataLengthM(0)
 {
-    // FIXME
 }
 
 ByteArrayBuffer::ByteArrayBuffer(const ByteArrayBuffer& other)
@@ -37,38 +34,30 @@ ByteArrayBuffer& ByteArrayBuffer::operator=(const ByteArrayBuffer& other)
 
 void ByteArrayBuffer::push(const ByteArray& byteArrayP)
 {
-    dataListM.push_back(byteArrayP);
-    dataLengthM += byteArrayP.getDataArraySize();
+    dataM.addDataFromByteArray(byteArrayP, 0, byteArrayP.getDataArraySize());
 }
 
 void ByteArrayBuffer::push(const void* bufferP, unsigned int bufferLengthP)
 {
-    ByteArray byteArray;
-    dataListM.push_back(byteArray);
-    dataListM.back().setDataFromBuffer(bufferP, bufferLengthP);
-    dataLengthM += bufferLengthP;
+    dataM.addDataFromBuffer(bufferP, bufferLengthP);
 }
 
 unsigned int ByteArrayBuffer::getBytesToBuffer(void* bufferP, unsigned int bufferLengthP, unsigned int srcOffsP) const
 {
-    unsigned int copiedBytes = 0;
-    DataList::const_iterator i;
+    return dataM.copyDataToBuffer(bufferP, bufferLengthP, srcOffsP);
+}
+
+unsigned int ByteArrayBuffer::getBytesToByteArray(ByteArray& byteArrayP, unsigned int lengthP, unsigned int srcOffsP) const
+{
+    unsigned int dataLength = dataM.getDataArraySize();
 
-    for (i = this->dataListM.begin(); (copiedBytes < bufferLengthP) && (i != dataListM.end()); ++i)
-    {
-        unsigned int cbytes = i->copyDataToBuffer((char *)bufferP + copiedBytes,
-                bufferLengthP - copiedBytes, srcOffsP);
-        if (cbytes)
-        {
-            copiedBytes += cbytes;
-            srcOffsP = 0;
-        }
-        else
-        {
-            srcOffsP -= i->getDataArraySize();
-        }
-    }
-    return copiedBytes;
+    if (srcOffsP >= dataLength)
+        lengthP = 0;
+    else if (lengthP > dataLength - srcOffsP)
+        lengthP = dataLength - srcOffsP;
+
+    byteArrayP.setDataFromByteArray(dataM, lengthP ? srcOffsP : 0, lengthP);
+    return lengthP;
 }
 
 unsigned int ByteArrayBuffer::popBytesToBuffer(void* bufferP, unsigned int bufferLengthP)
@@ -76,40 +65,20 @@ unsigned int ByteArrayBuffer::popBytesToBuffer(void* bufferP, unsigned int buffe
     return drop(getBytesToBuffer(bufferP, bufferLengthP));
 }
 
-unsigned int ByteArrayBuffer::drop(unsigned int lengthP)
+unsigned int ByteArrayBuffer::popBytesToByteArray(ByteArray& byteArrayP, unsigned int lengthP)
 {
-    ASSERT(lengthP <= dataLengthM);
-
-    unsigned int length = lengthP;
+    return drop(getBytesToByteArray(byteArrayP, lengthP));
+}
 
-    while (length > 0)
-    {
-        unsigned int sliceLength = dataListM.front().getDataArraySize();
+unsigned int ByteArrayBuffer::drop(unsigned int lengthP)
+{
+    ASSERT(lengthP <= dataM.getDataArraySize());
 
-        if (sliceLength <= length)
-        {
-            dataListM.pop_front();
-            dataLengthM -= sliceLength;
-            length -= sliceLength;
-        }
-        else
-        {
-            dataListM.front().truncateData(length);
-            dataLengthM -= length;
-            length = 0;
-        }
-    }
-    ASSERT(0 == length);
+    dataM.truncateData(lengthP);
     return lengthP;
 }
 
 void ByteArrayBuffer::clear()
 {
-    dataLengthM = 0;
-
-    while (dataListM.begin() != dataListM.end())
-    {
-        dataListM.pop_front();
-    }
+    dataM.setDataArraySize(0);
 }
-
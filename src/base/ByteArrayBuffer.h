@@ -19,16 +19,17 @@
 
 /**
  * Buffer that carries BytesArrays.
+ *
+ * The pushed ByteArrays are not copied: the buffer is a ByteArray itself,
+ * made of slices of their chunks.
  */
 class ByteArrayBuffer : public cObject
 {
   protected:
-    typedef std::list<ByteArray> DataList;
-    uint64 dataLengthM;
-    DataList dataListM;
+    ByteArray dataM;
 
   private:
-    void copy(const ByteArrayBuffer& other) { dataLengthM = other.dataLengthM; dataListM = other.dataListM; }
+    void copy(const ByteArrayBuffer& other) { dataM = other.dataM; }
 
   public:
     /** Ctor. */
@@ -50,7 +51,7 @@ class ByteArrayBuffer : public cObject
     virtual void push(const void* bufferP, unsigned int bufferLengthP);
 
     /** Returns length of stored data */
-    virtual uint64 getLength() const { return dataLengthM; }
+    virtual uint64 getLength() const { return dataM.getDataArraySize(); }
 
     /**
      * Copy bytes to an external buffer
@@ -61,6 +62,15 @@ class ByteArrayBuffer : public cObject
      */
     virtual unsigned int getBytesToBuffer(void* bufferP, unsigned int bufferLengthP, unsigned int srcOffsP = 0) const;
 
+    /**
+     * Set the content of a ByteArray to bytes of the buffer, sharing them instead of copying
+     * @param byteArrayP: output ByteArray
+     * @param lengthP: maximum count of bytes
+     * @param srcOffsP: source offset
+     * @return count of bytes in byteArrayP
+     */
+    virtual unsigned int getBytesToByteArray(ByteArray& byteArrayP, unsigned int lengthP, unsigned int srcOffsP = 0) const;
+
     /**
      * Move bytes to an external buffer
      * @param bufferP: pointer to output buffer
@@ -69,6 +79,14 @@ class ByteArrayBuffer : public cObject
      */
     virtual unsigned int popBytesToBuffer(void* bufferP, unsigned int bufferLengthP);
 
+    /**
+     * Move bytes to a ByteArray, sharing them instead of copying
+     * @param byteArrayP: output ByteArray
+     * @param lengthP: maximum count of bytes
+     * @return count of moved bytes
+     */
+    virtual unsigned int popBytesToByteArray(ByteArray& byteArrayP, unsigned int lengthP);
+
     /**
      * Drop bytes from buffer
      * @param lengthP: count of droppable bytes
@@ -17,6 +17,10 @@
 
 
 #include <algorithm>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "NotificationBoard.h"
 #include "NotifierConsts.h"
 
@@ -47,14 +51,44 @@ std::ostream& operator<<(std::ostream& os, const NotificationBoard::NotifiableVe
 }
 
 
+NotificationBoard::NotificationBoard()
+{
+    deliverMsg = NULL;
+    numFired = numCoalesced = 0;
+}
+
+NotificationBoard::~NotificationBoard()
+{
+    cancelAndDelete(deliverMsg);
+}
+
 void NotificationBoard::initialize()
 {
-    WATCH_MAP(clientMap);
+    cStringTokenizer tokenizer(par("coalescedCategories"));
+    while (tokenizer.hasMoreTokens())
+        setCoalescing(parseCategory(tokenizer.nextToken()), true);
+
+    WATCH_VECTOR(clients);
+    WATCH(numFired);
+    WATCH(numCoalesced);
+}
+
+int NotificationBoard::parseCategory(const char *name)
+{
+    if (isdigit(*name))
+        return atoi(name);
+    for (int category = 0; category <= NF_BATTERY_CPUTIME_CONSUMED; category++)
+        if (!strcmp(name, notificationCategoryName(category)))
+            return category;
+    error("Unknown notification category '%s'", name);
+    return -1;
 }
 
 void NotificationBoard::handleMessage(cMessage *msg)
 {
-    error("NotificationBoard doesn't handle messages, it can be accessed via direct method calls");
+    if (msg != deliverMsg)
+        error("NotificationBoard doesn't handle messages, it can be accessed via direct method calls");
+    deliverPendingNotifications();
 }
 
 
@@ -62,12 +96,16 @@ void NotificationBoard::subscribe(INotifiable *client, int category)
 {
     Enter_Method("subscribe(%s)", notificationCategoryName(category));
 
-    // find or create entry for this category
-    NotifiableVector& clients = clientMap[category];
+    if (category < 0)
+        error("subscribe(): invalid notification category %d", category);
+    if ((unsigned int)category >= clients.size())
+        clients.resize(category + 1);
 
     // add client if not already there
-    if (std::find(clients.begin(), clients.end(), client) == clients.end())
-        clients.push_back(client);
+    NotifiableVector& categoryClients = clients[category];
+    if (std::find(categoryClients.begin(), categoryClients.end(), client) != categoryClients.end())
+        return;
+    categoryClients.push_back(client);
 
     fireChangeNotification(NF_SUBSCRIBERLIST_CHANGED, NULL);
 }
@@ -76,34 +114,85 @@ void NotificationBoard::unsubscribe(INotifiable *client, int category)
 {
     Enter_Method("unsubscribe(%s)", notificationCategoryName(category));
 
-    // find (or create) entry for this category
-    NotifiableVector& clients = clientMap[category];
+    if ((unsigned int)category >= clients.size())
+        return;
 
     // remove client if there
-    NotifiableVector::iterator it = std::find(clients.begin(), clients.end(), client);
-    if (it!=clients.end())
-        clients.erase(it);
+    NotifiableVector& categoryClients = clients[category];
+    NotifiableVector::iterator it = std::find(categoryClients.begin(), categoryClients.end(), client);
+    if (it == categoryClients.end())
+        return;
+    categoryClients.erase(it);
 
     fireChangeNotification(NF_SUBSCRIBERLIST_CHANGED, NULL);
 }
 
-bool NotificationBoard::hasSubscribers(int category)
-{
-    ClientMap::iterator it = clientMap.find(category);
-    return it!=clientMap.end() && !it->second.empty();
-}
-
 void NotificationBoard::fireChangeNotification(int category, const cObject *details)
 {
+    // nothing to do (and no method call to display) without subscribers
+    if (!hasSubscribers(category))
+        return;
+
+    // the details string is only needed for animation
     Enter_Method("fireChangeNotification(%s, %s)", notificationCategoryName(category),
-                 details?details->info().c_str() : "n/a");
+                 details && ev.isGUI() ? details->info().c_str() : "n/a");
 
-    ClientMap::iterator it = clientMap.find(category);
-    if (it==clientMap.end())
+    numFired++;
+    if (!isCoalesced(category))
+    {
+        deliverNotification(category, details);
         return;
-    NotifiableVector& clients = it->second;
-    for (NotifiableVector::iterator j=clients.begin(); j!=clients.end(); j++)
-        (*j)->receiveChangeNotification(category, details);
+    }
+
+    // coalescing: deliver once after this event, with the last details
+    if ((unsigned int)category >= pendingIndex.size())
+        pendingIndex.resize(category + 1, -1);
+    if (pendingIndex[category] != -1)
+    {
+        pendingNotifications[pendingIndex[category]].details = details;
+        numCoalesced++;
+        return;
+    }
+    PendingNotification notification;
+    notification.category = category;
+    notification.details = details;
+    pendingIndex[category] = pendingNotifications.size();
+    pendingNotifications.push_back(notification);
+
+    if (!deliverMsg)
+        deliverMsg = new cMessage("deliverNotifications");
+    if (!deliverMsg->isScheduled())
+        scheduleAt(simTime(), deliverMsg);
+}
+
+void NotificationBoard::deliverNotification(int category, const cObject *details)
+{
+    // clients may subscribe or unsubscribe from the callback, which may
+    // reallocate the vectors: index them on every iteration
+    for (unsigned int i = 0; i < clients[category].size(); i++)
+        clients[category][i]->receiveChangeNotification(category, details);
+}
+
+void NotificationBoard::deliverPendingNotifications()
+{
+    // notifications fired from the callbacks go into a new batch
+    std::vector<PendingNotification> notifications;
+    notifications.swap(pendingNotifications);
+    for (unsigned int i = 0; i < notifications.size(); i++)
+        pendingIndex[notifications[i].category] = -1;
+
+    for (unsigned int i = 0; i < notifications.size(); i++)
+        if (hasSubscribers(notifications[i].category))
+            deliverNotification(notifications[i].category, notifications[i].details);
+}
+
+void NotificationBoard::setCoalescing(int category, bool enabled)
+{
+    if (category < 0)
+        throw cRuntimeError("NotificationBoard: invalid notification category %d", category);
+    if ((unsigned int)category >= coalesced.size())
+        coalesced.resize(category + 1, false);
+    coalesced[category] = enabled;
 }
 
 
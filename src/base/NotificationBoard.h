@@ -19,7 +19,6 @@
 #ifndef __INET_NOTIFICATIONBOARD_H
 #define __INET_NOTIFICATIONBOARD_H
 
-#include <map>
 #include <vector>
 
 #include "INETDefs.h"
@@ -78,6 +77,13 @@
  * </pre>
  *
  *
+ * Categories can be configured to be coalesced (see the coalescedCategories
+ * parameter and setCoalescing()): notifications of such a category are not
+ * delivered immediately, but once after the current event, with the details
+ * object of the last one. This is only suitable for categories whose details
+ * object is NULL or outlives the event (e.g. points to the state of the
+ * producer).
+ *
  * See NED file for additional info.
  *
  * @see INotifiable
@@ -87,11 +93,27 @@ class INET_API NotificationBoard : public cSimpleModule
 {
   public: // should be protected
     typedef std::vector<INotifiable *> NotifiableVector;
-    typedef std::map<int, NotifiableVector> ClientMap;
+    typedef std::vector<NotifiableVector> ClientVector;
     friend std::ostream& operator<<(std::ostream&, const NotifiableVector&); // doesn't work in MSVC 6.0
 
   protected:
-    ClientMap clientMap;
+    struct PendingNotification
+    {
+        int category;
+        const cObject *details;
+    };
+
+    ClientVector clients;  // indexed by category
+
+    // coalescing
+    std::vector<bool> coalesced;  // indexed by category
+    std::vector<PendingNotification> pendingNotifications;  // to be delivered after the current event
+    std::vector<int> pendingIndex;  // indexed by category: index in pendingNotifications, or -1
+    cMessage *deliverMsg;
+
+    // statistics
+    long numFired;
+    long numCoalesced;
 
   protected:
     /**
@@ -100,10 +122,29 @@ class INET_API NotificationBoard : public cSimpleModule
     virtual void initialize();
 
     /**
-     * Does nothing.
+     * Delivers coalesced notifications.
      */
     virtual void handleMessage(cMessage *msg);
 
+    /**
+     * Calls receiveChangeNotification() of the subscribers of the category.
+     */
+    virtual void deliverNotification(int category, const cObject *details);
+
+    /**
+     * Delivers the notifications queued in coalescing mode.
+     */
+    virtual void deliverPendingNotifications();
+
+    /**
+     * Converts a category name (see notificationCategoryName()) or number to a category.
+     */
+    virtual int parseCategory(const char *name);
+
+  public:
+    NotificationBoard();
+    virtual ~NotificationBoard();
+
   public:
     /** @name Methods for consumers of change notifications */
     //@{
@@ -119,13 +160,14 @@ class INET_API NotificationBoard : public cSimpleModule
 
     /**
      * Returns true if any client has subscribed to the given category.
-     * This, by using a local boolean 'hasSubscriber' flag, allows
-     * performance-critical clients to leave out calls to
-     * fireChangeNotification() if there's no one subscribed anyway.
-     * The flag should be refreshed on each NF_SUBSCRIBERLIST_CHANGED
-     * notification.
+     * It is an inline array lookup, so performance-critical clients can
+     * call it before fireChangeNotification() (or before building the
+     * details object), or cache it in a local boolean 'hasSubscriber' flag
+     * refreshed on each NF_SUBSCRIBERLIST_CHANGED notification.
      */
-    virtual bool hasSubscribers(int category);
+    bool hasSubscribers(int category) const {
+        return (unsigned int)category < clients.size() && !clients[category].empty();
+    }
     //@}
 
     /** @name Methods for producers of change notifications */
@@ -137,6 +179,18 @@ class INET_API NotificationBoard : public cSimpleModule
      * that changed, old value, new value, etc).
      */
     virtual void fireChangeNotification(int category, const cObject *details = NULL);
+
+    /**
+     * Turns coalescing on or off for the given category.
+     */
+    virtual void setCoalescing(int category, bool enabled);
+
+    /**
+     * Returns true if notifications of the given category are coalesced.
+     */
+    bool isCoalesced(int category) const {
+        return (unsigned int)category < coalesced.size() && coalesced[category];
+    }
     //@}
 };
 
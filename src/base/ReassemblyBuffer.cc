@@ -18,6 +18,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #include "INETDefs.h"
 
@@ -71,7 +72,7 @@ void ReassemblyBuffer::merge(ushort beg, ushort end, bool islast)
         r.beg = beg;
         r.end = end;
         r.islast = islast;
-        fragments->push_back(r);
+        fragments->insert(std::upper_bound(fragments->begin(), fragments->end(), r, regionBegLess), r);
     }
     else
     {
@@ -84,46 +85,26 @@ void ReassemblyBuffer::mergeFragments()
 {
     RegionVector& frags = *fragments;
 
-    bool oncemore;
-    do
+    // The fragments are sorted by beg, so a chain of fragments connecting
+    // to the beginning of main is found walking backwards, and a chain
+    // connecting to its end walking forwards.
+    for (int i = frags.size() - 1; i >= 0; i--)
+        if (frags[i].end == main.beg)
+            main.beg = frags[i].beg;
+    for (unsigned int i = 0; i < frags.size(); i++)
     {
-        oncemore = false;
-        for (RegionVector::iterator i=frags.begin(); i!=frags.end(); )
+        if (frags[i].beg == main.end)
         {
-            bool deleteit = false;
-            Region& frag = *i;
-            if (main.end==frag.beg)
-            {
-                main.end = frag.end;
-                if (frag.islast)
-                    main.islast = true;
-                deleteit = true;
-            }
-            else if (main.beg==frag.end)
-            {
-                main.beg = frag.beg;
-                deleteit = true;
-            }
-            else if (main.beg<=frag.beg && main.end>=frag.end)
-            {
-                // we already have this region (duplicate fragment), delete it
-                deleteit = true;
-            }
-
-            if (deleteit)
-            {
-                // deletion is tricky because erase() invalidates iterator
-                int pos = i - frags.begin();
-                frags.erase(i);
-                i = frags.begin() + pos;
-                oncemore = true;
-            }
-            else
-            {
-                ++i;
-            }
+            main.end = frags[i].end;
+            if (frags[i].islast)
+                main.islast = true;
         }
     }
-    while (oncemore);
-}
 
+    // throw out what is now part of main (merged or duplicate fragments)
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < frags.size(); i++)
+        if (!(main.beg <= frags[i].beg && main.end >= frags[i].end))
+            frags[n++] = frags[i];
+    frags.resize(n);
+}
@@ -51,9 +51,10 @@ class INET_API ReassemblyBuffer
     // put them aside into buf until new fragments come and fill the gap.
     //
     Region main;   // offset range we already have
-    RegionVector *fragments;  // only used if we receive disjoint fragments
+    RegionVector *fragments;  // only used if we receive disjoint fragments; sorted by beg
 
   protected:
+    static bool regionBegLess(const Region& a, const Region& b) {return a.beg < b.beg;}
     void merge(ushort beg, ushort end, bool islast);
     void mergeFragments();
 
@@ -161,13 +161,20 @@ void EtherHub::handleMessage(cMessage *msg)
     numMessages++;
     emit(pkSignal, msg);
 
-    if (numPorts <= 1)
+    // the original message goes out on the last connected port, the others get
+    // copies; dup() shares the encapsulated packet, so only the frame is copied
+    int lastPort = -1;
+    for (int i = numPorts - 1; i >= 0 && lastPort < 0; i--)
+        if (i != arrivalPort && gate(outputGateBaseId + i)->isConnected())
+            lastPort = i;
+
+    if (lastPort < 0)
     {
         delete msg;
         return;
     }
 
-    for (int i = 0; i < numPorts; i++)
+    for (int i = 0; i <= lastPort; i++)
     {
         if (i != arrivalPort)
         {
@@ -175,20 +182,15 @@ void EtherHub::handleMessage(cMessage *msg)
             if (!ogate->isConnected())
                 continue;
 
-            bool isLast = (arrivalPort == numPorts-1) ? (i == numPorts-2) : (i == numPorts-1);
-            cMessage *msg2 = isLast ? msg : msg->dup();
+            cMessage *msg2 = (i == lastPort) ? msg : msg->dup();
 
             // stop current transmission
             ogate->getTransmissionChannel()->forceTransmissionFinishTime(SIMTIME_ZERO);
 
             // send
             send(msg2, ogate);
-
-            if (isLast)
-                msg = NULL;  // msg sent, do not delete it.
         }
     }
-    delete msg;
 }
 
 void EtherHub::finish()
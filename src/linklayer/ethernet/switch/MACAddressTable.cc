@@ -0,0 +1,148 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "MACAddressTable.h"
+
+
+#define INITIAL_NUM_BUCKETS  64
+
+MACAddressTable::MACAddressTable() : buckets(INITIAL_NUM_BUCKETS, (Entry *)NULL), numEntries(0), oldest(NULL), newest(NULL)
+{
+}
+
+MACAddressTable::~MACAddressTable()
+{
+    clear();
+}
+
+uint32 MACAddressTable::hash(const MACAddress& address)
+{
+    // vendor part (upper 24 bits) is often shared, so mix all bits
+    uint64 x = address.getInt();
+    x ^= x >> 29;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 32;
+    return (uint32)x;
+}
+
+MACAddressTable::Entry **MACAddressTable::findLink(const MACAddress& address)
+{
+    Entry **link = &buckets[hash(address) & (buckets.size() - 1)];
+    while (*link && (*link)->address != address)
+        link = &(*link)->hashNext;
+    return link;
+}
+
+MACAddressTable::Entry *MACAddressTable::find(const MACAddress& address)
+{
+    return *findLink(address);
+}
+
+void MACAddressTable::unlink(Entry *entry)
+{
+    if (entry->older)
+        entry->older->newer = entry->newer;
+    else
+        oldest = entry->newer;
+    if (entry->newer)
+        entry->newer->older = entry->older;
+    else
+        newest = entry->older;
+}
+
+void MACAddressTable::appendNewest(Entry *entry)
+{
+    ASSERT(!newest || newest->insertionTime <= entry->insertionTime);
+    entry->older = newest;
+    entry->newer = NULL;
+    if (newest)
+        newest->newer = entry;
+    else
+        oldest = entry;
+    newest = entry;
+}
+
+MACAddressTable::Entry *MACAddressTable::add(const MACAddress& address, int portno, simtime_t insertionTime)
+{
+    if (numEntries >= (int)buckets.size())
+        rehash(2 * buckets.size());
+
+    Entry **link = findLink(address);
+    ASSERT(*link == NULL);
+
+    Entry *entry = new Entry();
+    entry->address = address;
+    entry->portno = portno;
+    entry->insertionTime = insertionTime;
+    entry->hashNext = NULL;
+    *link = entry;
+    appendNewest(entry);
+    numEntries++;
+    return entry;
+}
+
+void MACAddressTable::refresh(Entry *entry, int portno, simtime_t insertionTime)
+{
+    entry->portno = portno;
+    entry->insertionTime = insertionTime;
+    if (entry != newest)
+    {
+        unlink(entry);
+        appendNewest(entry);
+    }
+}
+
+void MACAddressTable::remove(Entry *entry)
+{
+    Entry **link = findLink(entry->address);
+    ASSERT(*link == entry);
+    *link = entry->hashNext;
+    unlink(entry);
+    numEntries--;
+    delete entry;
+}
+
+void MACAddressTable::clear()
+{
+    while (oldest)
+    {
+        Entry *entry = oldest;
+        oldest = entry->newer;
+        delete entry;
+    }
+    newest = NULL;
+    numEntries = 0;
+    buckets.assign(INITIAL_NUM_BUCKETS, (Entry *)NULL);
+}
+
+void MACAddressTable::rehash(int numBuckets)
+{
+    buckets.assign(numBuckets, (Entry *)NULL);
+    for (Entry *entry = oldest; entry; entry = entry->newer)
+    {
+        Entry *&bucket = buckets[hash(entry->address) & (numBuckets - 1)];
+        entry->hashNext = bucket;
+        bucket = entry;
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const MACAddressTable& table)
+{
+    os << table.size() << " entries";
+    for (const MACAddressTable::Entry *entry = table.getOldest(); entry; entry = table.getNewer(entry))
+        os << "; " << entry->address << " --> port" << entry->portno << " insTime=" << entry->insertionTime;
+    return os;
+}
+
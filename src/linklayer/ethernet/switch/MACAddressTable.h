@@ -0,0 +1,101 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_MACADDRESSTABLE_H
+#define __INET_MACADDRESSTABLE_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "MACAddress.h"
+
+
+/**
+ * Address lookup table (filtering database) of an Ethernet switch, used
+ * by MACRelayUnitBase. Entries are kept in a chained hash table keyed by
+ * MAC address, and also in a doubly linked list ordered by insertion time
+ * (oldest first). Because the insertion time of an entry is only ever set
+ * to the current simulation time, moving refreshed entries to the end of
+ * the list keeps it sorted, so both the oldest entry and the aged ones
+ * can be found at the front of the list in constant time.
+ */
+class INET_API MACAddressTable
+{
+  public:
+    struct Entry
+    {
+        MACAddress address;
+        int portno;              // Input port
+        simtime_t insertionTime; // Arrival time of Lookup Address Table entry
+
+      private:
+        friend class MACAddressTable;
+        Entry *hashNext;         // next entry in the same hash bucket
+        Entry *older;            // neighbours in the insertion time ordered list
+        Entry *newer;
+    };
+
+  protected:
+    std::vector<Entry *> buckets;  // size is a power of two
+    int numEntries;
+    Entry *oldest;
+    Entry *newest;
+
+  protected:
+    static uint32 hash(const MACAddress& address);
+    Entry **findLink(const MACAddress& address);
+    void unlink(Entry *entry);
+    void appendNewest(Entry *entry);
+    void rehash(int numBuckets);
+
+  private:
+    // not copyable
+    MACAddressTable(const MACAddressTable&);
+    MACAddressTable& operator=(const MACAddressTable&);
+
+  public:
+    MACAddressTable();
+    ~MACAddressTable();
+
+    /** Returns the entry for the given address, or NULL */
+    Entry *find(const MACAddress& address);
+
+    /** Adds a new entry as the newest one; the address must not be in the table */
+    Entry *add(const MACAddress& address, int portno, simtime_t insertionTime);
+
+    /** Updates the entry and makes it the newest one; insertionTime must not be earlier than that of the newest entry */
+    void refresh(Entry *entry, int portno, simtime_t insertionTime);
+
+    /** Removes and deletes the entry */
+    void remove(Entry *entry);
+
+    /** Removes all entries */
+    void clear();
+
+    /** Returns the number of entries */
+    int size() const {return numEntries;}
+
+    /** Returns the entry with the earliest insertion time, or NULL if the table is empty */
+    Entry *getOldest() const {return oldest;}
+
+    /** For iterating over the entries in insertion time order */
+    Entry *getNewer(const Entry *entry) const {return entry->newer;}
+};
+
+std::ostream& operator<<(std::ostream& os, const MACAddressTable& table);
+
+#endif
+
@@ -24,6 +24,10 @@
 
 #define MAX_LINE 100
 
+simsignal_t MACRelayUnitBase::addressLookupPkSignal = SIMSIGNAL_NULL;
+simsignal_t MACRelayUnitBase::addressMissPkSignal = SIMSIGNAL_NULL;
+simsignal_t MACRelayUnitBase::floodedPkSignal = SIMSIGNAL_NULL;
+
 
 /* unused for now
 static std::ostream& operator<< (std::ostream& os, cMessage *msg)
@@ -33,12 +37,6 @@ static std::ostream& operator<< (std::ostream& os, cMessage *msg)
 }
 */
 
-static std::ostream& operator<<(std::ostream& os, const MACRelayUnitBase::AddressEntry& e)
-{
-    os << "port=" << e.portno << " insTime=" << e.insertionTime;
-    return os;
-}
-
 /**
  * Function reads from a file stream pointed to by 'fp' and stores characters
  * until the '\n' or EOF character is found, the resultant string is returned.
@@ -94,7 +92,11 @@ void MACRelayUnitBase::initialize()
 
     seqNum = 0;
 
-    WATCH_MAP(addresstable);
+    addressLookupPkSignal = registerSignal("addressLookupPk");
+    addressMissPkSignal = registerSignal("addressMissPk");
+    floodedPkSignal = registerSignal("floodedPk");
+
+    WATCH(addresstable);
 }
 
 void MACRelayUnitBase::handleAndDispatchFrame(EtherFrame *frame, int inputport)
@@ -112,7 +114,10 @@ void MACRelayUnitBase::handleAndDispatchFrame(EtherFrame *frame, int inputport)
 
     // Finds output port of destination address and sends to output port
     // if not found then broadcasts to all other ports instead
+    emit(addressLookupPkSignal, frame);
     int outputport = getPortForAddress(frame->getDest());
+    if (outputport < 0)
+        emit(addressMissPkSignal, frame);
     // should not send out the same frame on the same ethernet port
     // (although wireless ports are ok to receive the same message)
     if (inputport == outputport)
@@ -130,115 +135,106 @@ void MACRelayUnitBase::handleAndDispatchFrame(EtherFrame *frame, int inputport)
     else
     {
         EV << "Dest address " << frame->getDest() << " unknown, broadcasting frame " << frame << endl;
+        emit(floodedPkSignal, frame);
         broadcastFrame(frame, inputport);
     }
 }
 
 void MACRelayUnitBase::broadcastFrame(EtherFrame *frame, int inputport)
 {
-    for (int i=0; i<numPorts; ++i)
+    // Note: dup() only copies the Ethernet header, the encapsulated packet is
+    // shared by the copies (reference counted by the simulation kernel), and
+    // it only gets duplicated when a receiver decapsulates it. The original
+    // frame goes out on the last port, so we need one copy less.
+    int lastport = (inputport == numPorts-1) ? numPorts-2 : numPorts-1;
+    if (lastport < 0)
+    {
+        delete frame;
+        return;
+    }
+    for (int i=0; i<lastport; ++i)
         if (i != inputport)
             send((EtherFrame*)frame->dup(), "lowerLayerOut", i);
-    delete frame;
+    send(frame, "lowerLayerOut", lastport);
 }
 
 void MACRelayUnitBase::printAddressTable()
 {
-    AddressTable::iterator iter;
     EV << "Address Table (" << addresstable.size() << " entries):\n";
-    for (iter = addresstable.begin(); iter!=addresstable.end(); ++iter)
+    for (AddressEntry *entry = addresstable.getOldest(); entry; entry = addresstable.getNewer(entry))
     {
-        EV << "  " << iter->first << " --> port" << iter->second.portno <<
-              (iter->second.insertionTime+agingTime <= simTime() ? " (aged)" : "") << endl;
+        EV << "  " << entry->address << " --> port" << entry->portno <<
+              (entry->insertionTime+agingTime <= simTime() ? " (aged)" : "") << endl;
     }
 }
 
 void MACRelayUnitBase::removeAgedEntriesFromTable()
 {
-    for (AddressTable::iterator iter = addresstable.begin(); iter != addresstable.end();)
+    // entries are ordered by insertion time, so aged ones are at the front
+    AddressEntry *entry;
+    while ((entry = addresstable.getOldest()) != NULL && entry->insertionTime + agingTime <= simTime())
     {
-        AddressTable::iterator cur = iter++; // iter will get invalidated after erase()
-        AddressEntry& entry = cur->second;
-        if (entry.insertionTime + agingTime <= simTime())
-        {
-            EV << "Removing aged entry from Address Table: " <<
-                  cur->first << " --> port" << cur->second.portno << "\n";
-            addresstable.erase(cur);
-        }
+        EV << "Removing aged entry from Address Table: " <<
+              entry->address << " --> port" << entry->portno << "\n";
+        addresstable.remove(entry);
     }
 }
 
 void MACRelayUnitBase::removeOldestTableEntry()
 {
-    AddressTable::iterator oldest = addresstable.end();
-    simtime_t oldestInsertTime = simTime()+1;
-    for (AddressTable::iterator iter = addresstable.begin(); iter != addresstable.end(); iter++)
-    {
-        if (iter->second.insertionTime < oldestInsertTime)
-        {
-            oldest = iter;
-            oldestInsertTime = iter->second.insertionTime;
-        }
-    }
-    if (oldest != addresstable.end())
+    AddressEntry *oldest = addresstable.getOldest();
+    if (oldest)
     {
         EV << "Table full, removing oldest entry: " <<
-              oldest->first << " --> port" << oldest->second.portno << "\n";
-        addresstable.erase(oldest);
+              oldest->address << " --> port" << oldest->portno << "\n";
+        addresstable.remove(oldest);
     }
 }
 
 void MACRelayUnitBase::updateTableWithAddress(MACAddress& address, int portno)
 {
-    AddressTable::iterator iter;
-
-    iter = addresstable.find(address);
-    if (iter == addresstable.end())
+    AddressEntry *entry = addresstable.find(address);
+    if (!entry)
     {
         // Observe finite table size
-        if (addressTableSize!=0 && addresstable.size() == (unsigned int)addressTableSize)
+        if (addressTableSize!=0 && addresstable.size() == addressTableSize)
         {
             // lazy removal of aged entries: only if table gets full (this step is not strictly needed)
             EV << "Making room in Address Table by throwing out aged entries.\n";
             removeAgedEntriesFromTable();
 
-            if (addresstable.size() == (unsigned int)addressTableSize)
+            if (addresstable.size() == addressTableSize)
                 removeOldestTableEntry();
         }
 
         // Add entry to table
         EV << "Adding entry to Address Table: "<< address << " --> port" << portno << "\n";
-        AddressEntry entry;
-        entry.portno = portno;
-        entry.insertionTime = simTime();
-        addresstable[address] = entry;
+        addresstable.add(address, portno, simTime());
     }
     else
     {
         // Update existing entry
         EV << "Updating entry in Address Table: "<< address << " --> port" << portno << "\n";
-        AddressEntry& entry = iter->second;
-        entry.insertionTime = simTime();
-        entry.portno = portno;
+        addresstable.refresh(entry, portno, simTime());
     }
 }
 
 int MACRelayUnitBase::getPortForAddress(MACAddress& address)
 {
-    AddressTable::iterator iter = addresstable.find(address);
-    if (iter == addresstable.end())
+    AddressEntry *entry = addresstable.find(address);
+    if (!entry)
     {
         // not found
         return -1;
     }
-    if (iter->second.insertionTime + agingTime <= simTime())
+    if (entry->insertionTime + agingTime <= simTime())
     {
         // don't use (and throw out) aged entries
-        EV << "Ignoring and deleting aged entry: "<< iter->first << " --> port" << iter->second.portno << "\n";
-        addresstable.erase(iter);
+        EV << "Ignoring and deleting aged entry: "<< entry->address << " --> port" << entry->portno << "\n";
+        addresstable.remove(entry);
         return -1;
     }
-    return iter->second.portno;
+    return entry->portno;
 }
 
 
@@ -282,12 +278,16 @@ void MACRelayUnitBase::readAddressTable(const char* fileName)
             error("line %d invalid in address table file `%s'", lineno, fileName);
 
         // Create an entry with address and portno and insert into table
-        AddressEntry entry;
-        entry.insertionTime = 0;
-        entry.portno = atoi(portno);
-        if (addresstable.size() >= (unsigned int)addressTableSize)
-            error("Too many entries in address table file '%s'", fileName);
-        addresstable[MACAddress(hexaddress)] = entry;
+        MACAddress address(hexaddress);
+        AddressEntry *entry = addresstable.find(address);
+        if (entry)
+            entry->portno = atoi(portno);
+        else
+        {
+            if (addressTableSize != 0 && addresstable.size() >= addressTableSize)
+                error("Too many entries in address table file '%s'", fileName);
+            addresstable.add(address, atoi(portno), 0);
+        }
 
         // Garbage collection before next iteration
         delete [] line;
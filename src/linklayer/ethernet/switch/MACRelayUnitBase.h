@@ -19,12 +19,12 @@
 #ifndef __INET_MACRELAYUNITBASE_H
 #define __INET_MACRELAYUNITBASE_H
 
-#include <map>
 #include <string>
 
 #include "INETDefs.h"
 
 #include "MACAddress.h"
+#include "MACAddressTable.h"
 
 class EtherFrame;
 
@@ -39,20 +39,10 @@ class INET_API MACRelayUnitBase : public cSimpleModule
 {
   public:
     // An entry of the Address Lookup Table
-    struct AddressEntry
-    {
-        int portno;              // Input port
-        simtime_t insertionTime; // Arrival time of Lookup Address Table entry
-    };
+    typedef MACAddressTable::Entry AddressEntry;
 
   protected:
-    struct MAC_compare
-    {
-        bool operator()(const MACAddress& u1, const MACAddress& u2) const
-            {return u1.compareTo(u2) < 0;}
-    };
-
-    typedef std::map<MACAddress, AddressEntry, MAC_compare> AddressTable;
+    typedef MACAddressTable AddressTable;
 
     // Parameters controlling how the switch operates
     int numPorts;               // Number of ports of the switch
@@ -64,6 +54,10 @@ class INET_API MACRelayUnitBase : public cSimpleModule
     int seqNum;                 // counter for PAUSE frames
     simtime_t *pauseFinished;   // finish time of last PAUSE (array of numPorts element)
 
+    static simsignal_t addressLookupPkSignal;  // frames whose dest address was looked up
+    static simsignal_t addressMissPkSignal;    // frames whose dest address was not in the table
+    static simsignal_t floodedPkSignal;        // frames flooded because of unknown dest address
+
   public:
     MACRelayUnitBase() { pauseFinished = NULL; }
     ~MACRelayUnitBase() { delete [] pauseFinished; }
@@ -23,6 +23,7 @@
 #include "FWMath.h"
 #include "yans-error-rate-model.h"
 #include "nist-error-rate-model.h"
+#include "TabulatedErrorModel.h"
 #define NS3CALMODE
 
 
@@ -66,6 +67,10 @@ void Ieee80211RadioModel::initializeFrom(cModule *radioModule)
     else
         opp_error("Error %s model is not valid",radioModule->par("errorModel").stringValue());
 
+    if (radioModule->par("errorModelTable").boolValue())
+        errorModel = new TabulatedErrorModel(errorModel, radioModule->par("errorModel").stringValue(),
+                radioModule->par("errorModelTableMaxError").doubleValue());
+
 
     btSize = radioModule->par("btSize").longValue();
     autoHeaderSize = radioModule->par("AutoHeaderSize");
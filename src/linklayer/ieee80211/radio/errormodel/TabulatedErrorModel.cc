@@ -0,0 +1,155 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <math.h>
+
+#include "TabulatedErrorModel.h"
+
+
+// below this -L, the error of any realistic chunk is negligible, so it is not checked
+#define NEGLIGIBLE_BIT_ERROR  1e-15
+#define INITIAL_STEP          0.1
+#define MIN_STEP              0.001
+
+const double TabulatedErrorModel::minSnrdB = -10;
+const double TabulatedErrorModel::maxSnrdB = 40;
+
+TabulatedErrorModel::TableMap TabulatedErrorModel::tables;
+
+bool TabulatedErrorModel::TableKey::operator<(const TableKey& other) const
+{
+    if (modelName != other.modelName)
+        return modelName < other.modelName;
+    if (maxError != other.maxError)
+        return maxError < other.maxError;
+    if (modulationClass != other.modulationClass)
+        return modulationClass < other.modulationClass;
+    if (bandwidth != other.bandwidth)
+        return bandwidth < other.bandwidth;
+    if (dataRate != other.dataRate)
+        return dataRate < other.dataRate;
+    if (codeRate != other.codeRate)
+        return codeRate < other.codeRate;
+    return constellationSize < other.constellationSize;
+}
+
+TabulatedErrorModel::TabulatedErrorModel(IErrorModel *model, const char *modelName, double maxError) :
+    model(model), modelName(modelName), maxError(maxError)
+{
+    if (maxError <= 0)
+        throw cRuntimeError("TabulatedErrorModel: maxError must be positive, got %g", maxError);
+}
+
+TabulatedErrorModel::~TabulatedErrorModel()
+{
+    delete model;
+}
+
+double TabulatedErrorModel::computeLogMinusLogSuccessRate(ModulationType mode, double snrdB) const
+{
+    double bitSuccessRate = model->GetChunkSuccessRate(mode, pow(10.0, snrdB / 10), 1);
+    double minusL = -log(bitSuccessRate);
+    // keep the table finite: these limits mean "no error" and "always error" for any chunk
+    if (!(minusL >= 1e-300))
+        minusL = 1e-300;
+    else if (minusL > 800)
+        minusL = 800;
+    return log(minusL);
+}
+
+double TabulatedErrorModel::getMaxInterpolationError(const ModulationType& mode, const Table& table) const
+{
+    double maxRelativeError = 0;
+    for (int i = 0; i < (int)table.values.size() - 1; i++)
+    {
+        double exact = computeLogMinusLogSuccessRate(mode, minSnrdB + (i + 0.5) * table.step);
+        if (exp(exact) < NEGLIGIBLE_BIT_ERROR)
+            continue;
+        double interpolated = (table.values[i] + table.values[i + 1]) / 2;
+        double relativeError = fabs(exp(interpolated - exact) - 1);
+        if (relativeError > maxRelativeError)
+            maxRelativeError = relativeError;
+    }
+    return maxRelativeError;
+}
+
+void TabulatedErrorModel::buildTable(const ModulationType& mode, Table& table) const
+{
+    for (table.step = INITIAL_STEP; ; table.step /= 2)
+    {
+        int size = (int)ceil((maxSnrdB - minSnrdB) / table.step) + 1;
+        table.values.resize(size);
+        for (int i = 0; i < size; i++)
+            table.values[i] = computeLogMinusLogSuccessRate(mode, minSnrdB + i * table.step);
+
+        double error = getMaxInterpolationError(mode, table);
+        if (error <= maxError)
+            break;
+        if (table.step / 2 < MIN_STEP)
+        {
+            EV << "TabulatedErrorModel: cannot reach maxError=" << maxError << ", max relative error is " << error << endl;
+            break;
+        }
+    }
+}
+
+bool TabulatedErrorModel::isSameMode(const ModulationType& a, const ModulationType& b)
+{
+    return a.getModulationClass() == b.getModulationClass() && a.getBandwidth() == b.getBandwidth() &&
+           a.getDataRate() == b.getDataRate() && a.getCodeRate() == b.getCodeRate() &&
+           a.getConstellationSize() == b.getConstellationSize();
+}
+
+const TabulatedErrorModel::Table& TabulatedErrorModel::getTable(const ModulationType& mode) const
+{
+    for (TableCache::const_iterator it = tableCache.begin(); it != tableCache.end(); ++it)
+        if (isSameMode(it->first, mode))
+            return *it->second;
+
+    TableKey key;
+    key.modelName = modelName;
+    key.maxError = maxError;
+    key.modulationClass = mode.getModulationClass();
+    key.bandwidth = mode.getBandwidth();
+    key.dataRate = mode.getDataRate();
+    key.codeRate = mode.getCodeRate();
+    key.constellationSize = mode.getConstellationSize();
+
+    TableMap::iterator it = tables.find(key);
+    if (it == tables.end())
+    {
+        it = tables.insert(std::make_pair(key, Table())).first;
+        buildTable(mode, it->second);
+    }
+    tableCache.push_back(std::make_pair(mode, &it->second));
+    return it->second;
+}
+
+double TabulatedErrorModel::GetChunkSuccessRate(ModulationType mode, double snr, uint32_t nbits) const
+{
+    if (nbits == 0 || !(snr > 0))
+        return model->GetChunkSuccessRate(mode, snr, nbits);
+
+    const Table& table = getTable(mode);
+    double pos = (10 * log10(snr) - minSnrdB) / table.step;
+    if (!(pos >= 0) || pos >= (int)table.values.size() - 1)
+        return model->GetChunkSuccessRate(mode, snr, nbits);
+
+    int i = (int)pos;
+    double f = pos - i;
+    double y = table.values[i] + f * (table.values[i + 1] - table.values[i]);
+    return exp(-(double)nbits * exp(y));
+}
+
@@ -0,0 +1,106 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef TABULATED_ERROR_MODEL_H
+#define TABULATED_ERROR_MODEL_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "WifiMode.h"
+#include "IErrorModel.h"
+
+
+/**
+ * Wraps an analytic error model (Yans, Nist), and answers
+ * GetChunkSuccessRate() from precomputed tables instead of evaluating
+ * the model's formulas on every call.
+ *
+ * All wrapped models compute the chunk success rate as (1-p)^(c*nbits),
+ * where p depends only on the modulation and the SNR; so the per-bit log
+ * success rate L(snr) = log(GetChunkSuccessRate(mode, snr, 1)) determines
+ * the result for any chunk length as exp(nbits*L). For each modulation,
+ * log(-L) is tabulated over SNR in dB, and interpolated linearly. The table
+ * of a modulation is built on first use; its step is halved until the
+ * relative error of -L at the midpoints between table entries is below
+ * maxError. SNR values outside the tabulated range are passed to the
+ * wrapped model.
+ *
+ * Tables are shared by all instances that wrap the same kind of model
+ * with the same maxError, since they only depend on those.
+ */
+class TabulatedErrorModel : public IErrorModel
+{
+  protected:
+    struct Table
+    {
+        double step;                // table step in dB
+        std::vector<double> values; // log(-L) at minSnrdB + i * step
+    };
+
+    struct TableKey
+    {
+        std::string modelName;
+        double maxError;
+        int modulationClass;
+        uint32_t bandwidth;
+        uint32_t dataRate;
+        int codeRate;
+        int constellationSize;
+
+        bool operator<(const TableKey& other) const;
+    };
+
+    typedef std::map<TableKey, Table> TableMap;
+    static TableMap tables;
+
+    IErrorModel *model;     // the wrapped model, owned
+    std::string modelName;
+    double maxError;
+
+    // tables used by this instance, to avoid looking them up in the shared map
+    typedef std::vector<std::pair<ModulationType, const Table *> > TableCache;
+    mutable TableCache tableCache;
+
+  protected:
+    static bool isSameMode(const ModulationType& a, const ModulationType& b);
+    double computeLogMinusLogSuccessRate(ModulationType mode, double snrdB) const;
+    const Table& getTable(const ModulationType& mode) const;
+    void buildTable(const ModulationType& mode, Table& table) const;
+    double getMaxInterpolationError(const ModulationType& mode, const Table& table) const;
+
+  public:
+    static const double minSnrdB;
+    static const double maxSnrdB;
+
+  public:
+    /**
+     * Takes ownership of the model. modelName identifies the model for
+     * sharing the tables, e.g. "NistModel".
+     */
+    TabulatedErrorModel(IErrorModel *model, const char *modelName, double maxError);
+    virtual ~TabulatedErrorModel();
+
+    virtual double GetChunkSuccessRate(ModulationType mode, double snr, uint32_t nbits) const;
+
+    /** Returns the wrapped model */
+    const IErrorModel *getModel() const {return model;}
+};
+
+#endif
+
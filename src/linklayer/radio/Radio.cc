@@ -123,6 +123,10 @@ void Radio::initialize(int stage)
         receptionModel = (IReceptionModel *) createOne(propModel.c_str());
         receptionModel->initializeFrom(this);
 
+        usePathLossCache = par("usePathLossCache").boolValue() && receptionModel->isDeterministic();
+        numPathLossCacheHits = 0;
+        numPathLossCacheMisses = 0;
+
         // radio model to handle frame length and reception success calculation (modulation, error correction etc.)
         std::string rModel = par("radioModel").stdstringValue();
         if (rModel=="")
@@ -173,6 +177,13 @@ void Radio::initialize(int stage)
 
 void Radio::finish()
 {
+    if (usePathLossCache)
+    {
+        long numLookups = numPathLossCacheHits + numPathLossCacheMisses;
+        recordScalar("path loss cache hits", numPathLossCacheHits);
+        recordScalar("path loss cache misses", numPathLossCacheMisses);
+        recordScalar("path loss cache hit rate", numLookups == 0 ? 0.0 : (double)numPathLossCacheHits / numLookups);
+    }
 }
 
 Radio::~Radio()
@@ -544,25 +555,54 @@ void Radio::handleSelfMsg(cMessage *msg)
  * currently being received message (if any) has to be updated as
  * well as the RadioState.
  */
-void Radio::handleLowerMsgStart(AirFrame* airframe)
+double Radio::calculateReceivedPower(AirFrame *airframe)
 {
-    // Calculate the receive power of the message
-
-    // calculate distance
     const Coord& framePos = airframe->getSenderPos();
-    double distance = getRadioPosition().distance(framePos);
-
-    // calculate receive power
     double frequency = carrierFrequency;
     if (airframe && airframe->getCarrierFrequency()>0.0)
         frequency = airframe->getCarrierFrequency();
 
+    // look up the link budget cache first
+    PathLossCacheEntry *cacheEntry = NULL;
+    if (usePathLossCache)
+    {
+        cacheEntry = &pathLossCache[airframe->getSenderModuleId()];
+        // note: exact comparison (Coord::operator== allows some tolerance)
+        const Coord& cachedPos = cacheEntry->senderPos;
+        if (cachedPos.x == framePos.x && cachedPos.y == framePos.y && cachedPos.z == framePos.z
+                && cacheEntry->pSend == airframe->getPSend() && cacheEntry->carrierFrequency == frequency)
+        {
+            numPathLossCacheHits++;
+            return cacheEntry->rcvdPower;
+        }
+        numPathLossCacheMisses++;
+    }
+
+    // calculate distance
+    double distance = getRadioPosition().distance(framePos);
+
+    // calculate receive power
     if (distance<MIN_DISTANCE)
         distance = MIN_DISTANCE;
 
     double rcvdPower = receptionModel->calculateReceivedPower(airframe->getPSend(), frequency, distance);
     if (obstacles && distance > MIN_DISTANCE)
         rcvdPower = obstacles->calculateReceivedPower(rcvdPower, carrierFrequency, framePos, 0, getRadioPosition(), 0);
+
+    if (cacheEntry)
+    {
+        cacheEntry->senderPos = framePos;
+        cacheEntry->pSend = airframe->getPSend();
+        cacheEntry->carrierFrequency = frequency;
+        cacheEntry->rcvdPower = rcvdPower;
+    }
+    return rcvdPower;
+}
+
+void Radio::handleLowerMsgStart(AirFrame* airframe)
+{
+    // Calculate the receive power of the message
+    double rcvdPower = calculateReceivedPower(airframe);
     airframe->setPowRec(rcvdPower);
     // store the receive power in the recvBuff
     recvBuff[airframe] = rcvdPower;
@@ -978,7 +1018,12 @@ double Radio::calcDistFreeSpace()
 void Radio::receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj)
 {
     ChannelAccess::receiveSignal(source,signalID, obj);
-    if (signalID == changeLevelNoise)
+    if (signalID == mobilityStateChangedSignal)
+    {
+        // our position changed: all cached link budgets are stale
+        pathLossCache.clear();
+    }
+    else if (signalID == changeLevelNoise)
     {
         if (BASE_NOISE_LEVEL<sensitivity)
         {
@@ -87,6 +87,9 @@ class INET_API Radio : public ChannelAccess, public IPowerControl
     /** @brief Buffer the frame and update noise levels and snr information */
     virtual void handleLowerMsgStart(AirFrame *airframe);
 
+    /** @brief Calculates the receive power of the frame, using the path loss cache if possible */
+    virtual double calculateReceivedPower(AirFrame *airframe);
+
     /** @brief Unbuffer the frame and update noise levels and snr information */
     virtual void handleLowerMsgEnd(AirFrame *airframe);
 
@@ -174,8 +177,28 @@ class INET_API Radio : public ChannelAccess, public IPowerControl
     long numGivenUp;
     long numReceivedCorrectly;
     double lossRate;
+    long numPathLossCacheHits;
+    long numPathLossCacheMisses;
     //@}
 
+    /**
+     * Link budget cache: the receive power of the last frame from a given
+     * sender radio, together with the inputs it was calculated from. An entry
+     * is reused as long as the sender's position, transmit power and carrier
+     * frequency are the same; the whole cache is dropped when this radio moves.
+     * Only used if the reception model is deterministic.
+     */
+    struct PathLossCacheEntry
+    {
+        Coord senderPos;
+        double pSend;
+        double carrierFrequency;
+        double rcvdPower;
+    };
+    typedef std::map<int, PathLossCacheEntry> PathLossCache; // keyed by sender module id
+    PathLossCache pathLossCache;
+    bool usePathLossCache;
+
     /** Power used to transmit messages */
     double transmitterPower;
 
@@ -57,6 +57,9 @@ public:
      * To be redefined to calculate the received power of a transmission.
      */
     virtual double calculateReceivedPower(double pSend, double carrierFrequency, double distance);
+
+    /** Returns true: the received power only depends on the arguments */
+    virtual bool isDeterministic() const { return true; }
     ~FreeSpaceModel() { };
 
     protected:
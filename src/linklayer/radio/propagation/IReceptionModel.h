@@ -40,6 +40,12 @@ class INET_API IReceptionModel : public cObject
      */
     virtual double calculateReceivedPower(double pSend, double carrierFrequency, double distance) = 0;
 
+    /**
+     * Should return true if calculateReceivedPower() always returns the same
+     * value for the same arguments, i.e. results may be cached.
+     */
+    virtual bool isDeterministic() const { return false; }
+
     /**
      * Virtual destructor.
      */
@@ -37,6 +37,9 @@ class INET_API LogNormalShadowingModel : public FreeSpaceModel {
      */
     virtual double calculateReceivedPower(double pSend, double carrierFrequency, double distance);
 
+    /** Returns false: the received power is a random variate */
+    virtual bool isDeterministic() const { return false; }
+
     private:
     double sigma;
 
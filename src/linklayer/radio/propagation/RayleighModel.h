@@ -53,6 +53,9 @@ public:
      */
     virtual double calculateReceivedPower(double pSend, double carrierFrequency, double distance);
 
+    /** Returns false: the received power is a random variate */
+    virtual bool isDeterministic() const { return false; }
+
 };
 
 #endif /* __RAYLEIGH_H__ */
@@ -51,6 +51,9 @@ class INET_API RiceModel : public FreeSpaceModel {
      * To be redefined to calculate the received power of a transmission.
      */
     virtual double calculateReceivedPower(double pSend, double carrierFrequency, double distance);
+
+    /** Returns false: the received power is a random variate */
+    virtual bool isDeterministic() const { return false; }
     private:
     /** @brief  Ricean K Factor */
     double K;
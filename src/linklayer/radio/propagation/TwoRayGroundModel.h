@@ -35,6 +35,9 @@ class INET_API TwoRayGroundModel : public FreeSpaceModel {
      */
     virtual double calculateReceivedPower(double pSend, double carrierFrequency, double distance);
 
+    /** Returns true: the received power only depends on the arguments */
+    virtual bool isDeterministic() const { return true; }
+
     private:
     double ht, hr;
 };
@@ -41,7 +41,7 @@ static std::ostream& operator<<(std::ostream& out, cMessage *msg)
     return out;
 }
 
-static std::ostream& operator<<(std::ostream& out, const ARP::ARPCacheEntry& e)
+static std::ostream& operator<<(std::ostream& out, const ARPCacheEntry& e)
 {
     if (e.pending)
         out << "pending (" << e.numRetries << " retries)";
@@ -50,7 +50,19 @@ static std::ostream& operator<<(std::ostream& out, const ARP::ARPCacheEntry& e)
     return out;
 }
 
-ARP::ARPCache ARP::globalArpCache;
+static std::ostream& operator<<(std::ostream& out, const ARPCache& cache)
+{
+    out << cache.size() << " entries";
+    for (int i = 0; i < cache.getCapacity(); i++)
+    {
+        ARPCacheEntry *e = cache.getEntry(i);
+        if (e)
+            out << "; " << e->ipAddress << (e->ie ? " on " : "") << (e->ie ? e->ie->getName() : "") << ": " << *e;
+    }
+    return out;
+}
+
+ARPCache ARP::globalArpCache;
 int ARP::globalArpCacheRefCnt = 0;
 
 Define_Module(ARP);
@@ -65,6 +77,9 @@ ARP::ARP()
 
     ift = NULL;
     rt = NULL;
+    freePacket = -1;
+    numPendingPackets = 0;
+    timerMsg = NULL;
 }
 
 void ARP::initialize(int stage)
@@ -90,7 +105,7 @@ void ARP::initialize(int stage)
         doProxyARP = par("proxyARP");
         globalARP = par("globalARP");
 
-        pendingQueue.setName("pendingQueue");
+        timerMsg = new cMessage("ARP timer");
 
         // init statistics
         numRequestsSent = numRepliesSent = 0;
@@ -99,9 +114,10 @@ void ARP::initialize(int stage)
         WATCH(numRepliesSent);
         WATCH(numResolutions);
         WATCH(numFailedResolutions);
+        WATCH(numPendingPackets);
 
-        WATCH_PTRMAP(arpCache);
-        WATCH_PTRMAP(globalArpCache);
+        WATCH(arpCache);
+        WATCH(globalArpCache);
 
         // initialize global cache
         for (int i=0; i<ift->getNumInterfaces(); i++)
@@ -109,15 +125,15 @@ void ARP::initialize(int stage)
             InterfaceEntry *ie = ift->getInterface(i);
             if (ie->isLoopback())
                 continue;
+            IPv4Address nextHopAddr = ie->ipv4Data()->getIPAddress();
+            if (globalArpCache.find(nextHopAddr, ARPCache::ANY_INTERFACE))
+                continue;  // the first interface with the address wins
             ARPCacheEntry *entry = new ARPCacheEntry();
+            entry->ipAddress = nextHopAddr;
+            entry->interfaceId = ARPCache::ANY_INTERFACE;
             entry->ie = ie;
-            entry->pending = false;
-            entry->timer = NULL;
-            entry->numRetries = 0;
             entry->macAddress = ie->getMacAddress();
-            IPv4Address nextHopAddr = ie->ipv4Data()->getIPAddress();
-            ARPCache::iterator where = globalArpCache.insert(globalArpCache.begin(), std::make_pair(nextHopAddr, entry));
-            entry->myIter = where; // note: "inserting a new element into a map does not invalidate iterators that point to existing elements"
+            globalArpCache.insert(entry);
         }
     }
 }
@@ -128,29 +144,22 @@ void ARP::finish()
 
 ARP::~ARP()
 {
-    while (!arpCache.empty())
-    {
-        ARPCache::iterator i = arpCache.begin();
-        delete (*i).second;
-        arpCache.erase(i);
-    }
+    cancelAndDelete(timerMsg);
+    for (unsigned int i = 0; i < packetPool.size(); i++)
+        delete packetPool[i].msg;
+    arpCache.clear();
 
     if (--globalArpCacheRefCnt != 0)
         return;
 
-    while (!globalArpCache.empty())
-    {
-        ARPCache::iterator i = globalArpCache.begin();
-        delete (*i).second;
-        globalArpCache.erase(i);
-    }
+    globalArpCache.clear();
 }
 
 void ARP::handleMessage(cMessage *msg)
 {
-    if (msg->isSelfMessage())
+    if (msg == timerMsg)
     {
-        requestTimedOut(msg);
+        processTimers();
     }
     else if (dynamic_cast<ARPPacket *>(msg))
     {
@@ -169,7 +178,7 @@ void ARP::updateDisplayString()
 {
     std::stringstream os;
 
-    os << arpCache.size() << " cache entries\nsent req:" << numRequestsSent
+    os << arpCache.size() << " cache entries, " << numPendingPackets << " queued\nsent req:" << numRequestsSent
             << " repl:" << numRepliesSent << " fail:" << numFailedResolutions;
 
     getDisplayString().setTagArg("t", 0, os.str().c_str());
@@ -224,56 +233,47 @@ void ARP::processOutboundPacket(cMessage *msg)
 
     if (globalARP)
     {
-        ARPCache::iterator it = globalArpCache.find(nextHopAddr);
-        if (it==globalArpCache.end())
+        ARPCacheEntry *entry = globalArpCache.find(nextHopAddr, ARPCache::ANY_INTERFACE);
+        if (!entry)
             throw cRuntimeError("Address not found in global ARP cache: %s", nextHopAddr.str().c_str());
-        sendPacketToNIC(msg, ie, (*it).second->macAddress, ETHERTYPE_IPv4);
+        sendPacketToNIC(msg, ie, entry->macAddress, ETHERTYPE_IPv4);
         return;
     }
 
     // try look up
-    ARPCache::iterator it = arpCache.find(nextHopAddr);
-    //ASSERT(it==arpCache.end() || ie==(*it).second->ie); // verify: if arpCache gets keyed on InterfaceEntry* too, this becomes unnecessary
-    if (it==arpCache.end())
+    ARPCacheEntry *entry = arpCache.find(nextHopAddr, ie->getInterfaceId());
+    if (!entry)
     {
         // no cache entry: launch ARP request
-        ARPCacheEntry *entry = new ARPCacheEntry();
-        ARPCache::iterator where = arpCache.insert(arpCache.begin(), std::make_pair(nextHopAddr, entry));
-        entry->myIter = where; // note: "inserting a new element into a map does not invalidate iterators that point to existing elements"
-        entry->ie = ie;
+        entry = createCacheEntry(nextHopAddr, ie);
 
         EV << "Starting ARP resolution for " << nextHopAddr << "\n";
         initiateARPResolution(entry);
 
         // and queue up packet
-        entry->pendingPackets.push_back(msg);
-        pendingQueue.insert(msg);
+        addPendingPacket(entry, msg);
     }
-    else if ((*it).second->pending)
+    else if (entry->pending)
     {
         // an ARP request is already pending for this address -- just queue up packet
         EV << "ARP resolution for " << nextHopAddr << " is pending, queueing up packet\n";
-        (*it).second->pendingPackets.push_back(msg);
-        pendingQueue.insert(msg);
+        addPendingPacket(entry, msg);
     }
-    else if ((*it).second->lastUpdate+cacheTimeout<simTime())
+    else if (entry->lastUpdate+cacheTimeout<simTime())
     {
         EV << "ARP cache entry for " << nextHopAddr << " expired, starting new ARP resolution\n";
 
         // cache entry stale, send new ARP request
-        ARPCacheEntry *entry = (*it).second;
-        entry->ie = ie; // routing table may have changed
         initiateARPResolution(entry);
 
         // and queue up packet
-        entry->pendingPackets.push_back(msg);
-        pendingQueue.insert(msg);
+        addPendingPacket(entry, msg);
     }
     else
     {
         // valid ARP cache entry found, flag msg with MAC address and send it out
-        EV << "ARP cache hit, MAC address for " << nextHopAddr << " is " << (*it).second->macAddress << ", sending packet down\n";
-        sendPacketToNIC(msg, ie, (*it).second->macAddress, ETHERTYPE_IPv4);
+        EV << "ARP cache hit, MAC address for " << nextHopAddr << " is " << entry->macAddress << ", sending packet down\n";
+        sendPacketToNIC(msg, ie, entry->macAddress, ETHERTYPE_IPv4);
     }
 }
 
@@ -294,16 +294,14 @@ MACAddress ARP::mapMulticastAddress(IPv4Address addr)
 
 void ARP::initiateARPResolution(ARPCacheEntry *entry)
 {
-    IPv4Address nextHopAddr = entry->myIter->first;
+    stopTimer(entry);
     entry->pending = true;
     entry->numRetries = 0;
     entry->lastUpdate = 0;
-    sendARPRequest(entry->ie, nextHopAddr);
+    sendARPRequest(entry->ie, entry->ipAddress);
 
     // start timer
-    cMessage *msg = entry->timer = new cMessage("ARP timeout");
-    msg->setContextPointer(entry);
-    scheduleAt(simTime()+retryTimeout, msg);
+    startTimer(entry, simTime()+retryTimeout);
 
     numResolutions++;
     emit(initiatedResolutionSignal, 1L);
@@ -345,41 +343,149 @@ void ARP::sendARPRequest(InterfaceEntry *ie, IPv4Address ipAddress)
     emit(sentReqSignal, 1L);
 }
 
-void ARP::requestTimedOut(cMessage *selfmsg)
+void ARP::requestTimedOut(ARPCacheEntry *entry)
 {
-    ARPCacheEntry *entry = (ARPCacheEntry *)selfmsg->getContextPointer();
     entry->numRetries++;
     if (entry->numRetries < retryCount)
     {
         // retry
-        IPv4Address nextHopAddr = entry->myIter->first;
-        EV << "ARP request for " << nextHopAddr << " timed out, resending\n";
-        sendARPRequest(entry->ie, nextHopAddr);
-        scheduleAt(simTime()+retryTimeout, selfmsg);
+        EV << "ARP request for " << entry->ipAddress << " timed out, resending\n";
+        sendARPRequest(entry->ie, entry->ipAddress);
+        startTimer(entry, simTime()+retryTimeout);
         return;
     }
 
     // max retry count reached: ARP failure.
     // throw out entry from cache, delete pending messages
-    MsgPtrVector& pendingPackets = entry->pendingPackets;
-    EV << "ARP timeout, max retry count " << retryCount << " for "
-       << entry->myIter->first << " reached. Dropping " << pendingPackets.size()
-       << " waiting packets from the queue\n";
-    while (!pendingPackets.empty())
+    int numDropped = 0;
+    while (cMessage *msg = removePendingPacket(entry))
     {
-        MsgPtrVector::iterator i = pendingPackets.begin();
-        cMessage *msg = (*i);
-        pendingPackets.erase(i);
-        pendingQueue.remove(msg);
         delete msg;
+        numDropped++;
     }
-    delete selfmsg;
-    arpCache.erase(entry->myIter);
-    delete entry;
+    EV << "ARP timeout, max retry count " << retryCount << " for "
+       << entry->ipAddress << " reached. Dropped " << numDropped
+       << " waiting packets from the queue\n";
+    deleteCacheEntry(entry);
     numFailedResolutions++;
     emit(failedResolutionSignal, 1L);
 }
 
+ARPCacheEntry *ARP::createCacheEntry(IPv4Address ipAddress, InterfaceEntry *ie)
+{
+    ARPCacheEntry *entry = new ARPCacheEntry();
+    entry->ipAddress = ipAddress;
+    entry->interfaceId = ie->getInterfaceId();
+    entry->ie = ie;
+    arpCache.insert(entry);
+    return entry;
+}
+
+void ARP::deleteCacheEntry(ARPCacheEntry *entry)
+{
+    ASSERT(entry->firstPacket == -1);
+    stopTimer(entry);
+    arpCache.remove(entry);
+    delete entry;
+}
+
+void ARP::addPendingPacket(ARPCacheEntry *entry, cMessage *msg)
+{
+    int i = freePacket;
+    if (i == -1)
+    {
+        i = packetPool.size();
+        packetPool.push_back(PendingPacket());
+    }
+    else
+        freePacket = packetPool[i].next;
+
+    packetPool[i].msg = msg;
+    packetPool[i].next = -1;
+    if (entry->lastPacket == -1)
+        entry->firstPacket = i;
+    else
+        packetPool[entry->lastPacket].next = i;
+    entry->lastPacket = i;
+    numPendingPackets++;
+}
+
+cMessage *ARP::removePendingPacket(ARPCacheEntry *entry)
+{
+    int i = entry->firstPacket;
+    if (i == -1)
+        return NULL;
+
+    cMessage *msg = packetPool[i].msg;
+    entry->firstPacket = packetPool[i].next;
+    if (entry->firstPacket == -1)
+        entry->lastPacket = -1;
+    packetPool[i].msg = NULL;
+    packetPool[i].next = freePacket;
+    freePacket = i;
+    numPendingPackets--;
+    return msg;
+}
+
+void ARP::startTimer(ARPCacheEntry *entry, simtime_t timeout)
+{
+    stopTimer(entry);
+
+    ASSERT(retryTimers.tail == NULL || retryTimers.tail->timeout <= timeout);
+    entry->timeout = timeout;
+    entry->prevTimer = retryTimers.tail;
+    entry->nextTimer = NULL;
+    if (retryTimers.tail)
+        retryTimers.tail->nextTimer = entry;
+    else
+        retryTimers.head = entry;
+    retryTimers.tail = entry;
+    entry->timerRunning = true;
+    rescheduleTimer();
+}
+
+void ARP::stopTimer(ARPCacheEntry *entry)
+{
+    if (!entry->timerRunning)
+        return;
+
+    if (entry->prevTimer)
+        entry->prevTimer->nextTimer = entry->nextTimer;
+    else
+        retryTimers.head = entry->nextTimer;
+    if (entry->nextTimer)
+        entry->nextTimer->prevTimer = entry->prevTimer;
+    else
+        retryTimers.tail = entry->prevTimer;
+    entry->prevTimer = entry->nextTimer = NULL;
+    entry->timerRunning = false;
+    rescheduleTimer();
+}
+
+void ARP::rescheduleTimer()
+{
+    // timerMsg is not left scheduled for a stopped timer, so that it
+    // causes no more events than the per-entry timers it replaces
+    if (!retryTimers.head)
+        cancelEvent(timerMsg);
+    else if (!timerMsg->isScheduled() || timerMsg->getArrivalTime() != retryTimers.head->timeout)
+    {
+        cancelEvent(timerMsg);
+        scheduleAt(retryTimers.head->timeout, timerMsg);
+    }
+}
+
+void ARP::processTimers()
+{
+    simtime_t now = simTime();
+    while (retryTimers.head && retryTimers.head->timeout <= now)
+    {
+        ARPCacheEntry *entry = retryTimers.head;
+        stopTimer(entry);
+        requestTimedOut(entry);
+    }
+}
+
 
 bool ARP::addressRecognized(IPv4Address destAddr, InterfaceEntry *ie)
 {
@@ -450,11 +556,10 @@ void ARP::processARPPacket(ARPPacket *arp)
 
     bool mergeFlag = false;
     // "If ... sender protocol address is already in my translation table"
-    ARPCache::iterator it = arpCache.find(srcIPAddress);
-    if (it!=arpCache.end())
+    ARPCacheEntry *entry = arpCache.find(srcIPAddress, ie->getInterfaceId());
+    if (entry)
     {
         // "update the sender hardware address field"
-        ARPCacheEntry *entry = (*it).second;
         updateARPCache(entry, srcMACAddress);
         mergeFlag = true;
     }
@@ -467,22 +572,7 @@ void ARP::processARPPacket(ARPPacket *arp)
         // protocol address, sender hardware address to the translation table"
         if (!mergeFlag)
         {
-            ARPCacheEntry *entry;
-            if (it!=arpCache.end())
-            {
-                entry = (*it).second;
-            }
-            else
-            {
-                entry = new ARPCacheEntry();
-                ARPCache::iterator where = arpCache.insert(arpCache.begin(), std::make_pair(srcIPAddress, entry));
-                entry->myIter = where;
-                entry->ie = ie;
-
-                entry->pending = false;
-                entry->timer = NULL;
-                entry->numRetries = 0;
-            }
+            entry = createCacheEntry(srcIPAddress, ie);
             updateARPCache(entry, srcMACAddress);
         }
 
@@ -532,27 +622,21 @@ void ARP::processARPPacket(ARPPacket *arp)
 
 void ARP::updateARPCache(ARPCacheEntry *entry, const MACAddress& macAddress)
 {
-    EV << "Updating ARP cache entry: " << entry->myIter->first << " <--> " << macAddress << "\n";
+    EV << "Updating ARP cache entry: " << entry->ipAddress << " <--> " << macAddress << "\n";
 
-    // update entry
+    // update entry; it expires on the first lookup after cacheTimeout
+    stopTimer(entry);
     if (entry->pending)
     {
         entry->pending = false;
-        delete cancelEvent(entry->timer);
-        entry->timer = NULL;
         entry->numRetries = 0;
     }
     entry->macAddress = macAddress;
     entry->lastUpdate = simTime();
 
     // process queued packets
-    MsgPtrVector& pendingPackets = entry->pendingPackets;
-    while (!pendingPackets.empty())
+    while (cMessage *msg = removePendingPacket(entry))
     {
-        MsgPtrVector::iterator i = pendingPackets.begin();
-        cMessage *msg = (*i);
-        pendingPackets.erase(i);
-        pendingQueue.remove(msg);
         EV << "Sending out queued packet " << msg << "\n";
         sendPacketToNIC(msg, entry->ie, macAddress, ETHERTYPE_IPv4);
     }
@@ -560,19 +644,22 @@ void ARP::updateARPCache(ARPCacheEntry *entry, const MACAddress& macAddress)
 
 const MACAddress ARP::getDirectAddressResolution(const IPv4Address & add) const
 {
-    ARPCache::const_iterator it;
     MACAddress address = MACAddress::UNSPECIFIED_ADDRESS;
     if (globalARP)
     {
-        it = globalArpCache.find(add);
-        if (it!=globalArpCache.end())
-            address = (*it).second->macAddress;
+        ARPCacheEntry *entry = globalArpCache.find(add, ARPCache::ANY_INTERFACE);
+        if (entry)
+            address = entry->macAddress;
     }
     else
     {
-        it = arpCache.find(add);
-        if (it!=arpCache.end())
-            address = (*it).second->macAddress;
+        // the cache is keyed by interface too: try each
+        for (int i=0; i<ift->getNumInterfaces(); i++)
+        {
+            ARPCacheEntry *entry = arpCache.find(add, ift->getInterface(i)->getInterfaceId());
+            if (entry)
+                return entry->macAddress;
+        }
     }
     return address;
 }
@@ -580,24 +667,15 @@ const MACAddress ARP::getDirectAddressResolution(const IPv4Address & add) const
 const IPv4Address ARP::getInverseAddressResolution(const MACAddress &add) const
 {
     IPv4Address address;
-    ARPCache::const_iterator it;
-    if (globalARP)
+    const ARPCache& cache = globalARP ? globalArpCache : arpCache;
+    for (int i = 0; i < cache.getCapacity(); i++)
     {
-        for (it = globalArpCache.begin(); it!=globalArpCache.end(); it++)
-            if ((*it).second->macAddress==add)
-            {
-                address = (*it).first;
-                return address;
-            }
-    }
-    else
-    {
-        for (it = arpCache.begin(); it!=arpCache.end(); it++)
-            if ((*it).second->macAddress==add)
-            {
-                address = (*it).first;
-                return address;
-            }
+        ARPCacheEntry *entry = cache.getEntry(i);
+        if (entry && entry->macAddress==add)
+        {
+            address = entry->ipAddress;
+            return address;
+        }
     }
     return address;
 }
@@ -605,20 +683,19 @@ const IPv4Address ARP::getInverseAddressResolution(const MACAddress &add) const
 void ARP::setChangeAddress(const IPv4Address &oldAddress)
 {
     Enter_Method_Silent();
-    ARPCache::iterator it;
     if (globalARP)
     {
-        it = globalArpCache.find(oldAddress);
-        if (it!=globalArpCache.end())
+        ARPCacheEntry *entry = globalArpCache.find(oldAddress, ARPCache::ANY_INTERFACE);
+        if (entry)
         {
-            ARPCacheEntry *entry = (*it).second;
-            globalArpCache.erase(it);
+            globalArpCache.remove(entry);
             entry->pending = false;
-            entry->timer = NULL;
             entry->numRetries = 0;
-            IPv4Address nextHopAddr = entry->ie->ipv4Data()->getIPAddress();
-            ARPCache::iterator where = globalArpCache.insert(globalArpCache.begin(), std::make_pair(nextHopAddr, entry));
-            entry->myIter = where; // note: "inserting a new element into a map does not invalidate iterators that point to existing elements"
+            entry->ipAddress = entry->ie->ipv4Data()->getIPAddress();
+            if (globalArpCache.find(entry->ipAddress, ARPCache::ANY_INTERFACE))
+                delete entry;  // the address is already known
+            else
+                globalArpCache.insert(entry);
         }
     }
 }
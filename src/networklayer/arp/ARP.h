@@ -18,16 +18,14 @@
 #ifndef __INET_ARP_H
 #define __INET_ARP_H
 
-//#include <stdio.h>
-//#include <string.h>
-//#include <vector>
-#include <map>
+#include <vector>
 
 #include "INETDefs.h"
 
 #include "MACAddress.h"
 #include "ModuleAccess.h"
 #include "IPv4Address.h"
+#include "ARPCache.h"
 
 // Forward declarations:
 class ARPPacket;
@@ -40,24 +38,20 @@ class IRoutingTable;
  */
 class INET_API ARP : public cSimpleModule
 {
-  public:
-    struct ARPCacheEntry;
-    typedef std::map<IPv4Address, ARPCacheEntry*> ARPCache;
-    typedef std::vector<cMessage*> MsgPtrVector;
+  protected:
+    // a packet waiting for ARP resolution, in the list of its cache entry
+    struct PendingPacket
+    {
+        cMessage *msg;  // NULL if the element is free
+        int next;       // next element of the list, or -1
+    };
 
-    // IPv4Address -> MACAddress table
-    // TBD should we key it on (IPv4Address, InterfaceEntry*)?
-    struct ARPCacheEntry
+    // pending entries with a running retry timer, ordered by timeout
+    struct TimerList
     {
-        InterfaceEntry *ie; // NIC to send the packet to
-        bool pending; // true if resolution is pending
-        MACAddress macAddress;  // MAC address
-        simtime_t lastUpdate;  // entries should time out after cacheTimeout
-        int numRetries; // if pending==true: 0 after first ARP request, 1 after second, etc.
-        cMessage *timer;  // if pending==true: request timeout msg
-        MsgPtrVector pendingPackets;  // if pending==true: ptrs to packets waiting for resolution
-                                      // (packets are owned by pendingQueue)
-        ARPCache::iterator myIter;  // iterator pointing to this entry
+        ARPCacheEntry *head;
+        ARPCacheEntry *tail;
+        TimerList() : head(NULL), tail(NULL) {}
     };
 
   protected:
@@ -81,7 +75,20 @@ class INET_API ARP : public cSimpleModule
     static ARPCache globalArpCache;
     static int globalArpCacheRefCnt;
 
-    cQueue pendingQueue; // outbound packets waiting for ARP resolution
+    // outbound packets waiting for ARP resolution; free elements are
+    // chained from freePacket
+    std::vector<PendingPacket> packetPool;
+    int freePacket;
+    int numPendingPackets;
+
+    // A single self-message drives the retry timers of pending entries,
+    // scheduled for the earliest of them. As retryTimeout is the same for
+    // all entries, a timer started later also expires later, so appending
+    // keeps the list ordered. Resolved entries have no timer: they expire
+    // on the first lookup after cacheTimeout.
+    TimerList retryTimers;
+    cMessage *timerMsg;
+
     int nicOutBaseGateId;  // id of the nicOut[0] gate
 
     IInterfaceTable *ift;
@@ -108,11 +115,22 @@ class INET_API ARP : public cSimpleModule
 
     virtual void initiateARPResolution(ARPCacheEntry *entry);
     virtual void sendARPRequest(InterfaceEntry *ie, IPv4Address ipAddress);
-    virtual void requestTimedOut(cMessage *selfmsg);
+    virtual void requestTimedOut(ARPCacheEntry *entry);
     virtual bool addressRecognized(IPv4Address destAddr, InterfaceEntry *ie);
     virtual void processARPPacket(ARPPacket *arp);
     virtual void updateARPCache(ARPCacheEntry *entry, const MACAddress& macAddress);
 
+    virtual ARPCacheEntry *createCacheEntry(IPv4Address ipAddress, InterfaceEntry *ie);
+    virtual void deleteCacheEntry(ARPCacheEntry *entry);
+
+    virtual void addPendingPacket(ARPCacheEntry *entry, cMessage *msg);
+    virtual cMessage *removePendingPacket(ARPCacheEntry *entry);
+
+    virtual void startTimer(ARPCacheEntry *entry, simtime_t timeout);
+    virtual void stopTimer(ARPCacheEntry *entry);
+    virtual void rescheduleTimer();
+    virtual void processTimers();
+
     virtual void dumpARPPacket(ARPPacket *arp);
     virtual void updateDisplayString();
 
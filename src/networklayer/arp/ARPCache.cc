@@ -0,0 +1,99 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "ARPCache.h"
+
+
+#define INITIAL_SIZE  16
+
+unsigned int ARPCache::hash(IPv4Address ipAddress, int interfaceId)
+{
+    // addresses of a subnet differ in the low bits; the multiplication spreads them
+    uint32 h = ipAddress.getInt() ^ ((uint32)interfaceId * 0x9e3779b9u);
+    h *= 0x85ebca6bu;
+    return h ^ (h >> 16);
+}
+
+int ARPCache::findSlot(IPv4Address ipAddress, int interfaceId) const
+{
+    unsigned int mask = slots.size() - 1;
+    unsigned int i = hash(ipAddress, interfaceId) & mask;
+    while (slots[i] != NULL && (slots[i]->ipAddress != ipAddress || slots[i]->interfaceId != interfaceId))
+        i = (i + 1) & mask;
+    return i;
+}
+
+void ARPCache::resize(unsigned int newSize)
+{
+    std::vector<ARPCacheEntry*> oldSlots(newSize, (ARPCacheEntry*)NULL);
+    slots.swap(oldSlots);
+    for (unsigned int i = 0; i < oldSlots.size(); i++)
+        if (oldSlots[i] != NULL)
+            slots[findSlot(oldSlots[i]->ipAddress, oldSlots[i]->interfaceId)] = oldSlots[i];
+}
+
+ARPCacheEntry *ARPCache::find(IPv4Address ipAddress, int interfaceId) const
+{
+    if (count == 0)
+        return NULL;
+    return slots[findSlot(ipAddress, interfaceId)];
+}
+
+void ARPCache::insert(ARPCacheEntry *entry)
+{
+    // keep the load factor at or below 1/2
+    if (2 * (count + 1) > (int)slots.size())
+        resize(slots.empty() ? INITIAL_SIZE : 2 * slots.size());
+
+    int i = findSlot(entry->ipAddress, entry->interfaceId);
+    if (slots[i] != NULL)
+        throw cRuntimeError("ARPCache: duplicate entry for %s", entry->ipAddress.str().c_str());
+    slots[i] = entry;
+    count++;
+}
+
+void ARPCache::remove(ARPCacheEntry *entry)
+{
+    unsigned int mask = slots.size() - 1;
+    unsigned int i = findSlot(entry->ipAddress, entry->interfaceId);
+    if (slots[i] != entry)
+        throw cRuntimeError("ARPCache: entry for %s not found", entry->ipAddress.str().c_str());
+    slots[i] = NULL;
+    count--;
+
+    // backward shift deletion: move up the following entries of the probe
+    // sequence which would not be found across the hole otherwise
+    unsigned int hole = i;
+    for (unsigned int j = (i + 1) & mask; slots[j] != NULL; j = (j + 1) & mask)
+    {
+        unsigned int home = hash(slots[j]->ipAddress, slots[j]->interfaceId) & mask;
+        // move if home is cyclically outside (hole, j]
+        if (((j - home) & mask) >= ((j - hole) & mask))
+        {
+            slots[hole] = slots[j];
+            slots[j] = NULL;
+            hole = j;
+        }
+    }
+}
+
+void ARPCache::clear()
+{
+    for (unsigned int i = 0; i < slots.size(); i++)
+        delete slots[i];
+    slots.clear();
+    count = 0;
+}
+
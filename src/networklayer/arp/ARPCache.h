@@ -0,0 +1,108 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_ARPCACHE_H
+#define __INET_ARPCACHE_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "MACAddress.h"
+#include "IPv4Address.h"
+
+class InterfaceEntry;
+
+/**
+ * An entry of the ARP cache: IPv4 address on an interface -> MAC address.
+ */
+struct ARPCacheEntry
+{
+    IPv4Address ipAddress;  // key, together with interfaceId
+    int interfaceId;        // interface id, or ARPCache::ANY_INTERFACE
+    InterfaceEntry *ie;     // NIC to send the packet to
+    bool pending;           // true if resolution is pending
+    MACAddress macAddress;  // MAC address
+    simtime_t lastUpdate;   // entries time out cacheTimeout after this
+    int numRetries;         // if pending==true: 0 after first ARP request, 1 after second, etc.
+
+    // retry timer of a pending entry; entries with a running timer are
+    // linked into the timer list of ARP
+    simtime_t timeout;
+    ARPCacheEntry *prevTimer;
+    ARPCacheEntry *nextTimer;
+    bool timerRunning;
+
+    // if pending==true: packets waiting for resolution, as a list in the
+    // packet pool of ARP; -1 if there are none
+    int firstPacket;
+    int lastPacket;
+
+    ARPCacheEntry() : interfaceId(-1), ie(NULL), pending(false), numRetries(0),
+        prevTimer(NULL), nextTimer(NULL), timerRunning(false), firstPacket(-1), lastPacket(-1) {}
+};
+
+/**
+ * Hash table of ARP cache entries keyed by (IPv4 address, interface id),
+ * with open addressing and linear probing. The table owns the entries.
+ * It replaces a std::map<IPv4Address, ARPCacheEntry*>, which was keyed on
+ * the address only.
+ */
+class INET_API ARPCache
+{
+  public:
+    /** Interface id of the entries of the global ARP cache */
+    static const int ANY_INTERFACE = -1;
+
+  protected:
+    std::vector<ARPCacheEntry*> slots;  // size is a power of two (or zero); NULL is empty
+    int count;
+
+  protected:
+    static unsigned int hash(IPv4Address ipAddress, int interfaceId);
+    // slot of the entry with the given key, or of the empty slot where it would go
+    int findSlot(IPv4Address ipAddress, int interfaceId) const;
+    void resize(unsigned int newSize);
+
+  private:
+    ARPCache(const ARPCache&);
+    ARPCache& operator=(const ARPCache&);
+
+  public:
+    ARPCache() : count(0) {}
+    ~ARPCache() {clear();}
+
+    /** Returns the entry for the address on the interface, or NULL */
+    ARPCacheEntry *find(IPv4Address ipAddress, int interfaceId) const;
+
+    /** Inserts the entry; its ipAddress and interfaceId must be set and not yet present */
+    void insert(ARPCacheEntry *entry);
+
+    /** Removes the entry without deleting it */
+    void remove(ARPCacheEntry *entry);
+
+    /** Removes and deletes all entries */
+    void clear();
+
+    int size() const {return count;}
+    bool empty() const {return count == 0;}
+
+    /** For iterating over the entries: getEntry(i) for i < getCapacity() is an entry or NULL */
+    int getCapacity() const {return slots.size();}
+    ARPCacheEntry *getEntry(int i) const {return slots[i];}
+};
+
+#endif
+
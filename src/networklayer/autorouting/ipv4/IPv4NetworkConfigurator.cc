@@ -18,6 +18,7 @@
 // Authors: Levente Meszaros (primary author), Andras Varga, Tamas Borbely
 //
 
+#include <map>
 #include <set>
 #include "stlutils.h"
 #include "IRoutingTable.h"
@@ -29,6 +30,12 @@
 #include "PatternMatcher.h"
 #include "ModuleAccess.h"
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <sys/time.h>
+#include <time.h>
+#endif
+
 Define_Module(IPv4NetworkConfigurator);
 
 #define ADDRLEN_BITS 32
@@ -61,6 +68,9 @@ void IPv4NetworkConfigurator::initialize(int stage)
         addDefaultRoutesParameter = par("addDefaultRoutes");
         optimizeRoutesParameter = par("optimizeRoutes");
         assignDisjunctSubnetAddressesParameter = par("assignDisjunctSubnetAddresses");
+        numThreadsParameter = par("numThreads");
+        if (numThreadsParameter < 1)
+            throw cRuntimeError("numThreads must be at least 1");
 
         // extract topology into the IPv4Topology object, then fill in a LinkInfo[] vector
         T(extractTopology(topology));
@@ -95,7 +105,16 @@ void IPv4NetworkConfigurator::initialize(int stage)
 
         // calculate shortest paths, and add corresponding static routes
         if (par("addStaticRoutes").boolValue())
-            T(addStaticRoutes(topology));
+        {
+            if (numThreadsParameter > 1)
+            {
+                T(addStaticRoutesInThreads(topology));
+            }
+            else
+            {
+                T(addStaticRoutes(topology));
+            }
+        }
 
         // print routes to module output
         if (par("dumpRoutes").boolValue())
@@ -1605,19 +1624,54 @@ IPv4NetworkConfigurator::LinkInfo *IPv4NetworkConfigurator::findLinkOfInterface(
     return NULL;
 }
 
-bool IPv4NetworkConfigurator::containsRoute(const std::vector<IPv4Route *>& routes, IPv4Route *route)
+/**
+ * Orders routes by the fields compared by IPv4Route::equals(), so that
+ * duplicate routes can be detected with a std::set.
+ */
+struct RouteFieldsLess
 {
-    for (int i = 0; i < (int)routes.size(); i++)
-        if (*routes.at(i) == *route)
-            return true;
-    return false;
-}
+    bool operator()(const IPv4Route *route1, const IPv4Route *route2) const
+    {
+        if (route1->getDestination() != route2->getDestination())
+            return route1->getDestination() < route2->getDestination();
+        if (route1->getNetmask() != route2->getNetmask())
+            return route1->getNetmask() < route2->getNetmask();
+        if (route1->getGateway() != route2->getGateway())
+            return route1->getGateway() < route2->getGateway();
+        if (route1->getInterface() != route2->getInterface())
+            return route1->getInterface() < route2->getInterface();
+        if (route1->getSource() != route2->getSource())
+            return route1->getSource() < route2->getSource();
+        if (route1->getMetric() != route2->getMetric())
+            return route1->getMetric() < route2->getMetric();
+        return route1->getRoutingTable() < route2->getRoutingTable();
+    }
+};
+
+/**
+ * Same order as RouteFieldsLess, for the fields of StaticRoutes.
+ */
+struct StaticRouteLess
+{
+    bool operator()(const IPv4NetworkConfigurator::StaticRoute& route1, const IPv4NetworkConfigurator::StaticRoute& route2) const
+    {
+        if (route1.destination != route2.destination)
+            return route1.destination < route2.destination;
+        if (route1.netmask != route2.netmask)
+            return route1.netmask < route2.netmask;
+        if (route1.gateway != route2.gateway)
+            return route1.gateway < route2.gateway;
+        return route1.interfaceEntry < route2.interfaceEntry;
+    }
+};
 
 void IPv4NetworkConfigurator::addStaticRoutes(IPv4Topology& topology)
 {
     long optimizeRoutesDuration = 0;
     long addDefaultRoutesDuration = 0;
     long calculateShortestPathsDuration = 0;
+    long collectRoutesDuration = 0;
+    long addRoutesDuration = 0;
 
     // TODO: it should be configurable (via xml?) which nodes need static routes filled in automatically
     // add static routes for all routing tables
@@ -1639,43 +1693,17 @@ void IPv4NetworkConfigurator::addStaticRoutes(IPv4Topology& topology)
         calculateShortestPathsDuration += clock() - begin;
 
         // check if adding the default routes would be ok (this is an optimization)
-        if (addDefaultRoutesParameter && sourceNode->interfaceInfos.size() == 1 && sourceNode->interfaceInfos[0]->linkInfo->gatewayInterfaceInfo)
+        if (canUseDefaultRoutes(sourceNode))
         {
             begin = clock();
-            InterfaceInfo *sourceInterfaceInfo = sourceNode->interfaceInfos[0];
-            InterfaceEntry *sourceInterfaceEntry = sourceInterfaceInfo->interfaceEntry;
-            InterfaceInfo *gatewayInterfaceInfo = sourceInterfaceInfo->linkInfo->gatewayInterfaceInfo;
-            InterfaceEntry *gatewayInterfaceEntry = gatewayInterfaceInfo->interfaceEntry;
-
-            // add a network route for the local network using ARP
-            IPv4Route *route = new IPv4Route();
-            IPv4InterfaceData *ipv4InterfaceData = sourceInterfaceEntry->ipv4Data();
-            IPv4Address address = ipv4InterfaceData->getIPAddress();
-            IPv4Address netmask = ipv4InterfaceData->getNetmask();
-            route->setDestination(IPv4Address(address.getInt() & netmask.getInt()));
-            route->setGateway(IPv4Address::UNSPECIFIED_ADDRESS);
-            route->setNetmask(netmask);
-            route->setInterface(sourceInterfaceEntry);
-            route->setSource(IPv4Route::MANUAL);
-            sourceRoutingTable->addRoute(route);
-
-            // add a default route towards the only one gateway
-            route = new IPv4Route();
-            IPv4Address gateway = gatewayInterfaceEntry->ipv4Data()->getIPAddress();
-            route->setDestination(IPv4Address::UNSPECIFIED_ADDRESS);
-            route->setNetmask(IPv4Address::UNSPECIFIED_ADDRESS);
-            route->setGateway(gateway);
-            route->setInterface(sourceInterfaceEntry);
-            route->setSource(IPv4Route::MANUAL);
-            sourceRoutingTable->addRoute(route);
-
-            // skip building and optimizing the whole routing table
-            EV_DEBUG << "Adding default routes to " << sourceNode->getModule()->getFullPath() << ", node has only one (non-loopback) interface\n";
+            addDefaultRoutes(sourceNode);
             addDefaultRoutesDuration += clock() - begin;
         }
         else
         {
+            begin = clock();
             std::vector<IPv4Route *> sourceRoutes;
+            std::set<IPv4Route *, RouteFieldsLess> sourceRouteSet;  // for fast duplicate checks
 
             // add a route to all destinations in the network
             for (int j = 0; j < topology.getNumNodes(); j++)
@@ -1734,7 +1762,7 @@ void IPv4NetworkConfigurator::addStaticRoutes(IPv4Topology& topology)
                         if (gatewayAddress != destinationAddress)
                             route->setGateway(gatewayAddress);
                         route->setSource(IPv4Route::MANUAL);
-                        if (containsRoute(sourceRoutes, route))
+                        if (!sourceRouteSet.insert(route).second)
                             delete route;
                         else {
                             sourceRoutes.push_back(route);
@@ -1744,26 +1772,414 @@ void IPv4NetworkConfigurator::addStaticRoutes(IPv4Topology& topology)
                 }
             }
 
+            collectRoutesDuration += clock() - begin;
+
             // optimize routing table to save memory and increase lookup performance
             if (optimizeRoutesParameter)
             {
-                long begin = clock();
+                begin = clock();
                 optimizeRoutes(sourceRoutes);
                 optimizeRoutesDuration += clock() - begin;
             }
 
             // copy into routing table
+            begin = clock();
             for (int i = 0; i < (int)sourceRoutes.size(); i++)
                 sourceRoutingTable->addRoute(sourceRoutes[i]);
+            addRoutesDuration += clock() - begin;
         }
     }
 
     // print some timing information
     printTimeSpentUsingDuration("calculateShortestPaths", calculateShortestPathsDuration);
     printTimeSpentUsingDuration("addDefaultRoutes", addDefaultRoutesDuration);
+    printTimeSpentUsingDuration("collectRoutes", collectRoutesDuration);
     printTimeSpentUsingDuration("optimizeRoutes", optimizeRoutesDuration);
+    printTimeSpentUsingDuration("addRoutes", addRoutesDuration);
+}
+
+bool IPv4NetworkConfigurator::canUseDefaultRoutes(Node *node)
+{
+    return addDefaultRoutesParameter && node->interfaceInfos.size() == 1 && node->interfaceInfos[0]->linkInfo->gatewayInterfaceInfo;
+}
+
+void IPv4NetworkConfigurator::addDefaultRoutes(Node *node)
+{
+    IRoutingTable *routingTable = node->routingTable;
+    InterfaceInfo *interfaceInfo = node->interfaceInfos[0];
+    InterfaceEntry *interfaceEntry = interfaceInfo->interfaceEntry;
+    InterfaceInfo *gatewayInterfaceInfo = interfaceInfo->linkInfo->gatewayInterfaceInfo;
+    InterfaceEntry *gatewayInterfaceEntry = gatewayInterfaceInfo->interfaceEntry;
+
+    // add a network route for the local network using ARP
+    IPv4Route *route = new IPv4Route();
+    IPv4InterfaceData *ipv4InterfaceData = interfaceEntry->ipv4Data();
+    IPv4Address address = ipv4InterfaceData->getIPAddress();
+    IPv4Address netmask = ipv4InterfaceData->getNetmask();
+    route->setDestination(IPv4Address(address.getInt() & netmask.getInt()));
+    route->setGateway(IPv4Address::UNSPECIFIED_ADDRESS);
+    route->setNetmask(netmask);
+    route->setInterface(interfaceEntry);
+    route->setSource(IPv4Route::MANUAL);
+    routingTable->addRoute(route);
+
+    // add a default route towards the only one gateway
+    route = new IPv4Route();
+    IPv4Address gateway = gatewayInterfaceEntry->ipv4Data()->getIPAddress();
+    route->setDestination(IPv4Address::UNSPECIFIED_ADDRESS);
+    route->setNetmask(IPv4Address::UNSPECIFIED_ADDRESS);
+    route->setGateway(gateway);
+    route->setInterface(interfaceEntry);
+    route->setSource(IPv4Route::MANUAL);
+    routingTable->addRoute(route);
+
+    // skip building and optimizing the whole routing table
+    EV_DEBUG << "Adding default routes to " << node->getModule()->getFullPath() << ", node has only one (non-loopback) interface\n";
+}
+
+/**
+ * Copies the enabled links and the destination addresses of the topology
+ * into plain arrays.
+ */
+void IPv4NetworkConfigurator::extractRouteGraph(IPv4Topology& topology, RouteGraph& graph)
+{
+    int numNodes = topology.getNumNodes();
+    std::map<Topology::Node *, int> nodeIndices;
+    for (int i = 0; i < numNodes; i++)
+        nodeIndices[topology.getNode(i)] = i;
+
+    for (int i = 0; i < numNodes; i++)
+    {
+        Node *node = (Node *)topology.getNode(i);
+        graph.hasInterfaceTable.push_back(node->interfaceTable != NULL);
+
+        // the links that calculateUnweightedSingleShortestPathsTo() follows backwards from this node
+        graph.linkBegin.push_back(graph.links.size());
+        for (int j = 0; j < node->getNumInLinks(); j++)
+        {
+            Link *link = (Link *)node->getLinkIn(j);
+            if (!link->isEnabled() || !link->getRemoteNode()->isEnabled())
+                continue;
+            RouteGraphLink graphLink;
+            graphLink.fromNode = nodeIndices[link->getRemoteNode()];
+            graphLink.toNode = i;
+            graphLink.fromInterface = link->sourceInterfaceInfo ? link->sourceInterfaceInfo->interfaceEntry : NULL;
+            graphLink.fromInterfaceHasIPv4 = graphLink.fromInterface && graphLink.fromInterface->ipv4Data();
+            graphLink.fromAddress = graphLink.fromInterfaceHasIPv4 ? graphLink.fromInterface->ipv4Data()->getIPAddress().getInt() : 0;
+            graphLink.toInterface = link->destinationInterfaceInfo ? link->destinationInterfaceInfo->interfaceEntry : NULL;
+            graph.links.push_back(graphLink);
+        }
+
+        // routes to all destination interfaces (IP packets are accepted from any interface at the destination)
+        graph.destinationBegin.push_back(graph.destinations.size());
+        IInterfaceTable *interfaceTable = node->interfaceTable;
+        if (!interfaceTable)
+            continue;
+        bool addSubnetRoute = addSubnetRoutesParameter && node->interfaceInfos.size() == 1 && node->interfaceInfos[0]->linkInfo->gatewayInterfaceInfo;
+        for (int j = 0; j < interfaceTable->getNumInterfaces(); j++)
+        {
+            InterfaceEntry *interfaceEntry = interfaceTable->getInterface(j);
+            if (!interfaceEntry->ipv4Data())
+                continue;
+            IPv4Address address = interfaceEntry->ipv4Data()->getIPAddress();
+            IPv4Address netmask = interfaceEntry->ipv4Data()->getNetmask();
+            if (interfaceEntry->isLoopback() || address.isUnspecified())
+                continue;
+            RouteDestination destination;
+            destination.address = address.getInt();
+            destination.routeDestination = addSubnetRoute ? address.getInt() & netmask.getInt() : address.getInt();
+            destination.routeNetmask = addSubnetRoute ? netmask.getInt() : IPv4Address::ALLONES_ADDRESS.getInt();
+            graph.destinations.push_back(destination);
+        }
+    }
+    graph.linkBegin.push_back(graph.links.size());
+    graph.destinationBegin.push_back(graph.destinations.size());
+}
+
+/**
+ * Breadth-first search towards the source node, visiting links in the same
+ * order as Topology::calculateUnweightedSingleShortestPathsTo(). Sets outLinks
+ * to the index of the first link on the path from each node, or -1.
+ */
+void IPv4NetworkConfigurator::calculateShortestPaths(const RouteGraph& graph, int sourceIndex, std::vector<int>& outLinks)
+{
+    int numNodes = graph.hasInterfaceTable.size();
+    std::vector<bool> reached(numNodes, false);
+    std::vector<int> queue;
+    outLinks.assign(numNodes, -1);
+    reached[sourceIndex] = true;
+    queue.push_back(sourceIndex);
+    for (int head = 0; head < (int)queue.size(); head++)
+    {
+        int node = queue[head];
+        for (int i = graph.linkBegin[node]; i < graph.linkBegin[node + 1]; i++)
+        {
+            int fromNode = graph.links[i].fromNode;
+            if (!reached[fromNode])
+            {
+                reached[fromNode] = true;
+                outLinks[fromNode] = i;
+                queue.push_back(fromNode);
+            }
+        }
+    }
+}
+
+/**
+ * Same as collecting the routes in addStaticRoutes(), on the RouteGraph.
+ */
+void IPv4NetworkConfigurator::collectStaticRoutes(const RouteGraph& graph, int sourceIndex, const std::vector<int>& outLinks, std::vector<StaticRoute>& routes)
+{
+    std::set<StaticRoute, StaticRouteLess> routeSet;  // for fast duplicate checks
+    int numNodes = graph.hasInterfaceTable.size();
+    for (int i = 0; i < numNodes; i++)
+    {
+        if (i == sourceIndex || outLinks[i] == -1 || !graph.hasInterfaceTable[i])
+            continue;
+
+        // find next hop interface (the last IP interface on the path that is not in the source node)
+        const RouteGraphLink *link = NULL;
+        const RouteGraphLink *nextHopLink = NULL;
+        for (int node = i; node != sourceIndex; node = link->toNode)
+        {
+            link = &graph.links[outLinks[node]];
+            if (graph.hasInterfaceTable[node] && link->fromInterface)
+                nextHopLink = link;
+        }
+        if (!nextHopLink || !nextHopLink->fromInterfaceHasIPv4)
+            continue;
+
+        for (int j = graph.destinationBegin[i]; j < graph.destinationBegin[i + 1]; j++)
+        {
+            const RouteDestination& destination = graph.destinations[j];
+            StaticRoute route;
+            route.destination = destination.routeDestination;
+            route.netmask = destination.routeNetmask;
+            route.gateway = nextHopLink->fromAddress != destination.address ? nextHopLink->fromAddress : 0;
+            route.interfaceEntry = link->toInterface;
+            if (routeSet.insert(route).second)
+                routes.push_back(route);
+        }
+    }
+}
+
+/**
+ * Same as optimizeRoutes(), on StaticRoutes.
+ */
+void IPv4NetworkConfigurator::optimizeStaticRoutes(std::vector<StaticRoute>& routes)
+{
+    RoutingTableInfo routingTableInfo;
+    std::vector<StaticRoute> colorToRoute;
+    std::vector<RouteInfo *> originalRouteInfos;
+
+    for (int i = 0; i < (int)routes.size(); i++)
+    {
+        const StaticRoute& route = routes[i];
+        int color = 0;
+        while (color < (int)colorToRoute.size() &&
+               (colorToRoute[color].gateway != route.gateway || colorToRoute[color].interfaceEntry != route.interfaceEntry))
+            color++;
+        if (color == (int)colorToRoute.size())
+            colorToRoute.push_back(route);
+
+        RouteInfo *originalRouteInfo = new RouteInfo(color, route.destination, route.netmask);
+        originalRouteInfos.push_back(originalRouteInfo);
+        RouteInfo *optimizedRouteInfo = new RouteInfo(*originalRouteInfo);
+        optimizedRouteInfo->originalRouteInfos.push_back(originalRouteInfo);
+        routingTableInfo.addRouteInfo(optimizedRouteInfo);
+    }
+
+    optimizeRouteInfos(routingTableInfo, originalRouteInfos);
+
+    routes.clear();
+    for (int i = 0; i < (int)routingTableInfo.routeInfos.size(); i++)
+    {
+        RouteInfo *routeInfo = routingTableInfo.routeInfos.at(i);
+        StaticRoute route = colorToRoute[routeInfo->color];
+        route.destination = routeInfo->destination;
+        route.netmask = routeInfo->netmask;
+        routes.push_back(route);
+        delete routeInfo;
+    }
+    for (int i = 0; i < (int)originalRouteInfos.size(); i++)
+        delete originalRouteInfos[i];
 }
 
+#ifdef HAVE_PTHREAD
+
+/**
+ * State of a worker thread of addStaticRoutesInThreads(). Worker k computes
+ * the routing tables of sources k, k + numThreads, k + 2 * numThreads, ...
+ */
+struct IPv4NetworkConfigurator::RouteWorker
+{
+    IPv4NetworkConfigurator *configurator;
+    const RouteGraph *graph;
+    const std::vector<int> *sourceIndices;
+    std::vector<std::vector<StaticRoute> > *sourceRoutes;  // by position in sourceIndices
+    int first;
+    int step;
+    double calculateShortestPathsTime;
+    double collectRoutesTime;
+    double optimizeRoutesTime;
+    std::string errorMessage;  // set if the worker failed
+};
+
+// CPU time of the calling thread, in seconds
+static double getThreadCpuTime()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double getWallClockTime()
+{
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec / 1e6;
+}
+
+void *IPv4NetworkConfigurator::runRouteWorker(void *arg)
+{
+    RouteWorker *worker = (RouteWorker *)arg;
+    try
+    {
+        std::vector<int> outLinks;
+        for (int i = worker->first; i < (int)worker->sourceIndices->size(); i += worker->step)
+        {
+            std::vector<StaticRoute>& routes = (*worker->sourceRoutes)[i];
+            double begin = getThreadCpuTime();
+            worker->configurator->calculateShortestPaths(*worker->graph, (*worker->sourceIndices)[i], outLinks);
+            double end = getThreadCpuTime();
+            worker->calculateShortestPathsTime += end - begin;
+            begin = end;
+            worker->configurator->collectStaticRoutes(*worker->graph, (*worker->sourceIndices)[i], outLinks, routes);
+            end = getThreadCpuTime();
+            worker->collectRoutesTime += end - begin;
+            if (worker->configurator->optimizeRoutesParameter)
+            {
+                begin = end;
+                worker->configurator->optimizeStaticRoutes(routes);
+                worker->optimizeRoutesTime += getThreadCpuTime() - begin;
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        worker->errorMessage = e.what();
+    }
+    return NULL;
+}
+
+void IPv4NetworkConfigurator::addStaticRoutesInThreads(IPv4Topology& topology)
+{
+    long begin = clock();
+    RouteGraph graph;
+    extractRouteGraph(topology, graph);
+
+    // the nodes that get a full routing table
+    std::vector<int> sourceIndices;
+    for (int i = 0; i < topology.getNumNodes(); i++)
+    {
+        Node *sourceNode = (Node *)topology.getNode(i);
+        if (sourceNode->interfaceTable && sourceNode->routingTable && !canUseDefaultRoutes(sourceNode))
+            sourceIndices.push_back(i);
+    }
+    printTimeSpentUsingDuration("extractRouteGraph", clock() - begin);
+
+    // compute routes on the worker threads, each into its own slots of sourceRoutes
+    std::vector<std::vector<StaticRoute> > sourceRoutes(sourceIndices.size());
+    std::vector<RouteWorker> workers(numThreadsParameter);
+    std::vector<pthread_t> threads(numThreadsParameter);
+    double wallClockBegin = getWallClockTime();
+    int numStarted = 0;
+    for (int i = 0; i < numThreadsParameter; i++)
+    {
+        RouteWorker& worker = workers[i];
+        worker.configurator = this;
+        worker.graph = &graph;
+        worker.sourceIndices = &sourceIndices;
+        worker.sourceRoutes = &sourceRoutes;
+        worker.first = i;
+        worker.step = numThreadsParameter;
+        worker.calculateShortestPathsTime = 0;
+        worker.collectRoutesTime = 0;
+        worker.optimizeRoutesTime = 0;
+        if (pthread_create(&threads[i], NULL, runRouteWorker, &worker) != 0)
+            break;
+        numStarted++;
+    }
+    for (int i = 0; i < numStarted; i++)
+        pthread_join(threads[i], NULL);
+    if (numStarted < numThreadsParameter)
+        throw cRuntimeError("Cannot start %d threads for computing static routes", numThreadsParameter);
+    double wallClockTime = getWallClockTime() - wallClockBegin;
+
+    double calculateShortestPathsTime = 0;
+    double collectRoutesTime = 0;
+    double optimizeRoutesTime = 0;
+    for (int i = 0; i < numThreadsParameter; i++)
+    {
+        if (!workers[i].errorMessage.empty())
+            throw cRuntimeError("Computing static routes failed: %s", workers[i].errorMessage.c_str());
+        calculateShortestPathsTime += workers[i].calculateShortestPathsTime;
+        collectRoutesTime += workers[i].collectRoutesTime;
+        optimizeRoutesTime += workers[i].optimizeRoutesTime;
+    }
+
+    // add the routes in node order, as addStaticRoutes() does
+    long addDefaultRoutesDuration = 0;
+    long addRoutesDuration = 0;
+    int position = 0;
+    for (int i = 0; i < topology.getNumNodes(); i++)
+    {
+        Node *sourceNode = (Node *)topology.getNode(i);
+        if (!sourceNode->interfaceTable || !sourceNode->routingTable)
+            continue;
+        begin = clock();
+        if (canUseDefaultRoutes(sourceNode))
+        {
+            addDefaultRoutes(sourceNode);
+            addDefaultRoutesDuration += clock() - begin;
+        }
+        else
+        {
+            ASSERT(sourceIndices[position] == i);
+            std::vector<StaticRoute>& routes = sourceRoutes[position++];
+            for (int j = 0; j < (int)routes.size(); j++)
+            {
+                IPv4Route *route = new IPv4Route();
+                route->setDestination(IPv4Address(routes[j].destination));
+                route->setNetmask(IPv4Address(routes[j].netmask));
+                route->setInterface(routes[j].interfaceEntry);
+                route->setGateway(IPv4Address(routes[j].gateway));
+                route->setSource(IPv4Route::MANUAL);
+                sourceNode->routingTable->addRoute(route);
+            }
+            std::vector<StaticRoute>().swap(routes);
+            addRoutesDuration += clock() - begin;
+        }
+    }
+
+    // print some timing information; the phases on the worker threads are summed up
+    printTimeSpentUsingDuration("calculateShortestPaths", (long)(calculateShortestPathsTime * CLOCKS_PER_SEC));
+    printTimeSpentUsingDuration("addDefaultRoutes", addDefaultRoutesDuration);
+    printTimeSpentUsingDuration("collectRoutes", (long)(collectRoutesTime * CLOCKS_PER_SEC));
+    printTimeSpentUsingDuration("optimizeRoutes", (long)(optimizeRoutesTime * CLOCKS_PER_SEC));
+    printTimeSpentUsingDuration("addRoutes", addRoutesDuration);
+    EV_INFO << "Wall clock time of computing static routes on " << numThreadsParameter << " threads: " << wallClockTime << "s" << endl;
+}
+
+#else
+
+void IPv4NetworkConfigurator::addStaticRoutesInThreads(IPv4Topology& topology)
+{
+    throw cRuntimeError("numThreads > 1 needs POSIX threads: INET was built without HAVE_PTHREAD (see src/makefrag)");
+}
+
+#endif
+
 /**
  * Returns true if the two routes are the same except their address prefix and netmask.
  * If it returns true we say that the routes have the same color.
@@ -2010,6 +2426,23 @@ bool IPv4NetworkConfigurator::tryToMergeAnyTwoRoutes(RoutingTableInfo& routingTa
     return false;
 }
 
+/**
+ * Merges the routes of the optimizer's routing table until no two routes can be merged.
+ */
+void IPv4NetworkConfigurator::optimizeRouteInfos(RoutingTableInfo& routingTableInfo, const std::vector<RouteInfo *>& originalRouteInfos)
+{
+#ifndef NDEBUG
+    checkOriginalRoutes(routingTableInfo, originalRouteInfos);
+#endif
+
+    // the main optimizer loop runs until it cannot merge any two routes.
+    while (tryToMergeAnyTwoRoutes(routingTableInfo));
+
+#ifndef NDEBUG
+    checkOriginalRoutes(routingTableInfo, originalRouteInfos);
+#endif
+}
+
 void IPv4NetworkConfigurator::optimizeRoutes(std::vector<IPv4Route *>& originalRoutes)
 {
     // The basic idea: if two routes "do the same" (same output interface, gateway, etc) and
@@ -2049,18 +2482,9 @@ void IPv4NetworkConfigurator::optimizeRoutes(std::vector<IPv4Route *>& originalR
         routingTableInfo.addRouteInfo(optimizedRouteInfo);
     }
 
-#ifndef NDEBUG
-    checkOriginalRoutes(routingTableInfo, originalRouteInfos);
-#endif
-
     // STEP 2.
     // from now on we are only working with the internal data structures called RouteInfo and RoutingTableInfo.
-    // the main optimizer loop runs until it cannot merge any two routes.
-    while (tryToMergeAnyTwoRoutes(routingTableInfo));
-
-#ifndef NDEBUG
-    checkOriginalRoutes(routingTableInfo, originalRouteInfos);
-#endif
+    optimizeRouteInfos(routingTableInfo, originalRouteInfos);
 
     // STEP 3.
     // convert the optimized routes to new optimized IPv4 routes based on the saved colors
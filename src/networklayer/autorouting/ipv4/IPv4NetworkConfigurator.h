@@ -171,6 +171,54 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule
                 static bool routeInfoLessThan(const RouteInfo *a, const RouteInfo *b) { return a->netmask != b->netmask ? a->netmask > b->netmask : a->destination < b->destination; }
         };
 
+        /**
+         * Plain representation of a static route. Worker threads compute
+         * routes in this form; IPv4Route objects are created only when the
+         * routes are added to the routing tables.
+         */
+        struct StaticRoute {
+            uint32 destination;
+            uint32 netmask;
+            uint32 gateway;                  // 0 means unspecified
+            InterfaceEntry *interfaceEntry;
+        };
+
+        /**
+         * An entry of Topology::Node::inLinks in RouteGraph.
+         */
+        struct RouteGraphLink {
+            int fromNode;                    // index of the node the link comes from
+            int toNode;                      // index of the node the link goes to
+            InterfaceEntry *fromInterface;   // interface of the link in fromNode, or NULL
+            bool fromInterfaceHasIPv4;
+            uint32 fromAddress;              // IPv4 address of fromInterface
+            InterfaceEntry *toInterface;     // interface of the link in toNode, or NULL
+        };
+
+        /**
+         * An address of a destination interface, and the route that leads to it.
+         */
+        struct RouteDestination {
+            uint32 address;
+            uint32 routeDestination;
+            uint32 routeNetmask;
+        };
+
+        /**
+         * Copy of the topology data needed to compute static routes, indexed by
+         * node index in the Topology. The worker threads of addStaticRoutes()
+         * only read this; they do not touch Topology, modules or interfaces.
+         */
+        struct RouteGraph {
+            std::vector<int> linkBegin;      // enabled in-links of node i are links[linkBegin[i]..linkBegin[i+1]-1], in Topology order
+            std::vector<RouteGraphLink> links;
+            std::vector<bool> hasInterfaceTable;
+            std::vector<int> destinationBegin;  // destination addresses of node i, like linkBegin
+            std::vector<RouteDestination> destinations;
+        };
+
+        struct RouteWorker;
+
         class Matcher
         {
             private:
@@ -202,6 +250,7 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule
         bool addDefaultRoutesParameter;
         bool optimizeRoutesParameter;
         bool assignDisjunctSubnetAddressesParameter;
+        int numThreadsParameter;
 
     protected:
         virtual int numInitStages() const  { return 3; }
@@ -234,6 +283,12 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule
          */
         virtual void addStaticRoutes(IPv4Topology& topology);
 
+        /**
+         * Computes the same static routes as addStaticRoutes() on numThreads threads,
+         * then adds them to the routing tables in node order.
+         */
+        virtual void addStaticRoutesInThreads(IPv4Topology& topology);
+
         /**
          * Destructively optimizes the given IPv4 routes by merging some of them.
          * The resulting routes might be different in that they will route packets
@@ -275,8 +330,16 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule
                 uint32& mergedAddress, uint32& mergedAddressSpecifiedBits, uint32& mergedAddressIncompatibleBits,
                 uint32& mergedNetmask, uint32& mergedNetmaskSpecifiedBits, uint32& mergedNetmaskIncompatibleBits);
 
+        // helpers for static routes
+        bool canUseDefaultRoutes(Node *node);
+        void addDefaultRoutes(Node *node);
+        void extractRouteGraph(IPv4Topology& topology, RouteGraph& graph);
+        void calculateShortestPaths(const RouteGraph& graph, int sourceIndex, std::vector<int>& outLinks);
+        void collectStaticRoutes(const RouteGraph& graph, int sourceIndex, const std::vector<int>& outLinks, std::vector<StaticRoute>& routes);
+        void optimizeStaticRoutes(std::vector<StaticRoute>& routes);
+        static void *runRouteWorker(void *worker);
+
         // helpers for routing table optimization
-        bool containsRoute(const std::vector<IPv4Route *>& routes, IPv4Route *route);
         bool routesHaveSameColor(IPv4Route *route1, IPv4Route *route2);
         int findRouteIndexWithSameColor(const std::vector<IPv4Route *>& routes, IPv4Route *route);
         bool routesCanBeSwapped(RouteInfo *routeInfo1, RouteInfo *routeInfo2);
@@ -285,6 +348,7 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule
         bool interruptsAnyOriginalRoute(const RoutingTableInfo& routingTableInfo, int begin, int end, const std::vector<RouteInfo *>& originalRouteInfos);
         bool interruptsSubsequentOriginalRoutes(const RoutingTableInfo& routingTableInfo, int index);
         void checkOriginalRoutes(const RoutingTableInfo& routingTableInfo, const std::vector<RouteInfo *>& originalRouteInfos);
+        void optimizeRouteInfos(RoutingTableInfo& routingTableInfo, const std::vector<RouteInfo *>& originalRouteInfos);
         void findLongestCommonDestinationPrefix(uint32 destination1, uint32 netmask1, uint32 destination2, uint32 netmask2, uint32& destinationOut, uint32& netmaskOut);
         void addOriginalRouteInfos(RoutingTableInfo& routingTableInfo, int begin, int end, const std::vector<RouteInfo *>& originalRouteInfos);
         bool tryToMergeTwoRoutes(RoutingTableInfo& routingTableInfo, int i, int j, RouteInfo *routeInfoI, RouteInfo *routeInfoJ);
@@ -409,8 +409,8 @@ void Established::entry()
         }
     }
 
-    std::vector<BGP::RoutingTableEntry*> BGPRoutingTable = session.getBGPRoutingTable();
-    for (std::vector<BGP::RoutingTableEntry*>::iterator it = BGPRoutingTable.begin(); it != BGPRoutingTable.end(); it++)
+    const std::vector<BGP::RoutingTableEntry*>& BGPRoutingTable = session.getBGPRoutingTable();
+    for (std::vector<BGP::RoutingTableEntry*>::const_iterator it = BGPRoutingTable.begin(); it != BGPRoutingTable.end(); it++)
     {
         session.updateSendProcess((*it));
     }
@@ -422,6 +422,15 @@ void Established::entry()
         session.findAndStartNextSession(BGP::IGP);
     }
 }
+
+void Established::exit()
+{
+    std::cout << "Established::exit" << std::endl;
+    //the peer announces its routes again when the session is re-established,
+    //they must not be taken for repetitions of the routes received before
+    TopState::box().getModule().clearAdjRIBIn();
+}
+
 void Established::ConnectRetryTimer_Expires()
 {
     EV << "Processing Established::ConnectRetryTimer_Expires" << std::endl;
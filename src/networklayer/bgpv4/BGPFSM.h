@@ -215,7 +215,7 @@ SUBSTATE(Established, TopState) {
 
 private:
     void entry();
-    void exit()     { std::cout << "Established::exit" << std::endl; }
+    void exit();
 };
 
 } // namespace BGPFSM
@@ -57,9 +57,10 @@ void BGPUpdateMessage::setPathAttributeList(const BGPUpdatePathAttributeList& pa
     setByteLength(getByteLength() + delta_bytes);
 }
 
-void BGPUpdateMessage::setNLRI(const BGPUpdateNLRI& NLRI_var)
+void BGPUpdateMessage::setNLRIArraySize(unsigned int size)
 {
-    setByteLength(getByteLength() + 5); //5 = NLRI (length (1) + IPv4Address (4))
-    BGPUpdateMessage_Base::NLRI_var = NLRI_var;
+    int delta_size = size - getNLRIArraySize();
+    setByteLength(getByteLength() + delta_size * 5); //5 = NLRI (length (1) + IPv4Address (4))
+    BGPUpdateMessage_Base::setNLRIArraySize(size);
 }
 
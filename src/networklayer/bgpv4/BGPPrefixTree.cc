@@ -0,0 +1,195 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+
+#include "BGPPrefixTree.h"
+
+
+BGP::PrefixTree::PrefixTree() : root(NULL), numEntries(0)
+{
+}
+
+BGP::PrefixTree::~PrefixTree()
+{
+    deleteSubtree(root);
+}
+
+void BGP::PrefixTree::deleteSubtree(Node *node)
+{
+    if (node)
+    {
+        deleteSubtree(node->child[0]);
+        deleteSubtree(node->child[1]);
+        delete node;
+    }
+}
+
+void BGP::PrefixTree::clear()
+{
+    deleteSubtree(root);
+    root = NULL;
+    numEntries = 0;
+}
+
+int BGP::PrefixTree::commonPrefixLength(uint32 a, uint32 b, int maxLength)
+{
+    uint32 diff = a ^ b;
+    int length = 0;
+    while (length < maxLength && !(diff & 0x80000000u))
+    {
+        diff <<= 1;
+        length++;
+    }
+    return length;
+}
+
+const BGP::PrefixTree::Node *BGP::PrefixTree::findNode(uint32 prefix, int length) const
+{
+    const Node *node = root;
+    while (node && node->length <= length && (prefix & mask(node->length)) == node->prefix)
+    {
+        if (node->length == length)
+            return node;
+        node = node->child[bitAt(prefix, node->length)];
+    }
+    return NULL;
+}
+
+BGP::RoutingTableEntry *BGP::PrefixTree::find(const IPv4Address& prefix, int length) const
+{
+    const Node *node = findNode(prefix.getInt() & mask(length), length);
+    return node ? node->entry : NULL;
+}
+
+BGP::RoutingTableEntry *BGP::PrefixTree::insert(const IPv4Address& prefixAddr, int length, RoutingTableEntry *entry)
+{
+    ASSERT(entry != NULL && length >= 0 && length <= 32);
+    uint32 prefix = prefixAddr.getInt() & mask(length);
+
+    Node **link = &root;
+    Node *node;
+    while (true)
+    {
+        node = *link;
+        if (!node)
+        {
+            // empty subtree: add a leaf
+            node = *link = new Node(prefix, length);
+            break;
+        }
+
+        int common = commonPrefixLength(node->prefix, prefix, std::min(node->length, length));
+        if (common == node->length)
+        {
+            if (common == length)
+                break;  // exact match
+            link = &node->child[bitAt(prefix, node->length)];
+            continue;
+        }
+
+        if (common == length)
+        {
+            // new prefix is a prefix of the node's: insert it above the node
+            Node *newNode = new Node(prefix, length);
+            newNode->child[bitAt(node->prefix, length)] = node;
+            node = *link = newNode;
+        }
+        else
+        {
+            // prefixes diverge at bit 'common': add a branching node
+            Node *branch = new Node(prefix & mask(common), common);
+            Node *newNode = new Node(prefix, length);
+            branch->child[bitAt(node->prefix, common)] = node;
+            branch->child[bitAt(prefix, common)] = newNode;
+            *link = branch;
+            node = newNode;
+        }
+        break;
+    }
+
+    RoutingTableEntry *replaced = node->entry;
+    node->entry = entry;
+    if (!replaced)
+        numEntries++;
+    return replaced;
+}
+
+BGP::RoutingTableEntry *BGP::PrefixTree::remove(const IPv4Address& prefixAddr, int length)
+{
+    uint32 prefix = prefixAddr.getInt() & mask(length);
+
+    Node **links[33];
+    int depth = 0;
+    Node **link = &root;
+    while (*link && (*link)->length <= length && (prefix & mask((*link)->length)) == (*link)->prefix)
+    {
+        links[depth++] = link;
+        if ((*link)->length == length)
+            break;
+        link = &(*link)->child[bitAt(prefix, (*link)->length)];
+    }
+
+    if (depth == 0 || (*links[depth-1])->length != length || !(*links[depth-1])->entry)
+        return NULL;
+
+    RoutingTableEntry *entry = (*links[depth-1])->entry;
+    (*links[depth-1])->entry = NULL;
+    numEntries--;
+
+    // remove nodes that became unnecessary, bottom up
+    for (int i = depth - 1; i >= 0; i--)
+    {
+        Node *node = *links[i];
+        if (node->entry || (node->child[0] && node->child[1]))
+            break;
+        *links[i] = node->child[0] ? node->child[0] : node->child[1];
+        delete node;
+    }
+    return entry;
+}
+
+BGP::RoutingTableEntry *BGP::PrefixTree::lookup(const IPv4Address& dest) const
+{
+    uint32 addr = dest.getInt();
+    RoutingTableEntry *entry = NULL;
+
+    const Node *node = root;
+    while (node && (addr & mask(node->length)) == node->prefix)
+    {
+        if (node->entry)
+            entry = node->entry;
+        if (node->length == 32)
+            break;
+        node = node->child[bitAt(addr, node->length)];
+    }
+    return entry;
+}
+
+void BGP::PrefixTree::collectEntries(const Node *node, std::vector<RoutingTableEntry *>& entries)
+{
+    if (node)
+    {
+        if (node->entry)
+            entries.push_back(node->entry);
+        collectEntries(node->child[0], entries);
+        collectEntries(node->child[1], entries);
+    }
+}
+
+void BGP::PrefixTree::getEntries(std::vector<RoutingTableEntry *>& entries) const
+{
+    collectEntries(root, entries);
+}
@@ -0,0 +1,98 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_BGPPREFIXTREE_H
+#define __INET_BGPPREFIXTREE_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "IPv4Address.h"
+
+namespace BGP {
+
+class RoutingTableEntry;
+
+/**
+ * Path-compressed binary trie (radix tree) mapping IPv4 prefixes to BGP
+ * routes, at most one route per prefix. BGPRouting keeps its Loc-RIB and
+ * the Adj-RIB-In of each session in such trees, so finding the route of
+ * a prefix takes at most 33 node visits regardless of the table size.
+ *
+ * Prefixes are given as address and length; address bits beyond the
+ * length are ignored. The tree does not own the routes.
+ */
+class INET_API PrefixTree
+{
+  protected:
+    struct Node
+    {
+        uint32 prefix;  // prefix bits, bits beyond length are zero
+        int length;     // prefix length (0..32)
+        Node *child[2]; // subtrees, selected by the bit after the prefix
+        RoutingTableEntry *entry;   // route of exactly this prefix, or NULL
+
+        Node(uint32 prefix, int length) : prefix(prefix), length(length), entry(NULL) {child[0] = child[1] = NULL;}
+    };
+
+    Node *root;
+    int numEntries;
+
+  private:
+    // copying not supported: following are private and also left undefined
+    PrefixTree(const PrefixTree& other);
+    PrefixTree& operator=(const PrefixTree& other);
+
+  protected:
+    static uint32 mask(int length) {return length == 0 ? 0 : 0xffffffffu << (32 - length);}
+    static int bitAt(uint32 addr, int pos) {return (addr >> (31 - pos)) & 1;}
+    static int commonPrefixLength(uint32 a, uint32 b, int maxLength);
+    static void deleteSubtree(Node *node);
+    static void collectEntries(const Node *node, std::vector<RoutingTableEntry *>& entries);
+    const Node *findNode(uint32 prefix, int length) const;
+
+  public:
+    PrefixTree();
+    ~PrefixTree();
+
+    /** Returns the number of prefixes that have a route */
+    int size() const {return numEntries;}
+
+    /** Returns the route of the prefix, or NULL */
+    RoutingTableEntry *find(const IPv4Address& prefix, int length) const;
+
+    /**
+     * Stores the route under the prefix. Returns the route it replaced,
+     * or NULL if the prefix had no route.
+     */
+    RoutingTableEntry *insert(const IPv4Address& prefix, int length, RoutingTableEntry *entry);
+
+    /** Removes the route of the prefix and returns it, or returns NULL if there was none */
+    RoutingTableEntry *remove(const IPv4Address& prefix, int length);
+
+    /** Returns the route of the longest prefix containing the address, or NULL */
+    RoutingTableEntry *lookup(const IPv4Address& addr) const;
+
+    /** Appends all routes to the vector, in prefix order */
+    void getEntries(std::vector<RoutingTableEntry *>& entries) const;
+
+    /** Removes all routes (route objects are not deleted) */
+    void clear();
+};
+
+} // namespace BGP
+
+#endif
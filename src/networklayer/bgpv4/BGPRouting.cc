@@ -15,6 +15,8 @@
 // along with this program; if not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
+
 #include "BGPRouting.h"
 #include "RoutingTableAccess.h"
 #include "OSPFRouting.h"
@@ -22,6 +24,37 @@
 
 Define_Module(BGPRouting);
 
+static BGP::RoutingTableEntry* copyRoute(const BGP::RoutingTableEntry* entry)
+{
+    BGP::RoutingTableEntry* copy = new BGP::RoutingTableEntry();
+    copy->setDestination(entry->getDestination());
+    copy->setNetmask(entry->getNetmask());
+    copy->setPathType(entry->getPathType());
+    copy->setGateway(entry->getGateway());
+    for (unsigned int i = 0; i < entry->getASCount(); i++)
+    {
+        copy->addAS(entry->getAS(i));
+    }
+    return copy;
+}
+
+static bool isSameRoute(const BGP::RoutingTableEntry* entry1, const BGP::RoutingTableEntry* entry2)
+{
+    if (entry1->getPathType() != entry2->getPathType() || entry1->getGateway() != entry2->getGateway() ||
+        entry1->getASCount() != entry2->getASCount())
+    {
+        return false;
+    }
+    for (unsigned int i = 0; i < entry1->getASCount(); i++)
+    {
+        if (entry1->getAS(i) != entry2->getAS(i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 BGPRouting::~BGPRouting(void)
 {
     for (std::map<BGP::SessionID, BGPSession*>::iterator sessionIterator = _BGPSessions.begin();
@@ -252,96 +285,148 @@ void BGPRouting::processMessage(const BGPUpdateMessage& msg)
     EV << "Processing BGP Update message" << std::endl;
     _BGPSessions[_currSessionId]->getFSM()->UpdateMsgEvent();
 
-    unsigned char               decisionProcessResult;
-    IPv4Address                 netMask(IPv4Address::ALLONES_ADDRESS);
-    BGP::RoutingTableEntry*     entry = new BGP::RoutingTableEntry();
-    const unsigned char         length = msg.getNLRI().length;
-    unsigned int                ASValueCount = msg.getPathAttributeList(0).getAsPath(0).getValue(0).getAsValueArraySize();
-
-    entry->setDestination(msg.getNLRI().prefix);
-    netMask = IPv4Address::makeNetmask(length);
-    entry->setNetmask(netMask);
-    for (unsigned int j=0; j < ASValueCount; j++)
+    //withdrawn routes are not processed
+    if (msg.getPathAttributeListArraySize() == 0)
     {
-        entry->addAS(msg.getPathAttributeList(0).getAsPath(0).getValue(0).getAsValue(j));
+        return;
     }
 
-    decisionProcessResult = asLoopDetection(entry, _myAS);
+    BGPSession*                         session = _BGPSessions[_currSessionId];
+    const BGPUpdatePathAttributeList&   attributes = msg.getPathAttributeList(0);
+    unsigned int                        ASValueCount = attributes.getAsPath(0).getValue(0).getAsValueArraySize();
+    unsigned int                        NLRICount = msg.getNLRIArraySize();
+    bool                                ospfExists = session->getType() == BGP::EGP && ospfExist(_rt);
+    std::vector<BGP::RoutingTableEntry*> changedRoutes;
+    std::vector<BGP::RoutingTableEntry*> addedRoutes;
 
-    if (decisionProcessResult == BGP::ASLOOP_NO_DETECTED)
+    //all prefixes of the message share the path attributes
+    for (unsigned int i = 0; i < NLRICount; i++)
     {
-        // RFC 4271, 9.1.  Decision Process
-        decisionProcessResult = decisionProcess(msg, entry, _currSessionId);
-        //RFC 4271, 9.2.  Update-Send Process
-        if (decisionProcessResult != 0)
+        BGP::RoutingTableEntry* entry = new BGP::RoutingTableEntry();
+        const unsigned char     length = msg.getNLRI(i).length;
+
+        entry->setDestination(msg.getNLRI(i).prefix);
+        entry->setNetmask(IPv4Address::makeNetmask(length));
+        for (unsigned int j=0; j < ASValueCount; j++)
+        {
+            entry->addAS(attributes.getAsPath(0).getValue(0).getAsValue(j));
+        }
+        entry->setPathType(attributes.getOrigin().getValue());
+        entry->setGateway(attributes.getNextHop().getValue());
+
+        //the peer repeated the route it sent last time for this prefix, which was accepted (Adj-RIB-In): nothing changes
+        BGP::RoutingTableEntry* received = session->getAdjRIBIn().find(entry->getDestination(), length);
+        if (received != NULL && isSameRoute(received, entry))
+        {
+            delete entry;
+            continue;
+        }
+        BGP::RoutingTableEntry* receivedCopy = copyRoute(entry);
+
+        unsigned char decisionProcessResult = 0;
+        if (asLoopDetection(entry, _myAS) != BGP::ASLOOP_NO_DETECTED)
+        {
+            delete entry;
+        }
+        else
+        {
+            // RFC 4271, 9.1.  Decision Process
+            decisionProcessResult = decisionProcess(entry, _currSessionId, ospfExists);
+        }
+
+        //only an accepted route is remembered; a rejected one is evaluated again when the peer repeats it
+        if (decisionProcessResult == BGP::ROUTE_DESTINATION_CHANGED || decisionProcessResult == BGP::NEW_ROUTE_ADDED)
+        {
+            delete session->getAdjRIBIn().insert(receivedCopy->getDestination(), length, receivedCopy);
+        }
+        else
+        {
+            delete session->getAdjRIBIn().remove(receivedCopy->getDestination(), length);
+            delete receivedCopy;
+        }
+
+        if (decisionProcessResult == BGP::ROUTE_DESTINATION_CHANGED)
+        {
+            changedRoutes.push_back(entry);
+        }
+        else if (decisionProcessResult == BGP::NEW_ROUTE_ADDED)
         {
-            updateSendProcess(decisionProcessResult, _currSessionId, entry);
+            addedRoutes.push_back(entry);
         }
     }
+
+    //RFC 4271, 9.2.  Update-Send Process
+    if (!changedRoutes.empty())
+    {
+        updateSendProcess(BGP::ROUTE_DESTINATION_CHANGED, _currSessionId, changedRoutes);
+    }
+    if (!addedRoutes.empty())
+    {
+        updateSendProcess(BGP::NEW_ROUTE_ADDED, _currSessionId, addedRoutes);
+    }
 }
 
-unsigned char BGPRouting::decisionProcess(const BGPUpdateMessage& msg, BGP::RoutingTableEntry* entry, BGP::SessionID sessionIndex)
+unsigned char BGPRouting::decisionProcess(BGP::RoutingTableEntry* entry, BGP::SessionID sessionIndex, bool ospfExists)
 {
     //Don't add the route if it exists in PrefixListINTable or in ASListINTable
-    if (isInTable(_prefixListIN, entry) != (unsigned long)-1 || isInASList(_ASListIN, entry))
+    if (isInPrefixList(_prefixListIN, entry) || isInASList(_ASListIN, entry))
     {
+        delete entry;
         return 0;
     }
 
-    /*If the AS_PATH attribute of a BGP route contains an AS loop, the BGP
-    route should be excluded from the decision process. */
-    entry->setPathType(msg.getPathAttributeList(0).getOrigin().getValue());
-    entry->setGateway(msg.getPathAttributeList(0).getNextHop().getValue());
-
     //if the route already exist in BGP routing table, tieBreakingProcess();
     //(RFC 4271: 9.1.2.2 Breaking Ties)
-    unsigned long BGPindex = isInTable(_BGPRoutingTable, entry);
-    if (BGPindex != (unsigned long)-1)
+    int prefixLength = entry->getNetmask().getNetmaskLength();
+    BGP::RoutingTableEntry* oldEntry = _BGPRoutingTableIndex.find(entry->getDestination(), prefixLength);
+    if (oldEntry != NULL)
     {
-        if (tieBreakingProcess(_BGPRoutingTable[BGPindex], entry))
+        if (tieBreakingProcess(oldEntry, entry))
         {
+            delete entry;
             return 0;
         }
         else
         {
             entry->setInterface(_BGPSessions[sessionIndex]->getLinkIntf());
             _BGPRoutingTable.push_back(entry);
+            _BGPRoutingTableIndex.insert(entry->getDestination(), prefixLength, entry);
             _rt->addRoute(entry);
             return BGP::ROUTE_DESTINATION_CHANGED;
         }
     }
 
     //Don't add the route if it exists in IPv4 routing table except if the msg come from IGP session
-    int indexIP = isInRoutingTable(_rt, entry->getDestination());
-    if (indexIP != -1 && _rt->getRoute(indexIP)->getSource() != IPv4Route::BGP )
+    IPv4Route* route = _rt->findBestMatchingRoute(entry->getDestination());
+    if (route != NULL && route->getSource() != IPv4Route::BGP )
     {
         if (_BGPSessions[sessionIndex]->getType() != BGP::IGP )
         {
+            delete entry;
             return 0;
         }
         else
         {
             IPv4Route* newEntry = new IPv4Route;
-            newEntry->setDestination(_rt->getRoute(indexIP)->getDestination());
-            newEntry->setNetmask(_rt->getRoute(indexIP)->getNetmask());
-            newEntry->setGateway(_rt->getRoute(indexIP)->getGateway());
-            newEntry->setInterface(_rt->getRoute(indexIP)->getInterface());
+            newEntry->setDestination(route->getDestination());
+            newEntry->setNetmask(route->getNetmask());
+            newEntry->setGateway(route->getGateway());
+            newEntry->setInterface(route->getInterface());
             newEntry->setSource(IPv4Route::BGP);
-            _rt->deleteRoute(_rt->getRoute(indexIP));
+            _rt->deleteRoute(route);
             _rt->addRoute(newEntry);
         }
     }
 
     entry->setInterface(_BGPSessions[sessionIndex]->getLinkIntf());
     _BGPRoutingTable.push_back(entry);
+    _BGPRoutingTableIndex.insert(entry->getDestination(), prefixLength, entry);
 
     if (_BGPSessions[sessionIndex]->getType() == BGP::EGP)
     {
-        std::string entryh = entry->getDestination().str();
-        std::string entryn = entry->getNetmask().str();
         _rt->addRoute(entry);
         //insertExternalRoute on OSPF ExternalRoutingTable if OSPF exist on this BGP router
-        if (ospfExist(_rt))
+        if (ospfExists)
         {
             OSPF::IPv4AddressRange  OSPFnetAddr;
             OSPFnetAddr.address = entry->getDestination();
@@ -379,16 +464,41 @@ bool BGPRouting::tieBreakingProcess(BGP::RoutingTableEntry* oldEntry, BGP::Routi
 }
 
 void BGPRouting::updateSendProcess(const unsigned char type, BGP::SessionID sessionIndex, BGP::RoutingTableEntry* entry)
+{
+    std::vector<BGP::RoutingTableEntry*> entries(1, entry);
+    updateSendProcess(type, sessionIndex, entries);
+}
+
+void BGPRouting::updateSendProcess(const unsigned char type, BGP::SessionID sessionIndex, const std::vector<BGP::RoutingTableEntry*>& entries)
 {
     //Don't send the update Message if the route exists in listOUTTable
     //SESSION = EGP : send an update message to all BGP Peer (EGP && IGP)
     //if it is not the currentSession and if the session is already established
     //SESSION = IGP : send an update message to External BGP Peer (EGP) only
     //if it is not the currentSession and if the session is already established
+    //The entries share their AS_PATH, so their prefixes are sent in the same message
+    std::vector<BGPUpdateNLRI> NLRIs;
+    for (std::vector<BGP::RoutingTableEntry*>::const_iterator it = entries.begin(); it != entries.end(); it++)
+    {
+        if (!isInPrefixList(_prefixListOUT, (*it)))
+        {
+            BGPUpdateNLRI   NLRI;
+            IPv4Address     netMask = (*it)->getNetmask();
+            NLRI.prefix = (*it)->getDestination().doAnd(netMask);
+            NLRI.length = (unsigned char) netMask.getNetmaskLength();
+            NLRIs.push_back(NLRI);
+        }
+    }
+    if (NLRIs.empty())
+    {
+        return;
+    }
+
+    BGP::RoutingTableEntry* entry = entries.front();
     for (std::map<BGP::SessionID, BGPSession*>::iterator sessionIt = _BGPSessions.begin();
         sessionIt != _BGPSessions.end(); sessionIt ++)
     {
-        if (isInTable(_prefixListOUT, entry) != (unsigned long)-1 || isInASList(_ASListOUT, entry) ||
+        if (isInASList(_ASListOUT, entry) ||
             ((*sessionIt).first == sessionIndex && type != BGP::NEW_SESSION_ESTABLISHED ) ||
             (type == BGP::NEW_SESSION_ESTABLISHED && (*sessionIt).first != sessionIndex ) ||
             !(*sessionIt).second->isEstablished() )
@@ -400,7 +510,6 @@ void BGPRouting::updateSendProcess(const unsigned char type, BGP::SessionID sess
             type == BGP::ROUTE_DESTINATION_CHANGED ||
             type == BGP::NEW_SESSION_ESTABLISHED )
         {
-            BGPUpdateNLRI                   NLRI;
             BGPUpdatePathAttributeList  content;
 
             unsigned int nbAS = entry->getASCount();
@@ -431,14 +540,15 @@ void BGPRouting::updateSendProcess(const unsigned char type, BGP::SessionID sess
             InterfaceEntry*  iftEntry = (*sessionIt).second->getLinkIntf();
             content.getOrigin().setValue((*sessionIt).second->getType());
             content.getNextHop().setValue(iftEntry->ipv4Data()->getIPAddress());
-            IPv4Address netMask = entry->getNetmask();
-            NLRI.prefix = entry->getDestination().doAnd(netMask);
-            NLRI.length = (unsigned char) netMask.getNetmaskLength();
             {
                 BGPUpdateMessage* updateMsg = new BGPUpdateMessage("BGPUpdate");
                 updateMsg->setPathAttributeListArraySize(1);
                 updateMsg->setPathAttributeList(content);
-                updateMsg->setNLRI(NLRI);
+                updateMsg->setNLRIArraySize(NLRIs.size());
+                for (unsigned int j = 0; j < NLRIs.size(); j++)
+                {
+                    updateMsg->setNLRI(j, NLRIs[j]);
+                }
                 (*sessionIt).second->getSocket()->send(updateMsg);
                 (*sessionIt).second->addUpdateMsgSent();
             }
@@ -556,21 +666,21 @@ std::vector<const char *> BGPRouting::loadASConfig(cXMLElementList& ASConfig)
         }
         if (nodeName == "DenyRoute" || nodeName == "DenyRouteIN" || nodeName == "DenyRouteOUT")
         {
-            BGP::RoutingTableEntry* entry = new BGP::RoutingTableEntry();
-            entry->setDestination(IPv4Address((*ASConfigIt)->getAttribute("Address")));
-            entry->setNetmask(IPv4Address((*ASConfigIt)->getAttribute("Netmask")));
+            IPv4Address address((*ASConfigIt)->getAttribute("Address"));
+            IPv4Address netmask((*ASConfigIt)->getAttribute("Netmask"));
+            uint32 prefix = address.getInt() & netmask.getInt();
             if (nodeName == "DenyRouteIN")
             {
-                _prefixListIN.push_back(entry);
+                _prefixListIN.insert(prefix);
             }
             else if (nodeName == "DenyRouteOUT")
             {
-                _prefixListOUT.push_back(entry);
+                _prefixListOUT.insert(prefix);
             }
             else
             {
-                _prefixListIN.push_back(entry);
-                _prefixListOUT.push_back(entry);
+                _prefixListIN.insert(prefix);
+                _prefixListOUT.insert(prefix);
             }
         }
         else if (nodeName == "DenyAS" || nodeName == "DenyASIN" || nodeName == "DenyASOUT")
@@ -716,9 +826,9 @@ BGP::SessionID BGPRouting::createSession(BGP::type typeSession, const char* peer
 }
 
 
-BGP::SessionID BGPRouting::findIdFromPeerAddr(std::map<BGP::SessionID, BGPSession*> sessions, IPv4Address peerAddr)
+BGP::SessionID BGPRouting::findIdFromPeerAddr(const std::map<BGP::SessionID, BGPSession*>& sessions, IPv4Address peerAddr)
 {
-    for (std::map<BGP::SessionID, BGPSession*>::iterator sessionIterator = sessions.begin();
+    for (std::map<BGP::SessionID, BGPSession*>::const_iterator sessionIterator = sessions.begin();
         sessionIterator != sessions.end(); sessionIterator ++)
     {
         if ((*sessionIterator).second->getPeerAddr().equals(peerAddr))
@@ -731,32 +841,17 @@ BGP::SessionID BGPRouting::findIdFromPeerAddr(std::map<BGP::SessionID, BGPSessio
 
 /*delete BGP Routing entry, if the route deleted correctly return true, false else*/
 bool BGPRouting::deleteBGPRoutingEntry(BGP::RoutingTableEntry* entry){
-    for (std::vector<BGP::RoutingTableEntry*>::iterator it = _BGPRoutingTable.begin();
-         it != _BGPRoutingTable.end(); it++)
+    if (_BGPRoutingTableIndex.remove(entry->getDestination(), entry->getNetmask().getNetmaskLength()) == NULL)
     {
-        if (((*it)->getDestination().getInt() & (*it)->getNetmask().getInt()) ==
-            (entry->getDestination().getInt() & entry->getNetmask().getInt()))
-        {
-            _BGPRoutingTable.erase(it);
-            _rt->deleteRoute(entry);
-            return true;
-        }
+        return false;
     }
-    return false;
-}
-
-/*return index of the IPv4 table if the route is found, -1 else*/
-int BGPRouting::isInRoutingTable(IRoutingTable* rtTable, IPv4Address addr)
-{
-    for (int i = 0; i < rtTable->getNumRoutes(); i++)
+    std::vector<BGP::RoutingTableEntry*>::iterator it = std::find(_BGPRoutingTable.begin(), _BGPRoutingTable.end(), entry);
+    if (it != _BGPRoutingTable.end())
     {
-        const IPv4Route* entry = rtTable->getRoute(i);
-        if (IPv4Address::maskedAddrAreEqual(addr, entry->getDestination(), entry->getNetmask()))
-        {
-            return i;
-        }
+        _BGPRoutingTable.erase(it);
     }
-    return -1;
+    _rt->deleteRoute(entry);
+    return true;
 }
 
 int BGPRouting::isInInterfaceTable(IInterfaceTable* ifTable, IPv4Address addr)
@@ -771,9 +866,9 @@ int BGPRouting::isInInterfaceTable(IInterfaceTable* ifTable, IPv4Address addr)
     return -1;
 }
 
-BGP::SessionID BGPRouting::findIdFromSocketConnId(std::map<BGP::SessionID, BGPSession*> sessions, int connId)
+BGP::SessionID BGPRouting::findIdFromSocketConnId(const std::map<BGP::SessionID, BGPSession*>& sessions, int connId)
 {
-    for (std::map<BGP::SessionID, BGPSession*>::iterator sessionIterator = sessions.begin();
+    for (std::map<BGP::SessionID, BGPSession*>::const_iterator sessionIterator = sessions.begin();
         sessionIterator != sessions.end(); sessionIterator ++)
     {
         TCPSocket* socket = (*sessionIterator).second->getSocket();
@@ -785,25 +880,16 @@ BGP::SessionID BGPRouting::findIdFromSocketConnId(std::map<BGP::SessionID, BGPSe
     return -1;
 }
 
-/*return index of the table if the route is found, -1 else*/
-unsigned long BGPRouting::isInTable(std::vector<BGP::RoutingTableEntry*> rtTable, BGP::RoutingTableEntry* entry)
+/*return true if the masked destination of the route is in the list, false else*/
+bool BGPRouting::isInPrefixList(const std::set<uint32>& prefixList, BGP::RoutingTableEntry* entry)
 {
-    for (unsigned long i = 0; i < rtTable.size(); i++)
-    {
-        BGP::RoutingTableEntry* entryCur = rtTable[i];
-        if ((entry->getDestination().getInt() & entry->getNetmask().getInt()) ==
-            (entryCur->getDestination().getInt() & entryCur->getNetmask().getInt()))
-        {
-            return i;
-        }
-    }
-    return -1;
+    return prefixList.find(entry->getDestination().getInt() & entry->getNetmask().getInt()) != prefixList.end();
 }
 
 /*return true if the AS is found, false else*/
-bool BGPRouting::isInASList(std::vector<BGP::ASID> ASList, BGP::RoutingTableEntry* entry)
+bool BGPRouting::isInASList(const std::vector<BGP::ASID>& ASList, BGP::RoutingTableEntry* entry)
 {
-    for (std::vector<BGP::ASID>::iterator it = ASList.begin(); it != ASList.end(); it++)
+    for (std::vector<BGP::ASID>::const_iterator it = ASList.begin(); it != ASList.end(); it++)
     {
         for (unsigned int i = 0; i < entry->getASCount(); i++)
         {
@@ -18,6 +18,8 @@
 #ifndef __INET_BGPROUTING_H
 #define __INET_BGPROUTING_H
 
+#include <set>
+
 #include "INETDefs.h"
 
 #include "TCPSocket.h"
@@ -26,6 +28,7 @@
 #include "InterfaceTableAccess.h"
 #include "OSPFRoutingAccess.h"
 #include "BGPRoutingTableEntry.h"
+#include "BGPPrefixTree.h"
 #include "BGPCommon.h"
 #include "IPv4InterfaceData.h"
 #include "IPv4Address.h"
@@ -64,7 +67,7 @@ protected:
     cMessage*       getCancelEvent(cMessage* msg)               { return cancelEvent(msg);}
     cGate*          getGate(const char* gateName)               { return gate(gateName);}
     IRoutingTable*  getIPRoutingTable()                         { return _rt;}
-    std::vector<BGP::RoutingTableEntry*> getBGPRoutingTable()   { return _BGPRoutingTable;}
+    const std::vector<BGP::RoutingTableEntry*>& getBGPRoutingTable()   { return _BGPRoutingTable;}
     /**
      * \brief active listenSocket for a given session (used by BGPFSM)
      */
@@ -77,6 +80,11 @@ protected:
      * \brief RFC 4271, 9.2 : Update-Send Process / Sent or not new UPDATE messages to its peers
       */
     void updateSendProcess(const unsigned char decisionProcessResult, BGP::SessionID sessionIndex, BGP::RoutingTableEntry* entry);
+    /**
+     * \brief Update-Send Process for routes with the same AS_PATH: one UPDATE message
+     *  per peer carries all of their prefixes
+     */
+    void updateSendProcess(const unsigned char decisionProcessResult, BGP::SessionID sessionIndex, const std::vector<BGP::RoutingTableEntry*>& entries);
     /**
      * \brief find the next SessionID compared to his type and start this session if boolean is true
      */
@@ -101,8 +109,10 @@ private:
      * \brief RFC 4271: 9.1. : Decision Process used when an UPDATE message is received
      *  As matches, routes are sent or not to UpdateSentProcess
      *  The result can be ROUTE_DESTINATION_CHANGED, NEW_ROUTE_ADDED or 0 if no routingTable modification
+     *  (then the entry is deleted). Only the route already selected for the prefix of the entry is
+     *  considered.
      */
-    unsigned char decisionProcess(const BGPUpdateMessage& msg, BGP::RoutingTableEntry* entry, BGP::SessionID sessionIndex);
+    unsigned char decisionProcess(BGP::RoutingTableEntry* entry, BGP::SessionID sessionIndex, bool ospfExists);
     /**
      * \brief RFC 4271: 9.1.2.2 Breaking Ties used when BGP speaker may have several routes
      *  to the same destination that have the same degree of preference.
@@ -112,8 +122,8 @@ private:
     bool tieBreakingProcess(BGP::RoutingTableEntry* oldEntry, BGP::RoutingTableEntry* entry);
 
     BGP::SessionID createSession(BGP::type typeSession, const char* peerAddr);
-    bool isInASList(std::vector<BGP::ASID> ASList, BGP::RoutingTableEntry* entry);
-    unsigned long   isInTable(std::vector<BGP::RoutingTableEntry*> rtTable, BGP::RoutingTableEntry* entry);
+    bool isInASList(const std::vector<BGP::ASID>& ASList, BGP::RoutingTableEntry* entry);
+    bool isInPrefixList(const std::set<uint32>& prefixList, BGP::RoutingTableEntry* entry);
 
     std::vector<const char *> loadASConfig(cXMLElementList& ASConfig);
     void loadSessionConfig(cXMLElementList& sessionList, simtime_t* delayTab);
@@ -122,10 +132,9 @@ private:
     bool ospfExist(IRoutingTable* rtTable);
     void loadTimerConfig(cXMLElementList& timerConfig, simtime_t* delayTab);
     unsigned char asLoopDetection(BGP::RoutingTableEntry* entry, BGP::ASID myAS);
-    BGP::SessionID findIdFromPeerAddr(std::map<BGP::SessionID, BGPSession*> sessions, IPv4Address peerAddr);
-    int isInRoutingTable(IRoutingTable* rtTable, IPv4Address addr);
+    BGP::SessionID findIdFromPeerAddr(const std::map<BGP::SessionID, BGPSession*>& sessions, IPv4Address peerAddr);
     int isInInterfaceTable(IInterfaceTable* rtTable, IPv4Address addr);
-    BGP::SessionID findIdFromSocketConnId(std::map<BGP::SessionID, BGPSession*> sessions, int connId);
+    BGP::SessionID findIdFromSocketConnId(const std::map<BGP::SessionID, BGPSession*>& sessions, int connId);
     unsigned int calculateStartDelay(int rtListSize, unsigned char rtPosition, unsigned char rtPeerPosition);
 
     TCPSocketMap                            _socketMap;
@@ -134,9 +143,10 @@ private:
 
     IInterfaceTable*                        _inft;
     IRoutingTable*                          _rt;                // The IP routing table
-    std::vector<BGP::RoutingTableEntry*>    _BGPRoutingTable;   // The BGP routing table
-    std::vector<BGP::RoutingTableEntry*>    _prefixListIN;
-    std::vector<BGP::RoutingTableEntry*>    _prefixListOUT;
+    std::vector<BGP::RoutingTableEntry*>    _BGPRoutingTable;   // The BGP routing table (Loc-RIB), in the order the routes were selected
+    BGP::PrefixTree                         _BGPRoutingTableIndex;  // The same routes by prefix
+    std::set<uint32>                        _prefixListIN;      // denied prefixes, as masked addresses
+    std::set<uint32>                        _prefixListOUT;
     std::vector<BGP::ASID>                  _ASListIN;
     std::vector<BGP::ASID>                  _ASListOUT;
     std::map<BGP::SessionID, BGPSession*>   _BGPSessions;
@@ -38,10 +38,22 @@ BGPSession::~BGPSession()
     _bgpRouting.getCancelAndDelete(_ptrStartEvent);
     _bgpRouting.getCancelAndDelete(_ptrHoldTimer);
     _bgpRouting.getCancelAndDelete(_ptrKeepAliveTimer);
+    clearAdjRIBIn();
     _info.socket->~TCPSocket();
     _info.socketListen->~TCPSocket();
 }
 
+void BGPSession::clearAdjRIBIn()
+{
+    std::vector<BGP::RoutingTableEntry*> adjRIBIn;
+    _adjRIBIn.getEntries(adjRIBIn);
+    for (std::vector<BGP::RoutingTableEntry*>::iterator it = adjRIBIn.begin(); it != adjRIBIn.end(); it++)
+    {
+        delete (*it);
+    }
+    _adjRIBIn.clear();
+}
+
 void BGPSession::setInfo(BGP::SessionInfo info)
 {
     _info.sessionType = info.sessionType;
@@ -23,6 +23,7 @@
 #include "INETDefs.h"
 
 #include "BGPCommon.h"
+#include "BGPPrefixTree.h"
 #include "TCPSocket.h"
 #include "BGPRouting.h"
 #include "BGPFSM.h"
@@ -62,7 +63,9 @@ public:
     TCPSocket*      getSocket()                                 { return _info.socket;}
     TCPSocket*      getSocketListen()                           { return _info.socketListen;}
     IRoutingTable*  getIPRoutingTable()                         { return _bgpRouting.getIPRoutingTable();}
-    std::vector<BGP::RoutingTableEntry*> getBGPRoutingTable()   { return _bgpRouting.getBGPRoutingTable();}
+    const std::vector<BGP::RoutingTableEntry*>& getBGPRoutingTable()   { return _bgpRouting.getBGPRoutingTable();}
+    BGP::PrefixTree&                     getAdjRIBIn()          { return _adjRIBIn;}
+    void                                 clearAdjRIBIn();
     Macho::Machine<BGPFSM::TopState>&    getFSM()               { return *_fsm;}
     bool checkExternalRoute(const IPv4Route* ospfRoute)           { return _bgpRouting.checkExternalRoute(ospfRoute);}
     void updateSendProcess(BGP::RoutingTableEntry* entry)       { return _bgpRouting.updateSendProcess(BGP::NEW_SESSION_ESTABLISHED, _info.sessionID, entry);}
@@ -70,6 +73,7 @@ public:
 private:
     BGP::SessionInfo    _info;
     BGPRouting&         _bgpRouting;
+    BGP::PrefixTree     _adjRIBIn;      // the last accepted route received from the peer for each prefix (Adj-RIB-In) while established, owned
 
     static const int    BGP_RETRY_TIME = 120;
     static const int    BGP_HOLD_TIME = 180;
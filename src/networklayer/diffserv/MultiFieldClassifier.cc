@@ -41,91 +41,6 @@
 
 using namespace DiffservUtil;
 
-#ifdef WITH_IPv4
-bool MultiFieldClassifier::Filter::matches(IPv4Datagram *datagram)
-{
-    if (srcPrefixLength > 0 && (srcAddr.isIPv6() || !datagram->getSrcAddress().prefixMatches(srcAddr.get4(), srcPrefixLength)))
-        return false;
-    if (destPrefixLength > 0 && (destAddr.isIPv6() || !datagram->getDestAddress().prefixMatches(destAddr.get4(), destPrefixLength)))
-        return false;
-    if (protocol >= 0 && datagram->getTransportProtocol() != protocol)
-        return false;
-    if (tosMask != 0 && (tos & tosMask) != (datagram->getTypeOfService() & tosMask))
-        return false;
-    if (srcPortMin >= 0 || destPortMin >= 0)
-    {
-        int srcPort = -1, destPort = -1;
-        cPacket *packet = datagram->getEncapsulatedPacket();
-#ifdef WITH_UDP
-        UDPPacket *udpPacket = dynamic_cast<UDPPacket*>(packet);
-        if (udpPacket)
-        {
-            srcPort = udpPacket->getSourcePort();
-            destPort = udpPacket->getDestinationPort();
-        }
-#endif
-#ifdef WITH_TCP_COMMON
-        TCPSegment *tcpSegment = dynamic_cast<TCPSegment*>(packet);
-        if (tcpSegment)
-        {
-            srcPort = tcpSegment->getSrcPort();
-            destPort = tcpSegment->getDestPort();
-        }
-#endif
-
-        if (srcPortMin >= 0 && (srcPort < srcPortMin || srcPort > srcPortMax))
-            return false;
-        if (destPortMin >= 0 && (destPort < destPortMin || destPort > destPortMax))
-            return false;
-    }
-
-    return true;
-}
-#endif
-
-#ifdef WITH_IPv6
-bool MultiFieldClassifier::Filter::matches(IPv6Datagram *datagram)
-{
-    if (srcPrefixLength > 0 && (!srcAddr.isIPv6() || !datagram->getSrcAddress().matches(srcAddr.get6(), srcPrefixLength)))
-        return false;
-    if (destPrefixLength > 0 && (!destAddr.isIPv6() || !datagram->getDestAddress().matches(destAddr.get6(), destPrefixLength)))
-        return false;
-    if (protocol >= 0 && datagram->getTransportProtocol() != protocol)
-        return false;
-    if (tosMask != 0 && (tos & tosMask) != (datagram->getTrafficClass() & tosMask))
-        return false;
-    if (srcPortMin >= 0 || destPortMin >= 0)
-    {
-        int srcPort = -1, destPort = -1;
-        cPacket *packet = datagram->getEncapsulatedPacket();
-#ifdef WITH_UDP
-        UDPPacket *udpPacket = dynamic_cast<UDPPacket*>(packet);
-        if (udpPacket)
-        {
-            srcPort = udpPacket->getSourcePort();
-            destPort = udpPacket->getDestinationPort();
-        }
-#endif
-#ifdef WITH_TCP_COMMON
-        TCPSegment *tcpSegment = dynamic_cast<TCPSegment*>(packet);
-        if (tcpSegment)
-        {
-            srcPort = tcpSegment->getSrcPort();
-            destPort = tcpSegment->getDestPort();
-        }
-#endif
-
-        if (srcPortMin >= 0 && (srcPort < srcPortMin || srcPort > srcPortMax))
-            return false;
-        if (destPortMin >= 0 && (destPort < destPortMin || destPort > destPortMax))
-            return false;
-    }
-
-    return true;
-}
-#endif
-
-
 Define_Module(MultiFieldClassifier);
 
 simsignal_t MultiFieldClassifier::pkClassSignal = SIMSIGNAL_NULL;
@@ -145,6 +60,7 @@ void MultiFieldClassifier::initialize(int stage)
     {
         cXMLElement *config = par("filters").xmlValue();
         configureFilters(config);
+        filterIndex.build(filters);
     }
 }
 
@@ -173,26 +89,59 @@ int MultiFieldClassifier::classifyPacket(cPacket *packet)
 {
     for (; packet; packet = packet->getEncapsulatedPacket())
     {
+        MultiFieldFilterIndex::PacketFields fields;
+        cPacket *transportPacket = NULL;
+        bool found = false;
 #ifdef WITH_IPv4
         IPv4Datagram *ipv4Datagram = dynamic_cast<IPv4Datagram*>(packet);
         if (ipv4Datagram)
         {
-            for (std::vector<Filter>::iterator it = filters.begin(); it != filters.end(); ++it)
-                if (it->matches(ipv4Datagram))
-                    return it->gateIndex;
-            return -1;
+            fields.srcAddr = ipv4Datagram->getSrcAddress();
+            fields.destAddr = ipv4Datagram->getDestAddress();
+            fields.protocol = ipv4Datagram->getTransportProtocol();
+            fields.tos = ipv4Datagram->getTypeOfService();
+            transportPacket = ipv4Datagram->getEncapsulatedPacket();
+            found = true;
         }
 #endif
 #ifdef WITH_IPv6
-        IPv6Datagram *ipv6Datagram = dynamic_cast<IPv6Datagram *>(packet);
+        IPv6Datagram *ipv6Datagram = found ? NULL : dynamic_cast<IPv6Datagram *>(packet);
         if (ipv6Datagram)
         {
-            for (std::vector<Filter>::iterator it = filters.begin(); it != filters.end(); ++it)
-                if (it->matches(ipv6Datagram))
-                    return it->gateIndex;
-            return -1;
+            fields.srcAddr = ipv6Datagram->getSrcAddress();
+            fields.destAddr = ipv6Datagram->getDestAddress();
+            fields.protocol = ipv6Datagram->getTransportProtocol();
+            fields.tos = ipv6Datagram->getTrafficClass();
+            transportPacket = ipv6Datagram->getEncapsulatedPacket();
+            found = true;
         }
 #endif
+        if (!found)
+            continue;
+
+        // the transport header is only looked at if some filter needs the ports
+        if (filterIndex.usesPorts())
+        {
+#ifdef WITH_UDP
+            UDPPacket *udpPacket = dynamic_cast<UDPPacket*>(transportPacket);
+            if (udpPacket)
+            {
+                fields.srcPort = udpPacket->getSourcePort();
+                fields.destPort = udpPacket->getDestinationPort();
+            }
+#endif
+#ifdef WITH_TCP_COMMON
+            TCPSegment *tcpSegment = dynamic_cast<TCPSegment*>(transportPacket);
+            if (tcpSegment)
+            {
+                fields.srcPort = tcpSegment->getSrcPort();
+                fields.destPort = tcpSegment->getDestPort();
+            }
+#endif
+        }
+
+        int index = filterIndex.findFirstMatch(fields);
+        return index >= 0 ? filters[index].gateIndex : -1;
     }
 
     return -1;
@@ -0,0 +1,292 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <map>
+
+#include "MultiFieldFilterIndex.h"
+
+
+bool MultiFieldFilterIndex::Filter::matches(const PacketFields& fields) const
+{
+    bool ipv6 = fields.srcAddr.isIPv6();
+    if (srcPrefixLength > 0)
+    {
+        if (srcAddr.isIPv6() != ipv6)
+            return false;
+        if (ipv6 ? !fields.srcAddr.get6().matches(srcAddr.get6(), srcPrefixLength) : !fields.srcAddr.get4().prefixMatches(srcAddr.get4(), srcPrefixLength))
+            return false;
+    }
+    if (destPrefixLength > 0)
+    {
+        if (destAddr.isIPv6() != ipv6)
+            return false;
+        if (ipv6 ? !fields.destAddr.get6().matches(destAddr.get6(), destPrefixLength) : !fields.destAddr.get4().prefixMatches(destAddr.get4(), destPrefixLength))
+            return false;
+    }
+    if (protocol >= 0 && fields.protocol != protocol)
+        return false;
+    if (tosMask != 0 && (tos & tosMask) != (fields.tos & tosMask))
+        return false;
+    if (srcPortMin >= 0 && (fields.srcPort < srcPortMin || fields.srcPort > srcPortMax))
+        return false;
+    if (destPortMin >= 0 && (fields.destPort < destPortMin || fields.destPort > destPortMax))
+        return false;
+    return true;
+}
+
+bool MultiFieldFilterIndex::Key::operator<(const Key& other) const
+{
+    for (int i = 0; i < 4; i++)
+        if (w[i] != other.w[i])
+            return w[i] < other.w[i];
+    return false;
+}
+
+bool MultiFieldFilterIndex::Key::operator==(const Key& other) const
+{
+    return w[0] == other.w[0] && w[1] == other.w[1] && w[2] == other.w[2] && w[3] == other.w[3];
+}
+
+int MultiFieldFilterIndex::IntervalMap::find(const Key& key) const
+{
+    // last interval starting at or before key
+    int lo = 0, hi = starts.size();
+    while (hi - lo > 1)
+    {
+        int mid = (lo + hi) / 2;
+        if (key < starts[mid])
+            hi = mid;
+        else
+            lo = mid;
+    }
+    return bitmaps[lo];
+}
+
+MultiFieldFilterIndex::Key MultiFieldFilterIndex::makeKey(const IPvXAddress& addr)
+{
+    Key key;
+    if (addr.isIPv6())
+    {
+        IPv6Address addr6 = addr.get6();
+        for (int i = 0; i < 4; i++)
+            key.w[i] = addr6.words()[i];
+    }
+    else
+    {
+        key.w[0] = addr.get4().getInt();
+        key.w[1] = key.w[2] = key.w[3] = 0;
+    }
+    return key;
+}
+
+MultiFieldFilterIndex::Key MultiFieldFilterIndex::makeKey(uint32 value)
+{
+    Key key;
+    key.w[0] = value;
+    key.w[1] = key.w[2] = key.w[3] = 0;
+    return key;
+}
+
+bool MultiFieldFilterIndex::isApplicable(const Filter& filter, bool ipv6)
+{
+    return (filter.srcPrefixLength == 0 || filter.srcAddr.isIPv6() == ipv6) &&
+           (filter.destPrefixLength == 0 || filter.destAddr.isIPv6() == ipv6);
+}
+
+int MultiFieldFilterIndex::addBitmap(const std::vector<uint64>& bitmap, Tables& tables)
+{
+    int id = tables.bitmaps.size() / numWords;
+    tables.bitmaps.insert(tables.bitmaps.end(), bitmap.begin(), bitmap.end());
+    return id;
+}
+
+void MultiFieldFilterIndex::buildIntervalMap(const std::vector<Key>& firsts, const std::vector<Key>& lasts, const std::vector<bool>& used, IntervalMap& map, Tables& tables)
+{
+    // events: filter i becomes matching at firsts[i], and stops matching after lasts[i]
+    std::vector<std::pair<Key, int> > events;   // second is i to set bit i, ~i to clear it
+    for (int i = 0; i < (int)firsts.size(); i++)
+    {
+        if (!used[i])
+            continue;
+        events.push_back(std::make_pair(firsts[i], i));
+        Key next = lasts[i];
+        int k = 3;
+        while (k >= 0 && ++next.w[k] == 0)
+            k--;
+        if (k >= 0)  // no overflow
+            events.push_back(std::make_pair(next, ~i));
+    }
+    std::sort(events.begin(), events.end());
+
+    map.starts.clear();
+    map.bitmaps.clear();
+    std::vector<uint64> bitmap(numWords, 0);
+    std::vector<uint64> prevBitmap;
+    Key start = makeKey(0);
+    unsigned int e = 0;
+    while (true)
+    {
+        for ( ; e < events.size() && events[e].first == start; e++)
+        {
+            int i = events[e].second;
+            if (i >= 0)
+                bitmap[i / 64] |= (uint64)1 << (i % 64);
+            else
+                bitmap[~i / 64] &= ~((uint64)1 << (~i % 64));
+        }
+        if (map.starts.empty() || bitmap != prevBitmap)
+        {
+            map.starts.push_back(start);
+            map.bitmaps.push_back(addBitmap(bitmap, tables));
+            prevBitmap = bitmap;
+        }
+        if (e == events.size())
+            break;
+        start = events[e].first;
+    }
+}
+
+void MultiFieldFilterIndex::getPrefixRange(const IPvXAddress& addr, int prefixLength, Key& first, Key& last)
+{
+    Key key = makeKey(addr);
+    int numBits = addr.isIPv6() ? 128 : 32;
+    for (int i = 0; i < 4; i++)
+    {
+        int bits = std::min(std::max(prefixLength - 32 * i, 0), 32);
+        uint32 mask = bits == 0 ? 0 : bits == 32 ? 0xffffffffu : ~(0xffffffffu >> bits);
+        first.w[i] = key.w[i] & mask;
+        last.w[i] = 32 * i < numBits ? (first.w[i] | ~mask) : 0;
+    }
+}
+
+void MultiFieldFilterIndex::buildTables(const std::vector<Filter>& filters, bool ipv6, Tables& tables)
+{
+    int n = filters.size();
+    std::vector<bool> used(n);
+    for (int i = 0; i < n; i++)
+        used[i] = isApplicable(filters[i], ipv6);
+
+    tables.bitmaps.clear();
+
+    // addresses
+    Key zero = makeKey(0);
+    Key maxAddress = makeKey(0xffffffffu);
+    if (ipv6)
+        maxAddress.w[1] = maxAddress.w[2] = maxAddress.w[3] = 0xffffffffu;
+    std::vector<Key> firsts(n), lasts(n);
+    for (int i = 0; i < n; i++)
+    {
+        if (filters[i].srcPrefixLength > 0)
+            getPrefixRange(filters[i].srcAddr, filters[i].srcPrefixLength, firsts[i], lasts[i]);
+        else
+            firsts[i] = zero, lasts[i] = maxAddress;
+    }
+    buildIntervalMap(firsts, lasts, used, tables.srcAddr, tables);
+    for (int i = 0; i < n; i++)
+    {
+        if (filters[i].destPrefixLength > 0)
+            getPrefixRange(filters[i].destAddr, filters[i].destPrefixLength, firsts[i], lasts[i]);
+        else
+            firsts[i] = zero, lasts[i] = maxAddress;
+    }
+    buildIntervalMap(firsts, lasts, used, tables.destAddr, tables);
+
+    // ports, shifted by one so that "no port" (-1) is 0
+    for (int i = 0; i < n; i++)
+    {
+        if (filters[i].srcPortMin >= 0)
+            firsts[i] = makeKey(filters[i].srcPortMin + 1), lasts[i] = makeKey(filters[i].srcPortMax + 1);
+        else
+            firsts[i] = zero, lasts[i] = makeKey(0x10000);
+    }
+    buildIntervalMap(firsts, lasts, used, tables.srcPort, tables);
+    for (int i = 0; i < n; i++)
+    {
+        if (filters[i].destPortMin >= 0)
+            firsts[i] = makeKey(filters[i].destPortMin + 1), lasts[i] = makeKey(filters[i].destPortMax + 1);
+        else
+            firsts[i] = zero, lasts[i] = makeKey(0x10000);
+    }
+    buildIntervalMap(firsts, lasts, used, tables.destPort, tables);
+
+    // protocol and ToS: a table for all 256 values; equal bitmaps are stored once
+    std::map<std::vector<uint64>, int> bitmapIds;
+    tables.protocol.resize(256);
+    tables.tos.resize(256);
+    for (int value = 0; value < 256; value++)
+    {
+        std::vector<uint64> protocolBitmap(numWords, 0), tosBitmap(numWords, 0);
+        for (int i = 0; i < n; i++)
+        {
+            const Filter& filter = filters[i];
+            if (used[i] && (filter.protocol < 0 || filter.protocol == value))
+                protocolBitmap[i / 64] |= (uint64)1 << (i % 64);
+            if (used[i] && (filter.tosMask == 0 || (filter.tos & filter.tosMask) == (value & filter.tosMask)))
+                tosBitmap[i / 64] |= (uint64)1 << (i % 64);
+        }
+        std::map<std::vector<uint64>, int>::iterator it = bitmapIds.find(protocolBitmap);
+        if (it == bitmapIds.end())
+            it = bitmapIds.insert(std::make_pair(protocolBitmap, addBitmap(protocolBitmap, tables))).first;
+        tables.protocol[value] = it->second;
+        it = bitmapIds.find(tosBitmap);
+        if (it == bitmapIds.end())
+            it = bitmapIds.insert(std::make_pair(tosBitmap, addBitmap(tosBitmap, tables))).first;
+        tables.tos[value] = it->second;
+    }
+}
+
+void MultiFieldFilterIndex::build(const std::vector<Filter>& filters)
+{
+    numWords = (filters.size() + 63) / 64;
+    portsUsed = false;
+    for (int i = 0; i < (int)filters.size(); i++)
+        if (filters[i].srcPortMin >= 0 || filters[i].destPortMin >= 0)
+            portsUsed = true;
+    if (numWords == 0)
+        return;
+
+    buildTables(filters, false, ipv4Tables);
+    buildTables(filters, true, ipv6Tables);
+}
+
+int MultiFieldFilterIndex::findFirstMatch(const PacketFields& fields) const
+{
+    if (numWords == 0)
+        return -1;
+
+    const Tables& tables = fields.srcAddr.isIPv6() ? ipv6Tables : ipv4Tables;
+    const uint64 *srcAddrBitmap = &tables.bitmaps[tables.srcAddr.find(makeKey(fields.srcAddr)) * numWords];
+    const uint64 *destAddrBitmap = &tables.bitmaps[tables.destAddr.find(makeKey(fields.destAddr)) * numWords];
+    const uint64 *srcPortBitmap = &tables.bitmaps[tables.srcPort.find(makeKey(fields.srcPort + 1)) * numWords];
+    const uint64 *destPortBitmap = &tables.bitmaps[tables.destPort.find(makeKey(fields.destPort + 1)) * numWords];
+    const uint64 *protocolBitmap = &tables.bitmaps[tables.protocol[fields.protocol & 0xff] * numWords];
+    const uint64 *tosBitmap = &tables.bitmaps[tables.tos[fields.tos & 0xff] * numWords];
+
+    for (int i = 0; i < numWords; i++)
+    {
+        uint64 word = srcAddrBitmap[i] & destAddrBitmap[i] & srcPortBitmap[i] & destPortBitmap[i] & protocolBitmap[i] & tosBitmap[i];
+        if (word != 0)
+        {
+            int bit = 0;
+            while ((word & 0xffffffffu) == 0)
+                word >>= 32, bit += 32;
+            while ((word & 1) == 0)
+                word >>= 1, bit++;
+            return 64 * i + bit;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,136 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __INET_MULTIFIELDFILTERINDEX_H
+#define __INET_MULTIFIELDFILTERINDEX_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "IPvXAddress.h"
+
+/**
+ * Finds the first filter of MultiFieldClassifier that matches a packet,
+ * by bitmap intersection.
+ *
+ * For each header field, the range of possible values is cut into
+ * intervals at the boundaries of the filter conditions, so that all values
+ * of an interval match the same set of filters. That set is stored as a
+ * bitmap indexed by filter position. Classifying a packet takes a binary
+ * search per field and the AND of the six bitmaps; the lowest set bit
+ * is the first matching filter, as with evaluating the filters in order.
+ * IPv4 and IPv6 packets use separate tables.
+ */
+class INET_API MultiFieldFilterIndex
+{
+  public:
+    /**
+     * The header fields of a packet used for classification.
+     */
+    struct PacketFields
+    {
+        IPvXAddress srcAddr;
+        IPvXAddress destAddr;
+        int protocol;
+        int tos;
+        int srcPort;    // -1 if there is no UDP or TCP header
+        int destPort;   // -1 if there is no UDP or TCP header
+
+        PacketFields() : protocol(-1), tos(0), srcPort(-1), destPort(-1) {}
+    };
+
+    struct Filter
+    {
+        int gateIndex;
+
+        IPvXAddress srcAddr;
+        int srcPrefixLength;
+        IPvXAddress destAddr;
+        int destPrefixLength;
+        int protocol;
+        int tos;
+        int tosMask;
+        int srcPortMin;
+        int srcPortMax;
+        int destPortMin;
+        int destPortMax;
+
+        Filter() : gateIndex(-1),
+                   srcPrefixLength(0), destPrefixLength(0), protocol(-1), tos(0), tosMask(0),
+                   srcPortMin(-1), srcPortMax(-1), destPortMin(-1), destPortMax(-1)  {}
+
+        /** Evaluates the filter directly */
+        bool matches(const PacketFields& fields) const;
+    };
+
+  protected:
+    // field value, as an unsigned number of up to 128 bits, most significant word first
+    struct Key
+    {
+        uint32 w[4];
+        bool operator<(const Key& other) const;
+        bool operator==(const Key& other) const;
+    };
+
+    // maps the intervals of a field to bitmaps
+    struct IntervalMap
+    {
+        std::vector<Key> starts;  // first value of each interval, ascending; starts[0] is zero
+        std::vector<int> bitmaps; // bitmap id of each interval
+        int find(const Key& key) const;
+    };
+
+    // tables of one address family
+    struct Tables
+    {
+        IntervalMap srcAddr;
+        IntervalMap destAddr;
+        IntervalMap srcPort;      // port+1, so that "no port" is 0
+        IntervalMap destPort;
+        std::vector<int> protocol; // bitmap id for each protocol number
+        std::vector<int> tos;      // bitmap id for each ToS/traffic class value
+        std::vector<uint64> bitmaps; // numWords words per bitmap
+    };
+
+    int numWords;
+    bool portsUsed;
+    Tables ipv4Tables;
+    Tables ipv6Tables;
+
+  protected:
+    static Key makeKey(const IPvXAddress& addr);
+    static Key makeKey(uint32 value);
+    static void getPrefixRange(const IPvXAddress& addr, int prefixLength, Key& first, Key& last);
+    static bool isApplicable(const Filter& filter, bool ipv6);
+    void buildTables(const std::vector<Filter>& filters, bool ipv6, Tables& tables);
+    void buildIntervalMap(const std::vector<Key>& firsts, const std::vector<Key>& lasts, const std::vector<bool>& used, IntervalMap& map, Tables& tables);
+    int addBitmap(const std::vector<uint64>& bitmap, Tables& tables);
+
+  public:
+    MultiFieldFilterIndex() : numWords(0), portsUsed(false) {}
+
+    /** Builds the tables for the given filters, replacing the previous ones */
+    void build(const std::vector<Filter>& filters);
+
+    /** Returns the index of the first filter that matches, or -1 */
+    int findFirstMatch(const PacketFields& fields) const;
+
+    /** Returns true if any filter refers to ports, i.e. PacketFields needs them */
+    bool usesPorts() const {return portsUsed;}
+};
+
+#endif
@@ -32,6 +32,10 @@
 
 Define_Module(IPv4);
 
+simsignal_t IPv4::reassemblyTimeoutSignal = SIMSIGNAL_NULL;
+simsignal_t IPv4::reassemblyOverflowSignal = SIMSIGNAL_NULL;
+simsignal_t IPv4::reassemblyBufferSizeSignal = SIMSIGNAL_NULL;
+
 
 void IPv4::initialize()
 {
@@ -49,8 +53,12 @@ void IPv4::initialize()
     mapping.parseProtocolMapping(par("protocolMapping"));
 
     curFragmentId = 0;
-    lastCheckTime = 0;
     fragbuf.init(icmpAccess.get());
+    fragbuf.setMaxBufferedBytes(par("fragmentBufferLimit").longValue());
+
+    reassemblyTimeoutSignal = registerSignal("reassemblyTimeout");
+    reassemblyOverflowSignal = registerSignal("reassemblyOverflow");
+    reassemblyBufferSizeSignal = registerSignal("reassemblyBufferSize");
 
     numMulticast = numLocalDeliver = numDropped = numUnroutable = numForwarded = 0;
 
@@ -553,14 +561,17 @@ void IPv4::reassembleAndDeliver(IPv4Datagram *datagram)
         EV << "Datagram fragment: offset=" << datagram->getFragmentOffset()
            << ", MORE=" << (datagram->getMoreFragments() ? "true" : "false") << ".\n";
 
-        // erase timed out fragments in fragmentation buffer; check every 10 seconds max
-        if (simTime() >= lastCheckTime + 10)
-        {
-            lastCheckTime = simTime();
-            fragbuf.purgeStaleFragments(simTime()-fragmentTimeoutTime);
-        }
+        // erase timed out fragments in fragmentation buffer; this only
+        // visits the datagrams that time out
+        int numTimedOut = fragbuf.purgeStaleFragments(simTime()-fragmentTimeoutTime);
+        if (numTimedOut > 0)
+            emit(reassemblyTimeoutSignal, (long)numTimedOut);
 
+        long numEvicted = fragbuf.getNumEvicted();
         datagram = fragbuf.addFragment(datagram, simTime());
+        if (fragbuf.getNumEvicted() != numEvicted)
+            emit(reassemblyOverflowSignal, fragbuf.getNumEvicted() - numEvicted);
+        emit(reassemblyBufferSizeSignal, fragbuf.getBufferedBytes());
         if (!datagram)
         {
             EV << "No complete datagram yet.\n";
@@ -61,7 +61,6 @@ class INET_API IPv4 : public QueueBase
     // working vars
     long curFragmentId; // counter, used to assign unique fragmentIds to datagrams
     IPv4FragBuf fragbuf;  // fragmentation reassembly buffer
-    simtime_t lastCheckTime; // when fragbuf was last checked for state fragments
     ProtocolMapping mapping; // where to send packets after decapsulation
 
     // statistics
@@ -71,6 +70,9 @@ class INET_API IPv4 : public QueueBase
     int numUnroutable;
     int numForwarded;
 
+    static simsignal_t reassemblyTimeoutSignal;
+    static simsignal_t reassemblyOverflowSignal;
+    static simsignal_t reassemblyBufferSizeSignal;
 
   protected:
     // utility: look up interface from getArrivalGate()
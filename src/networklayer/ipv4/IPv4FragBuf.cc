@@ -27,17 +27,20 @@
 
 IPv4FragBuf::IPv4FragBuf()
 {
+    numBuffers = 0;
+    oldest = newest = NULL;
+    bufferedBytes = 0;
+    maxBufferedBytes = 0;
+    numEvicted = 0;
     icmpModule = NULL;
 }
 
 IPv4FragBuf::~IPv4FragBuf()
 {
-    while (!bufs.empty())
+    while (oldest)
     {
-        if (bufs.begin()->second.datagram)
-            delete bufs.begin()->second.datagram;
-
-        bufs.erase(bufs.begin());
+        delete oldest->datagram;
+        removeBuffer(oldest);
     }
 }
 
@@ -46,6 +49,98 @@ void IPv4FragBuf::init(ICMP *icmp)
     icmpModule = icmp;
 }
 
+unsigned int IPv4FragBuf::hash(const Key& key)
+{
+    uint32 h = key.id * 0x9e3779b9u;
+    h ^= key.src.getInt() * 0x85ebca6bu;
+    h ^= key.dest.getInt() * 0xc2b2ae35u;
+    return h ^ (h >> 16);
+}
+
+IPv4FragBuf::DatagramBuffer *IPv4FragBuf::findBuffer(const Key& key) const
+{
+    if (buckets.empty())
+        return NULL;
+    DatagramBuffer *buf = buckets[hash(key) & (buckets.size() - 1)];
+    while (buf && !(buf->key == key))
+        buf = buf->nextInBucket;
+    return buf;
+}
+
+IPv4FragBuf::DatagramBuffer *IPv4FragBuf::createBuffer(const Key& key)
+{
+    // keep at most one buffer per bucket on average
+    if (numBuffers + 1 > (int)buckets.size())
+    {
+        std::vector<DatagramBuffer *> newBuckets(buckets.empty() ? 16 : 2 * buckets.size(), (DatagramBuffer *)NULL);
+        for (DatagramBuffer *buf = oldest; buf; buf = buf->next)
+        {
+            unsigned int i = hash(buf->key) & (newBuckets.size() - 1);
+            buf->nextInBucket = newBuckets[i];
+            newBuckets[i] = buf;
+        }
+        buckets.swap(newBuckets);
+    }
+
+    DatagramBuffer *buf = new DatagramBuffer();
+    buf->key = key;
+    buf->datagram = NULL;
+    buf->bytes = 0;
+    unsigned int i = hash(key) & (buckets.size() - 1);
+    buf->nextInBucket = buckets[i];
+    buckets[i] = buf;
+
+    // append to the list as the newest
+    buf->prev = newest;
+    buf->next = NULL;
+    if (newest)
+        newest->next = buf;
+    else
+        oldest = buf;
+    newest = buf;
+    numBuffers++;
+    return buf;
+}
+
+void IPv4FragBuf::touchBuffer(DatagramBuffer *buf, simtime_t now)
+{
+    buf->lastupdate = now;
+    if (buf == newest)
+        return;
+
+    // move to the end of the list
+    if (buf->prev)
+        buf->prev->next = buf->next;
+    else
+        oldest = buf->next;
+    buf->next->prev = buf->prev;
+    buf->prev = newest;
+    buf->next = NULL;
+    newest->next = buf;
+    newest = buf;
+}
+
+void IPv4FragBuf::removeBuffer(DatagramBuffer *buf)
+{
+    DatagramBuffer **p = &buckets[hash(buf->key) & (buckets.size() - 1)];
+    while (*p != buf)
+        p = &(*p)->nextInBucket;
+    *p = buf->nextInBucket;
+
+    if (buf->prev)
+        buf->prev->next = buf->next;
+    else
+        oldest = buf->next;
+    if (buf->next)
+        buf->next->prev = buf->prev;
+    else
+        newest = buf->prev;
+
+    bufferedBytes -= buf->bytes;
+    numBuffers--;
+    delete buf;
+}
+
 IPv4Datagram *IPv4FragBuf::addFragment(IPv4Datagram *datagram, simtime_t now)
 {
     // find datagram buffer
@@ -54,20 +149,12 @@ IPv4Datagram *IPv4FragBuf::addFragment(IPv4Datagram *datagram, simtime_t now)
     key.src = datagram->getSrcAddress();
     key.dest = datagram->getDestAddress();
 
-    Buffers::iterator i = bufs.find(key);
-
-    DatagramBuffer *buf = NULL;
+    DatagramBuffer *buf = findBuffer(key);
 
-    if (i == bufs.end())
+    if (buf == NULL)
     {
         // this is the first fragment of that datagram, create reassembly buffer for it
-        buf = &bufs[key];
-        buf->datagram = NULL;
-    }
-    else
-    {
-        // use existing buffer
-        buf = &(i->second);
+        buf = createBuffer(key);
     }
 
     // add fragment into reassembly buffer
@@ -75,6 +162,8 @@ IPv4Datagram *IPv4FragBuf::addFragment(IPv4Datagram *datagram, simtime_t now)
     bool isComplete = buf->buf.addFragment(datagram->getFragmentOffset(),
                                            datagram->getFragmentOffset() + bytes,
                                            !datagram->getMoreFragments());
+    buf->bytes += datagram->getByteLength();
+    bufferedBytes += datagram->getByteLength();
 
     // store datagram. Only one fragment carries the actual modelled
     // content (getEncapsulatedPacket()), other (empty) ones are only
@@ -101,45 +190,44 @@ IPv4Datagram *IPv4FragBuf::addFragment(IPv4Datagram *datagram, simtime_t now)
         ret->setByteLength(ret->getHeaderLength()+buf->buf.getTotalLength());
         ret->setFragmentOffset(0);
         ret->setMoreFragments(false);
-        bufs.erase(i);
+        removeBuffer(buf);
         return ret;
     }
     else
     {
         // there are still missing fragments
-        buf->lastupdate = now;
+        touchBuffer(buf, now);
+
+        // enforce the buffer limit, dropping the least recently updated datagrams
+        while (maxBufferedBytes > 0 && bufferedBytes > maxBufferedBytes)
+        {
+            EV << "reassembly buffer full, dropping the fragments of the oldest datagram\n";
+            delete oldest->datagram;
+            removeBuffer(oldest);
+            numEvicted++;
+        }
         return NULL;
     }
 }
 
-void IPv4FragBuf::purgeStaleFragments(simtime_t lastupdate)
+int IPv4FragBuf::purgeStaleFragments(simtime_t lastupdate)
 {
-    // this method shouldn't be called too often because iteration on
-    // an std::map is *very* slow...
-
     ASSERT(icmpModule);
 
-    for (Buffers::iterator i = bufs.begin(); i != bufs.end(); )
+    // the list is ordered by last update, so stop at the first fresh one
+    int count = 0;
+    while (oldest && oldest->lastupdate < lastupdate)
     {
-        // if too old, remove it
-        DatagramBuffer& buf = i->second;
-        if (buf.lastupdate < lastupdate)
-        {
-            // send ICMP error.
-            // Note: receiver MUST NOT call decapsulate() on the datagram fragment,
-            // because its length (being a fragment) is smaller than the encapsulated
-            // packet, resulting in "length became negative" error. Use getEncapsulatedPacket().
-            EV << "datagram fragment timed out in reassembly buffer, sending ICMP_TIME_EXCEEDED\n";
-            icmpModule->sendErrorMessage(buf.datagram, ICMP_TIME_EXCEEDED, 0);
-
-            // delete
-            Buffers::iterator oldi = i++;
-            bufs.erase(oldi);
-        }
-        else
-        {
-            ++i;
-        }
+        // send ICMP error.
+        // Note: receiver MUST NOT call decapsulate() on the datagram fragment,
+        // because its length (being a fragment) is smaller than the encapsulated
+        // packet, resulting in "length became negative" error. Use getEncapsulatedPacket().
+        EV << "datagram fragment timed out in reassembly buffer, sending ICMP_TIME_EXCEEDED\n";
+        icmpModule->sendErrorMessage(oldest->datagram, ICMP_TIME_EXCEEDED, 0);
+
+        // delete
+        removeBuffer(oldest);
+        count++;
     }
+    return count;
 }
-
@@ -19,7 +19,7 @@
 #define __INET_IPv4FRAGBUF_H
 
 
-#include <map>
+#include <vector>
 
 #include "INETDefs.h"
 
@@ -33,6 +33,12 @@ class IPv4Datagram;
 
 /**
  * Reassembly buffer for fragmented IPv4 datagrams.
+ *
+ * Datagram buffers are found via a hash table, and are also linked into a
+ * list in the order of their last update, so that purging stale fragments
+ * only visits the buffers that actually time out. The total size of the
+ * buffered fragments can be limited; when the limit is exceeded, the least
+ * recently updated datagrams are dropped.
  */
 class INET_API IPv4FragBuf
 {
@@ -46,8 +52,8 @@ class INET_API IPv4FragBuf
         IPv4Address src;
         IPv4Address dest;
 
-        inline bool operator<(const Key& b) const {
-            return (id!=b.id) ? (id<b.id) : (src!=b.src) ? (src<b.src) : (dest<b.dest);
+        inline bool operator==(const Key& b) const {
+            return id==b.id && src==b.src && dest==b.dest;
         }
     };
 
@@ -56,20 +62,36 @@ class INET_API IPv4FragBuf
     //
     struct DatagramBuffer
     {
+        Key key;
         ReassemblyBuffer buf;  // reassembly buffer
         IPv4Datagram *datagram;  // the actual datagram
         simtime_t lastupdate;  // last time a new fragment arrived
+        long bytes;  // total length of the fragments received
+        DatagramBuffer *nextInBucket;  // hash chain
+        DatagramBuffer *prev;  // list ordered by lastupdate, oldest first
+        DatagramBuffer *next;
     };
 
-    // we use std::map for fast lookup by datagram Id
-    typedef std::map<Key,DatagramBuffer> Buffers;
+    // the reassembly buffers: hash buckets, and the list by last update
+    std::vector<DatagramBuffer *> buckets;
+    int numBuffers;
+    DatagramBuffer *oldest;
+    DatagramBuffer *newest;
 
-    // the reassembly buffers
-    Buffers bufs;
+    long bufferedBytes;     // sum of DatagramBuffer::bytes
+    long maxBufferedBytes;  // 0 means no limit
+    long numEvicted;        // datagrams dropped because of the limit
 
     // needed for TIME_EXCEEDED errors
     ICMP *icmpModule;
 
+  protected:
+    static unsigned int hash(const Key& key);
+    DatagramBuffer *findBuffer(const Key& key) const;
+    DatagramBuffer *createBuffer(const Key& key);
+    void touchBuffer(DatagramBuffer *buf, simtime_t now);
+    void removeBuffer(DatagramBuffer *buf);  // unlinks and deletes, but not the datagram
+
   public:
     /**
      * Ctor.
@@ -87,23 +109,41 @@ class INET_API IPv4FragBuf
      */
     void init(ICMP *icmp);
 
+    /**
+     * Limits the total length of the buffered fragments, in bytes;
+     * 0 means no limit.
+     */
+    void setMaxBufferedBytes(long bytes) {maxBufferedBytes = bytes;}
+
     /**
      * Takes a fragment and inserts it into the reassembly buffer.
      * If this fragment completes a datagram, the full reassembled
-     * datagram is returned, otherwise NULL.
+     * datagram is returned, otherwise NULL. If the buffer limit is
+     * exceeded, the least recently updated incomplete datagrams are
+     * dropped without an ICMP error.
      */
     IPv4Datagram *addFragment(IPv4Datagram *datagram, simtime_t now);
 
     /**
      * Throws out all fragments which are incomplete and their
      * last update (last fragment arrival) was before "lastupdate",
-     * and sends ICMP TIME EXCEEDED message about them.
+     * and sends ICMP TIME EXCEEDED message about them. Returns the
+     * number of datagrams thrown out.
      *
      * Timeout should be between 60 seconds and 120 seconds (RFC1122).
-     * This method should be called more frequently, maybe every
-     * 10..30 seconds or so.
+     * The cost is proportional to the number of datagrams thrown out,
+     * so it can be called on every fragment arrival.
      */
-    void purgeStaleFragments(simtime_t lastupdate);
+    int purgeStaleFragments(simtime_t lastupdate);
+
+    /** Number of datagrams being reassembled */
+    int getNumDatagrams() const {return numBuffers;}
+
+    /** Total length of the buffered fragments, in bytes */
+    long getBufferedBytes() const {return bufferedBytes;}
+
+    /** Number of datagrams dropped because of the buffer limit so far */
+    long getNumEvicted() const {return numEvicted;}
 };
 
 #endif
@@ -0,0 +1,200 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+
+#include "IPv4RouteTrie.h"
+
+#include "IPv4Route.h"
+
+
+IPv4RouteTrie::IPv4RouteTrie(RouteLessThan lessThan) : root(NULL), lessThan(lessThan)
+{
+}
+
+IPv4RouteTrie::~IPv4RouteTrie()
+{
+    deleteSubtree(root);
+}
+
+void IPv4RouteTrie::deleteSubtree(Node *node)
+{
+    if (node)
+    {
+        deleteSubtree(node->child[0]);
+        deleteSubtree(node->child[1]);
+        delete node;
+    }
+}
+
+void IPv4RouteTrie::clear()
+{
+    deleteSubtree(root);
+    root = NULL;
+}
+
+int IPv4RouteTrie::commonPrefixLength(uint32 a, uint32 b, int maxLength)
+{
+    uint32 diff = a ^ b;
+    int length = 0;
+    while (length < maxLength && !(diff & 0x80000000u))
+    {
+        diff <<= 1;
+        length++;
+    }
+    return length;
+}
+
+void IPv4RouteTrie::insert(IPv4Route *route)
+{
+    uint32 prefix = route->getDestination().getInt();
+    int length = route->getNetmask().getNetmaskLength();
+    ASSERT((prefix & ~mask(length)) == 0);
+
+    Node **link = &root;
+    Node *node;
+    while (true)
+    {
+        node = *link;
+        if (!node)
+        {
+            // empty subtree: add a leaf
+            node = *link = new Node(prefix, length);
+            break;
+        }
+
+        int common = commonPrefixLength(node->prefix, prefix, std::min(node->length, length));
+        if (common == node->length)
+        {
+            if (common == length)
+                break;  // exact match
+            link = &node->child[bitAt(prefix, node->length)];
+            continue;
+        }
+
+        if (common == length)
+        {
+            // new prefix is a prefix of the node's: insert it above the node
+            Node *newNode = new Node(prefix, length);
+            newNode->child[bitAt(node->prefix, length)] = node;
+            node = *link = newNode;
+        }
+        else
+        {
+            // prefixes diverge at bit 'common': add a branching node
+            Node *branch = new Node(prefix & mask(common), common);
+            Node *newNode = new Node(prefix, length);
+            branch->child[bitAt(node->prefix, common)] = node;
+            branch->child[bitAt(prefix, common)] = newNode;
+            *link = branch;
+            node = newNode;
+        }
+        break;
+    }
+
+    // keep routes of the same prefix in routing table order
+    std::vector<IPv4Route *>& routes = node->routes;
+    routes.insert(std::upper_bound(routes.begin(), routes.end(), route, lessThan), route);
+}
+
+bool IPv4RouteTrie::remove(IPv4Route *route)
+{
+    uint32 prefix = route->getDestination().getInt();
+    int length = route->getNetmask().getNetmaskLength();
+
+    // fast path: walk down to the node of the route's current prefix
+    Node **links[33];
+    int depth = 0;
+    Node **link = &root;
+    while (*link && (*link)->length <= length && (prefix & mask((*link)->length)) == (*link)->prefix)
+    {
+        links[depth++] = link;
+        if ((*link)->length == length)
+            break;
+        link = &(*link)->child[bitAt(prefix, (*link)->length)];
+    }
+
+    if (depth > 0 && (*links[depth-1])->length == length)
+    {
+        std::vector<IPv4Route *>& routes = (*links[depth-1])->routes;
+        std::vector<IPv4Route *>::iterator it = std::find(routes.begin(), routes.end(), route);
+        if (it != routes.end())
+        {
+            routes.erase(it);
+            // remove nodes that became unnecessary, bottom up
+            for (int i = depth - 1; i >= 0; i--)
+            {
+                Node *node = *links[i];
+                if (!node->routes.empty() || (node->child[0] && node->child[1]))
+                    break;
+                *links[i] = node->child[0] ? node->child[0] : node->child[1];
+                delete node;
+            }
+            return true;
+        }
+    }
+
+    // the route's destination or netmask was changed while in the trie
+    return removeFromSubtree(&root, route);
+}
+
+bool IPv4RouteTrie::removeFromSubtree(Node **link, IPv4Route *route)
+{
+    Node *node = *link;
+    if (!node)
+        return false;
+
+    std::vector<IPv4Route *>::iterator it = std::find(node->routes.begin(), node->routes.end(), route);
+    if (it != node->routes.end())
+        node->routes.erase(it);
+    else if (!removeFromSubtree(&node->child[0], route) && !removeFromSubtree(&node->child[1], route))
+        return false;
+
+    if (node->routes.empty() && !(node->child[0] && node->child[1]))
+    {
+        *link = node->child[0] ? node->child[0] : node->child[1];
+        delete node;
+    }
+    return true;
+}
+
+IPv4Route *IPv4RouteTrie::lookup(const IPv4Address& dest) const
+{
+    uint32 addr = dest.getInt();
+
+    // collect the nodes of matching prefixes that have routes, shortest first
+    const Node *matches[33];
+    int numMatches = 0;
+    const Node *node = root;
+    while (node && (addr & mask(node->length)) == node->prefix)
+    {
+        if (!node->routes.empty())
+            matches[numMatches++] = node;
+        if (node->length == 32)
+            break;
+        node = node->child[bitAt(addr, node->length)];
+    }
+
+    // longest prefix first; skip routes that are currently invalid
+    for (int i = numMatches - 1; i >= 0; i--)
+    {
+        const std::vector<IPv4Route *>& routes = matches[i]->routes;
+        for (std::vector<IPv4Route *>::const_iterator it = routes.begin(); it != routes.end(); ++it)
+            if ((*it)->isValid())
+                return *it;
+    }
+    return NULL;
+}
+
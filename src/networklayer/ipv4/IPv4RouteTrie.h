@@ -0,0 +1,91 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_IPV4ROUTETRIE_H
+#define __INET_IPV4ROUTETRIE_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "IPv4Address.h"
+
+class IPv4Route;
+
+
+/**
+ * Path-compressed binary trie over IPv4 prefixes, used by RoutingTable
+ * for longest prefix matching. Each node holds the routes whose
+ * destination/netmask is exactly the node's prefix, ordered the same way
+ * as in the routing table (i.e. by metric), so lookup() returns the same
+ * route as a linear scan of the sorted route vector would.
+ *
+ * Routes are inserted/removed incrementally; lookup() takes at most 33
+ * node visits regardless of the number of routes.
+ */
+class INET_API IPv4RouteTrie
+{
+  public:
+    /** Ordering of routes with the same prefix */
+    typedef bool (*RouteLessThan)(const IPv4Route *a, const IPv4Route *b);
+
+  protected:
+    struct Node
+    {
+        uint32 prefix;  // prefix bits, bits beyond length are zero
+        int length;     // prefix length (0..32)
+        Node *child[2]; // subtrees, selected by the bit after the prefix
+        std::vector<IPv4Route *> routes; // routes with exactly this prefix
+
+        Node(uint32 prefix, int length) : prefix(prefix), length(length) {child[0] = child[1] = NULL;}
+    };
+
+    Node *root;
+    RouteLessThan lessThan;
+
+  protected:
+    static uint32 mask(int length) {return length == 0 ? 0 : 0xffffffffu << (32 - length);}
+    static int bitAt(uint32 addr, int pos) {return (addr >> (31 - pos)) & 1;}
+    static int commonPrefixLength(uint32 a, uint32 b, int maxLength);
+    static void deleteSubtree(Node *node);
+    bool removeFromSubtree(Node **link, IPv4Route *route);
+
+  public:
+    IPv4RouteTrie(RouteLessThan lessThan);
+    ~IPv4RouteTrie();
+
+    /** Adds the route under its current destination and netmask */
+    void insert(IPv4Route *route);
+
+    /**
+     * Removes the route. The route is looked up under its current destination
+     * and netmask first; if it is not found there (its fields were changed
+     * while in the trie), the whole trie is searched. Returns false if the
+     * route was not in the trie.
+     */
+    bool remove(IPv4Route *route);
+
+    /** Removes all routes (route objects are not deleted) */
+    void clear();
+
+    /**
+     * Returns the first valid route of the longest matching prefix
+     * that has a valid route, or NULL if there is none.
+     */
+    IPv4Route *lookup(const IPv4Address& dest) const;
+};
+
+#endif
+
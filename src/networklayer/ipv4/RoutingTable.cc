@@ -48,7 +48,7 @@ std::ostream& operator<<(std::ostream& os, const IPv4MulticastRoute& e)
     return os;
 };
 
-RoutingTable::RoutingTable()
+RoutingTable::RoutingTable() : routeTrie(routeLessThan)
 {
     ift = NULL;
     nb = NULL;
@@ -220,6 +220,7 @@ void RoutingTable::deleteInterfaceRoutes(InterfaceEntry *entry)
         if (route->getInterface() == entry)
         {
             it = routes.erase(it);
+            routeTrie.remove(route);
             ASSERT(route->getRoutingTable() == this); // still filled in, for the listeners' benefit
             nb->fireChangeNotification(NF_IPv4_ROUTE_DELETED, route);
             delete route;
@@ -264,7 +265,6 @@ void RoutingTable::deleteInterfaceRoutes(InterfaceEntry *entry)
 
 void RoutingTable::invalidateCache()
 {
-    routingCache.clear();
     localAddresses.clear();
     localBroadcastAddresses.clear();
 }
@@ -454,6 +454,7 @@ void RoutingTable::purge()
         else
         {
             it = routes.erase(it);
+            routeTrie.remove(route);
             ASSERT(route->getRoutingTable() == this); // still filled in, for the listeners' benefit
             nb->fireChangeNotification(NF_IPv4_ROUTE_DELETED, route);
             delete route;
@@ -488,31 +489,9 @@ IPv4Route *RoutingTable::findBestMatchingRoute(const IPv4Address& dest) const
 {
     Enter_Method("findBestMatchingRoute(%u.%u.%u.%u)", dest.getDByte(0), dest.getDByte(1), dest.getDByte(2), dest.getDByte(3)); // note: str().c_str() too slow here
 
-    RoutingCache::iterator it = routingCache.find(dest);
-    if (it != routingCache.end())
-    {
-        if (it->second==NULL || it->second->isValid())
-            return it->second;
-    }
-
     // find best match (one with longest prefix)
     // default route has zero prefix length, so (if exists) it'll be selected as last resort
-    IPv4Route *bestRoute = NULL;
-    for (RouteVector::const_iterator i=routes.begin(); i!=routes.end(); ++i)
-    {
-        IPv4Route *e = *i;
-        if (e->isValid())
-        {
-            if (IPv4Address::maskedAddrAreEqual(dest, e->getDestination(), e->getNetmask())) // match
-            {
-                bestRoute = const_cast<IPv4Route *>(e);
-                break;
-            }
-        }
-    }
-
-    routingCache[dest] = bestRoute;
-    return bestRoute;
+    return routeTrie.lookup(dest);
 }
 
 InterfaceEntry *RoutingTable::getInterfaceForDestAddr(const IPv4Address& dest) const
@@ -613,6 +592,7 @@ void RoutingTable::internalAddRoute(IPv4Route *entry)
     // stop at the first match when doing the longest netmask matching
     RouteVector::iterator pos = upper_bound(routes.begin(), routes.end(), entry, routeLessThan);
     routes.insert(pos, entry);
+    routeTrie.insert(entry);
 
     entry->setRoutingTable(this);
 }
@@ -635,6 +615,7 @@ IPv4Route *RoutingTable::internalRemoveRoute(IPv4Route *entry)
     if (i!=routes.end())
     {
         routes.erase(i);
+        routeTrie.remove(entry);
         return entry;
     }
     return NULL;
@@ -827,6 +808,7 @@ void RoutingTable::updateNetmaskRoutes()
             std::vector<IPv4Route *>::iterator it = routes.begin()+(k--);  // '--' is necessary because indices shift down
             IPv4Route *route = *it;
             routes.erase(it);
+            routeTrie.remove(route);
             ASSERT(route->getRoutingTable() == this); // still filled in, for the listeners' benefit
             nb->fireChangeNotification(NF_IPv4_ROUTE_DELETED, route);
             delete route;
@@ -851,6 +833,7 @@ void RoutingTable::updateNetmaskRoutes()
             route->setRoutingTable(this);
             RouteVector::iterator pos = upper_bound(routes.begin(), routes.end(), route, routeLessThan);
             routes.insert(pos, route);
+            routeTrie.insert(route);
             nb->fireChangeNotification(NF_IPv4_ROUTE_ADDED, route);
         }
     }
@@ -35,6 +35,7 @@
 #include "INotifiable.h"
 #include "IPv4Address.h"
 #include "IRoutingTable.h"
+#include "IPv4RouteTrie.h"
 
 class IInterfaceTable;
 class NotificationBoard;
@@ -94,9 +95,9 @@ class INET_API RoutingTable: public cSimpleModule, public IRoutingTable, protect
     typedef IPv4MulticastRoute::ChildInterface ChildInterface;
     typedef IPv4MulticastRoute::ChildInterfaceVector ChildInterfaceVector;
 
-    // routing cache: maps destination address to the route
-    typedef std::map<IPv4Address, IPv4Route *> RoutingCache;
-    mutable RoutingCache routingCache;
+    // prefix trie over the unicast routes, for longest prefix matching;
+    // updated incrementally together with the routes vector
+    IPv4RouteTrie routeTrie;
 
     // local addresses cache (to speed up isLocalAddress())
     typedef std::set<IPv4Address> AddressSet;
@@ -120,7 +121,7 @@ class INET_API RoutingTable: public cSimpleModule, public IRoutingTable, protect
     // delete routes for the given interface
     virtual void deleteInterfaceRoutes(InterfaceEntry *entry);
 
-    // invalidates routing cache and local addresses cache
+    // invalidates local addresses cache
     virtual void invalidateCache();
 
     // helper for sorting routing table, used by addRoute()
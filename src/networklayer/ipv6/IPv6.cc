@@ -44,6 +44,10 @@
 
 Define_Module(IPv6);
 
+simsignal_t IPv6::reassemblyTimeoutSignal = SIMSIGNAL_NULL;
+simsignal_t IPv6::reassemblyOverflowSignal = SIMSIGNAL_NULL;
+simsignal_t IPv6::reassemblyBufferSizeSignal = SIMSIGNAL_NULL;
+
 void IPv6::initialize()
 {
     QueueBase::initialize();
@@ -58,8 +62,12 @@ void IPv6::initialize()
     mapping.parseProtocolMapping(par("protocolMapping"));
 
     curFragmentId = 0;
-    lastCheckTime = 0;
     fragbuf.init(icmp);
+    fragbuf.setMaxBufferedBytes(par("fragmentBufferLimit").longValue());
+
+    reassemblyTimeoutSignal = registerSignal("reassemblyTimeout");
+    reassemblyOverflowSignal = registerSignal("reassemblyOverflow");
+    reassemblyBufferSizeSignal = registerSignal("reassemblyBufferSize");
 
     numMulticast = numLocalDeliver = numDropped = numUnroutable = numForwarded = 0;
 
@@ -458,14 +466,17 @@ void IPv6::localDeliver(IPv6Datagram *datagram)
         EV << "Datagram fragment: offset=" << fh->getFragmentOffset()
            << ", MORE=" << (fh->getMoreFragments() ? "true" : "false") << ".\n";
 
-        // erase timed out fragments in fragmentation buffer; check every 10 seconds max
-        if (simTime() >= lastCheckTime + 10)
-        {
-            lastCheckTime = simTime();
-            fragbuf.purgeStaleFragments(simTime()-FRAGMENT_TIMEOUT);
-        }
+        // erase timed out fragments in fragmentation buffer; this only
+        // visits the datagrams that time out
+        int numTimedOut = fragbuf.purgeStaleFragments(simTime()-FRAGMENT_TIMEOUT);
+        if (numTimedOut > 0)
+            emit(reassemblyTimeoutSignal, (long)numTimedOut);
 
+        long numEvicted = fragbuf.getNumEvicted();
         datagram = fragbuf.addFragment(datagram, fh, simTime());
+        if (fragbuf.getNumEvicted() != numEvicted)
+            emit(reassemblyOverflowSignal, fragbuf.getNumEvicted() - numEvicted);
+        emit(reassemblyBufferSizeSignal, fragbuf.getBufferedBytes());
         if (!datagram)
         {
             EV << "No complete datagram yet.\n";
@@ -50,7 +50,6 @@ class INET_API IPv6 : public QueueBase
     // working vars
     unsigned int curFragmentId; // counter, used to assign unique fragmentIds to datagrams
     IPv6FragBuf fragbuf;  // fragmentation reassembly buffer
-    simtime_t lastCheckTime; // when fragbuf was last checked for state fragments
     ProtocolMapping mapping; // where to send packets after decapsulation
 
     // statistics
@@ -60,6 +59,10 @@ class INET_API IPv6 : public QueueBase
     int numUnroutable;
     int numForwarded;
 
+    static simsignal_t reassemblyTimeoutSignal;
+    static simsignal_t reassemblyOverflowSignal;
+    static simsignal_t reassemblyBufferSizeSignal;
+
 #ifdef WITH_xMIPv6
     // 28.9.07 - CB
     // datagrams that are supposed to be sent with a tentative IPv6 address
@@ -30,11 +30,21 @@
 
 IPv6FragBuf::IPv6FragBuf()
 {
+    numBuffers = 0;
+    oldest = newest = NULL;
+    bufferedBytes = 0;
+    maxBufferedBytes = 0;
+    numEvicted = 0;
     icmpModule = NULL;
 }
 
 IPv6FragBuf::~IPv6FragBuf()
 {
+    while (oldest)
+    {
+        delete oldest->datagram;
+        removeBuffer(oldest);
+    }
 }
 
 void IPv6FragBuf::init(ICMPv6 *icmp)
@@ -42,6 +52,83 @@ void IPv6FragBuf::init(ICMPv6 *icmp)
     icmpModule = icmp;
 }
 
+unsigned int IPv6FragBuf::hash(const Key& key)
+{
+    const uint32 *src = key.src.words();
+    const uint32 *dest = key.dest.words();
+    uint32 h = key.id * 0x9e3779b9u;
+    for (int i = 0; i < 4; i++)
+        h = (h ^ src[i] ^ (dest[i] * 0xc2b2ae35u)) * 0x85ebca6bu;
+    return h ^ (h >> 16);
+}
+
+IPv6FragBuf::DatagramBuffer *IPv6FragBuf::findBuffer(const Key& key) const
+{
+    if (buckets.empty())
+        return NULL;
+    DatagramBuffer *buf = buckets[hash(key) & (buckets.size() - 1)];
+    while (buf && !(buf->key == key))
+        buf = buf->nextInBucket;
+    return buf;
+}
+
+IPv6FragBuf::DatagramBuffer *IPv6FragBuf::createBuffer(const Key& key, simtime_t now)
+{
+    // keep at most one buffer per bucket on average
+    if (numBuffers + 1 > (int)buckets.size())
+    {
+        std::vector<DatagramBuffer *> newBuckets(buckets.empty() ? 16 : 2 * buckets.size(), (DatagramBuffer *)NULL);
+        for (DatagramBuffer *buf = oldest; buf; buf = buf->next)
+        {
+            unsigned int i = hash(buf->key) & (newBuckets.size() - 1);
+            buf->nextInBucket = newBuckets[i];
+            newBuckets[i] = buf;
+        }
+        buckets.swap(newBuckets);
+    }
+
+    DatagramBuffer *buf = new DatagramBuffer();
+    buf->key = key;
+    buf->datagram = NULL;
+    buf->createdAt = now;
+    buf->bytes = 0;
+    unsigned int i = hash(key) & (buckets.size() - 1);
+    buf->nextInBucket = buckets[i];
+    buckets[i] = buf;
+
+    // append to the list as the newest
+    buf->prev = newest;
+    buf->next = NULL;
+    if (newest)
+        newest->next = buf;
+    else
+        oldest = buf;
+    newest = buf;
+    numBuffers++;
+    return buf;
+}
+
+void IPv6FragBuf::removeBuffer(DatagramBuffer *buf)
+{
+    DatagramBuffer **p = &buckets[hash(buf->key) & (buckets.size() - 1)];
+    while (*p != buf)
+        p = &(*p)->nextInBucket;
+    *p = buf->nextInBucket;
+
+    if (buf->prev)
+        buf->prev->next = buf->next;
+    else
+        oldest = buf->next;
+    if (buf->next)
+        buf->next->prev = buf->prev;
+    else
+        newest = buf->prev;
+
+    bufferedBytes -= buf->bytes;
+    numBuffers--;
+    delete buf;
+}
+
 IPv6Datagram *IPv6FragBuf::addFragment(IPv6Datagram *datagram, IPv6FragmentHeader *fh, simtime_t now)
 {
     // find datagram buffer
@@ -50,22 +137,6 @@ IPv6Datagram *IPv6FragBuf::addFragment(IPv6Datagram *datagram, IPv6FragmentHeade
     key.src = datagram->getSrcAddress();
     key.dest = datagram->getDestAddress();
 
-    Buffers::iterator i = bufs.find(key);
-
-    DatagramBuffer *buf = NULL;
-    if (i==bufs.end())
-    {
-        // this is the first fragment of that datagram, create reassembly buffer for it
-        buf = &bufs[key];
-        buf->datagram = NULL;
-        buf->createdAt = now;
-    }
-    else
-    {
-        // use existing buffer
-        buf = &(i->second);
-    }
-
     int fragmentLength = datagram->calculateFragmentLength();
     unsigned short offset = fh->getFragmentOffset();
     bool moreFragments = fh->getMoreFragments();
@@ -96,7 +167,17 @@ IPv6Datagram *IPv6FragBuf::addFragment(IPv6Datagram *datagram, IPv6FragmentHeade
         return NULL;
     }
 
+    DatagramBuffer *buf = findBuffer(key);
+    if (buf == NULL)
+    {
+        // this is the first fragment of that datagram, create reassembly buffer for it
+        buf = createBuffer(key, now);
+    }
+
     // add fragment to buffer
+    long datagramBytes = datagram->getByteLength();
+    buf->bytes += datagramBytes;
+    bufferedBytes += datagramBytes;
     bool isComplete = buf->buf.addFragment(offset,
                                            offset+fragmentLength,
                                            !moreFragments);
@@ -122,12 +203,20 @@ IPv6Datagram *IPv6FragBuf::addFragment(IPv6Datagram *datagram, IPv6FragmentHeade
         ASSERT(ret);
         ret->removeExtensionHeader(IP_PROT_IPv6EXT_FRAGMENT);
         ret->setByteLength(ret->calculateUnfragmentableHeaderByteLength()+buf->buf.getTotalLength());
-        bufs.erase(i);
+        removeBuffer(buf);
         return ret;
     }
     else
     {
-        // there are still missing fragments
+        // there are still missing fragments; enforce the buffer limit,
+        // dropping the oldest datagrams
+        while (maxBufferedBytes > 0 && bufferedBytes > maxBufferedBytes)
+        {
+            EV << "reassembly buffer full, dropping the fragments of the oldest datagram\n";
+            delete oldest->datagram;
+            removeBuffer(oldest);
+            numEvicted++;
+        }
         return NULL;
     }
 }
@@ -143,34 +232,24 @@ IPv6Datagram *IPv6FragBuf::addFragment(IPv6Datagram *datagram, IPv6FragmentHeade
       sent to the source of that fragment.
  *
  */
-void IPv6FragBuf::purgeStaleFragments(simtime_t lastupdate)
+int IPv6FragBuf::purgeStaleFragments(simtime_t lastupdate)
 {
-    // this method shouldn't be called too often because iteration on
-    // an std::map is *very* slow...
-
     ASSERT(icmpModule);
 
-    for (Buffers::iterator i=bufs.begin(); i!=bufs.end(); )
+    // the list is ordered by creation time, so stop at the first fresh one
+    int count = 0;
+    while (oldest && oldest->createdAt < lastupdate)
     {
-        // if too old, remove it
-        DatagramBuffer& buf = i->second;
-        if (buf.createdAt < lastupdate)
-        {
-            if (buf.datagram)
-            {
-                // send ICMP error
-                EV << "datagram fragment timed out in reassembly buffer, sending ICMP_TIME_EXCEEDED\n";
-                icmpModule->sendErrorMessage(buf.datagram, ICMPv6_TIME_EXCEEDED, 0);
-            }
-
-            // delete
-            Buffers::iterator oldi = i++;
-            bufs.erase(oldi);
-        }
-        else
+        if (oldest->datagram)
         {
-            ++i;
+            // send ICMP error
+            EV << "datagram fragment timed out in reassembly buffer, sending ICMP_TIME_EXCEEDED\n";
+            icmpModule->sendErrorMessage(oldest->datagram, ICMPv6_TIME_EXCEEDED, 0);
         }
+
+        // delete
+        removeBuffer(oldest);
+        count++;
     }
+    return count;
 }
-
@@ -18,7 +18,6 @@
 #ifndef __IPv6FRAGBUF_H__
 #define __IPv6FRAGBUF_H__
 
-#include <map>
 #include <vector>
 #include "INETDefs.h"
 #include "ReassemblyBuffer.h"
@@ -30,6 +29,12 @@ class IPv6FragmentHeader;
 
 /**
  * Reassembly buffer for fragmented IPv6 datagrams.
+ *
+ * Datagram buffers are found via a hash table, and are also linked into a
+ * list in creation order, so that purging stale fragments only visits the
+ * buffers that actually time out. The total size of the buffered fragments
+ * can be limited; when the limit is exceeded, the oldest datagrams are
+ * dropped.
  */
 class INET_API IPv6FragBuf
 {
@@ -43,8 +48,8 @@ class INET_API IPv6FragBuf
         IPv6Address src;
         IPv6Address dest;
 
-        inline bool operator<(const Key& b) const {
-            return (id!=b.id) ? (id<b.id) : (src!=b.src) ? (src<b.src) : (dest<b.dest);
+        inline bool operator==(const Key& b) const {
+            return id==b.id && src==b.src && dest==b.dest;
         }
     };
 
@@ -53,20 +58,35 @@ class INET_API IPv6FragBuf
     //
     struct DatagramBuffer
     {
+        Key key;
         ReassemblyBuffer buf;  // reassembly buffer
         IPv6Datagram *datagram;  // the actual datagram
         simtime_t createdAt;  // time of the buffer creation (i.e. reception time of first-arriving fragment)
+        long bytes;  // total length of the fragments received
+        DatagramBuffer *nextInBucket;  // hash chain
+        DatagramBuffer *prev;  // list ordered by createdAt, oldest first
+        DatagramBuffer *next;
     };
 
-    // we use std::map for fast lookup by datagram Id
-    typedef std::map<Key,DatagramBuffer> Buffers;
+    // the reassembly buffers: hash buckets, and the list by creation time
+    std::vector<DatagramBuffer *> buckets;
+    int numBuffers;
+    DatagramBuffer *oldest;
+    DatagramBuffer *newest;
 
-    // the reassembly buffers
-    Buffers bufs;
+    long bufferedBytes;     // sum of DatagramBuffer::bytes
+    long maxBufferedBytes;  // 0 means no limit
+    long numEvicted;        // datagrams dropped because of the limit
 
     // needed for TIME_EXCEEDED errors
     ICMPv6 *icmpModule;
 
+  protected:
+    static unsigned int hash(const Key& key);
+    DatagramBuffer *findBuffer(const Key& key) const;
+    DatagramBuffer *createBuffer(const Key& key, simtime_t now);
+    void removeBuffer(DatagramBuffer *buf);  // unlinks and deletes, but not the datagram
+
   public:
     /**
      * Ctor.
@@ -84,23 +104,40 @@ class INET_API IPv6FragBuf
      */
     void init(ICMPv6 *icmp);
 
+    /**
+     * Limits the total length of the buffered fragments, in bytes;
+     * 0 means no limit.
+     */
+    void setMaxBufferedBytes(long bytes) {maxBufferedBytes = bytes;}
+
     /**
      * Takes a fragment and inserts it into the reassembly buffer.
      * If this fragment completes a datagram, the full reassembled
-     * datagram is returned, otherwise NULL.
+     * datagram is returned, otherwise NULL. If the buffer limit is
+     * exceeded, the oldest incomplete datagrams are dropped without
+     * an ICMP error.
      */
     IPv6Datagram *addFragment(IPv6Datagram *datagram, IPv6FragmentHeader *fh, simtime_t now);
 
     /**
-     * Throws out all fragments which are incomplete and their
-     * last update (last fragment arrival) was before "lastupdate",
-     * and sends ICMP TIME EXCEEDED message about them.
+     * Throws out all fragments of datagrams whose first fragment arrived
+     * before "lastupdate", and sends ICMP TIME EXCEEDED message about them
+     * if the first fragment has been received. Returns the number of
+     * datagrams thrown out.
      *
-     * Timeout should be between 60 seconds and 120 seconds (RFC1122).
-     * This method should be called more frequently, maybe every
-     * 10..30 seconds or so.
+     * The cost is proportional to the number of datagrams thrown out,
+     * so it can be called on every fragment arrival.
      */
-    void purgeStaleFragments(simtime_t lastupdate);
+    int purgeStaleFragments(simtime_t lastupdate);
+
+    /** Number of datagrams being reassembled */
+    int getNumDatagrams() const {return numBuffers;}
+
+    /** Total length of the buffered fragments, in bytes */
+    long getBufferedBytes() const {return bufferedBytes;}
+
+    /** Number of datagrams dropped because of the buffer limit so far */
+    long getNumEvicted() const {return numEvicted;}
 };
 
 #endif
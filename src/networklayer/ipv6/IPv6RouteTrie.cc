@@ -0,0 +1,188 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+
+#include "IPv6RouteTrie.h"
+
+#include "RoutingTable6.h"
+
+
+IPv6RouteTrie::IPv6RouteTrie(RouteLessThan lessThan) : root(NULL), lessThan(lessThan)
+{
+}
+
+IPv6RouteTrie::~IPv6RouteTrie()
+{
+    deleteSubtree(root);
+}
+
+void IPv6RouteTrie::deleteSubtree(Node *node)
+{
+    if (node)
+    {
+        deleteSubtree(node->child[0]);
+        deleteSubtree(node->child[1]);
+        delete node;
+    }
+}
+
+void IPv6RouteTrie::clear()
+{
+    deleteSubtree(root);
+    root = NULL;
+}
+
+int IPv6RouteTrie::commonPrefixLength(const IPv6Address& a, const IPv6Address& b, int maxLength)
+{
+    int length = 0;
+    for (int i = 0; i < 4 && length < maxLength; i++)
+    {
+        uint32 diff = a.words()[i] ^ b.words()[i];
+        if (diff == 0)
+        {
+            length += 32;
+            continue;
+        }
+        while (!(diff & 0x80000000u))
+        {
+            diff <<= 1;
+            length++;
+        }
+        break;
+    }
+    return std::min(length, maxLength);
+}
+
+void IPv6RouteTrie::insert(IPv6Route *route)
+{
+    int length = route->getPrefixLength();
+    IPv6Address prefix = route->getDestPrefix().getPrefix(length);
+
+    Node **link = &root;
+    Node *node;
+    while (true)
+    {
+        node = *link;
+        if (!node)
+        {
+            // empty subtree: add a leaf
+            node = *link = new Node(prefix, length);
+            break;
+        }
+
+        int common = commonPrefixLength(node->prefix, prefix, std::min(node->length, length));
+        if (common == node->length)
+        {
+            if (common == length)
+                break;  // exact match
+            link = &node->child[bitAt(prefix, node->length)];
+            continue;
+        }
+
+        if (common == length)
+        {
+            // new prefix is a prefix of the node's: insert it above the node
+            Node *newNode = new Node(prefix, length);
+            newNode->child[bitAt(node->prefix, length)] = node;
+            node = *link = newNode;
+        }
+        else
+        {
+            // prefixes diverge at bit 'common': add a branching node
+            Node *branch = new Node(prefix.getPrefix(common), common);
+            Node *newNode = new Node(prefix, length);
+            branch->child[bitAt(node->prefix, common)] = node;
+            branch->child[bitAt(prefix, common)] = newNode;
+            *link = branch;
+            node = newNode;
+        }
+        break;
+    }
+
+    // keep routes of the same prefix in routing table order
+    RouteVector& routes = node->routes;
+    routes.insert(std::upper_bound(routes.begin(), routes.end(), route, lessThan), route);
+}
+
+bool IPv6RouteTrie::remove(IPv6Route *route)
+{
+    int length = route->getPrefixLength();
+    const IPv6Address& prefix = route->getDestPrefix();
+
+    // walk down to the node of the route's prefix
+    Node **links[129];
+    int depth = 0;
+    Node **link = &root;
+    while (*link && (*link)->length <= length && prefix.matches((*link)->prefix, (*link)->length))
+    {
+        links[depth++] = link;
+        if ((*link)->length == length)
+            break;
+        link = &(*link)->child[bitAt(prefix, (*link)->length)];
+    }
+
+    if (depth == 0 || (*links[depth-1])->length != length)
+        return false;
+
+    RouteVector& routes = (*links[depth-1])->routes;
+    RouteVector::iterator it = std::find(routes.begin(), routes.end(), route);
+    if (it == routes.end())
+        return false;
+    routes.erase(it);
+
+    // remove nodes that became unnecessary, bottom up
+    for (int i = depth - 1; i >= 0; i--)
+    {
+        Node *node = *links[i];
+        if (!node->routes.empty() || (node->child[0] && node->child[1]))
+            break;
+        *links[i] = node->child[0] ? node->child[0] : node->child[1];
+        delete node;
+    }
+    return true;
+}
+
+IPv6Route *IPv6RouteTrie::lookup(const IPv6Address& dest, simtime_t now, RouteVector& expiredRoutes) const
+{
+    // collect the nodes of matching prefixes that have routes, shortest first
+    const Node *matches[129];
+    int numMatches = 0;
+    const Node *node = root;
+    while (node && dest.matches(node->prefix, node->length))
+    {
+        if (!node->routes.empty())
+            matches[numMatches++] = node;
+        if (node->length == 128)
+            break;
+        node = node->child[bitAt(dest, node->length)];
+    }
+
+    // longest prefix first
+    for (int i = numMatches - 1; i >= 0; i--)
+    {
+        const RouteVector& routes = matches[i]->routes;
+        for (RouteVector::const_iterator it = routes.begin(); it != routes.end(); ++it)
+        {
+            simtime_t expiryTime = (*it)->getExpiryTime();
+            if (now > expiryTime && expiryTime != 0) // 0 represents infinity
+                expiredRoutes.push_back(*it);
+            else
+                return *it;
+        }
+    }
+    return NULL;
+}
+
@@ -0,0 +1,85 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_IPV6ROUTETRIE_H
+#define __INET_IPV6ROUTETRIE_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "IPv6Address.h"
+
+class IPv6Route;
+
+
+/**
+ * Path-compressed binary trie over IPv6 prefixes, used by RoutingTable6
+ * for longest prefix matching. Each node holds the routes whose prefix
+ * is exactly the node's prefix, ordered the same way as in the routing
+ * table (i.e. by metric).
+ *
+ * Routes are inserted/removed incrementally; a lookup visits at most
+ * 129 nodes regardless of the number of routes.
+ */
+class INET_API IPv6RouteTrie
+{
+  public:
+    /** Ordering of routes with the same prefix */
+    typedef bool (*RouteLessThan)(const IPv6Route *a, const IPv6Route *b);
+    typedef std::vector<IPv6Route *> RouteVector;
+
+  protected:
+    struct Node
+    {
+        IPv6Address prefix; // prefix bits, bits beyond length are zero
+        int length;         // prefix length (0..128)
+        Node *child[2];     // subtrees, selected by the bit after the prefix
+        RouteVector routes; // routes with exactly this prefix
+
+        Node(const IPv6Address& prefix, int length) : prefix(prefix), length(length) {child[0] = child[1] = NULL;}
+    };
+
+    Node *root;
+    RouteLessThan lessThan;
+
+  protected:
+    static int bitAt(const IPv6Address& addr, int pos) {return (addr.words()[pos / 32] >> (31 - pos % 32)) & 1;}
+    static int commonPrefixLength(const IPv6Address& a, const IPv6Address& b, int maxLength);
+    static void deleteSubtree(Node *node);
+
+  public:
+    IPv6RouteTrie(RouteLessThan lessThan);
+    ~IPv6RouteTrie();
+
+    /** Adds the route under its destination prefix */
+    void insert(IPv6Route *route);
+
+    /** Removes the route; returns false if it was not in the trie */
+    bool remove(IPv6Route *route);
+
+    /** Removes all routes (route objects are not deleted) */
+    void clear();
+
+    /**
+     * Returns the first route of the longest matching prefix that has not
+     * expired at 'now' (expiry time 0 means infinite), or NULL if there is
+     * none. Expired routes that were passed over are appended to expiredRoutes.
+     */
+    IPv6Route *lookup(const IPv6Address& dest, simtime_t now, RouteVector& expiredRoutes) const;
+};
+
+#endif
+
@@ -73,7 +73,7 @@ std::ostream& operator<<(std::ostream& os, const RoutingTable6::DestCacheEntry&
     return os;
 };
 
-RoutingTable6::RoutingTable6()
+RoutingTable6::RoutingTable6() : routeTrie(routeLessThan)
 {
 }
 
@@ -99,6 +99,7 @@ void RoutingTable6::initialize(int stage)
         WATCH_PTRVECTOR(routeList);
         WATCH_MAP(destCache); // FIXME commented out for now
         isrouter = par("isRouter");
+        maxDestCacheSize = par("destCacheSize");
         WATCH(isrouter);
 
 #ifdef WITH_xMIPv6
@@ -476,11 +477,14 @@ const IPv6Address& RoutingTable6::lookupDestCache(const IPv6Address& dest, int&
     DestCacheEntry &entry = it->second;
     if (entry.expiryTime > 0 && simTime() > entry.expiryTime)
     {
-        destCache.erase(it);
+        removeDestCacheEntry(it);
         outInterfaceId = -1;
         return IPv6Address::UNSPECIFIED_ADDRESS;
     }
 
+    // mark as most recently used
+    destCacheLRUList.splice(destCacheLRUList.begin(), destCacheLRUList, entry.lruPos);
+
     outInterfaceId = entry.interfaceId;
     return entry.nextHopAddr;
 }
@@ -489,33 +493,21 @@ const IPv6Route *RoutingTable6::doLongestPrefixMatch(const IPv6Address& dest)
 {
     Enter_Method("doLongestPrefixMatch(%s)", dest.str().c_str());
 
-    // we'll just stop at the first match, because the table is sorted
-    // by prefix lengths and metric (see addRoute())
+    // the trie returns the first non-expired route of the longest matching
+    // prefix; routes with the same prefix are ordered by metric (see addRoute())
+    RouteList expiredRoutes;
+    const IPv6Route *route = routeTrie.lookup(dest, simTime(), expiredRoutes);
 
-    // bugfix - CB
-    RouteList::iterator it = routeList.begin();
-    while (it!=routeList.end())
+    // bugfix - CB: throw out expired on-link prefixes we came across
+    for (RouteList::iterator it = expiredRoutes.begin(); it != expiredRoutes.end(); ++it)
     {
-        if (dest.matches((*it)->getDestPrefix(), (*it)->getPrefixLength()))
+        if ((*it)->getSrc()==IPv6Route::FROM_RA)
         {
-            if (simTime() > (*it)->getExpiryTime() && (*it)->getExpiryTime() != 0)//since 0 represents infinity.
-            {
-                if ( (*it)->getSrc()==IPv6Route::FROM_RA )
-                {
-                    EV << "Expired prefix detected!!" << endl;
-                    it = routeList.erase(it);
-                    //RouteList::iterator oldIt = it++;
-                    //removeOnLinkPrefix((*oldIt)->getDestPrefix(), (*oldIt)->getPrefixLength());
-                }
-            }
-            else
-                return *it;
+            EV << "Expired prefix detected!!" << endl;
+            internalRemoveRoute(std::find(routeList.begin(), routeList.end(), *it));
         }
-        else
-            ++it;
     }
-    // FIXME todo: if we selected an expired route, throw it out and select again!
-    return NULL;
+    return route;
 }
 
 bool RoutingTable6::isPrefixPresent(const IPv6Address& prefix) const
@@ -528,33 +520,65 @@ bool RoutingTable6::isPrefixPresent(const IPv6Address& prefix) const
 
 void RoutingTable6::updateDestCache(const IPv6Address& dest, const IPv6Address& nextHopAddr, int interfaceId, simtime_t expiryTime)
 {
-    DestCacheEntry &entry = destCache[dest];
+    DestCache::iterator it = destCache.find(dest);
+    if (it == destCache.end())
+    {
+        it = destCache.insert(std::make_pair(dest, DestCacheEntry())).first;
+        destCacheLRUList.push_front(dest);
+    }
+    else
+    {
+        DestCacheNextHopIndex::iterator indexIt = destCacheNextHopIndex.find(NextHop(it->second.interfaceId, it->second.nextHopAddr));
+        ASSERT(indexIt != destCacheNextHopIndex.end());
+        indexIt->second.erase(dest);
+        if (indexIt->second.empty())
+            destCacheNextHopIndex.erase(indexIt);
+        destCacheLRUList.splice(destCacheLRUList.begin(), destCacheLRUList, it->second.lruPos);
+    }
+
+    DestCacheEntry &entry = it->second;
     entry.nextHopAddr = nextHopAddr;
     entry.interfaceId = interfaceId;
     entry.expiryTime = expiryTime;
+    entry.lruPos = destCacheLRUList.begin();
+    destCacheNextHopIndex[NextHop(interfaceId, nextHopAddr)].insert(dest);
+
+    // drop the least recently used entry if the cache is full
+    if (maxDestCacheSize > 0 && (int)destCache.size() > maxDestCacheSize)
+        removeDestCacheEntry(destCache.find(destCacheLRUList.back()));
 
     updateDisplayString();
 }
 
+void RoutingTable6::removeDestCacheEntry(DestCache::iterator it)
+{
+    DestCacheEntry &entry = it->second;
+    DestCacheNextHopIndex::iterator indexIt = destCacheNextHopIndex.find(NextHop(entry.interfaceId, entry.nextHopAddr));
+    ASSERT(indexIt != destCacheNextHopIndex.end());
+    indexIt->second.erase(it->first);
+    if (indexIt->second.empty())
+        destCacheNextHopIndex.erase(indexIt);
+    destCacheLRUList.erase(entry.lruPos);
+    destCache.erase(it);
+}
+
 void RoutingTable6::purgeDestCache()
 {
     destCache.clear();
+    destCacheLRUList.clear();
+    destCacheNextHopIndex.clear();
     updateDisplayString();
 }
 
 void RoutingTable6::purgeDestCacheEntriesToNeighbour(const IPv6Address& nextHopAddr, int interfaceId)
 {
-    for (DestCache::iterator it=destCache.begin(); it!=destCache.end(); )
+    DestCacheNextHopIndex::iterator indexIt = destCacheNextHopIndex.find(NextHop(interfaceId, nextHopAddr));
+    if (indexIt != destCacheNextHopIndex.end())
     {
-        if (it->second.interfaceId==interfaceId && it->second.nextHopAddr==nextHopAddr)
-        {
-            // move the iterator past this element before removing it
-            destCache.erase(it++);
-        }
-        else
-        {
-            it++;
-        }
+        // copy: removeDestCacheEntry() modifies the index
+        std::set<IPv6Address> dests = indexIt->second;
+        for (std::set<IPv6Address>::iterator it = dests.begin(); it != dests.end(); ++it)
+            removeDestCacheEntry(destCache.find(*it));
     }
 
     updateDisplayString();
@@ -643,7 +667,7 @@ void RoutingTable6::removeOnLinkPrefix(const IPv6Address& destPrefix, int prefix
     {
         if ((*it)->getSrc()==IPv6Route::FROM_RA && (*it)->getDestPrefix()==destPrefix && (*it)->getPrefixLength()==prefixLength)
         {
-            routeList.erase(it);
+            internalRemoveRoute(it);
             return; // there can be only one such route, addOrUpdateOnLinkPrefix() guarantees that
         }
     }
@@ -703,11 +727,10 @@ bool RoutingTable6::routeLessThan(const IPv6Route *a, const IPv6Route *b)
 
 void RoutingTable6::addRoute(IPv6Route *route)
 {
-    routeList.push_back(route);
-
-    // we keep entries sorted by prefix length in routeList, so that we can
-    // stop at the first match when doing the longest prefix matching
-    std::sort(routeList.begin(), routeList.end(), routeLessThan);
+    // we keep entries sorted by prefix length and metric in routeList
+    RouteList::iterator pos = std::upper_bound(routeList.begin(), routeList.end(), route, routeLessThan);
+    routeList.insert(pos, route);
+    routeTrie.insert(route);
 
     updateDisplayString();
 
@@ -721,12 +744,21 @@ void RoutingTable6::removeRoute(IPv6Route *route)
 
     nb->fireChangeNotification(NF_IPv6_ROUTE_DELETED, route); // rather: going to be deleted
 
-    routeList.erase(it);
+    internalRemoveRoute(it);
     delete route;
 
     updateDisplayString();
 }
 
+RoutingTable6::RouteList::iterator RoutingTable6::internalRemoveRoute(RouteList::iterator it)
+{
+    ASSERT(it != routeList.end());
+    bool removed = routeTrie.remove(*it);
+    ASSERT(removed);
+    (void)removed;
+    return routeList.erase(it);
+}
+
 int RoutingTable6::getNumRoutes() const
 {
     return routeList.size();
@@ -777,7 +809,7 @@ void RoutingTable6::removeDefaultRoutes(int interfaceID)
     {
         // default routes have prefix length 0
         if ( (((*it)->getInterfaceId()) == interfaceID) && ((*it)->getPrefixLength() == 0)  )
-            it = routeList.erase(it);
+            it = internalRemoveRoute(it);
         else
             ++it;
     }
@@ -794,6 +826,7 @@ void RoutingTable6::removeAllRoutes()
         delete routeList[i];
 
     routeList.clear();
+    routeTrie.clear();
 
     updateDisplayString();
 }
@@ -805,7 +838,7 @@ void RoutingTable6::removePrefixes(int interfaceID)
     {
         // "real" prefixes have a length of larger then 0
         if ( (((*it)->getInterfaceId()) == interfaceID) && ((*it)->getPrefixLength() > 0)  )
-            it = routeList.erase(it);
+            it = internalRemoveRoute(it);
         else
             ++it;
     }
@@ -815,19 +848,15 @@ void RoutingTable6::removePrefixes(int interfaceID)
 
 void RoutingTable6::purgeDestCacheForInterfaceID(int interfaceId)
 {
-    for (DestCache::iterator it=destCache.begin(); it!=destCache.end(); )
+    // index entries of an interface are adjacent, ordered by (interfaceId, nextHop)
+    DestCacheNextHopIndex::iterator indexIt = destCacheNextHopIndex.lower_bound(NextHop(interfaceId, IPv6Address()));
+    while (indexIt != destCacheNextHopIndex.end() && indexIt->first.first == interfaceId)
     {
-        if (it->second.interfaceId==interfaceId)
-        {
-            // move the iterator past this element before removing it
-            //DestCache::iterator oldIt = it++;
-            //destCache.erase(oldIt);
-            destCache.erase(it++);
-        }
-        else
-        {
-            ++it;
-        }
+        // removeDestCacheEntry() may erase the current index entry
+        std::set<IPv6Address> dests = indexIt->second;
+        ++indexIt;
+        for (std::set<IPv6Address>::iterator it = dests.begin(); it != dests.end(); ++it)
+            removeDestCacheEntry(destCache.find(*it));
     }
 
     updateDisplayString();
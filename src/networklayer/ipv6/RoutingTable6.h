@@ -19,10 +19,13 @@
 #define __INET_ROUTINGTABLE6_H
 
 #include <vector>
+#include <list>
+#include <set>
 
 #include "INETDefs.h"
 
 #include "IPv6Address.h"
+#include "IPv6RouteTrie.h"
 #include "NotificationBoard.h"
 
 class IInterfaceTable;
@@ -114,6 +117,10 @@ class INET_API RoutingTable6 : public cSimpleModule, protected INotifiable
     bool mipv6Support; // 4.9.07 - CB
 #endif /* WITH_xMIPv6 */
 
+    // destinations in the Destination Cache, most recently used first
+    typedef std::list<IPv6Address> DestCacheLRUList;
+    DestCacheLRUList destCacheLRUList;
+
     // Destination Cache maps dest address to next hop and interfaceId.
     // NOTE: nextHop might be a link-local address from which interfaceId cannot be deduced
     struct DestCacheEntry
@@ -122,21 +129,40 @@ class INET_API RoutingTable6 : public cSimpleModule, protected INotifiable
         IPv6Address nextHopAddr;
         simtime_t expiryTime;
         // more destination specific data may be added here, e.g. path MTU
+        DestCacheLRUList::iterator lruPos; // position in destCacheLRUList
     };
     friend std::ostream& operator<<(std::ostream& os, const DestCacheEntry& e);
     typedef std::map<IPv6Address,DestCacheEntry> DestCache;
     DestCache destCache;
 
+    // max number of Destination Cache entries (least recently used ones are
+    // dropped above that); zero or negative means unlimited
+    int maxDestCacheSize;
+
+    // Destination Cache entries indexed by (interfaceId, next hop), so that
+    // purging the entries of a neighbour or an interface doesn't need a full walk
+    typedef std::pair<int,IPv6Address> NextHop;
+    typedef std::map<NextHop, std::set<IPv6Address> > DestCacheNextHopIndex;
+    DestCacheNextHopIndex destCacheNextHopIndex;
+
     // RouteList contains local prefixes, and (for routers)
     // static, OSPF, RIP etc routes as well
     typedef std::vector<IPv6Route*> RouteList;
     RouteList routeList;
 
+    // prefix trie over routeList, for longest prefix matching;
+    // must be updated together with routeList
+    IPv6RouteTrie routeTrie;
+
   protected:
     // internal: routes of different type can only be added via well-defined functions
     virtual void addRoute(IPv6Route *route);
     // helper for addRoute()
     static bool routeLessThan(const IPv6Route *a, const IPv6Route *b);
+    // removes the route from routeList and routeTrie (does not delete it); returns the next position
+    virtual RouteList::iterator internalRemoveRoute(RouteList::iterator it);
+    // removes the given Destination Cache entry, and its LRU list and next hop index entries
+    virtual void removeDestCacheEntry(DestCache::iterator it);
     // internal
     virtual void configureInterfaceForIPv6(InterfaceEntry *ie);
     /**
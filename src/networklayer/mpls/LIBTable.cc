@@ -45,26 +45,104 @@ void LIBTable::handleMessage(cMessage *)
     ASSERT(false);
 }
 
-bool LIBTable::resolveLabel(std::string inInterface, int inLabel,
-        LabelOpVector& outLabel, std::string& outInterface, int& color)
+int LIBTable::getInterfaceId(const std::string& name)
 {
-    bool any = (inInterface.length() == 0);
+    std::map<std::string, int>::iterator it = interfaceIds.find(name);
+    if (it != interfaceIds.end())
+        return it->second;
+
+    int id = interfaceNames.size();
+    interfaceIds[name] = id;
+    interfaceNames.push_back(name);
+    return id;
+}
 
-    for (unsigned int i = 0; i < lib.size(); i++)
+int LIBTable::findIlmSlot(int inInterfaceId, int inLabel) const
+{
+    ASSERT(!ilm.empty());
+
+    unsigned int mask = ilm.size() - 1;
+    unsigned int h = (unsigned int)inLabel * 0x9e3779b1u ^ (unsigned int)(inInterfaceId + 1) * 0x85ebca6bu;
+    h ^= h >> 16;
+    for (unsigned int i = h & mask; ; i = (i + 1) & mask)
     {
-        if (!any && lib[i].inInterface != inInterface)
-            continue;
+        const IlmSlot& slot = ilm[i];
+        if (slot.index == -1 || (slot.inLabel == inLabel && slot.inInterfaceId == inInterfaceId))
+            return i;
+    }
+}
 
-        if (lib[i].inLabel != inLabel)
-            continue;
+void LIBTable::addToIlm(int index)
+{
+    // keep the load factor at or below 1/2
+    if (2 * (numIlmKeys + 2) > (int)ilm.size())
+    {
+        rebuildIlm();
+        return;
+    }
 
-        outLabel = lib[i].outLabel;
-        outInterface = lib[i].outInterface;
-        color = lib[i].color;
+    const LIBEntry& entry = lib[index];
+    int keys[2] = {entry.inInterfaceId, ANY_INTERFACE};
+    for (int k = 0; k < 2; k++)
+    {
+        IlmSlot& slot = ilm[findIlmSlot(keys[k], entry.inLabel)];
+        if (slot.index != -1)
+            continue; // an earlier entry has the same key
+
+        slot.inInterfaceId = keys[k];
+        slot.inLabel = entry.inLabel;
+        slot.index = index;
+        numIlmKeys++;
+    }
+}
 
-        return true;
+void LIBTable::rebuildIlm()
+{
+    unsigned int size = 16;
+    while (size < 4 * lib.size())
+        size *= 2;
+
+    IlmSlot empty;
+    empty.inInterfaceId = ANY_INTERFACE;
+    empty.inLabel = 0;
+    empty.index = -1;
+    ilm.assign(size, empty);
+    numIlmKeys = 0;
+
+    for (unsigned int i = 0; i < lib.size(); i++)
+        addToIlm(i);
+}
+
+const LIBTable::LIBEntry *LIBTable::findLibEntry(int inInterfaceId, int inLabel) const
+{
+    if (ilm.empty())
+        return NULL;
+
+    int index = ilm[findIlmSlot(inInterfaceId, inLabel)].index;
+    return index == -1 ? NULL : &lib[index];
+}
+
+bool LIBTable::resolveLabel(std::string inInterface, int inLabel,
+        LabelOpVector& outLabel, std::string& outInterface, int& color)
+{
+    int inInterfaceId = ANY_INTERFACE;
+    if (inInterface.length() != 0)
+    {
+        std::map<std::string, int>::iterator it = interfaceIds.find(inInterface);
+        if (it == interfaceIds.end())
+            return false;
+        inInterfaceId = it->second;
     }
-    return false;
+
+    const LIBEntry *entry = findLibEntry(inInterfaceId, inLabel);
+    if (!entry)
+        return false;
+
+    outLabel = entry->outLabel;
+    outInterface = entry->outInterface;
+    color = entry->color;
+
+    return true;
 }
 
 int LIBTable::installLibEntry(int inLabel, std::string inInterface, const LabelOpVector& outLabel,
@@ -78,38 +156,40 @@ int LIBTable::installLibEntry(int inLabel, std::string inInterface, const LabelO
         newItem.outLabel = outLabel;
         newItem.outInterface = outInterface;
         newItem.color = color;
+        newItem.inInterfaceId = getInterfaceId(inInterface);
+        newItem.outInterfaceId = getInterfaceId(outInterface);
         lib.push_back(newItem);
+        addToIlm(lib.size() - 1);
         return newItem.inLabel;
     }
     else
     {
-        for (unsigned int i = 0; i < lib.size(); i++)
+        const LIBEntry *entry = findLibEntry(ANY_INTERFACE, inLabel);
+        ASSERT(entry);
+
+        LIBEntry& item = lib[entry - &lib[0]];
+        int inInterfaceId = getInterfaceId(inInterface);
+        item.outLabel = outLabel;
+        item.outInterface = outInterface;
+        item.outInterfaceId = getInterfaceId(outInterface);
+        item.color = color;
+        if (item.inInterfaceId != inInterfaceId)
         {
-            if (lib[i].inLabel != inLabel)
-                continue;
-
-            lib[i].inInterface = inInterface;
-            lib[i].outLabel = outLabel;
-            lib[i].outInterface = outInterface;
-            lib[i].color = color;
-            return inLabel;
+            item.inInterface = inInterface;
+            item.inInterfaceId = inInterfaceId;
+            rebuildIlm();
         }
-        ASSERT(false);
-        return 0; // prevent warning
+        return inLabel;
     }
 }
 
 void LIBTable::removeLibEntry(int inLabel)
 {
-    for (unsigned int i = 0; i < lib.size(); i++)
-    {
-        if (lib[i].inLabel != inLabel)
-            continue;
+    const LIBEntry *entry = findLibEntry(ANY_INTERFACE, inLabel);
+    ASSERT(entry);
 
-        lib.erase(lib.begin() + i);
-        return;
-    }
-    ASSERT(false);
+    lib.erase(lib.begin() + (entry - &lib[0]));
+    rebuildIlm();
 }
 
 void LIBTable::readTableFromXML(const cXMLElement* libtable)
@@ -129,6 +209,8 @@ void LIBTable::readTableFromXML(const cXMLElement* libtable)
         newItem.inInterface = getParameterStrValue(&entry, "inInterface");
         newItem.outInterface = getParameterStrValue(&entry, "outInterface");
         newItem.color = getParameterIntValue(&entry, "color", 0);
+        newItem.inInterfaceId = getInterfaceId(newItem.inInterface);
+        newItem.outInterfaceId = getInterfaceId(newItem.outInterface);
 
         cXMLElementList ops = getUniqueChild(&entry, "outLabel")->getChildrenByTagName("op");
         for (cXMLElementList::iterator oit=ops.begin(); oit != ops.end(); oit++)
@@ -165,6 +247,7 @@ void LIBTable::readTableFromXML(const cXMLElement* libtable)
         }
 
         lib.push_back(newItem);
+        addToIlm(lib.size() - 1);
 
         ASSERT(newItem.inLabel > 0);
 
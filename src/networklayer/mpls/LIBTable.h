@@ -17,6 +17,7 @@
 #define __INET_LIBTABLE_H
 
 #include <vector>
+#include <map>
 #include <string>
 
 #include "INETDefs.h"
@@ -57,6 +58,23 @@ class INET_API LIBTable: public cSimpleModule
 
             // FIXME colors in nam, temporary solution
             int color;
+
+            // interned inInterface and outInterface, see getInterfaceId()
+            int inInterfaceId;
+            int outInterfaceId;
+        };
+
+        // for findLibEntry(): match the label on any incoming interface
+        static const int ANY_INTERFACE = -1;
+
+    protected:
+        // slot of the incoming label map; interface is ANY_INTERFACE in the
+        // label-only key that every entry also has
+        struct IlmSlot
+        {
+            int inInterfaceId;
+            int inLabel;
+            int index; // into lib, -1 if the slot is empty
         };
 
     protected:
@@ -64,6 +82,17 @@ class INET_API LIBTable: public cSimpleModule
         int maxLabel;
         std::vector<LIBEntry> lib;
 
+        // interface names are interned, so that entries can be looked up
+        // without string comparisons
+        std::map<std::string, int> interfaceIds;
+        std::vector<std::string> interfaceNames;
+
+        // incoming label map: open addressing hash table over lib, keyed by
+        // (inInterfaceId, inLabel) and (ANY_INTERFACE, inLabel); the first
+        // entry in lib wins if there are several with the same key
+        std::vector<IlmSlot> ilm;
+        int numIlmKeys;
+
     protected:
         virtual void initialize(int stage);
         virtual int numInitStages() const  {return 5;}
@@ -72,8 +101,30 @@ class INET_API LIBTable: public cSimpleModule
         // static configuration
         virtual void readTableFromXML(const cXMLElement* libtable);
 
+        // incoming label map maintenance
+        virtual int findIlmSlot(int inInterfaceId, int inLabel) const;
+        virtual void addToIlm(int index);
+        virtual void rebuildIlm();
+
     public:
+        LIBTable() : numIlmKeys(0) {}
+
+        // interface name interning; ids are small nonnegative integers,
+        // assigned on first use and never reused
+        virtual int getInterfaceId(const std::string& name);
+        virtual const std::string& getInterfaceName(int id) const {return interfaceNames.at(id);}
+
         // label management
+
+        /**
+         * Returns the entry for the given incoming label and interface id
+         * (or ANY_INTERFACE), or NULL. The pointer is only valid until the
+         * next change to the table. Takes constant time, this is the method
+         * to be used for forwarding.
+         */
+        virtual const LIBEntry *findLibEntry(int inInterfaceId, int inLabel) const;
+
+        // empty inInterface matches any interface
         virtual bool resolveLabel(std::string inInterface, int inLabel,
                           LabelOpVector& outLabel, std::string& outInterface, int& color);
 
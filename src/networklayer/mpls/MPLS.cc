@@ -44,6 +44,17 @@ void MPLS::initialize(int stage)
 
     pct = check_and_cast<IClassifier*>(getParentModule()->getSubmodule(par("classifier")));
 
+    for (int i = 0; i < ift->getNumInterfaces(); i++)
+    {
+        InterfaceEntry *ie = ift->getInterface(i);
+        int gateIndex = ie->getNetworkLayerGateIndex();
+        if (gateIndex < 0)
+            continue;
+        if (gateIndex >= (int)libInterfaceIds.size())
+            libInterfaceIds.resize(gateIndex + 1, -1);
+        libInterfaceIds[gateIndex] = lt->getInterfaceId(ie->getName());
+    }
+
     /*
      * we now send plain IPv4Datagrams instead of packets with label=-1
      * and we thus do not need this extra configuration
@@ -195,6 +206,23 @@ void MPLS::doStackOps(MPLSPacket *mplsPacket, const LabelOpVector& outLabel)
     }
 }
 
+int MPLS::getOutputGateIndex(int libInterfaceId)
+{
+    if (libInterfaceId >= (int)outputGateIndices.size())
+        outputGateIndices.resize(libInterfaceId + 1, -2);
+
+    int& gateIndex = outputGateIndices[libInterfaceId];
+    if (gateIndex == -2)
+    {
+        const std::string& name = lt->getInterfaceName(libInterfaceId);
+        InterfaceEntry *ie = ift->getInterfaceByName(name.c_str());
+        if (!ie)
+            error("LIB refers to nonexistent interface `%s'", name.c_str());
+        gateIndex = ie->getNetworkLayerGateIndex();
+    }
+    return gateIndex;
+}
+
 void MPLS::processPacketFromL2(cMessage *msg)
 {
     IPv4Datagram *ipdatagram = dynamic_cast<IPv4Datagram *>(msg);
@@ -224,12 +252,12 @@ void MPLS::processPacketFromL2(cMessage *msg)
 void MPLS::processMPLSPacketFromL2(MPLSPacket *mplsPacket)
 {
     int gateIndex = mplsPacket->getArrivalGate()->getIndex();
-    InterfaceEntry *ie = ift->getInterfaceByNetworkLayerGateIndex(gateIndex);
-    std::string senderInterface = ie->getName();
+    ASSERT(gateIndex < (int)libInterfaceIds.size() && libInterfaceIds[gateIndex] >= 0);
+    int inInterfaceId = libInterfaceIds[gateIndex];
     ASSERT(mplsPacket->hasLabel());
     int oldLabel = mplsPacket->getTopLabel();
 
-    EV << "Received " << mplsPacket << " from L2, label=" << oldLabel << " inInterface=" << senderInterface << endl;
+    EV << "Received " << mplsPacket << " from L2, label=" << oldLabel << " inInterface=" << lt->getInterfaceName(inInterfaceId) << endl;
 
     if (oldLabel==-1)
     {
@@ -243,12 +271,8 @@ void MPLS::processMPLSPacketFromL2(MPLSPacket *mplsPacket)
         return;
     }
 
-    LabelOpVector outLabel;
-    std::string outInterface;
-    int color;
-
-    bool found = lt->resolveLabel(senderInterface, oldLabel, outLabel, outInterface, color);
-    if (!found)
+    const LIBTable::LIBEntry *entry = lt->findLibEntry(inInterfaceId, oldLabel);
+    if (!entry)
     {
         EV << "discarding packet, incoming label not resolved" << endl;
 
@@ -256,7 +280,10 @@ void MPLS::processMPLSPacketFromL2(MPLSPacket *mplsPacket)
         return;
     }
 
-    int outgoingPort = ift->getInterfaceByName(outInterface.c_str())->getNetworkLayerGateIndex();
+    const LabelOpVector& outLabel = entry->outLabel;
+    const std::string& outInterface = entry->outInterface;
+    int color = entry->color;
+    int outgoingPort = getOutputGateIndex(entry->outInterfaceId);
 
     doStackOps(mplsPacket, outLabel);
 
@@ -45,6 +45,11 @@ class INET_API MPLS : public cSimpleModule
         IInterfaceTable *ift;
         IClassifier *pct;
 
+        // LIB interface id of each network layer gate index, and network
+        // layer gate index of each LIB interface id (-2 if not looked up yet)
+        std::vector<int> libInterfaceIds;
+        std::vector<int> outputGateIndices;
+
     protected:
         virtual void initialize(int stage);
         virtual int numInitStages() const  {return 5;}
@@ -58,6 +63,8 @@ class INET_API MPLS : public cSimpleModule
         virtual bool tryLabelAndForwardIPv4Datagram(IPv4Datagram *ipdatagram);
         virtual void labelAndForwardIPv4Datagram(IPv4Datagram *ipdatagram);
 
+        virtual int getOutputGateIndex(int libInterfaceId);
+
         virtual void sendToL2(cMessage *msg, int gateIndex);
         virtual void doStackOps(MPLSPacket *mplsPacket, const LabelOpVector& outLabel);
 };
@@ -36,14 +36,29 @@ struct NextHop {
 
 class RoutingInfo
 {
+public:
+    enum SPFState {
+        SPF_UNREACHED = 0,
+        SPF_CANDIDATE = 1,
+        SPF_ON_TREE = 2
+    };
+
 private:
     std::vector<NextHop>  nextHops;
     unsigned long         distance;
     OSPFLSA*              parent;
 
+    // shortest path calculation state, not copied with the LSA
+    SPFState              spfState;
+    unsigned long         spfCandidateOrder;    // breaks ties between candidates of equal distance
+    unsigned long         spfTreeOrder;         // order of addition to the tree
+    std::vector<OSPFLSA*> spfParents;           // all equal cost parents
+    std::vector<uint32>   spfInputs;            // the LSA contents the last calculation used
+
 public:
-    RoutingInfo() : distance(0), parent(NULL) {}
-    RoutingInfo(const RoutingInfo& routingInfo) : nextHops(routingInfo.nextHops), distance(routingInfo.distance), parent(routingInfo.parent) {}
+    RoutingInfo() : distance(0), parent(NULL), spfState(SPF_UNREACHED), spfCandidateOrder(0), spfTreeOrder(0) {}
+    RoutingInfo(const RoutingInfo& routingInfo) : nextHops(routingInfo.nextHops), distance(routingInfo.distance), parent(routingInfo.parent),
+                                                  spfState(SPF_UNREACHED), spfCandidateOrder(0), spfTreeOrder(0) {}
     virtual ~RoutingInfo() {}
 
     void            addNextHop(NextHop nextHop)  { nextHops.push_back(nextHop); }
@@ -54,6 +69,15 @@ public:
     unsigned long   getDistance() const  { return distance; }
     void            setParent(OSPFLSA* p)  { parent = p; }
     OSPFLSA*        getParent() const  { return parent; }
+
+    void                         setSPFState(SPFState state)  { spfState = state; }
+    SPFState                     getSPFState() const  { return spfState; }
+    void                         setSPFCandidateOrder(unsigned long order)  { spfCandidateOrder = order; }
+    unsigned long                getSPFCandidateOrder() const  { return spfCandidateOrder; }
+    void                         setSPFTreeOrder(unsigned long order)  { spfTreeOrder = order; }
+    unsigned long                getSPFTreeOrder() const  { return spfTreeOrder; }
+    std::vector<OSPFLSA*>&       getSPFParents()  { return spfParents; }
+    std::vector<uint32>&         getSPFInputs()  { return spfInputs; }
 };
 
 class LSATrackingInfo
@@ -18,6 +18,8 @@
 #include "OSPFArea.h"
 #include "OSPFRouter.h"
 #include <memory.h>
+#include <algorithm>
+#include <set>
 
 OSPF::Area::Area(OSPF::AreaID id) :
     areaID(id),
@@ -25,6 +27,7 @@ OSPF::Area::Area(OSPF::AreaID id) :
     externalRoutingCapability(true),
     stubDefaultCost(1),
     spfTreeRoot(NULL),
+    spfSequenceNumber(0),
     parentRouter(NULL)
 {
 }
@@ -1346,15 +1349,137 @@ OSPF::SummaryLSA* OSPF::Area::originateSummaryLSA(const OSPF::SummaryLSA* summar
     return NULL;
 }
 
+/**
+ * Index of the network destination entries of a routing table by netmask and
+ * masked destination, for the longest match lookups of the intra-area route
+ * calculation. An entry has to be removed from the index before its
+ * destination or netmask is changed, and added back afterwards.
+ */
+class RoutingTableNetworkIndex
+{
+private:
+    typedef std::pair<uint32, uint32> NetworkKey;      // (netmask, masked destination)
+    typedef std::map<NetworkKey, std::set<unsigned long> > NetworkMap;
+
+    const std::vector<OSPF::RoutingTableEntry*>& routingTable;
+    NetworkMap networks;                        // entry indices
+    std::map<uint32, unsigned long> netmasks;   // entry count of each netmask
+
+public:
+    RoutingTableNetworkIndex(const std::vector<OSPF::RoutingTableEntry*>& table) : routingTable(table)
+    {
+        unsigned long entryCount = routingTable.size();
+        for (unsigned long i = 0; i < entryCount; i++) {
+            add(i);
+        }
+    }
+
+    void add(unsigned long index)
+    {
+        const OSPF::RoutingTableEntry* entry = routingTable[index];
+        if (entry->getDestinationType() != OSPF::RoutingTableEntry::NETWORK_DESTINATION) {
+            return;
+        }
+        uint32 netmask = entry->getNetmask().getInt();
+        networks[NetworkKey(netmask, entry->getDestination().getInt() & netmask)].insert(index);
+        netmasks[netmask]++;
+    }
+
+    void remove(unsigned long index)
+    {
+        const OSPF::RoutingTableEntry* entry = routingTable[index];
+        if (entry->getDestinationType() != OSPF::RoutingTableEntry::NETWORK_DESTINATION) {
+            return;
+        }
+        uint32 netmask = entry->getNetmask().getInt();
+        NetworkMap::iterator it = networks.find(NetworkKey(netmask, entry->getDestination().getInt() & netmask));
+        if (it == networks.end() || it->second.erase(index) == 0) {
+            throw cRuntimeError("Routing table entry %lu is not indexed", index);
+        }
+        if (it->second.empty()) {
+            networks.erase(it);
+        }
+        if (--netmasks[netmask] == 0) {
+            netmasks.erase(netmask);
+        }
+    }
+
+    /**
+     * Returns the index of the entry whose network contains the destination
+     * with the largest masked destination value, the first one in the table
+     * if there are several, or -1 if there is none.
+     */
+    long findLongestMatch(uint32 destination) const
+    {
+        uint32 longestMatch = 0;
+        long matchIndex = -1;
+
+        for (std::map<uint32, unsigned long>::const_iterator it = netmasks.begin(); it != netmasks.end(); it++) {
+            uint32 match = destination & it->first;
+            if ((match == 0) || (match < longestMatch)) {
+                continue;
+            }
+            NetworkMap::const_iterator network = networks.find(NetworkKey(it->first, match));
+            if (network == networks.end()) {
+                continue;
+            }
+            long index = *network->second.begin();
+            if ((match > longestMatch) || (index < matchIndex)) {
+                longestMatch = match;
+                matchIndex = index;
+            }
+        }
+        return matchIndex;
+    }
+};
+
+/**
+ * Adds those of the next hops to the routing info that it does not have yet.
+ * Returns true if any was added.
+ */
+static bool addNewNextHops(OSPF::RoutingInfo* routingInfo, const std::vector<OSPF::NextHop>& nextHops)
+{
+    unsigned int newCount = nextHops.size();
+    bool added = false;
+
+    for (unsigned int i = 0; i < newCount; i++) {
+        unsigned int nextHopCount = routingInfo->getNextHopCount();
+        bool found = false;
+        for (unsigned int j = 0; j < nextHopCount; j++) {
+            if (routingInfo->getNextHop(j) == nextHops[i]) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            routingInfo->addNextHop(nextHops[i]);
+            added = true;
+        }
+    }
+    return added;
+}
+
+bool OSPF::Area::spfCandidateLess(const SPFCandidate& a, const SPFCandidate& b)
+{
+    // of equal distance, networks are added to the tree before routers (RFC2328 16.1 (3)),
+    // and otherwise the one that became candidate first
+    if (a.distance != b.distance) {
+        return a.distance < b.distance;
+    }
+    if (a.isRouter != b.isRouter) {
+        return b.isRouter;
+    }
+    return a.order < b.order;
+}
+
+bool OSPF::Area::spfCandidateGreater(const SPFCandidate& a, const SPFCandidate& b)
+{
+    return spfCandidateLess(b, a);
+}
+
 void OSPF::Area::calculateShortestPathTree(std::vector<OSPF::RoutingTableEntry*>& newRoutingTable)
 {
     OSPF::RouterID routerID = parentRouter->getRouterID();
-    bool finished = false;
-    std::vector<OSPFLSA*> treeVertices;
-    OSPFLSA* justAddedVertex;
-    std::vector<OSPFLSA*> candidateVertices;
-    unsigned long            i, j, k;
-    unsigned long lsaCount;
 
     if (spfTreeRoot == NULL) {
         OSPF::RouterLSA* newLSA = originateRouterLSA();
@@ -1371,33 +1496,294 @@ void OSPF::Area::calculateShortestPathTree(std::vector<OSPF::RoutingTableEntry*>
         return;
     }
 
-    lsaCount = routerLSAs.size();
-    for (i = 0; i < lsaCount; i++) {
-        routerLSAs[i]->clearNextHops();
+    if (!parentRouter->getIncrementalSPF() || !updateShortestPathTree()) {
+        buildShortestPathTree();
+    } else if (parentRouter->getVerifyIncrementalSPF()) {
+        verifyShortestPathTree();
     }
-    lsaCount = networkLSAs.size();
+    addShortestPathTreeRoutes(newRoutingTable);
+}
+
+void OSPF::Area::buildShortestPathTree()
+{
+    bool recordInputs = parentRouter->getIncrementalSPF();
+    unsigned long lsaCount = routerLSAs.size() + networkLSAs.size();
+
+    for (unsigned long i = 0; i < lsaCount; i++) {
+        OSPFLSA* vertex;
+        OSPF::RoutingInfo* routingInfo;
+        if (i < routerLSAs.size()) {
+            vertex = routerLSAs[i];
+            routingInfo = routerLSAs[i];
+        } else {
+            vertex = networkLSAs[i - routerLSAs.size()];
+            routingInfo = networkLSAs[i - routerLSAs.size()];
+        }
+        routingInfo->clearNextHops();
+        routingInfo->setParent(NULL);
+        routingInfo->getSPFParents().clear();
+        routingInfo->setSPFState(OSPF::RoutingInfo::SPF_UNREACHED);
+        if (recordInputs) {
+            getSPFInputs(vertex, routingInfo->getSPFInputs());
+        }
+    }
+    if (recordInputs) {
+        getSPFInterfaceInputs(spfInterfaceInputs);
+    }
+
+    SPFCandidateHeap candidates;
+
+    spfTreeVertices.clear();
+    spfTreeRoot->setDistance(0);    // (1)
+    spfTreeRoot->setSPFCandidateOrder(spfSequenceNumber++);
+    pushCandidate(spfTreeRoot, spfTreeRoot, candidates);
+    runDijkstra(candidates, false);
+}
+
+bool OSPF::Area::updateShortestPathTree()
+{
+    if (spfTreeVertices.empty() || (spfTreeVertices[0] != spfTreeRoot)) {
+        return false;
+    }
+
+    std::vector<uint32> inputs;
+    getSPFInterfaceInputs(inputs);
+    if (inputs != spfInterfaceInputs) {
+        return false;
+    }
+
+    // find the LSAs that changed since the last calculation
+    std::vector<OSPFLSA*> changedVertices;
+    std::vector<OSPF::RoutingInfo*> changedRoutingInfos;
+    unsigned long lsaCount = routerLSAs.size() + networkLSAs.size();
+    unsigned long treeSize = 0;
+    unsigned long i, j, k;
+
     for (i = 0; i < lsaCount; i++) {
-        networkLSAs[i]->clearNextHops();
+        OSPFLSA* vertex;
+        OSPF::RoutingInfo* routingInfo;
+        if (i < routerLSAs.size()) {
+            vertex = routerLSAs[i];
+            routingInfo = routerLSAs[i];
+        } else {
+            vertex = networkLSAs[i - routerLSAs.size()];
+            routingInfo = networkLSAs[i - routerLSAs.size()];
+        }
+        if (routingInfo->getSPFState() == OSPF::RoutingInfo::SPF_ON_TREE) {
+            treeSize++;
+        }
+        getSPFInputs(vertex, inputs);
+        if (inputs != routingInfo->getSPFInputs()) {
+            routingInfo->getSPFInputs().swap(inputs);
+            changedVertices.push_back(vertex);
+            changedRoutingInfos.push_back(routingInfo);
+        }
     }
-    spfTreeRoot->setDistance(0);
-    treeVertices.push_back(spfTreeRoot);
-    justAddedVertex = spfTreeRoot;          // (1)
 
-    do {
-        LSAType vertexType = static_cast<LSAType> (justAddedVertex->getHeader().getLsType());
+    // an LSA of the tree has been removed from the database
+    if (treeSize != spfTreeVertices.size()) {
+        return false;
+    }
+    if (std::find(changedVertices.begin(), changedVertices.end(), spfTreeRoot) != changedVertices.end()) {
+        return false;
+    }
+    if (changedVertices.empty()) {
+        return true;
+    }
 
-        if ((vertexType == ROUTERLSA_TYPE)) {
-            OSPF::RouterLSA* routerVertex = check_and_cast<OSPF::RouterLSA*> (justAddedVertex);
-            if (routerVertex->getV_VirtualLinkEndpoint()) {    // (2)
-                transitCapability = true;
+    // the changed vertices lose their place on the tree, together with everything
+    // reached through them; parents come before their children in tree order
+    std::vector<OSPFLSA*> affectedVertices;
+
+    for (i = 0; i < changedVertices.size(); i++) {
+        if (changedRoutingInfos[i]->getSPFState() == OSPF::RoutingInfo::SPF_ON_TREE) {
+            changedRoutingInfos[i]->setSPFState(OSPF::RoutingInfo::SPF_UNREACHED);
+        }
+    }
+    for (i = 1; i < spfTreeVertices.size(); i++) {
+        OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (spfTreeVertices[i]);
+        std::vector<OSPFLSA*>& parents = routingInfo->getSPFParents();
+
+        if (routingInfo->getSPFState() == OSPF::RoutingInfo::SPF_ON_TREE) {
+            for (j = 0; j < parents.size(); j++) {
+                OSPF::RoutingInfo* parentRoutingInfo = check_and_cast<OSPF::RoutingInfo*> (parents[j]);
+                if (parentRoutingInfo->getSPFState() == OSPF::RoutingInfo::SPF_UNREACHED) {
+                    routingInfo->setSPFState(OSPF::RoutingInfo::SPF_UNREACHED);
+                    break;
+                }
             }
+        }
+        if (routingInfo->getSPFState() == OSPF::RoutingInfo::SPF_UNREACHED) {
+            affectedVertices.push_back(spfTreeVertices[i]);
+        }
+    }
+    for (i = 0; i < affectedVertices.size(); i++) {
+        OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (affectedVertices[i]);
+        routingInfo->clearNextHops();
+        routingInfo->setParent(NULL);
+        routingInfo->getSPFParents().clear();
+    }
+
+    // the remaining vertices of the tree next to them are considered again,
+    // to reach them and to take the changed links into account
+    SPFCandidateHeap candidates;
+    std::vector<OSPFLSA*> adjacentVertices;
+
+    for (i = 0; i < affectedVertices.size() + changedVertices.size(); i++) {
+        OSPFLSA* vertex = (i < affectedVertices.size()) ? affectedVertices[i] : changedVertices[i - affectedVertices.size()];
+        getAdjacentVertices(vertex, adjacentVertices);
+        for (k = 0; k < adjacentVertices.size(); k++) {
+            OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (adjacentVertices[k]);
+            if (routingInfo->getSPFState() == OSPF::RoutingInfo::SPF_ON_TREE) {
+                pushCandidate(adjacentVertices[k], routingInfo, candidates);
+            }
+        }
+    }
+
+    EV << "Incremental SPF in area " << areaID << ": " << changedVertices.size() << " changed LSAs, "
+       << affectedVertices.size() << " vertices removed from the tree, " << candidates.size() << " restarting.\n";
+
+    runDijkstra(candidates, true);
+
+    // rebuild the tree order: by distance, then in the order of addition
+    std::vector<SPFCandidate> treeOrder;
+    for (i = 0; i < lsaCount; i++) {
+        SPFCandidate vertex;
+        if (i < routerLSAs.size()) {
+            vertex.vertex = routerLSAs[i];
+            vertex.routingInfo = routerLSAs[i];
+            vertex.isRouter = true;
+        } else {
+            vertex.vertex = networkLSAs[i - routerLSAs.size()];
+            vertex.routingInfo = networkLSAs[i - routerLSAs.size()];
+            vertex.isRouter = false;
+        }
+        if (vertex.routingInfo->getSPFState() == OSPF::RoutingInfo::SPF_ON_TREE) {
+            vertex.distance = vertex.routingInfo->getDistance();
+            vertex.order = vertex.routingInfo->getSPFTreeOrder();
+            treeOrder.push_back(vertex);
+        }
+    }
+    std::sort(treeOrder.begin(), treeOrder.end(), spfCandidateLess);
+
+    spfTreeVertices.clear();
+    for (i = 0; i < treeOrder.size(); i++) {
+        spfTreeVertices.push_back(treeOrder[i].vertex);
+    }
+    return true;
+}
+
+static bool sameNextHop(const OSPF::NextHop& a, const OSPF::NextHop& b)
+{
+    return a == b;
+}
+
+static bool nextHopLess(const OSPF::NextHop& a, const OSPF::NextHop& b)
+{
+    if (a.ifIndex != b.ifIndex) {
+        return a.ifIndex < b.ifIndex;
+    }
+    if (a.hopAddress != b.hopAddress) {
+        return a.hopAddress < b.hopAddress;
+    }
+    return a.advertisingRouter < b.advertisingRouter;
+}
+
+static void getNextHopSet(const OSPF::RoutingInfo* routingInfo, std::vector<OSPF::NextHop>& nextHops)
+{
+    nextHops.clear();
+    for (unsigned int i = 0; i < routingInfo->getNextHopCount(); i++) {
+        nextHops.push_back(routingInfo->getNextHop(i));
+    }
+    std::sort(nextHops.begin(), nextHops.end(), nextHopLess);
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < nextHops.size(); i++) {
+        if ((count == 0) || !(nextHops[count - 1] == nextHops[i])) {
+            nextHops[count++] = nextHops[i];
+        }
+    }
+    nextHops.resize(count);
+}
 
+void OSPF::Area::verifyShortestPathTree()
+{
+    // equal cost vertices and next hops may be in a different order than in the full
+    // calculation, so the vertices are compared as a set, and so are their next hops
+    std::map<OSPFLSA*, unsigned long> distances;
+    std::map<OSPFLSA*, std::vector<OSPF::NextHop> > nextHops;
+    std::vector<OSPF::NextHop> fullNextHops;
+    unsigned long i;
+
+    for (i = 0; i < spfTreeVertices.size(); i++) {
+        OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (spfTreeVertices[i]);
+        distances[spfTreeVertices[i]] = routingInfo->getDistance();
+        getNextHopSet(routingInfo, nextHops[spfTreeVertices[i]]);
+    }
+
+    buildShortestPathTree();
+
+    for (i = 0; i < spfTreeVertices.size(); i++) {
+        OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (spfTreeVertices[i]);
+        std::map<OSPFLSA*, unsigned long>::iterator it = distances.find(spfTreeVertices[i]);
+        getNextHopSet(routingInfo, fullNextHops);
+        if ((it == distances.end()) || (it->second != routingInfo->getDistance()) ||
+            (nextHops[spfTreeVertices[i]].size() != fullNextHops.size()) ||
+            !std::equal(fullNextHops.begin(), fullNextHops.end(), nextHops[spfTreeVertices[i]].begin(), sameNextHop))
+        {
+            throw cRuntimeError("The incremental shortest path tree of area %s differs from the full calculation at LSA %s",
+                                areaID.str().c_str(), spfTreeVertices[i]->getHeader().getLinkStateID().str().c_str());
+        }
+    }
+    if (spfTreeVertices.size() != distances.size()) {
+        throw cRuntimeError("The incremental shortest path tree of area %s has %lu vertices, the full calculation %lu",
+                            areaID.str().c_str(), (unsigned long)distances.size(), (unsigned long)spfTreeVertices.size());
+    }
+}
+
+void OSPF::Area::pushCandidate(OSPFLSA* vertex, OSPF::RoutingInfo* routingInfo, SPFCandidateHeap& candidates)
+{
+    SPFCandidate candidate;
+
+    candidate.distance = routingInfo->getDistance();
+    candidate.isRouter = (vertex->getHeader().getLsType() == ROUTERLSA_TYPE);
+    candidate.order = routingInfo->getSPFCandidateOrder();
+    candidate.vertex = vertex;
+    candidate.routingInfo = routingInfo;
+
+    routingInfo->setSPFState(OSPF::RoutingInfo::SPF_CANDIDATE);
+    candidates.push_back(candidate);
+    std::push_heap(candidates.begin(), candidates.end(), spfCandidateGreater);
+}
+
+void OSPF::Area::runDijkstra(SPFCandidateHeap& candidates, bool incremental)
+{
+    while (!candidates.empty()) {   // (3)
+        SPFCandidate candidate = candidates.front();
+        std::pop_heap(candidates.begin(), candidates.end(), spfCandidateGreater);
+        candidates.pop_back();
+
+        // a vertex is pushed again when its distance decreases, the earlier entries are left behind
+        OSPF::RoutingInfo* routingInfo = candidate.routingInfo;
+        if ((routingInfo->getSPFState() != OSPF::RoutingInfo::SPF_CANDIDATE) ||
+            (routingInfo->getDistance() != candidate.distance))
+        {
+            continue;
+        }
+
+        routingInfo->setSPFState(OSPF::RoutingInfo::SPF_ON_TREE);
+        routingInfo->setSPFTreeOrder(spfSequenceNumber++);
+        if (!incremental) {
+            spfTreeVertices.push_back(candidate.vertex);
+        }
+
+        if (candidate.isRouter) {
+            OSPF::RouterLSA* routerVertex = check_and_cast<OSPF::RouterLSA*> (candidate.vertex);
             unsigned int linkCount = routerVertex->getLinksArraySize();
-            for (i = 0; i < linkCount; i++) {
+
+            for (unsigned int i = 0; i < linkCount; i++) {
                 Link& link = routerVertex->getLinks(i);
                 LinkType linkType = static_cast<LinkType> (link.getType());
                 OSPFLSA* joiningVertex;
-                LSAType joiningVertexType;
 
                 if (linkType == STUB_LINK) {     // (2) (a)
                     continue;
@@ -1405,244 +1791,265 @@ void OSPF::Area::calculateShortestPathTree(std::vector<OSPF::RoutingTableEntry*>
 
                 if (linkType == TRANSIT_LINK) {
                     joiningVertex = findNetworkLSA(link.getLinkID());
-                    joiningVertexType = NETWORKLSA_TYPE;
                 } else {
                     joiningVertex = findRouterLSA(link.getLinkID());
-                    joiningVertexType = ROUTERLSA_TYPE;
                 }
 
                 if ((joiningVertex == NULL) ||
                     (joiningVertex->getHeader().getLsAge() == MAX_AGE) ||
-                    (!hasLink(joiningVertex, justAddedVertex)))  // (from, to)     (2) (b)
+                    (!hasLink(joiningVertex, routerVertex)))  // (from, to)     (2) (b)
                 {
                     continue;
                 }
 
-                unsigned int treeSize = treeVertices.size();
-                bool alreadyOnTree = false;
+                relaxEdge(routerVertex, joiningVertex, routerVertex->getDistance() + link.getLinkCost(), candidates, incremental);
+            }
+        } else {
+            OSPF::NetworkLSA* networkVertex = check_and_cast<OSPF::NetworkLSA*> (candidate.vertex);
+            unsigned int routerCount = networkVertex->getAttachedRoutersArraySize();
 
-                for (j = 0; j < treeSize; j++) {
-                    if (treeVertices[j] == joiningVertex) {
-                        alreadyOnTree = true;
-                        break;
-                    }
-                }
-                if (alreadyOnTree) {    // (2) (c)
+            for (unsigned int i = 0; i < routerCount; i++) {     // (2)
+                OSPF::RouterLSA* joiningVertex = findRouterLSA(networkVertex->getAttachedRouters(i));
+                if ((joiningVertex == NULL) ||
+                    (joiningVertex->getHeader().getLsAge() == MAX_AGE) ||
+                    (!hasLink(joiningVertex, networkVertex)))  // (from, to)     (2) (b)
+                {
                     continue;
                 }
 
-                unsigned long linkStateCost = routerVertex->getDistance() + link.getLinkCost();
-                unsigned int candidateCount = candidateVertices.size();
-                OSPFLSA* candidate = NULL;
+                relaxEdge(networkVertex, joiningVertex, networkVertex->getDistance(), candidates, incremental);   // link cost from network to router is always 0
+            }
+        }
+    }
+}
 
-                for (j = 0; j < candidateCount; j++) {
-                    if (candidateVertices[j] == joiningVertex) {
-                        candidate = candidateVertices[j];
-                    }
-                }
-                if (candidate != NULL) {    // (2) (d)
-                    OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (candidate);
-                    unsigned long candidateDistance = routingInfo->getDistance();
+void OSPF::Area::relaxEdge(OSPFLSA* fromVertex, OSPFLSA* toVertex, unsigned long distance, SPFCandidateHeap& candidates, bool incremental)
+{
+    OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (toVertex);
+    OSPF::RoutingInfo::SPFState state = routingInfo->getSPFState();
 
-                    if (linkStateCost > candidateDistance) {
-                        continue;
-                    }
-                    if (linkStateCost < candidateDistance) {
-                        routingInfo->setDistance(linkStateCost);
-                        routingInfo->clearNextHops();
-                    }
-                    std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(joiningVertex, justAddedVertex); // (destination, parent)
-                    unsigned int nextHopCount = newNextHops->size();
-                    for (k = 0; k < nextHopCount; k++) {
-                        routingInfo->addNextHop((*newNextHops)[k]);
-                    }
-                    delete newNextHops;
-                } else {
-                    if (joiningVertexType == ROUTERLSA_TYPE) {
-                        OSPF::RouterLSA* joiningRouterVertex = check_and_cast<OSPF::RouterLSA*> (joiningVertex);
-                        joiningRouterVertex->setDistance(linkStateCost);
-                        std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(joiningVertex, justAddedVertex); // (destination, parent)
-                        unsigned int nextHopCount = newNextHops->size();
-                        for (k = 0; k < nextHopCount; k++) {
-                            joiningRouterVertex->addNextHop((*newNextHops)[k]);
-                        }
-                        delete newNextHops;
-                        OSPF::RoutingInfo* vertexRoutingInfo = check_and_cast<OSPF::RoutingInfo*> (joiningRouterVertex);
-                        vertexRoutingInfo->setParent(justAddedVertex);
+    // in an incremental calculation, vertices left on the tree may still get a
+    // shorter path or new equal cost paths through the changed part of the tree
+    if ((state == OSPF::RoutingInfo::SPF_ON_TREE) && !incremental) {    // (2) (c)
+        return;
+    }
+    if ((state != OSPF::RoutingInfo::SPF_UNREACHED) && (distance > routingInfo->getDistance())) {    // (2) (d)
+        return;
+    }
 
-                        candidateVertices.push_back(joiningRouterVertex);
-                    } else {
-                        OSPF::NetworkLSA* joiningNetworkVertex = check_and_cast<OSPF::NetworkLSA*> (joiningVertex);
-                        joiningNetworkVertex->setDistance(linkStateCost);
-                        std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(joiningVertex, justAddedVertex); // (destination, parent)
-                        unsigned int nextHopCount = newNextHops->size();
-                        for (k = 0; k < nextHopCount; k++) {
-                            joiningNetworkVertex->addNextHop((*newNextHops)[k]);
-                        }
-                        delete newNextHops;
-                        OSPF::RoutingInfo* vertexRoutingInfo = check_and_cast<OSPF::RoutingInfo*> (joiningNetworkVertex);
-                        vertexRoutingInfo->setParent(justAddedVertex);
+    std::vector<OSPFLSA*>& parents = routingInfo->getSPFParents();
+    bool shorter = (state == OSPF::RoutingInfo::SPF_UNREACHED) || (distance < routingInfo->getDistance());
+    bool changed = shorter;
 
-                        candidateVertices.push_back(joiningNetworkVertex);
-                    }
-                }
-            }
+    // as before the heap: the parent is the vertex that reached the candidate first
+    if (state == OSPF::RoutingInfo::SPF_UNREACHED) {
+        routingInfo->setSPFCandidateOrder(spfSequenceNumber++);
+        routingInfo->setParent(fromVertex);
+    }
+    if (shorter) {
+        routingInfo->setDistance(distance);
+        routingInfo->clearNextHops();
+        parents.clear();
+    }
+    if (std::find(parents.begin(), parents.end(), fromVertex) == parents.end()) {
+        parents.push_back(fromVertex);
+        changed = true;
+    }
+
+    // the full calculation keeps the next hops as they come, duplicates included; the
+    // incremental one needs to know whether a vertex left on the tree got new ones
+    std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(toVertex, fromVertex); // (destination, parent)
+    if (incremental) {
+        changed = addNewNextHops(routingInfo, *newNextHops) || changed;
+    } else {
+        for (unsigned int i = 0; i < newNextHops->size(); i++) {
+            routingInfo->addNextHop((*newNextHops)[i]);
         }
+    }
+    delete newNextHops;
 
-        if ((vertexType == NETWORKLSA_TYPE)) {
-            OSPF::NetworkLSA* networkVertex = check_and_cast<OSPF::NetworkLSA*> (justAddedVertex);
-            unsigned int routerCount = networkVertex->getAttachedRoutersArraySize();
+    if (shorter || ((state == OSPF::RoutingInfo::SPF_ON_TREE) && changed)) {
+        pushCandidate(toVertex, routingInfo, candidates);
+    }
+}
 
-            for (i = 0; i < routerCount; i++) {     // (2)
-                OSPF::RouterLSA* joiningVertex = findRouterLSA(networkVertex->getAttachedRouters(i));
-                if ((joiningVertex == NULL) ||
-                    (joiningVertex->getHeader().getLsAge() == MAX_AGE) ||
-                    (!hasLink(joiningVertex, justAddedVertex)))  // (from, to)     (2) (b)
-                {
-                    continue;
-                }
+void OSPF::Area::getAdjacentVertices(OSPFLSA* vertex, std::vector<OSPFLSA*>& adjacentVertices)
+{
+    adjacentVertices.clear();
 
-                unsigned int treeSize = treeVertices.size();
-                bool alreadyOnTree = false;
+    if (vertex->getHeader().getLsType() == ROUTERLSA_TYPE) {
+        OSPF::RouterLSA* routerVertex = check_and_cast<OSPF::RouterLSA*> (vertex);
+        unsigned int linkCount = routerVertex->getLinksArraySize();
 
-                for (j = 0; j < treeSize; j++) {
-                    if (treeVertices[j] == joiningVertex) {
-                        alreadyOnTree = true;
-                        break;
-                    }
-                }
-                if (alreadyOnTree) {    // (2) (c)
-                    continue;
-                }
+        for (unsigned int i = 0; i < linkCount; i++) {
+            Link& link = routerVertex->getLinks(i);
+            OSPFLSA* adjacentVertex = NULL;
 
-                unsigned long linkStateCost = networkVertex->getDistance();   // link cost from network to router is always 0
-                unsigned int candidateCount = candidateVertices.size();
-                OSPFLSA* candidate = NULL;
+            if (link.getType() == TRANSIT_LINK) {
+                adjacentVertex = findNetworkLSA(link.getLinkID());
+            } else if (link.getType() != STUB_LINK) {
+                adjacentVertex = findRouterLSA(link.getLinkID());
+            }
+            if (adjacentVertex != NULL) {
+                adjacentVertices.push_back(adjacentVertex);
+            }
+        }
+    } else {
+        OSPF::NetworkLSA* networkVertex = check_and_cast<OSPF::NetworkLSA*> (vertex);
+        unsigned int routerCount = networkVertex->getAttachedRoutersArraySize();
 
-                for (j = 0; j < candidateCount; j++) {
-                    if (candidateVertices[j] == joiningVertex) {
-                        candidate = candidateVertices[j];
-                    }
-                }
-                if (candidate != NULL) {    // (2) (d)
-                    OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (candidate);
-                    unsigned long candidateDistance = routingInfo->getDistance();
+        for (unsigned int i = 0; i < routerCount; i++) {
+            OSPF::RouterLSA* adjacentVertex = findRouterLSA(networkVertex->getAttachedRouters(i));
+            if (adjacentVertex != NULL) {
+                adjacentVertices.push_back(adjacentVertex);
+            }
+        }
+    }
+}
 
-                    if (linkStateCost > candidateDistance) {
-                        continue;
-                    }
-                    if (linkStateCost < candidateDistance) {
-                        routingInfo->setDistance(linkStateCost);
-                        routingInfo->clearNextHops();
-                    }
-                    std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(joiningVertex, justAddedVertex); // (destination, parent)
-                    unsigned int nextHopCount = newNextHops->size();
-                    for (k = 0; k < nextHopCount; k++) {
-                        routingInfo->addNextHop((*newNextHops)[k]);
-                    }
-                    delete newNextHops;
-                } else {
-                    joiningVertex->setDistance(linkStateCost);
-                    std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(joiningVertex, justAddedVertex); // (destination, parent)
-                    unsigned int nextHopCount = newNextHops->size();
-                    for (k = 0; k < nextHopCount; k++) {
-                        joiningVertex->addNextHop((*newNextHops)[k]);
-                    }
-                    delete newNextHops;
-                    OSPF::RoutingInfo* vertexRoutingInfo = check_and_cast<OSPF::RoutingInfo*> (joiningVertex);
-                    vertexRoutingInfo->setParent(justAddedVertex);
+void OSPF::Area::getSPFInputs(OSPFLSA* vertex, std::vector<uint32>& inputs) const
+{
+    inputs.clear();
+    inputs.push_back(vertex->getHeader().getLsAge() == MAX_AGE);
 
-                    candidateVertices.push_back(joiningVertex);
-                }
-            }
+    if (vertex->getHeader().getLsType() == ROUTERLSA_TYPE) {
+        OSPF::RouterLSA* routerVertex = check_and_cast<OSPF::RouterLSA*> (vertex);
+        unsigned int linkCount = routerVertex->getLinksArraySize();
+
+        inputs.push_back(linkCount);
+        for (unsigned int i = 0; i < linkCount; i++) {
+            Link& link = routerVertex->getLinks(i);
+            inputs.push_back(link.getType());
+            inputs.push_back(link.getLinkID().getInt());
+            inputs.push_back(link.getLinkData());
+            inputs.push_back(link.getLinkCost());
         }
+    } else {
+        OSPF::NetworkLSA* networkVertex = check_and_cast<OSPF::NetworkLSA*> (vertex);
+        unsigned int routerCount = networkVertex->getAttachedRoutersArraySize();
 
-        if (candidateVertices.empty()) {  // (3)
-            finished = true;
-        } else {
-            unsigned int candidateCount = candidateVertices.size();
-            unsigned long minDistance = LS_INFINITY;
-            OSPFLSA* closestVertex = candidateVertices[0];
+        inputs.push_back(networkVertex->getNetworkMask().getInt());
+        inputs.push_back(routerCount);
+        for (unsigned int i = 0; i < routerCount; i++) {
+            inputs.push_back(networkVertex->getAttachedRouters(i).getInt());
+        }
+    }
+}
+
+void OSPF::Area::getSPFInterfaceInputs(std::vector<uint32>& inputs) const
+{
+    // everything calculateNextHops() looks at besides the LSAs
+    unsigned int interfaceCount = associatedInterfaces.size();
+
+    inputs.clear();
+    inputs.push_back(interfaceCount);
+    for (unsigned int i = 0; i < interfaceCount; i++) {
+        const OSPF::Interface* intf = associatedInterfaces[i];
+        unsigned int neighborCount = intf->getNeighborCount();
+
+        inputs.push_back(intf->getType());
+        inputs.push_back(intf->getState());
+        inputs.push_back(intf->getIfIndex());
+        inputs.push_back(intf->getAddressRange().address.getInt());
+        inputs.push_back(intf->getAddressRange().mask.getInt());
+        inputs.push_back(intf->getDesignatedRouter().ipInterfaceAddress.getInt());
+        inputs.push_back(neighborCount);
+        for (unsigned int j = 0; j < neighborCount; j++) {
+            const OSPF::Neighbor* neighbor = intf->getNeighbor(j);
+            inputs.push_back(neighbor->getNeighborID().getInt());
+            inputs.push_back(neighbor->getAddress().getInt());
+        }
+    }
+}
 
-            for (i = 0; i < candidateCount; i++) {
-                OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (candidateVertices[i]);
-                unsigned long currentDistance = routingInfo->getDistance();
+void OSPF::Area::addShortestPathTreeRoutes(std::vector<OSPF::RoutingTableEntry*>& newRoutingTable)
+{
+    RoutingTableNetworkIndex networkEntries(newRoutingTable);
+    unsigned int treeSize = spfTreeVertices.size();
+    unsigned long i, j, k;
 
-                if (currentDistance < minDistance) {
-                    closestVertex = candidateVertices[i];
-                    minDistance = currentDistance;
-                } else {
-                    if (currentDistance == minDistance) {
-                        if ((closestVertex->getHeader().getLsType() == ROUTERLSA_TYPE) &&
-                            (candidateVertices[i]->getHeader().getLsType() == NETWORKLSA_TYPE))
-                        {
-                            closestVertex = candidateVertices[i];
-                        }
-                    }
-                }
+    for (unsigned int vertexIndex = 0; vertexIndex < treeSize; vertexIndex++) {
+        OSPFLSA* closestVertex = spfTreeVertices[vertexIndex];
+
+        if (closestVertex->getHeader().getLsType() == ROUTERLSA_TYPE) {
+            OSPF::RouterLSA* routerVertex = check_and_cast<OSPF::RouterLSA*> (closestVertex);
+            if (routerVertex->getV_VirtualLinkEndpoint()) {    // (2)
+                transitCapability = true;
             }
+        }
+        if (vertexIndex == 0) {     // the root
+            continue;
+        }
 
-            treeVertices.push_back(closestVertex);
+        OSPFLSA* justAddedVertex = spfTreeVertices[vertexIndex - 1];
 
-            for (std::vector<OSPFLSA*>::iterator it = candidateVertices.begin(); it != candidateVertices.end(); it++) {
-                if ((*it) == closestVertex) {
-                    candidateVertices.erase(it);
-                    break;
-                }
-            }
+        if (closestVertex->getHeader().getLsType() == ROUTERLSA_TYPE) {
+            OSPF::RouterLSA* routerLSA = check_and_cast<OSPF::RouterLSA*> (closestVertex);
+            if (routerLSA->getB_AreaBorderRouter() || routerLSA->getE_ASBoundaryRouter()) {
+                OSPF::RoutingTableEntry* entry = new OSPF::RoutingTableEntry;
+                OSPF::RouterID destinationID = routerLSA->getHeader().getLinkStateID();
+                unsigned int nextHopCount = routerLSA->getNextHopCount();
+                OSPF::RoutingTableEntry::RoutingDestinationType destinationType = OSPF::RoutingTableEntry::NETWORK_DESTINATION;
 
-            if (closestVertex->getHeader().getLsType() == ROUTERLSA_TYPE) {
-                OSPF::RouterLSA* routerLSA = check_and_cast<OSPF::RouterLSA*> (closestVertex);
-                if (routerLSA->getB_AreaBorderRouter() || routerLSA->getE_ASBoundaryRouter()) {
-                    OSPF::RoutingTableEntry* entry = new OSPF::RoutingTableEntry;
-                    OSPF::RouterID destinationID = routerLSA->getHeader().getLinkStateID();
-                    unsigned int nextHopCount = routerLSA->getNextHopCount();
-                    OSPF::RoutingTableEntry::RoutingDestinationType destinationType = OSPF::RoutingTableEntry::NETWORK_DESTINATION;
-
-                    entry->setDestination(destinationID);
-                    entry->setLinkStateOrigin(routerLSA);
-                    entry->setArea(areaID);
-                    entry->setPathType(OSPF::RoutingTableEntry::INTRAAREA);
-                    entry->setCost(routerLSA->getDistance());
-                    if (routerLSA->getB_AreaBorderRouter()) {
-                        destinationType |= OSPF::RoutingTableEntry::AREA_BORDER_ROUTER_DESTINATION;
-                    }
-                    if (routerLSA->getE_ASBoundaryRouter()) {
-                        destinationType |= OSPF::RoutingTableEntry::AS_BOUNDARY_ROUTER_DESTINATION;
-                    }
-                    entry->setDestinationType(destinationType);
-                    entry->setOptionalCapabilities(routerLSA->getHeader().getLsOptions());
-                    for (i = 0; i < nextHopCount; i++) {
-                        entry->addNextHop(routerLSA->getNextHop(i));
-                    }
+                entry->setDestination(destinationID);
+                entry->setLinkStateOrigin(routerLSA);
+                entry->setArea(areaID);
+                entry->setPathType(OSPF::RoutingTableEntry::INTRAAREA);
+                entry->setCost(routerLSA->getDistance());
+                if (routerLSA->getB_AreaBorderRouter()) {
+                    destinationType |= OSPF::RoutingTableEntry::AREA_BORDER_ROUTER_DESTINATION;
+                }
+                if (routerLSA->getE_ASBoundaryRouter()) {
+                    destinationType |= OSPF::RoutingTableEntry::AS_BOUNDARY_ROUTER_DESTINATION;
+                }
+                entry->setDestinationType(destinationType);
+                entry->setOptionalCapabilities(routerLSA->getHeader().getLsOptions());
+                for (i = 0; i < nextHopCount; i++) {
+                    entry->addNextHop(routerLSA->getNextHop(i));
+                }
 
-                    newRoutingTable.push_back(entry);
+                newRoutingTable.push_back(entry);
 
-                    OSPF::Area* backbone;
-                    if (areaID != OSPF::BACKBONE_AREAID) {
-                        backbone = parentRouter->getAreaByID(OSPF::BACKBONE_AREAID);
-                    } else {
-                        backbone = this;
-                    }
-                    if (backbone != NULL) {
-                        OSPF::Interface* virtualIntf = backbone->findVirtualLink(destinationID);
-                        if ((virtualIntf != NULL) && (virtualIntf->getTransitAreaID() == areaID)) {
-                            OSPF::IPv4AddressRange range;
-                            range.address = getInterface(routerLSA->getNextHop(0).ifIndex)->getAddressRange().address;
-                            range.mask = IPv4Address::ALLONES_ADDRESS;
-                            virtualIntf->setAddressRange(range);
-                            virtualIntf->setIfIndex(routerLSA->getNextHop(0).ifIndex);
-                            virtualIntf->setOutputCost(routerLSA->getDistance());
-                            OSPF::Neighbor* virtualNeighbor = virtualIntf->getNeighbor(0);
-                            if (virtualNeighbor != NULL) {
-                                unsigned int linkCount = routerLSA->getLinksArraySize();
-                                OSPF::RouterLSA* toRouterLSA = dynamic_cast<OSPF::RouterLSA*> (justAddedVertex);
-                                if (toRouterLSA != NULL) {
+                OSPF::Area* backbone;
+                if (areaID != OSPF::BACKBONE_AREAID) {
+                    backbone = parentRouter->getAreaByID(OSPF::BACKBONE_AREAID);
+                } else {
+                    backbone = this;
+                }
+                if (backbone != NULL) {
+                    OSPF::Interface* virtualIntf = backbone->findVirtualLink(destinationID);
+                    if ((virtualIntf != NULL) && (virtualIntf->getTransitAreaID() == areaID)) {
+                        OSPF::IPv4AddressRange range;
+                        range.address = getInterface(routerLSA->getNextHop(0).ifIndex)->getAddressRange().address;
+                        range.mask = IPv4Address::ALLONES_ADDRESS;
+                        virtualIntf->setAddressRange(range);
+                        virtualIntf->setIfIndex(routerLSA->getNextHop(0).ifIndex);
+                        virtualIntf->setOutputCost(routerLSA->getDistance());
+                        OSPF::Neighbor* virtualNeighbor = virtualIntf->getNeighbor(0);
+                        if (virtualNeighbor != NULL) {
+                            unsigned int linkCount = routerLSA->getLinksArraySize();
+                            OSPF::RouterLSA* toRouterLSA = dynamic_cast<OSPF::RouterLSA*> (justAddedVertex);
+                            if (toRouterLSA != NULL) {
+                                for (i = 0; i < linkCount; i++) {
+                                    Link& link = routerLSA->getLinks(i);
+
+                                    if ((link.getType() == POINTTOPOINT_LINK) &&
+                                        (link.getLinkID() == toRouterLSA->getHeader().getLinkStateID()) &&
+                                        (virtualIntf->getState() < OSPF::Interface::WAITING_STATE))
+                                    {
+                                        virtualNeighbor->setAddress(IPv4Address(link.getLinkData()));
+                                        virtualIntf->processEvent(OSPF::Interface::INTERFACE_UP);
+                                        break;
+                                    }
+                                }
+                            } else {
+                                OSPF::NetworkLSA* toNetworkLSA = dynamic_cast<OSPF::NetworkLSA*> (justAddedVertex);
+                                if (toNetworkLSA != NULL) {
                                     for (i = 0; i < linkCount; i++) {
                                         Link& link = routerLSA->getLinks(i);
 
-                                        if ((link.getType() == POINTTOPOINT_LINK) &&
-                                            (link.getLinkID() == toRouterLSA->getHeader().getLinkStateID()) &&
+                                        if ((link.getType() == TRANSIT_LINK) &&
+                                            (link.getLinkID() == toNetworkLSA->getHeader().getLinkStateID()) &&
                                             (virtualIntf->getState() < OSPF::Interface::WAITING_STATE))
                                         {
                                             virtualNeighbor->setAddress(IPv4Address(link.getLinkData()));
@@ -1650,91 +2057,65 @@ void OSPF::Area::calculateShortestPathTree(std::vector<OSPF::RoutingTableEntry*>
                                             break;
                                         }
                                     }
-                                } else {
-                                    OSPF::NetworkLSA* toNetworkLSA = dynamic_cast<OSPF::NetworkLSA*> (justAddedVertex);
-                                    if (toNetworkLSA != NULL) {
-                                        for (i = 0; i < linkCount; i++) {
-                                            Link& link = routerLSA->getLinks(i);
-
-                                            if ((link.getType() == TRANSIT_LINK) &&
-                                                (link.getLinkID() == toNetworkLSA->getHeader().getLinkStateID()) &&
-                                                (virtualIntf->getState() < OSPF::Interface::WAITING_STATE))
-                                            {
-                                                virtualNeighbor->setAddress(IPv4Address(link.getLinkData()));
-                                                virtualIntf->processEvent(OSPF::Interface::INTERFACE_UP);
-                                                break;
-                                            }
-                                        }
-                                    }
                                 }
                             }
                         }
                     }
                 }
             }
+        }
 
-            if (closestVertex->getHeader().getLsType() == NETWORKLSA_TYPE) {
-                OSPF::NetworkLSA* networkLSA = check_and_cast<OSPF::NetworkLSA*> (closestVertex);
-                IPv4Address destinationID = (networkLSA->getHeader().getLinkStateID() & networkLSA->getNetworkMask());
-                unsigned int nextHopCount = networkLSA->getNextHopCount();
-                bool overWrite = false;
-                OSPF::RoutingTableEntry* entry = NULL;
-                unsigned long routeCount = newRoutingTable.size();
-                IPv4Address longestMatch(0u);
-
-                for (i = 0; i < routeCount; i++) {
-                    if (newRoutingTable[i]->getDestinationType() == OSPF::RoutingTableEntry::NETWORK_DESTINATION) {
-                        OSPF::RoutingTableEntry* routingEntry = newRoutingTable[i];
-                        IPv4Address entryAddress = routingEntry->getDestination();
-                        IPv4Address entryMask = routingEntry->getNetmask();
-
-                        if ((entryAddress & entryMask) == (destinationID & entryMask)) {
-                            if ((destinationID & entryMask) > longestMatch) {
-                                longestMatch = (destinationID & entryMask);
-                                entry = routingEntry;
-                            }
-                        }
-                    }
-                }
-                if (entry != NULL) {
-                    const OSPFLSA* entryOrigin = entry->getLinkStateOrigin();
-                    if ((entry->getCost() != networkLSA->getDistance()) ||
-                        (entryOrigin->getHeader().getLinkStateID() >= networkLSA->getHeader().getLinkStateID()))
-                    {
-                        overWrite = true;
-                    }
+        if (closestVertex->getHeader().getLsType() == NETWORKLSA_TYPE) {
+            OSPF::NetworkLSA* networkLSA = check_and_cast<OSPF::NetworkLSA*> (closestVertex);
+            IPv4Address destinationID = (networkLSA->getHeader().getLinkStateID() & networkLSA->getNetworkMask());
+            unsigned int nextHopCount = networkLSA->getNextHopCount();
+            bool overWrite = false;
+            OSPF::RoutingTableEntry* entry = NULL;
+            long entryIndex = networkEntries.findLongestMatch(destinationID.getInt());
+
+            if (entryIndex >= 0) {
+                entry = newRoutingTable[entryIndex];
+            }
+            if (entry != NULL) {
+                const OSPFLSA* entryOrigin = entry->getLinkStateOrigin();
+                if ((entry->getCost() != networkLSA->getDistance()) ||
+                    (entryOrigin->getHeader().getLinkStateID() >= networkLSA->getHeader().getLinkStateID()))
+                {
+                    overWrite = true;
                 }
+            }
 
-                if ((entry == NULL) || (overWrite)) {
-                    if (entry == NULL) {
-                        entry = new OSPF::RoutingTableEntry;
-                    }
+            if ((entry == NULL) || (overWrite)) {
+                if (entry == NULL) {
+                    entry = new OSPF::RoutingTableEntry;
+                } else {
+                    networkEntries.remove(entryIndex);
+                }
 
-                    entry->setDestination(IPv4Address(destinationID));
-                    entry->setNetmask(networkLSA->getNetworkMask());
-                    entry->setLinkStateOrigin(networkLSA);
-                    entry->setArea(areaID);
-                    entry->setPathType(OSPF::RoutingTableEntry::INTRAAREA);
-                    entry->setCost(networkLSA->getDistance());
-                    entry->setDestinationType(OSPF::RoutingTableEntry::NETWORK_DESTINATION);
-                    entry->setOptionalCapabilities(networkLSA->getHeader().getLsOptions());
-                    for (i = 0; i < nextHopCount; i++) {
-                        entry->addNextHop(networkLSA->getNextHop(i));
-                    }
+                entry->setDestination(IPv4Address(destinationID));
+                entry->setNetmask(networkLSA->getNetworkMask());
+                entry->setLinkStateOrigin(networkLSA);
+                entry->setArea(areaID);
+                entry->setPathType(OSPF::RoutingTableEntry::INTRAAREA);
+                entry->setCost(networkLSA->getDistance());
+                entry->setDestinationType(OSPF::RoutingTableEntry::NETWORK_DESTINATION);
+                entry->setOptionalCapabilities(networkLSA->getHeader().getLsOptions());
+                for (i = 0; i < nextHopCount; i++) {
+                    entry->addNextHop(networkLSA->getNextHop(i));
+                }
 
-                    if (!overWrite) {
-                        newRoutingTable.push_back(entry);
-                    }
+                if (!overWrite) {
+                    newRoutingTable.push_back(entry);
+                    networkEntries.add(newRoutingTable.size() - 1);
+                } else {
+                    networkEntries.add(entryIndex);
                 }
             }
-
-            justAddedVertex = closestVertex;
         }
-    } while (!finished);
+    }
 
-    unsigned int treeSize = treeVertices.size();
     for (i = 0; i < treeSize; i++) {
-        OSPF::RouterLSA* routerVertex = dynamic_cast<OSPF::RouterLSA*> (treeVertices[i]);
+        OSPF::RouterLSA* routerVertex = dynamic_cast<OSPF::RouterLSA*> (spfTreeVertices[i]);
         if (routerVertex == NULL) {
             continue;
         }
@@ -1749,22 +2130,10 @@ void OSPF::Area::calculateShortestPathTree(std::vector<OSPF::RoutingTableEntry*>
             unsigned long distance = routerVertex->getDistance() + link.getLinkCost();
             unsigned long destinationID = (link.getLinkID().getInt() & link.getLinkData());
             OSPF::RoutingTableEntry* entry = NULL;
-            unsigned long routeCount = newRoutingTable.size();
-            unsigned long longestMatch = 0;
-
-            for (k = 0; k < routeCount; k++) {
-                if (newRoutingTable[k]->getDestinationType() == OSPF::RoutingTableEntry::NETWORK_DESTINATION) {
-                    OSPF::RoutingTableEntry* routingEntry = newRoutingTable[k];
-                    unsigned long entryAddress = routingEntry->getDestination().getInt();
-                    unsigned long entryMask = routingEntry->getNetmask().getInt();
-
-                    if ((entryAddress & entryMask) == (destinationID & entryMask)) {
-                        if ((destinationID & entryMask) > longestMatch) {
-                            longestMatch = (destinationID & entryMask);
-                            entry = routingEntry;
-                        }
-                    }
-                }
+            long entryIndex = networkEntries.findLongestMatch(destinationID);
+
+            if (entryIndex >= 0) {
+                entry = newRoutingTable[entryIndex];
             }
 
             if (entry != NULL) {
@@ -1822,6 +2191,7 @@ void OSPF::Area::calculateShortestPathTree(std::vector<OSPF::RoutingTableEntry*>
                 delete newNextHops;
 
                 newRoutingTable.push_back(entry);
+                networkEntries.add(newRoutingTable.size() - 1);
             }
         }
     }
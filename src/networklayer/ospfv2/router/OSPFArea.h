@@ -48,8 +48,21 @@ private:
     bool                                                    externalRoutingCapability;
     Metric                                                  stubDefaultCost;
     RouterLSA*                                              spfTreeRoot;
+    std::vector<OSPFLSA*>                                   spfTreeVertices;        // in the order they were added to the tree
+    std::vector<uint32>                                     spfInterfaceInputs;     // interface and neighbor data the last calculation used
+    unsigned long                                           spfSequenceNumber;
 
     Router*                                                 parentRouter;
+
+    struct SPFCandidate {
+        unsigned long   distance;
+        bool            isRouter;
+        unsigned long   order;
+        OSPFLSA*        vertex;
+        RoutingInfo*    routingInfo;
+    };
+    typedef std::vector<SPFCandidate> SPFCandidateHeap;
+
 public:
             Area(AreaID id = BACKBONE_AREAID);
     virtual ~Area();
@@ -126,6 +139,19 @@ private:
     std::vector<NextHop>* calculateNextHops(OSPFLSA* destination, OSPFLSA* parent) const;
     std::vector<NextHop>* calculateNextHops(Link& destination, OSPFLSA* parent) const;
 
+    static bool           spfCandidateLess(const SPFCandidate& a, const SPFCandidate& b);
+    static bool           spfCandidateGreater(const SPFCandidate& a, const SPFCandidate& b);
+    void                  buildShortestPathTree();
+    bool                  updateShortestPathTree();
+    void                  verifyShortestPathTree();
+    void                  runDijkstra(SPFCandidateHeap& candidates, bool incremental);
+    void                  relaxEdge(OSPFLSA* fromVertex, OSPFLSA* toVertex, unsigned long distance, SPFCandidateHeap& candidates, bool incremental);
+    void                  pushCandidate(OSPFLSA* vertex, RoutingInfo* routingInfo, SPFCandidateHeap& candidates);
+    void                  getAdjacentVertices(OSPFLSA* vertex, std::vector<OSPFLSA*>& adjacentVertices);
+    void                  getSPFInputs(OSPFLSA* vertex, std::vector<uint32>& inputs) const;
+    void                  getSPFInterfaceInputs(std::vector<uint32>& inputs) const;
+    void                  addShortestPathTreeRoutes(std::vector<RoutingTableEntry*>& newRoutingTable);
+
     LinkStateID           getUniqueLinkStateID(IPv4AddressRange destination,
                                                Metric destinationCost,
                                                SummaryLSA*& lsaToReoriginate) const;
@@ -16,15 +16,39 @@
 //
 
 
+#ifdef _MSC_VER
+#include <time.h>
+#else
+#include <sys/time.h>
+#endif
+
 #include "OSPFRouter.h"
 
 #include "RoutingTableAccess.h"
 
 
+simsignal_t OSPF::Router::spfRunTimeSignal = SIMSIGNAL_NULL;
+
+// wall clock time in seconds, with microsecond resolution where available
+static double getWallClockTime()
+{
+#ifdef _MSC_VER
+    return (double)clock() / CLOCKS_PER_SEC;
+#else
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec / 1e6;
+#endif
+}
+
 OSPF::Router::Router(OSPF::RouterID id, cSimpleModule* containingModule) :
     routerID(id),
-    rfc1583Compatibility(false)
+    rfc1583Compatibility(false),
+    incrementalSPF(false),
+    verifyIncrementalSPF(false),
+    ospfModule(containingModule)
 {
+    spfRunTimeSignal = cComponent::registerSignal("spfRunTime");
     messageHandler = new OSPF::MessageHandler(this, containingModule);
     ageTimer = new OSPFTimer();
     ageTimer->setTimerKind(DATABASE_AGE_TIMER);
@@ -709,6 +733,7 @@ void OSPF::Router::rebuildRoutingTable()
     bool hasTransitAreas = false;
     std::vector<OSPF::RoutingTableEntry*> newTable;
     unsigned long i;
+    double startTime = getWallClockTime();
 
     EV << "Rebuilding routing table:\n";
 
@@ -778,6 +803,8 @@ void OSPF::Router::rebuildRoutingTable()
         delete (oldTable[i]);
     }
 
+    ospfModule->emit(spfRunTimeSignal, getWallClockTime() - startTime);
+
     EV << "Routing table was rebuilt.\n"
        << "Results:\n";
 
@@ -50,6 +50,11 @@ private:
     std::vector<RoutingTableEntry*>                                    routingTable;            ///< The OSPF routing table - contains more information than the one in the IP layer.
     MessageHandler*                                                    messageHandler;          ///< The message dispatcher class.
     bool                                                               rfc1583Compatibility;    ///< Decides whether to handle the preferred routing table entry to an AS boundary router as defined in RFC1583 or not.
+    bool                                                               incrementalSPF;          ///< Decides whether the shortest path trees are updated incrementally when only some LSAs changed.
+    bool                                                               verifyIncrementalSPF;    ///< Decides whether each incremental update is checked against a full calculation.
+    cSimpleModule*                                                     ospfModule;              ///< The module the spfRunTime signal (wall clock time of rebuildRoutingTable()) is emitted from.
+
+    static simsignal_t                                                 spfRunTimeSignal;
 
 public:
     /**
@@ -68,6 +73,10 @@ public:
     RouterID                 getRouterID() const  { return routerID; }
     void                     setRFC1583Compatibility(bool compatibility)  { rfc1583Compatibility = compatibility; }
     bool                     getRFC1583Compatibility() const  { return rfc1583Compatibility; }
+    void                     setIncrementalSPF(bool incremental)  { incrementalSPF = incremental; }
+    bool                     getIncrementalSPF() const  { return incrementalSPF; }
+    void                     setVerifyIncrementalSPF(bool verify)  { verifyIncrementalSPF = verify; }
+    bool                     getVerifyIncrementalSPF() const  { return verifyIncrementalSPF; }
     unsigned long            getAreaCount() const  { return areas.size(); }
 
     MessageHandler*          getMessageHandler()  { return messageHandler; }
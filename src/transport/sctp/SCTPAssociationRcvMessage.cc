@@ -741,12 +741,11 @@ SCTPEventCode SCTPAssociation::processSackArrived(SCTPSackChunk* sackChunk)
     sackGapList.setInitialCumAckTSN(sackChunk->getCumTsnAck());
     uint32 lastTSN = sackChunk->getCumTsnAck();
     for (uint32 i = 0; i < sackChunk->getNumGaps(); i++) {
-        uint32 tsn = sackChunk->getGapStart(i);
-        assert(tsnLt(lastTSN + 1, tsn)); lastTSN = tsn;
-        while (tsnLe(tsn, sackChunk->getGapStop(i))) {
+        const uint32 tsn = sackChunk->getGapStart(i);
+        assert(tsnLt(lastTSN + 1, tsn));
+        if (tsnLe(tsn, sackChunk->getGapStop(i))) {
             bool dummy;
-            sackGapList.updateGapList(tsn, dummy, true);    // revokable TSN
-            tsn++;
+            sackGapList.addGapBlock(tsn, sackChunk->getGapStop(i), dummy, true);    // revokable TSNs
         }
         lastTSN = sackChunk->getGapStop(i);
     }
@@ -756,12 +755,11 @@ SCTPEventCode SCTPAssociation::processSackArrived(SCTPSackChunk* sackChunk)
     if (sackChunk->getNrSubtractRGaps() == false) {
         lastTSN = sackChunk->getCumTsnAck();
         for (uint32 i = 0; i < sackChunk->getNumNrGaps(); i++) {
-            uint32 tsn = sackChunk->getNrGapStart(i);
-            assert(tsnLt(lastTSN + 1, tsn)); lastTSN = tsn;
-            while (tsnLe(tsn, sackChunk->getNrGapStop(i))) {
+            const uint32 tsn = sackChunk->getNrGapStart(i);
+            assert(tsnLt(lastTSN + 1, tsn));
+            if (tsnLe(tsn, sackChunk->getNrGapStop(i))) {
                 bool dummy;
-                sackGapList.updateGapList(tsn, dummy, false);   // non-revokable TSN
-                tsn++;
+                sackGapList.addGapBlock(tsn, sackChunk->getNrGapStop(i), dummy, false);   // non-revokable TSNs
             }
             lastTSN = sackChunk->getNrGapStop(i);
         }
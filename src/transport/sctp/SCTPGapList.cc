@@ -22,11 +22,6 @@
 // ###### Constructor #######################################################
 SCTPSimpleGapList::SCTPSimpleGapList()
 {
-    NumGaps = 0;
-    for (unsigned int i = 0; i < MAX_GAP_COUNT; i++) {
-        GapStartList[i] = 0xffff00ff;
-        GapStopList[i] = 0xffff0000;
-    }
 }
 
 
@@ -39,14 +34,15 @@ SCTPSimpleGapList::~SCTPSimpleGapList()
 // ###### Check gap list ####################################################
 void SCTPSimpleGapList::check(const uint32 cTsnAck) const
 {
-    for (uint32 i = 0; i < NumGaps; i++) {
+    assert(Gaps.size() <= MAX_GAP_COUNT);
+    for (uint32 i = 0; i < Gaps.size(); i++) {
         if (i == 0) {
-            assert(SCTPAssociation::tsnGt(GapStartList[i], cTsnAck + 1));
+            assert(SCTPAssociation::tsnGt(Gaps[i].Start, cTsnAck + 1));
         }
         else {
-            assert(SCTPAssociation::tsnGt(GapStartList[i], GapStopList[i - 1] + 1));
+            assert(SCTPAssociation::tsnGt(Gaps[i].Start, Gaps[i - 1].Stop + 1));
         }
-        assert(SCTPAssociation::tsnLe(GapStartList[i], GapStopList[i]));
+        assert(SCTPAssociation::tsnLe(Gaps[i].Start, Gaps[i].Stop));
     }
 }
 
@@ -55,55 +51,52 @@ void SCTPSimpleGapList::check(const uint32 cTsnAck) const
 void SCTPSimpleGapList::print(std::ostream& os) const
 {
     os << "{";
-    for (uint32 i = 0; i < NumGaps; i++) {
+    for (uint32 i = 0; i < Gaps.size(); i++) {
         if (i > 0) {
             os << ",";
         }
-        os << " " << GapStartList[i] << "-" << GapStopList[i];
+        os << " " << Gaps[i].Start << "-" << Gaps[i].Stop;
     }
     os << " }";
 }
 
 
-// ###### Is TSN in gap list? ###############################################
-bool SCTPSimpleGapList::tsnInGapList(const uint32 tsn) const
+// ###### Find gap block ####################################################
+uint32 SCTPSimpleGapList::findGap(const uint32 tsn) const
 {
-    for (uint32 i = 0; i < NumGaps; i++) {
-        if (SCTPAssociation::tsnBetween(GapStartList[i], tsn, GapStopList[i])) {
-            return true;
+    uint32 lo = 0;
+    uint32 hi = Gaps.size();
+    while (lo < hi) {
+        const uint32 mid = (lo + hi) / 2;
+        if (SCTPAssociation::tsnLt(Gaps[mid].Stop, tsn)) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
         }
     }
-    return false;
+    return (lo);
+}
+
+
+// ###### Is TSN in gap list? ###############################################
+bool SCTPSimpleGapList::tsnInGapList(const uint32 tsn) const
+{
+    const uint32 i = findGap(tsn);
+    return ((i < Gaps.size()) && (SCTPAssociation::tsnGe(tsn, Gaps[i].Start)));
 }
 
 
 // ###### Forward CumAckTSN #################################################
 void SCTPSimpleGapList::forwardCumAckTSN(const uint32 cTsnAck)
 {
-    if (NumGaps > 0) {
-        // It is only possible to advance CumAckTSN when there are gaps.
-        uint32 counter = 0;
-        uint32 advance = 0;
-        while (counter < NumGaps) {
-            // Check whether CumAckTSN can be advanced.
-            if (SCTPAssociation::tsnGe(cTsnAck, GapStartList[counter])) {   // Yes!
-                advance++;
-            }
-            else {   // No -> end of search.
-                break;
-            }
-            counter++;
-        }
-
-        if (advance > 0) {
-            // We can remove "advance" block now.
-            for (uint32 i = advance; i < NumGaps; i++) {
-                GapStartList[i - advance] = GapStartList[i];
-                GapStopList[i - advance] = GapStopList[i];
-            }
-            NumGaps -= advance;
-        }
+    // Remove all blocks starting at or below the new CumAckTSN.
+    uint32 advance = 0;
+    while ( (advance < Gaps.size()) &&
+            (SCTPAssociation::tsnGe(cTsnAck, Gaps[advance].Start)) ) {
+        advance++;
     }
+    Gaps.erase(Gaps.begin(), Gaps.begin() + advance);
 }
 
 
@@ -111,22 +104,10 @@ void SCTPSimpleGapList::forwardCumAckTSN(const uint32 cTsnAck)
 bool SCTPSimpleGapList::tryToAdvanceCumAckTSN(uint32& cTsnAck)
 {
     bool progress = false;
-    if (NumGaps > 0) {
-        // It is only possible to advance CumAckTSN when there are gaps.
-        uint32 counter = 0;
-        while (counter < NumGaps) {
-            // Check whether CumAckTSN can be advanced.
-            if (cTsnAck + 1 == GapStartList[0]) {   // Yes!
-                cTsnAck = GapStopList[0];
-                // We can take out all fragments of this block
-                for (uint32 i = 1; i < NumGaps; i++) {
-                    GapStartList[i-1] = GapStartList[i];
-                    GapStopList[i-1] = GapStopList[i];
-                }
-                progress = true;
-            }
-            counter++;
-        }
+    while ( (!Gaps.empty()) && (cTsnAck + 1 == Gaps[0].Start) ) {
+        cTsnAck = Gaps[0].Stop;
+        Gaps.erase(Gaps.begin());
+        progress = true;
     }
     return (progress);
 }
@@ -135,44 +116,38 @@ bool SCTPSimpleGapList::tryToAdvanceCumAckTSN(uint32& cTsnAck)
 // ###### Remove TSN from gap list ##########################################
 void SCTPSimpleGapList::removeFromGapList(const uint32 removedTSN)
 {
-    const int32 initialNumGaps = NumGaps;
-
-    for (int32 i = initialNumGaps - 1; i >= 0; i--) {
-        if (SCTPAssociation::tsnBetween(GapStartList[i], removedTSN, GapStopList[i])) {
-            // ====== Gap block contains more than one TSN =====================
-            const int32 gapsize = (int32)(GapStopList[i] - GapStartList[i] + 1);
-            if (gapsize > 1) {
-                if (GapStopList[i] == removedTSN) {   // Remove stop TSN
-                    GapStopList[i]--;
-                }
-                else if (GapStartList[i] == removedTSN) {   // Remove start TSN
-                    GapStartList[i]++;
-                }
-                else {   // Block has to be splitted up
-                    NumGaps = std::min(NumGaps + 1, (uint32)MAX_GAP_COUNT);   // Enforce upper limit!
-                    for (int32 j = NumGaps - 1;  j > i; j--) {
-                        GapStopList[j] = GapStopList[j - 1];
-                        GapStartList[j] = GapStartList[j - 1];
-                    }
-                    GapStopList[i] = removedTSN - 1;
-                    if ((uint32)i + 1 < NumGaps) {
-                        GapStartList[i + 1] = removedTSN + 1;
-                    }
-                }
-            }
+    removeFromGapList(removedTSN, removedTSN);
+}
+
 
-            // ====== Just a single TSN in the gap block (start==stop) =========
-            else {
-                for (int32 j = i; j <= initialNumGaps - 1; j++) {
-                    GapStopList[j] = GapStopList[j + 1];
-                    GapStartList[j] = GapStartList[j + 1];
+// ###### Remove TSN range from gap list ####################################
+void SCTPSimpleGapList::removeFromGapList(const uint32 firstTSN, const uint32 lastTSN)
+{
+    uint32 i = findGap(firstTSN);
+    while ( (i < Gaps.size()) && (SCTPAssociation::tsnLe(Gaps[i].Start, lastTSN)) ) {
+        GapBlock& gap = Gaps[i];
+        if (SCTPAssociation::tsnLt(gap.Start, firstTSN)) {
+            if (SCTPAssociation::tsnGt(gap.Stop, lastTSN)) {
+                // ====== Block has to be splitted up ==========================
+                GapBlock upper;
+                upper.Start = lastTSN + 1;
+                upper.Stop = gap.Stop;
+                gap.Stop = firstTSN - 1;
+                Gaps.insert(Gaps.begin() + i + 1, upper);
+                if (Gaps.size() > MAX_GAP_COUNT) {   // Enforce upper limit!
+                    Gaps.pop_back();
                 }
-                GapStartList[initialNumGaps - 1] = 0;
-                GapStopList[initialNumGaps - 1] = 0;
-                NumGaps--;
+                return;
             }
-
-            break;  // TSN removed -> done!
+            gap.Stop = firstTSN - 1;
+            i++;
+        }
+        else if (SCTPAssociation::tsnGt(gap.Stop, lastTSN)) {
+            gap.Start = lastTSN + 1;
+            return;
+        }
+        else {
+            Gaps.erase(Gaps.begin() + i);
         }
     }
 }
@@ -183,124 +158,65 @@ bool SCTPSimpleGapList::updateGapList(const uint32 receivedTSN,
         uint32&      cTsnAck,
         bool&        newChunkReceived)
 {
-    if (SCTPAssociation::tsnLe(receivedTSN, cTsnAck)) {
-        // Received TSN covered by CumAckTSN -> nothing to do.
+    return (updateGapList(receivedTSN, receivedTSN, cTsnAck, newChunkReceived));
+}
+
+
+// ###### Add TSN range to gap list #########################################
+bool SCTPSimpleGapList::updateGapList(const uint32 firstTSN,
+        const uint32 lastTSN,
+        uint32&      cTsnAck,
+        bool&        newChunkReceived)
+{
+    if (SCTPAssociation::tsnLe(lastTSN, cTsnAck)) {
+        // Received TSNs covered by CumAckTSN -> nothing to do.
         return (false);
     }
+    const uint32 first = SCTPAssociation::tsnLe(firstTSN, cTsnAck) ? cTsnAck + 1 : firstTSN;
 
-    uint32 lo = cTsnAck + 1;
-    for (uint32 i = 0; i < NumGaps; i++) {
-        if (GapStartList[i] > 0) {
-            const uint32 hi = GapStartList[i] - 1;
-            if (SCTPAssociation::tsnBetween(lo, receivedTSN, hi)) {
-                const uint32 gapsize = hi - lo + 1;
-                if (gapsize > 1) {
-                    /**
-                     * TSN either sits at the end of one gap, and thus changes gap
-                     * boundaries, or it is in between two gaps, and becomes a new gap
-                     */
-                    if (receivedTSN == hi) {
-                        GapStartList[i] = receivedTSN;
-                        newChunkReceived = true;
-                        return true;
-                    }
-                    else if (receivedTSN == lo) {
-                        if (receivedTSN == (cTsnAck + 1)) {
-                            cTsnAck++;
-                            newChunkReceived = true;
-                            return true;
-                        }
-                        /* some gap must increase its upper bound */
-                        GapStopList[i-1] = receivedTSN;
-                        newChunkReceived = true;
-                        return true;
-                    }
-                    else {   /* a gap in between */
-                        NumGaps = std::min(NumGaps + 1, (uint32)MAX_GAP_COUNT);   //  Enforce upper limit!
-
-                        for (uint32 j = NumGaps - 1; j > i; j--) {
-                            GapStartList[j] = GapStartList[j-1];
-                            GapStopList[j] = GapStopList[j-1];
-                        }
-                        GapStartList[i] = receivedTSN;
-                        GapStopList[i] = receivedTSN;
-                        newChunkReceived = true;
-                        return true;
-                    }
-                }
-                else {   /* alright: gapsize is 1: our received tsn may close gap between fragments */
-                    if (lo == cTsnAck + 1) {
-                        cTsnAck = GapStopList[i];
-                        if (i == NumGaps-1) {
-                            GapStartList[i] = 0;
-                            GapStopList[i] = 0;
-                        }
-                        else {
-                            for (uint32 j = i; j < NumGaps - 1; j++) {
-                                GapStartList[j] = GapStartList[j + 1];
-                                GapStopList[j] = GapStopList[j + 1];
-                            }
-                        }
-                        NumGaps--;
-                        newChunkReceived = true;
-                        return true;
-                    }
-                    else {
-                        GapStopList[i-1] = GapStopList[i];
-                        if (i == NumGaps-1) {
-                            GapStartList[i] = 0;
-                            GapStopList[i] = 0;
-                        }
-                        else {
-                            for (uint32 j = i; j < NumGaps - 1; j++) {
-                                GapStartList[j] = GapStartList[j + 1];
-                                GapStopList[j] = GapStopList[j + 1];
-                            }
-                        }
-                        NumGaps--;
-                        newChunkReceived = true;
-                        return true;
-                    }
-                }
-            }
-            else {  /* receivedTSN is not in the gap between these fragments... */
-                lo = GapStopList[i] + 1;
-            }
-        } /* end: for */
-    } /* end: for */
+    // ====== Find the blocks that overlap or touch first..lastTSN ===========
+    const uint32 i = findGap(first - 1);
+    uint32 j = i;
+    while ( (j < Gaps.size()) && (SCTPAssociation::tsnLe(Gaps[j].Start, lastTSN + 1)) ) {
+        j++;
+    }
 
-    // ====== We have reached the end of the list ============================
-    if (receivedTSN == lo) {   // just increase CumAckTSN, handle further update of CumAckTSN later
-        if (receivedTSN == cTsnAck + 1) {
-            cTsnAck = receivedTSN;
+    if (i < j) {
+        // ====== Merge the range and these blocks ============================
+        if ( (j > i + 1) ||
+             (SCTPAssociation::tsnLt(first, Gaps[i].Start)) ||
+             (SCTPAssociation::tsnGt(lastTSN, Gaps[i].Stop)) ) {
             newChunkReceived = true;
-            return true;
         }
-        // Update last fragment, stop TSN by one.
-        GapStopList[NumGaps-1]++;
-
-        newChunkReceived = true;
-        return true;
-
+        if (SCTPAssociation::tsnLt(first, Gaps[i].Start)) {
+            Gaps[i].Start = first;
+        }
+        Gaps[i].Stop = SCTPAssociation::tsnGt(lastTSN, Gaps[j - 1].Stop) ? lastTSN : Gaps[j - 1].Stop;
+        Gaps.erase(Gaps.begin() + i + 1, Gaps.begin() + j);
     }
     else {
-        // If the received TSN is new, the list is either empty or the received
-        // TSN is larger than the last gap end + 1. Otherwise, the TSN has already
-        // been acknowledged.
-        if ( (NumGaps == 0) ||
-                (SCTPAssociation::tsnGt(receivedTSN, GapStopList[NumGaps - 1] + 1)) ) {
-            // A new fragment altogether, past the end of the list
-            if (NumGaps < MAX_GAP_COUNT) {   // T.D. 18.12.09: Enforce upper limit!
-                GapStartList[NumGaps] = receivedTSN;
-                GapStopList[NumGaps] = receivedTSN;
-                NumGaps++;
-                newChunkReceived = true;
-            }
+        // ====== A new block =================================================
+        if ( (Gaps.size() >= MAX_GAP_COUNT) && (i == Gaps.size()) && (first != cTsnAck + 1) ) {
+            // T.D. 18.12.09: Enforce upper limit! The list is full, and the
+            // TSNs are past its end -> they are not recorded.
+            return (true);
         }
-        return true;
+        GapBlock gap;
+        gap.Start = first;
+        gap.Stop = lastTSN;
+        Gaps.insert(Gaps.begin() + i, gap);
+        newChunkReceived = true;
     }
 
-    return false;
+    // ====== Advance CumAckTSN, if possible =================================
+    if (Gaps[0].Start == cTsnAck + 1) {
+        cTsnAck = Gaps[0].Stop;
+        Gaps.erase(Gaps.begin());
+    }
+    if (Gaps.size() > MAX_GAP_COUNT) {   // Enforce upper limit!
+        Gaps.pop_back();
+    }
+    return (true);
 }
 
 
@@ -375,28 +291,37 @@ void SCTPGapList::removeFromGapList(const uint32 removedTSN)
 bool SCTPGapList::updateGapList(const uint32 receivedTSN,
         bool&        newChunkReceived,
         bool         tsnIsRevokable)
+{
+    return (addGapBlock(receivedTSN, receivedTSN, newChunkReceived, tsnIsRevokable));
+}
+
+
+// ###### Add TSN range to gap list #########################################
+bool SCTPGapList::addGapBlock(const uint32 firstTSN,
+        const uint32 lastTSN,
+        bool&        newChunkReceived,
+        bool         tsnIsRevokable)
 {
     uint32 oldCumAckTSN = CumAckTSN;
     if (tsnIsRevokable) {
         // Once a TSN become non-revokable, it cannot become revokable again!
         // However, if the list became too long, updateGapList() may be called
         // again when the chunk is received again.
-        RevokableGapList.updateGapList(receivedTSN, oldCumAckTSN, newChunkReceived);
+        RevokableGapList.updateGapList(firstTSN, lastTSN, oldCumAckTSN, newChunkReceived);
     }
     else {
-        if (NonRevokableGapList.updateGapList(receivedTSN, oldCumAckTSN, newChunkReceived) == true) {
-            // TSN has moved from revokable to non-revokable!
-            RevokableGapList.removeFromGapList(receivedTSN);
+        if (NonRevokableGapList.updateGapList(firstTSN, lastTSN, oldCumAckTSN, newChunkReceived) == true) {
+            // TSNs have moved from revokable to non-revokable!
+            RevokableGapList.removeFromGapList(firstTSN, lastTSN);
         }
     }
 
-    // Finally, add TSN to combined list and set CumAckTSN.
+    // Finally, add TSNs to combined list and set CumAckTSN.
     oldCumAckTSN = CumAckTSN;
-    const bool newChunk = CombinedGapList.updateGapList(receivedTSN, CumAckTSN, newChunkReceived);
+    const bool newChunk = CombinedGapList.updateGapList(firstTSN, lastTSN, CumAckTSN, newChunkReceived);
     if (oldCumAckTSN != CumAckTSN) {
         RevokableGapList.forwardCumAckTSN(CumAckTSN);
         NonRevokableGapList.forwardCumAckTSN(CumAckTSN);
     }
     return (newChunk);
 }
-
@@ -19,6 +19,7 @@
 #ifndef SCTPGAPLIST_H
 #define SCTPGAPLIST_H
 
+#include <vector>
 #include <omnetpp.h>
 #include <assert.h>
 
@@ -27,6 +28,12 @@
 #define MAX_GAP_COUNT 500
 
 
+/**
+ * Sorted list of disjoint, non-adjacent TSN blocks above the cumulative
+ * TSN ack. Blocks are located by binary search, and whole blocks can be
+ * added or removed at once, so the cost of an update does not depend on
+ * the number of TSNs in the affected blocks.
+ */
 class SCTPSimpleGapList
 {
   public:
@@ -37,31 +44,41 @@ class SCTPSimpleGapList
     void print(std::ostream& os) const;
 
     inline uint32 getNumGaps() const {
-        return (NumGaps);
+        return (Gaps.size());
     }
     inline uint32 getGapStart(const uint32 index) const {
-        assert(index < NumGaps);
-        return (GapStartList[index]);
+        assert(index < Gaps.size());
+        return (Gaps[index].Start);
     }
     inline uint32 getGapStop(const uint32 index) const {
-        assert(index < NumGaps);
-        return (GapStopList[index]);
+        assert(index < Gaps.size());
+        return (Gaps[index].Stop);
     }
 
     bool tsnInGapList(const uint32 tsn) const;
     void forwardCumAckTSN(const uint32 cTsnAck);
     bool tryToAdvanceCumAckTSN(uint32& cTsnAck);
     void removeFromGapList(const uint32 removedTSN);
+    void removeFromGapList(const uint32 firstTSN, const uint32 lastTSN);
     bool updateGapList(const uint32 receivedTSN,
                        uint32&      cTsnAck,
                        bool&        newChunkReceived);
+    bool updateGapList(const uint32 firstTSN,
+                       const uint32 lastTSN,
+                       uint32&      cTsnAck,
+                       bool&        newChunkReceived);
 
 
     // ====== Private data ===================================================
   private:
-    uint32 NumGaps;
-    uint32 GapStartList[MAX_GAP_COUNT];
-    uint32 GapStopList[MAX_GAP_COUNT];
+    struct GapBlock {
+        uint32 Start;
+        uint32 Stop;
+    };
+    std::vector<GapBlock> Gaps;    // at most MAX_GAP_COUNT blocks
+
+    // returns the index of the first block that ends at or after the given TSN
+    uint32 findGap(const uint32 tsn) const;
 };
 
 
@@ -147,6 +164,11 @@ class SCTPGapList
     bool updateGapList(const uint32 receivedTSN,
                        bool&        newChunkReceived,
                        bool         tsnIsRevokable = true);
+    // adds the TSNs firstTSN..lastTSN, e.g. a gap block of a SACK
+    bool addGapBlock(const uint32 firstTSN,
+                     const uint32 lastTSN,
+                     bool&        newChunkReceived,
+                     bool         tsnIsRevokable = true);
 
     // ====== Private data ===================================================
   private:
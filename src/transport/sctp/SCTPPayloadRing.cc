@@ -0,0 +1,244 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "SCTPPayloadRing.h"
+
+
+#define INITIAL_RING_SIZE  64
+#define MAX_SPAN           0x40000000   // TSNs further apart cannot be compared with serial number arithmetic
+
+
+// index of the lowest and the highest set bit of x, which must not be 0
+static int lowestBit(uint32 x)
+{
+    int n = 0;
+    if ((x & 0xffff) == 0) {n += 16; x >>= 16;}
+    if ((x & 0xff) == 0) {n += 8; x >>= 8;}
+    if ((x & 0xf) == 0) {n += 4; x >>= 4;}
+    if ((x & 0x3) == 0) {n += 2; x >>= 2;}
+    if ((x & 0x1) == 0) {n += 1;}
+    return n;
+}
+
+static int highestBit(uint32 x)
+{
+    int n = 0;
+    if (x & 0xffff0000) {n += 16; x >>= 16;}
+    if (x & 0xff00) {n += 8; x >>= 8;}
+    if (x & 0xf0) {n += 4; x >>= 4;}
+    if (x & 0xc) {n += 2; x >>= 2;}
+    if (x & 0x2) {n += 1;}
+    return n;
+}
+
+SCTPPayloadRing::SCTPPayloadRing() :
+    slots(INITIAL_RING_SIZE, value_type(0, (SCTPDataVariables*)NULL)),
+    occupied(INITIAL_RING_SIZE / 32, 0),
+    occupiedWords(1, 0)
+{
+    firstTsn = 0;
+    span = 0;
+    count = 0;
+}
+
+void SCTPPayloadRing::setOccupied(uint32 index)
+{
+    occupied[index >> 5] |= 1u << (index & 31);
+    occupiedWords[index >> 10] |= 1u << ((index >> 5) & 31);
+}
+
+void SCTPPayloadRing::clearOccupied(uint32 index)
+{
+    uint32 word = index >> 5;
+    occupied[word] &= ~(1u << (index & 31));
+    if (occupied[word] == 0)
+        occupiedWords[word >> 5] &= ~(1u << (word & 31));
+}
+
+int32 SCTPPayloadRing::findOccupiedFrom(uint32 index) const
+{
+    uint32 word = index >> 5;
+    uint32 bits = occupied[word] & (0xffffffffu << (index & 31));
+    if (bits != 0)
+        return (word << 5) + lowestBit(bits);
+
+    // skip the empty words using occupiedWords
+    if (++word >= occupied.size())
+        return -1;
+    uint32 summaryIndex = word >> 5;
+    uint32 summaryBits = occupiedWords[summaryIndex] & (0xffffffffu << (word & 31));
+    while (summaryBits == 0) {
+        if (++summaryIndex >= occupiedWords.size())
+            return -1;
+        summaryBits = occupiedWords[summaryIndex];
+    }
+    word = (summaryIndex << 5) + lowestBit(summaryBits);
+    return (word << 5) + lowestBit(occupied[word]);
+}
+
+int32 SCTPPayloadRing::findOccupiedUpTo(uint32 index) const
+{
+    uint32 word = index >> 5;
+    uint32 bits = occupied[word] & (0xffffffffu >> (31 - (index & 31)));
+    if (bits != 0)
+        return (word << 5) + highestBit(bits);
+
+    // skip the empty words using occupiedWords
+    if (word-- == 0)
+        return -1;
+    uint32 summaryIndex = word >> 5;
+    uint32 summaryBits = occupiedWords[summaryIndex] & (0xffffffffu >> (31 - (word & 31)));
+    while (summaryBits == 0) {
+        if (summaryIndex-- == 0)
+            return -1;
+        summaryBits = occupiedWords[summaryIndex];
+    }
+    word = (summaryIndex << 5) + highestBit(summaryBits);
+    return (word << 5) + highestBit(occupied[word]);
+}
+
+bool SCTPPayloadRing::findNext(uint32& tsn) const
+{
+    if (count == 0)
+        return false;
+    uint32 offset = ((int32)(tsn - firstTsn) < 0) ? 0 : tsn - firstTsn;
+    if (offset >= span)
+        return false;
+
+    // search the slots circularly from that of tsn; the first occupied one is the
+    // next chunk, unless the search wrapped around to a lower TSN
+    const uint32 mask = slots.size() - 1;
+    int32 index = findOccupiedFrom((firstTsn + offset) & mask);
+    if (index == -1)
+        index = findOccupiedFrom(0);
+    uint32 foundOffset = ((uint32)index - firstTsn) & mask;
+    if (foundOffset < offset)
+        return false;
+    tsn = firstTsn + foundOffset;
+    return true;
+}
+
+bool SCTPPayloadRing::findPrevious(uint32& tsn) const
+{
+    if (count == 0 || (int32)(tsn - firstTsn) < 0)
+        return false;
+    uint32 offset = (tsn - firstTsn >= span) ? span - 1 : tsn - firstTsn;
+
+    const uint32 mask = slots.size() - 1;
+    int32 index = findOccupiedUpTo((firstTsn + offset) & mask);
+    if (index == -1)
+        index = findOccupiedUpTo(mask);
+    uint32 foundOffset = ((uint32)index - firstTsn) & mask;
+    if (foundOffset > offset)
+        return false;
+    tsn = firstTsn + foundOffset;
+    return true;
+}
+
+void SCTPPayloadRing::reserve(uint32 newSpan)
+{
+    if (newSpan > MAX_SPAN)
+        throw cRuntimeError("SCTPPayloadRing: TSN range of %u chunks starting at %u exceeds the limit of %u", newSpan, firstTsn, MAX_SPAN);
+    if (newSpan <= slots.size())
+        return;
+
+    size_t newSize = slots.size();
+    while (newSize < newSpan)
+        newSize *= 2;
+    std::vector<value_type> oldSlots;
+    std::vector<uint32> oldOccupied;
+    slots.swap(oldSlots);
+    occupied.swap(oldOccupied);
+    slots.assign(newSize, value_type(0, (SCTPDataVariables*)NULL));
+    occupied.assign(newSize / 32, 0);
+    occupiedWords.assign((newSize / 32 + 31) / 32, 0);
+
+    for (uint32 word = 0; word < oldOccupied.size(); word++) {
+        for (uint32 bits = oldOccupied[word]; bits != 0; bits &= bits - 1) {
+            const value_type& s = oldSlots[(word << 5) + lowestBit(bits)];
+            uint32 index = s.first & (newSize - 1);
+            slots[index] = s;
+            setOccupied(index);
+        }
+    }
+}
+
+bool SCTPPayloadRing::insert(uint32 tsn, SCTPDataVariables *chunk)
+{
+    ASSERT(chunk != NULL);
+    if (count == 0) {
+        firstTsn = tsn;
+        span = 1;
+    }
+    else if ((int32)(tsn - firstTsn) < 0) {
+        uint32 newSpan = span + (firstTsn - tsn);
+        reserve(newSpan);
+        firstTsn = tsn;
+        span = newSpan;
+    }
+    else if (tsn - firstTsn >= span) {
+        uint32 newSpan = tsn - firstTsn + 1;
+        reserve(newSpan);
+        span = newSpan;
+    }
+    else if (contains(tsn)) {
+        return false;
+    }
+
+    slot(tsn) = value_type(tsn, chunk);
+    setOccupied(tsn & (slots.size() - 1));
+    count++;
+    return true;
+}
+
+void SCTPPayloadRing::erase(uint32 tsn)
+{
+    if (!contains(tsn))
+        return;
+
+    slot(tsn).second = NULL;
+    clearOccupied(tsn & (slots.size() - 1));
+    count--;
+    if (count == 0) {
+        span = 0;
+        return;
+    }
+
+    // keep the first and the last slot of the range occupied
+    if (tsn == firstTsn) {
+        uint32 next = tsn + 1;
+        findNext(next);
+        span -= next - firstTsn;
+        firstTsn = next;
+    }
+    else if (tsn == firstTsn + span - 1) {
+        uint32 previous = tsn - 1;
+        findPrevious(previous);
+        span = previous - firstTsn + 1;
+    }
+}
+
+void SCTPPayloadRing::clear()
+{
+    for (uint32 word = 0; word < occupied.size(); word++) {
+        for (uint32 bits = occupied[word]; bits != 0; bits &= bits - 1)
+            slots[(word << 5) + lowestBit(bits)].second = NULL;
+        occupied[word] = 0;
+    }
+    occupiedWords.assign(occupiedWords.size(), 0);
+    span = 0;
+    count = 0;
+}
@@ -0,0 +1,134 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __SCTPPAYLOADRING_H
+#define __SCTPPAYLOADRING_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+
+class SCTPDataVariables;
+
+
+/**
+ * Chunks of an SCTPQueue, keyed by TSN. It replaces the former
+ * std::map<uint32, SCTPDataVariables*>, and provides the subset of the
+ * std::map interface that the SCTP code uses.
+ *
+ * The chunks are stored in a circular buffer addressed by TSN modulo the
+ * buffer size, which covers the TSN range from the lowest to the highest
+ * TSN in the queue. Lookup, insertion and removal take constant time;
+ * the buffer grows when the TSN range does not fit into it. A queue of a
+ * receive stream may wait for a lost or abandoned TSN for long, so the
+ * range is not bounded by the window; only TSNs that are too far apart
+ * for serial number arithmetic (2^30) are an error.
+ * Iteration visits the chunks in TSN order, using serial number
+ * arithmetic, so it is also correct when the TSN wraps around.
+ *
+ * The queues of a receive stream only hold the TSNs of their stream, so
+ * their range may be sparse. An occupancy bitmap of the slots, and a
+ * second bitmap of its non-zero words, let iteration skip empty slots
+ * 32 and 1024 at a time.
+ *
+ * Iterators remain valid when other chunks are inserted or removed, and
+ * an iterator whose chunk has been removed can still be incremented.
+ */
+class INET_API SCTPPayloadRing
+{
+  public:
+    typedef std::pair<uint32, SCTPDataVariables*> value_type;
+
+    template<class Ring, class Value>
+    class Iterator
+    {
+        friend class SCTPPayloadRing;
+        template<class R, class V> friend class Iterator;
+
+      protected:
+        Ring *ring;
+        uint32 tsn;
+        bool atEnd;
+
+        Iterator(Ring *ring, uint32 tsn, bool atEnd) : ring(ring), tsn(tsn), atEnd(atEnd) {}
+
+      public:
+        Iterator() : ring(NULL), tsn(0), atEnd(true) {}
+        template<class R, class V>
+        Iterator(const Iterator<R, V>& other) : ring(other.ring), tsn(other.tsn), atEnd(other.atEnd) {}
+
+        Value& operator*() const {return ring->slot(tsn);}
+        Value *operator->() const {return &ring->slot(tsn);}
+        Iterator& operator++() {atEnd = !ring->findNext(++tsn); return *this;}
+        Iterator operator++(int) {Iterator tmp = *this; ++*this; return tmp;}
+        bool operator==(const Iterator& other) const {return atEnd ? other.atEnd : !other.atEnd && tsn == other.tsn;}
+        bool operator!=(const Iterator& other) const {return !(*this == other);}
+    };
+
+    typedef Iterator<SCTPPayloadRing, value_type> iterator;
+    typedef Iterator<const SCTPPayloadRing, const value_type> const_iterator;
+
+  protected:
+    std::vector<value_type> slots;  // size is a power of two; empty slots have NULL chunk
+    std::vector<uint32> occupied;   // one bit per slot, set if the slot holds a chunk
+    std::vector<uint32> occupiedWords;  // one bit per word of occupied, set if the word is not zero
+    uint32 firstTsn;                // lowest TSN in the queue
+    uint32 span;                    // highest TSN - lowest TSN + 1, or 0 if empty
+    uint32 count;                   // number of chunks
+
+  protected:
+    value_type& slot(uint32 tsn) {return slots[tsn & (slots.size() - 1)];}
+    const value_type& slot(uint32 tsn) const {return slots[tsn & (slots.size() - 1)];}
+    bool contains(uint32 tsn) const {
+        if (tsn - firstTsn >= span)
+            return false;
+        const value_type& s = slot(tsn);
+        return s.second != NULL && s.first == tsn;
+    }
+    void setOccupied(uint32 index);
+    void clearOccupied(uint32 index);
+    // index of the first occupied slot at or after index, or of the last one at or before index; -1 if none
+    int32 findOccupiedFrom(uint32 index) const;
+    int32 findOccupiedUpTo(uint32 index) const;
+    // sets tsn to the first TSN in the queue that is not lower than tsn; returns false if there is none
+    bool findNext(uint32& tsn) const;
+    // sets tsn to the last TSN in the queue that is not higher than tsn; returns false if there is none
+    bool findPrevious(uint32& tsn) const;
+    void reserve(uint32 newSpan);
+
+  public:
+    SCTPPayloadRing();
+
+    iterator begin() {return iterator(this, firstTsn, count == 0);}
+    iterator end() {return iterator(this, 0, true);}
+    const_iterator begin() const {return const_iterator(this, firstTsn, count == 0);}
+    const_iterator end() const {return const_iterator(this, 0, true);}
+
+    iterator find(uint32 tsn) {return iterator(this, tsn, !contains(tsn));}
+    const_iterator find(uint32 tsn) const {return const_iterator(this, tsn, !contains(tsn));}
+
+    /** Inserts the chunk; returns false and leaves the queue unchanged if the TSN is already present */
+    bool insert(uint32 tsn, SCTPDataVariables *chunk);
+
+    void erase(const iterator& it) {erase(it.tsn);}
+    void erase(uint32 tsn);
+    void clear();
+
+    size_t size() const {return count;}
+    bool empty() const {return count == 0;}
+};
+
+#endif
@@ -42,12 +42,7 @@ SCTPQueue::~SCTPQueue()
 
 bool SCTPQueue::checkAndInsertChunk(const uint32 key, SCTPDataVariables* chunk)
 {
-    PayloadQueue::iterator found = payloadQueue.find(key);
-    if (found != payloadQueue.end()) {
-        return false;
-    }
-    payloadQueue[key] = chunk;
-    return true;
+    return payloadQueue.insert(key, chunk);
 }
 
 uint32 SCTPQueue::getQueueSize() const
@@ -68,8 +63,8 @@ SCTPDataVariables* SCTPQueue::extractMessage()
 
 SCTPDataVariables* SCTPQueue::getAndExtractChunk(const uint32 tsn)
 {
-    if (!payloadQueue.empty()) {
-        PayloadQueue::iterator iterator = payloadQueue.find(tsn);
+    PayloadQueue::iterator iterator = payloadQueue.find(tsn);
+    if (iterator != payloadQueue.end()) {
         SCTPDataVariables*    chunk = iterator->second;
         payloadQueue.erase(iterator);
         return chunk;
@@ -125,33 +120,18 @@ SCTPDataVariables* SCTPQueue::getChunk(const uint32 tsn) const
 
 SCTPDataVariables* SCTPQueue::getChunkFast(const uint32 tsn, bool& firstTime)
 {
-    if (!firstTime) {
-        if (GetChunkFastIterator != payloadQueue.end()) {
-            SCTPDataVariables* chunk = GetChunkFastIterator->second;
-            if (chunk->tsn == tsn) {
-                GetChunkFastIterator++;
-                return (chunk);    // Found the right TSN!
-            }
-        }
-        // TSN not found -> needs regular TSN lookup.
-    }
-
-    GetChunkFastIterator = payloadQueue.find(tsn);
-    if (GetChunkFastIterator != payloadQueue.end()) {
-        SCTPDataVariables* chunk = GetChunkFastIterator->second;
-        GetChunkFastIterator++;
+    // lookups take constant time, so there is no position to remember between calls
+    SCTPDataVariables* chunk = getChunk(tsn);
+    if (chunk != NULL) {
         firstTime = false;
-        return (chunk);
     }
-
-    return (NULL);
+    return (chunk);
 }
 
 
 void SCTPQueue::removeMsg(const uint32 tsn)
 {
-    PayloadQueue::iterator iterator = payloadQueue.find(tsn);
-    payloadQueue.erase(iterator);
+    payloadQueue.erase(tsn);
 }
 
 bool SCTPQueue::deleteMsg(const uint32 tsn)
@@ -23,6 +23,7 @@
 
 #include "IPvXAddress.h"
 #include "SCTP.h"
+#include "SCTPPayloadRing.h"
 
 
 class SCTPDataVariables;
@@ -94,14 +95,11 @@ class INET_API SCTPQueue : public cObject
                                             uint32&            rtxEarliestOutstandingTSN) const;
 
   public:
-     typedef std::map<uint32, SCTPDataVariables*> PayloadQueue;
+     typedef SCTPPayloadRing PayloadQueue;
      PayloadQueue payloadQueue;
 
   protected:
      SCTPAssociation* assoc;    // SCTP connection object
-
-  private:
-     PayloadQueue::iterator GetChunkFastIterator;
 };
 
 #endif
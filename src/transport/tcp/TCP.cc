@@ -16,6 +16,8 @@
 //
 
 
+#include <algorithm>
+
 #include "TCP.h"
 
 #include "IPv4ControlInfo.h"
@@ -48,6 +50,7 @@ bool TCP::logverbose;
 
 #define EPHEMERAL_PORTRANGE_START 1024
 #define EPHEMERAL_PORTRANGE_END   5000
+#define EPHEMERAL_PORTRANGE_SIZE  (EPHEMERAL_PORTRANGE_END - EPHEMERAL_PORTRANGE_START)
 
 static std::ostream& operator<<(std::ostream& os, const TCP::SockPair& sp)
 {
@@ -69,6 +72,17 @@ static std::ostream& operator<<(std::ostream& os, const TCPConnection& conn)
     return os;
 }
 
+static std::ostream& operator<<(std::ostream& os, const TCPConnTable& table)
+{
+    std::vector<std::pair<TCP::SockPair, TCPConnection *> > entries;
+    table.getEntries(entries);
+    std::sort(entries.begin(), entries.end());
+    os << "size=" << entries.size();
+    for (unsigned int i = 0; i < entries.size(); i++)
+        os << " {" << entries[i].first << " ==> " << *entries[i].second << "}";
+    return os;
+}
+
 
 void TCP::initialize()
 {
@@ -84,7 +98,13 @@ void TCP::initialize()
     lastEphemeralPort = EPHEMERAL_PORTRANGE_START;
     WATCH(lastEphemeralPort);
 
-    WATCH_PTRMAP(tcpConnMap);
+    ephemeralPortUseCount.assign(EPHEMERAL_PORTRANGE_SIZE, 0);
+    ephemeralPortBitmap.assign((EPHEMERAL_PORTRANGE_SIZE + 31) / 32, 0);
+    if (EPHEMERAL_PORTRANGE_SIZE % 32 != 0)
+        ephemeralPortBitmap.back() = ~0u << (EPHEMERAL_PORTRANGE_SIZE % 32);  // padding bits: never free
+
+    WATCH(tcpConnTable);
+    WATCH(tcpListenerTable);
     WATCH_PTRMAP(tcpAppConnMap);
 
     recordStatistics = par("recordStats");
@@ -92,6 +112,8 @@ void TCP::initialize()
     cModule *netw = simulation.getSystemModule();
     testing = netw->hasPar("testing") && netw->par("testing").boolValue();
     logverbose = !testing && netw->hasPar("logverbose") && netw->par("logverbose").boolValue();
+
+    timerWheel.initialize(this, par("timerTickResolution").doubleValue(), par("timerWheelSize"));
 }
 
 TCP::~TCP()
@@ -106,12 +128,16 @@ TCP::~TCP()
 
 void TCP::handleMessage(cMessage *msg)
 {
-    if (msg->isSelfMessage())
+    if (timerWheel.isTickMessage(msg))
     {
-        TCPConnection *conn = (TCPConnection *) msg->getContextPointer();
-        bool ret = conn->processTimer(msg);
-        if (!ret)
-            removeConnection(conn);
+        // all timers expiring at this tick
+        TCPTimer *timer;
+        while ((timer = timerWheel.getNextExpired()) != NULL)
+            processConnectionTimer(timer);
+    }
+    else if (msg->isSelfMessage())
+    {
+        processConnectionTimer(msg);
     }
     else if (msg->arrivedOn("ipIn") || msg->arrivedOn("ipv6In"))
     {
@@ -269,6 +295,12 @@ void TCP::updateDisplayString()
     getDisplayString().setTagArg("t", 0, buf2);
 }
 
+TCPConnTable& TCP::getConnTableFor(const SockPair& key)
+{
+    bool isListening = key.remoteAddr.isUnspecified() && key.remotePort == -1;
+    return isListening ? tcpListenerTable : tcpConnTable;
+}
+
 TCPConnection *TCP::findConnForSegment(TCPSegment *tcpseg, IPvXAddress srcAddr, IPvXAddress destAddr)
 {
     SockPair key;
@@ -279,34 +311,29 @@ TCPConnection *TCP::findConnForSegment(TCPSegment *tcpseg, IPvXAddress srcAddr,
     SockPair save = key;
 
     // try with fully qualified SockPair
-    TcpConnMap::iterator i;
-    i = tcpConnMap.find(key);
-
-    if (i != tcpConnMap.end())
-        return i->second;
+    TCPConnection *conn = getConnTableFor(key).find(key);
+    if (conn)
+        return conn;
 
     // try with localAddr missing (only localPort specified in passive/active open)
     key.localAddr = IPvXAddress();
-    i = tcpConnMap.find(key);
-
-    if (i != tcpConnMap.end())
-        return i->second;
+    conn = getConnTableFor(key).find(key);
+    if (conn)
+        return conn;
 
     // try fully qualified local socket + blank remote socket (for incoming SYN)
     key = save;
     key.remoteAddr = IPvXAddress();
     key.remotePort = -1;
-    i = tcpConnMap.find(key);
-
-    if (i != tcpConnMap.end())
-        return i->second;
+    conn = tcpListenerTable.find(key);
+    if (conn)
+        return conn;
 
     // try with blank remote socket, and localAddr missing (for incoming SYN)
     key.localAddr = IPvXAddress();
-    i = tcpConnMap.find(key);
-
-    if (i != tcpConnMap.end())
-        return i->second;
+    conn = tcpListenerTable.find(key);
+    if (conn)
+        return conn;
 
     // given up
     return NULL;
@@ -325,23 +352,51 @@ TCPConnection *TCP::findConnForApp(int appGateIndex, int connId)
 ushort TCP::getEphemeralPort()
 {
     // start at the last allocated port number + 1, and search for an unused one
-    ushort searchUntil = lastEphemeralPort++;
-    if (lastEphemeralPort == EPHEMERAL_PORTRANGE_END) // wrap
-        lastEphemeralPort = EPHEMERAL_PORTRANGE_START;
+    int start = (lastEphemeralPort + 1 - EPHEMERAL_PORTRANGE_START) % EPHEMERAL_PORTRANGE_SIZE;
+    int index = findUnusedEphemeralPortIndex(start);
+    if (index < 0) // wrap
+        index = findUnusedEphemeralPortIndex(0);
+    if (index < 0)
+        error("Ephemeral port range %d..%d exhausted, all ports occupied", EPHEMERAL_PORTRANGE_START, EPHEMERAL_PORTRANGE_END);
+
+    // found a free one, return it
+    lastEphemeralPort = EPHEMERAL_PORTRANGE_START + index;
+    return lastEphemeralPort;
+}
 
-    while (usedEphemeralPorts.find(lastEphemeralPort) != usedEphemeralPorts.end())
+int TCP::findUnusedEphemeralPortIndex(int start) const
+{
+    // skip fully occupied words of the bitmap; bits before 'start' count as used
+    int numWords = ephemeralPortBitmap.size();
+    int w = start / 32;
+    uint32 bits = ephemeralPortBitmap[w] | ((1u << (start % 32)) - 1);
+    while (bits == ~0u)
     {
-        if (lastEphemeralPort == searchUntil) // got back to starting point?
-            error("Ephemeral port range %d..%d exhausted, all ports occupied", EPHEMERAL_PORTRANGE_START, EPHEMERAL_PORTRANGE_END);
+        if (++w == numWords)
+            return -1;
+        bits = ephemeralPortBitmap[w];
+    }
 
-        lastEphemeralPort++;
+    int bit = 0;
+    while (bits & (1u << bit))
+        bit++;
+    return w * 32 + bit;
+}
 
-        if (lastEphemeralPort == EPHEMERAL_PORTRANGE_END) // wrap
-            lastEphemeralPort = EPHEMERAL_PORTRANGE_START;
-    }
+void TCP::markEphemeralPort(int port, bool used)
+{
+    if (port < EPHEMERAL_PORTRANGE_START || port >= EPHEMERAL_PORTRANGE_END)
+        return;
 
-    // found a free one, return it
-    return lastEphemeralPort;
+    // several connections may share a local port (e.g. ones forked from a listening socket)
+    int index = port - EPHEMERAL_PORTRANGE_START;
+    int& count = ephemeralPortUseCount[index];
+    count += used ? 1 : -1;
+    ASSERT(count >= 0);
+    if (count > 0)
+        ephemeralPortBitmap[index / 32] |= 1u << (index % 32);
+    else
+        ephemeralPortBitmap[index / 32] &= ~(1u << (index % 32));
 }
 
 void TCP::addSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress remoteAddr, int localPort, int remotePort)
@@ -353,9 +408,8 @@ void TCP::addSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress re
     key.localPort = conn->localPort = localPort;
     key.remotePort = conn->remotePort = remotePort;
 
-    // make sure connection is unique
-    TcpConnMap::iterator it = tcpConnMap.find(key);
-    if (it != tcpConnMap.end())
+    // make sure connection is unique, then insert it into the table
+    if (!getConnTableFor(key).insert(key, conn))
     {
         // throw "address already in use" error
         if (remoteAddr.isUnspecified() && remotePort == -1)
@@ -366,12 +420,8 @@ void TCP::addSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress re
                   localAddr.str().c_str(), localPort, remoteAddr.str().c_str(), remotePort);
     }
 
-    // then insert it into tcpConnMap
-    tcpConnMap[key] = conn;
-
     // mark port as used
-    if (localPort >= EPHEMERAL_PORTRANGE_START && localPort < EPHEMERAL_PORTRANGE_END)
-        usedEphemeralPorts.insert(localPort);
+    markEphemeralPort(localPort, true);
 }
 
 void TCP::updateSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress remoteAddr, int localPort, int remotePort)
@@ -382,21 +432,23 @@ void TCP::updateSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress
     key.remoteAddr = conn->remoteAddr;
     key.localPort = conn->localPort;
     key.remotePort = conn->remotePort;
-    TcpConnMap::iterator it = tcpConnMap.find(key);
+    TCPConnTable& oldTable = getConnTableFor(key);
 
-    ASSERT(it != tcpConnMap.end() && it->second == conn);
+    ASSERT(oldTable.find(key) == conn);
 
-    // ...and remove from the old place in tcpConnMap
-    tcpConnMap.erase(it);
+    // ...and remove from the old place in the tables
+    oldTable.remove(key);
 
-    // then update addresses/ports, and re-insert it with new key into tcpConnMap
+    // then update addresses/ports, and re-insert it with new key
     key.localAddr = conn->localAddr = localAddr;
     key.remoteAddr = conn->remoteAddr = remoteAddr;
     ASSERT(conn->localPort == localPort);
     key.remotePort = conn->remotePort = remotePort;
-    tcpConnMap[key] = conn;
+    bool inserted = getConnTableFor(key).insert(key, conn);
+    ASSERT(inserted);
+    (void)inserted;
 
-    // localPort doesn't change (see ASSERT above), so there's no need to update usedEphemeralPorts[].
+    // localPort doesn't change (see ASSERT above), so there's no need to update the ephemeral port bitmap.
 }
 
 void TCP::addForkedConnection(TCPConnection *conn, TCPConnection *newConn, IPvXAddress localAddr, IPvXAddress remoteAddr, int localPort, int remotePort)
@@ -428,26 +480,68 @@ void TCP::removeConnection(TCPConnection *conn)
     key.connId = conn->connId;
     tcpAppConnMap.erase(key);
 
-    SockPair key2;
-    key2.localAddr = conn->localAddr;
-    key2.remoteAddr = conn->remoteAddr;
-    key2.localPort = conn->localPort;
-    key2.remotePort = conn->remotePort;
-    tcpConnMap.erase(key2);
+    removeSockPair(conn);
 
-    // IMPORTANT: usedEphemeralPorts.erase(conn->localPort) is NOT GOOD because it
-    // deletes ALL occurrences of the port from the multiset.
-    std::multiset<ushort>::iterator it = usedEphemeralPorts.find(conn->localPort);
+    delete conn;
+}
 
-    if (it != usedEphemeralPorts.end())
-        usedEphemeralPorts.erase(it);
+void TCP::processConnectionTimer(cMessage *timer)
+{
+    TCPConnection *conn = (TCPConnection *) timer->getContextPointer();
+    bool ret = conn->processTimer(timer);
+    if (!ret)
+        removeConnection(conn);
+}
 
-    delete conn;
+void TCP::scheduleTimer(cMessage *timer, simtime_t expiry)
+{
+    TCPTimer *tcpTimer = timerWheel.isEnabled() ? dynamic_cast<TCPTimer *>(timer) : NULL;
+
+    if (tcpTimer)
+        timerWheel.schedule(tcpTimer, expiry);
+    else
+        scheduleAt(expiry, timer);
+}
+
+cMessage *TCP::cancelTimer(cMessage *timer)
+{
+    TCPTimer *tcpTimer = timerWheel.isEnabled() ? dynamic_cast<TCPTimer *>(timer) : NULL;
+
+    if (tcpTimer && tcpTimer->isOnWheel())
+        return timerWheel.cancel(tcpTimer);
+    else
+        return cancelEvent(timer);
+}
+
+bool TCP::isTimerScheduled(cMessage *timer) const
+{
+    if (timer->isScheduled())
+        return true;
+
+    TCPTimer *tcpTimer = timerWheel.isEnabled() ? dynamic_cast<TCPTimer *>(timer) : NULL;
+    return tcpTimer && tcpTimer->isOnWheel();
+}
+
+void TCP::removeSockPair(TCPConnection *conn)
+{
+    SockPair key;
+    key.localAddr = conn->localAddr;
+    key.remoteAddr = conn->remoteAddr;
+    key.localPort = conn->localPort;
+    key.remotePort = conn->remotePort;
+
+    // connections that never got to OPEN are not in the tables
+    TCPConnTable& table = getConnTableFor(key);
+    if (table.find(key) == conn)
+    {
+        table.remove(key);
+        markEphemeralPort(conn->localPort, false);
+    }
 }
 
 void TCP::finish()
 {
-    tcpEV << getFullPath() << ": finishing with " << tcpConnMap.size() << " connections open.\n";
+    tcpEV << getFullPath() << ": finishing with " << tcpConnTable.size() + tcpListenerTable.size() << " connections open.\n";
 }
 
 TCPSendQueue* TCP::createSendQueue(TCPDataTransferMode transferModeP)
@@ -20,12 +20,14 @@
 #define __INET_TCPMAIN_H
 
 #include <map>
-#include <set>
+#include <vector>
 
 #include "INETDefs.h"
 
 #include "IPvXAddress.h"
 #include "TCPCommand_m.h"
+#include "TCPConnTable.h"
+#include "TCPTimerWheel.h"
 
 // Forward declarations:
 class TCPConnection;
@@ -116,35 +118,24 @@ class INET_API TCP : public cSimpleModule
         }
 
     };
-    struct SockPair
-    {
-        IPvXAddress localAddr;
-        IPvXAddress remoteAddr;
-        int localPort;   // -1: unspec
-        int remotePort;  // -1: unspec
-
-        inline bool operator<(const SockPair& b) const
-        {
-            if (remoteAddr != b.remoteAddr)
-                return remoteAddr < b.remoteAddr;
-            else if (localAddr != b.localAddr)
-                return localAddr < b.localAddr;
-            else if (remotePort != b.remotePort)
-                return remotePort < b.remotePort;
-            else
-                return localPort < b.localPort;
-        }
-    };
+    typedef TCPConnTable::SockPair SockPair;
 
   protected:
     typedef std::map<AppConnKey, TCPConnection*> TcpAppConnMap;
-    typedef std::map<SockPair, TCPConnection*> TcpConnMap;
 
     TcpAppConnMap tcpAppConnMap;
-    TcpConnMap tcpConnMap;
+
+    // socket pair to connection mapping: connections with a remote socket,
+    // and listening connections (blank remote socket)
+    TCPConnTable tcpConnTable;
+    TCPConnTable tcpListenerTable;
 
     ushort lastEphemeralPort;
-    std::multiset<ushort> usedEphemeralPorts;
+    std::vector<int> ephemeralPortUseCount;   // number of connections using each port of the range
+    std::vector<uint32> ephemeralPortBitmap;  // one bit per port of the range, set if the port is in use
+
+    // connection timers, if timerTickResolution is set
+    TCPTimerWheel timerWheel;
 
   protected:
     /** Factory method; may be overriden for customizing TCP */
@@ -155,8 +146,15 @@ class INET_API TCP : public cSimpleModule
     virtual TCPConnection *findConnForApp(int appGateIndex, int connId);
     virtual void segmentArrivalWhileClosed(TCPSegment *tcpseg, IPvXAddress src, IPvXAddress dest);
     virtual void removeConnection(TCPConnection *conn);
+    virtual void processConnectionTimer(cMessage *timer);
     virtual void updateDisplayString();
 
+    // socket pair table management
+    virtual TCPConnTable& getConnTableFor(const SockPair& key);
+    virtual void removeSockPair(TCPConnection *conn);
+    virtual void markEphemeralPort(int port, bool used);
+    virtual int findUnusedEphemeralPortIndex(int start) const;
+
   public:
     static bool testing;    // switches between tcpEV and testingEV
     static bool logverbose; // if !testing, turns on more verbose logging
@@ -196,6 +194,23 @@ class INET_API TCP : public cSimpleModule
      */
     virtual ushort getEphemeralPort();
 
+    /**
+     * To be called from TCPConnection and TCPAlgorithm: schedules a connection
+     * timer. TCPTimers go to the timer wheel if a tick resolution is set,
+     * other timers (and all timers otherwise) are scheduled with scheduleAt().
+     */
+    virtual void scheduleTimer(cMessage *timer, simtime_t expiry);
+
+    /**
+     * Cancels a timer scheduled with scheduleTimer(), and returns it.
+     */
+    virtual cMessage *cancelTimer(cMessage *timer);
+
+    /**
+     * Returns true if the timer is scheduled, in the FES or on the timer wheel.
+     */
+    virtual bool isTimerScheduled(cMessage *timer) const;
+
     /**
      * To be called from TCPConnection: create a new send queue.
      */
@@ -0,0 +1,138 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "TCPConnTable.h"
+
+
+#define INITIAL_TABLE_SIZE  16
+
+// final mixing step of MurmurHash3, spreads all input bits over the result
+static inline uint32 mix(uint32 h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+uint32 TCPConnTable::hashAddress(const IPvXAddress& addr)
+{
+    const uint32 *w = addr.words();
+    if (!addr.isIPv6())
+        return w[0];  // the other words are not used by IPv4 addresses
+    return w[0] ^ mix(w[1] ^ mix(w[2] ^ mix(w[3])));
+}
+
+uint32 TCPConnTable::hash(const SockPair& key)
+{
+    uint32 h = mix(hashAddress(key.remoteAddr) ^ ((uint32)key.remotePort << 16));
+    h = mix(h ^ hashAddress(key.localAddr) ^ (uint32)key.localPort);
+    return h;
+}
+
+int TCPConnTable::findSlot(const SockPair& key) const
+{
+    if (numEntries == 0)
+        return -1;
+
+    int mask = slots.size() - 1;
+    for (int i = hash(key) & mask; slots[i].conn; i = (i + 1) & mask)
+        if (slots[i].key == key)
+            return i;
+    return -1;
+}
+
+bool TCPConnTable::insert(const SockPair& key, TCPConnection *conn)
+{
+    ASSERT(conn);
+
+    if (findSlot(key) >= 0)
+        return false;
+
+    // keep the load factor at or below 1/2
+    if (2 * (numEntries + 1) > (int)slots.size())
+        rehash(slots.empty() ? INITIAL_TABLE_SIZE : 2 * slots.size());
+
+    int mask = slots.size() - 1;
+    int i = hash(key) & mask;
+    while (slots[i].conn)
+        i = (i + 1) & mask;
+    slots[i].key = key;
+    slots[i].conn = conn;
+    numEntries++;
+    return true;
+}
+
+bool TCPConnTable::remove(const SockPair& key)
+{
+    int i = findSlot(key);
+    if (i < 0)
+        return false;
+
+    // backward shift deletion: move later entries of the probe sequence
+    // into the hole unless that would put them before their home slot
+    int mask = slots.size() - 1;
+    int j = i;
+    while (true)
+    {
+        j = (j + 1) & mask;
+        if (!slots[j].conn)
+            break;
+        int home = hash(slots[j].key) & mask;
+        // can slot j's entry move to the hole at i? (cyclic distance check)
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+    slots[i].conn = NULL;
+    numEntries--;
+    return true;
+}
+
+void TCPConnTable::clear()
+{
+    slots.clear();
+    numEntries = 0;
+}
+
+void TCPConnTable::getEntries(std::vector<std::pair<SockPair, TCPConnection *> >& entries) const
+{
+    for (std::vector<Slot>::const_iterator it = slots.begin(); it != slots.end(); ++it)
+        if (it->conn)
+            entries.push_back(std::make_pair(it->key, it->conn));
+}
+
+void TCPConnTable::rehash(int newSize)
+{
+    std::vector<Slot> oldSlots(newSize);
+    oldSlots.swap(slots);
+
+    int mask = newSize - 1;
+    for (std::vector<Slot>::iterator it = oldSlots.begin(); it != oldSlots.end(); ++it)
+    {
+        if (it->conn)
+        {
+            int i = hash(it->key) & mask;
+            while (slots[i].conn)
+                i = (i + 1) & mask;
+            slots[i] = *it;
+        }
+    }
+}
+
@@ -0,0 +1,108 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_TCPCONNTABLE_H
+#define __INET_TCPCONNTABLE_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "IPvXAddress.h"
+
+class TCPConnection;
+
+
+/**
+ * Hash table that maps socket pairs to TCP connections, used by TCP
+ * for demultiplexing incoming segments. Open addressing with linear
+ * probing; the table doubles when it becomes half full, and entries are
+ * removed with backward shifting, so there are no tombstones.
+ */
+class INET_API TCPConnTable
+{
+  public:
+    struct SockPair
+    {
+        IPvXAddress localAddr;
+        IPvXAddress remoteAddr;
+        int localPort;   // -1: unspec
+        int remotePort;  // -1: unspec
+
+        inline bool operator<(const SockPair& b) const
+        {
+            if (remoteAddr != b.remoteAddr)
+                return remoteAddr < b.remoteAddr;
+            else if (localAddr != b.localAddr)
+                return localAddr < b.localAddr;
+            else if (remotePort != b.remotePort)
+                return remotePort < b.remotePort;
+            else
+                return localPort < b.localPort;
+        }
+
+        inline bool operator==(const SockPair& b) const
+        {
+            return localPort == b.localPort && remotePort == b.remotePort &&
+                   localAddr == b.localAddr && remoteAddr == b.remoteAddr;
+        }
+    };
+
+  protected:
+    struct Slot
+    {
+        SockPair key;
+        TCPConnection *conn;  // NULL: empty slot
+
+        Slot() : conn(NULL) {}
+    };
+
+    std::vector<Slot> slots;  // size is zero or a power of two
+    int numEntries;
+
+  protected:
+    static uint32 hashAddress(const IPvXAddress& addr);
+    static uint32 hash(const SockPair& key);
+    int findSlot(const SockPair& key) const;
+    void rehash(int newSize);
+
+  public:
+    TCPConnTable() : numEntries(0) {}
+
+    /** Returns the connection registered under the given key, or NULL */
+    TCPConnection *find(const SockPair& key) const
+    {
+        int i = findSlot(key);
+        return i < 0 ? NULL : slots[i].conn;
+    }
+
+    /** Adds the connection; returns false if the key is already in use */
+    bool insert(const SockPair& key, TCPConnection *conn);
+
+    /** Removes the entry with the given key; returns false if there was none */
+    bool remove(const SockPair& key);
+
+    /** Removes all entries (connections are not deleted) */
+    void clear();
+
+    /** Appends all entries to the vector, in no particular order */
+    void getEntries(std::vector<std::pair<SockPair, TCPConnection *> >& entries) const;
+
+    /** Returns the number of entries */
+    int size() const {return numEntries;}
+};
+
+#endif
+
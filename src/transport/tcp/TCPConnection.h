@@ -519,11 +519,14 @@ class INET_API TCPConnection
 
     /** Utility: start a timer */
     void scheduleTimeout(cMessage *msg, simtime_t timeout)
-        {tcpMain->scheduleAt(simTime()+timeout, msg);}
+        {tcpMain->scheduleTimer(msg, simTime()+timeout);}
 
   protected:
     /** Utility: cancel a timer */
-    cMessage *cancelEvent(cMessage *msg) {return tcpMain->cancelEvent(msg);}
+    cMessage *cancelEvent(cMessage *msg) {return tcpMain->cancelTimer(msg);}
+
+    /** Utility: returns true if the timer is running */
+    bool isScheduled(cMessage *msg) const {return tcpMain->isTimerScheduled(msg);}
 
     /** Utility: send IP packet */
     static void sendToIP(TCPSegment *tcpseg, IPvXAddress src, IPvXAddress dest);
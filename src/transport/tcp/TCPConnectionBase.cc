@@ -204,10 +204,10 @@ TCPConnection::TCPConnection(TCP *_mod, int _appGateIndex, int _connId)
     tcpAlgorithm = NULL;
     state = NULL;
 
-    the2MSLTimer = new cMessage("2MSL");
-    connEstabTimer = new cMessage("CONN-ESTAB");
-    finWait2Timer = new cMessage("FIN-WAIT-2");
-    synRexmitTimer = new cMessage("SYN-REXMIT");
+    the2MSLTimer = new TCPTimer("2MSL");
+    connEstabTimer = new TCPTimer("CONN-ESTAB");
+    finWait2Timer = new TCPTimer("FIN-WAIT-2");
+    synRexmitTimer = new TCPTimer("SYN-REXMIT");
 
     the2MSLTimer->setContextPointer(this);
     connEstabTimer->setContextPointer(this);
@@ -859,7 +859,7 @@ TCPEventCode TCPConnection::processSegmentInListen(TCPSegment *tcpseg, IPvXAddre
         sendSynAck();
         startSynRexmitTimer();
 
-        if (!connEstabTimer->isScheduled())
+        if (!isScheduled(connEstabTimer))
             scheduleTimeout(connEstabTimer, TCP_TIMEOUT_CONN_ESTAB);
 
         //"
@@ -1376,7 +1376,7 @@ void TCPConnection::startSynRexmitTimer()
     state->syn_rexmit_count = 0;
     state->syn_rexmit_timeout = TCP_TIMEOUT_SYN_REXMIT;
 
-    if (synRexmitTimer->isScheduled())
+    if (isScheduled(synRexmitTimer))
         cancelEvent(synRexmitTimer);
 
     scheduleTimeout(synRexmitTimer, state->syn_rexmit_timeout);
@@ -238,15 +238,9 @@ bool TCPConnection::nextSeg(uint32 &seqNum)
 
     state->highRxt = rexmitQueue->getHighestRexmittedSeqNum();
     uint32 highestSackedSeqNum = rexmitQueue->getHighestSackedSeqNum();
-    uint32 shift = state->snd_mss;
-    bool sacked = false;           // required for rexmitQueue->checkSackBlock()
-    bool rexmitted = false;        // required for rexmitQueue->checkSackBlock()
 
     seqNum = 0;
 
-    if (state->ts_enabled)
-        shift -= TCP_OPTION_TS_SIZE;
-
     // RFC 3517, page 5: "(1) If there exists a smallest unSACKed sequence number 'S2' that
     // meets the following three criteria for determining loss, the
     // sequence range of one segment of up to SMSS octets starting
@@ -260,24 +254,16 @@ bool TCPConnection::nextSeg(uint32 &seqNum)
     // (1.c) IsLost (S2) returns true."
 
     // Note: state->highRxt == RFC.HighRxt + 1
-    for (uint32 s2 = state->highRxt;
-            seqLess(s2, state->snd_max) && seqLess(s2, highestSackedSeqNum);
-            s2 += shift
-        )
-    {
-        rexmitQueue->checkSackBlock(s2, shift, sacked, rexmitted);
+    // The smallest unSACKed sequence number above HighRxt is the only candidate
+    // for both rule (1) and rule (3): !isLost(x) --> !isLost(x + d)
+    uint32 s2 = rexmitQueue->getFirstUnsackedSeqNum(state->highRxt);
+    bool s2Found = seqLess(s2, state->snd_max) && seqLess(s2, highestSackedSeqNum); // 1.a and 1.b
 
-        if (!sacked)
-        {
-            if (isLost(s2))  // 1.a and 1.b are true, see above "for" statement
-            {
-                seqNum = s2;
-
-                return true;
-            }
+    if (s2Found && isLost(s2))
+    {
+        seqNum = s2;
 
-            break; // !isLost(x) --> !isLost(x + d)
-        }
+        return true;
     }
 
     // RFC 3517, page 5: "(2) If no sequence number 'S2' per rule (1) exists but there
@@ -326,22 +312,12 @@ bool TCPConnection::nextSeg(uint32 &seqNum)
     // relative to the entire recovery algorithm.  Therefore we leave
     // the decision of whether or not to use rule (3) to
     // implementors."
+    if (s2Found)
     {
-        for (uint32 s3 = state->highRxt;
-                seqLess(s3, state->snd_max) && seqLess(s3, highestSackedSeqNum);
-                s3 += shift
-            )
-        {
-            rexmitQueue->checkSackBlock(s3, shift, sacked, rexmitted);
+        // 1.a and 1.b are true, see above
+        seqNum = s2;
 
-            if (!sacked)
-            {
-                // 1.a and 1.b are true, see above "for" statement
-                seqNum = s3;
-
-                return true;
-            }
-        }
+        return true;
     }
 
     // RFC 3517, page 6: "(4) If the conditions for each of (1), (2), and (3) are not met,
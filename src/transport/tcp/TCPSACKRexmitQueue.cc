@@ -23,17 +23,20 @@
 TCPSACKRexmitQueue::TCPSACKRexmitQueue()
 {
     conn = NULL;
+    root = NULL;
+    seed = 1;
     begin = end = 0;
 }
 
 TCPSACKRexmitQueue::~TCPSACKRexmitQueue()
 {
-    while (!rexmitQueue.empty())
-        rexmitQueue.pop_front();
+    deleteSubtree(root);
 }
 
 void TCPSACKRexmitQueue::init(uint32 seqNum)
 {
+    deleteSubtree(root);
+    root = NULL;
     begin = seqNum;
     end = seqNum;
 }
@@ -52,118 +55,376 @@ void TCPSACKRexmitQueue::info() const
 
     uint j = 1;
 
-    for (RexmitQueue::const_iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
+    for (const Node *i = findNode(begin); i != NULL; i = findNode(i->region.endSeqNum))
     {
-        tcpEV << j << ". region: [" << i->beginSeqNum << ".." << i->endSeqNum
-              << ") \t sacked=" << i->sacked << "\t rexmitted=" << i->rexmitted
+        tcpEV << j << ". region: [" << i->region.beginSeqNum << ".." << i->region.endSeqNum
+              << ") \t sacked=" << i->region.sacked << "\t rexmitted=" << i->region.rexmitted
               << endl;
         j++;
     }
 }
 
-void TCPSACKRexmitQueue::discardUpTo(uint32 seqNum)
+bool TCPSACKRexmitQueue::hasFlag(const Region& region, Flag flag)
 {
-    ASSERT(seqLE(begin, seqNum) && seqLE(seqNum, end));
+    switch (flag)
+    {
+        case SACKED: return region.sacked;
+        case REXMITTED: return region.rexmitted;
+        default: return region.sacked || region.rexmitted;
+    }
+}
 
-    if (!rexmitQueue.empty())
+uint32 TCPSACKRexmitQueue::getCount(const Summary& summary, Flag flag)
+{
+    switch (flag)
     {
-        RexmitQueue::iterator i = rexmitQueue.begin();
+        case SACKED: return summary.numSacked;
+        case REXMITTED: return summary.numRexmitted;
+        default: return summary.numSackedOrRexmitted;
+    }
+}
 
-        while ((i != rexmitQueue.end()) && seqLE(i->endSeqNum, seqNum)) // discard/delete regions from rexmit queue, which have been acked
-            i = rexmitQueue.erase(i);
+TCPSACKRexmitQueue::Summary TCPSACKRexmitQueue::summarize(const Region& region)
+{
+    Summary summary;
+    summary.numRegions = 1;
+    summary.numSacked = region.sacked ? 1 : 0;
+    summary.numRexmitted = region.rexmitted ? 1 : 0;
+    summary.numSackedOrRexmitted = (region.sacked || region.rexmitted) ? 1 : 0;
+    summary.sackedBytes = region.sacked ? region.endSeqNum - region.beginSeqNum : 0;
+    summary.numSackRuns = summary.numSacked;
+    summary.firstSacked = summary.lastSacked = region.sacked;
+    return summary;
+}
 
-        if (i != rexmitQueue.end())
-        {
-            ASSERT(seqLE(i->beginSeqNum, seqNum) && seqLess(seqNum, i->endSeqNum));
-            i->beginSeqNum = seqNum;
-        }
-    }
+TCPSACKRexmitQueue::Summary TCPSACKRexmitQueue::concat(const Summary& a, const Summary& b)
+{
+    if (a.numRegions == 0)
+        return b;
+    if (b.numRegions == 0)
+        return a;
+
+    Summary summary;
+    summary.numRegions = a.numRegions + b.numRegions;
+    summary.numSacked = a.numSacked + b.numSacked;
+    summary.numRexmitted = a.numRexmitted + b.numRexmitted;
+    summary.numSackedOrRexmitted = a.numSackedOrRexmitted + b.numSackedOrRexmitted;
+    summary.sackedBytes = a.sackedBytes + b.sackedBytes;
+    summary.numSackRuns = a.numSackRuns + b.numSackRuns - ((a.lastSacked && b.firstSacked) ? 1 : 0);
+    summary.firstSacked = a.firstSacked;
+    summary.lastSacked = b.lastSacked;
+    return summary;
+}
 
-    begin = seqNum;
+void TCPSACKRexmitQueue::update(Node *node)
+{
+    Summary summary = summarize(node->region);
 
-    // TESTING queue:
-    ASSERT(checkQueue());
+    if (node->left)
+        summary = concat(node->left->summary, summary);
+
+    if (node->right)
+        summary = concat(summary, node->right->summary);
+
+    node->summary = summary;
 }
 
-void TCPSACKRexmitQueue::enqueueSentData(uint32 fromSeqNum, uint32 toSeqNum)
+void TCPSACKRexmitQueue::rotateLeft(Node *&node)
 {
-    ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
+    Node *right = node->right;
+    node->right = right->left;
+    right->left = node;
+    update(node);
+    update(right);
+    node = right;
+}
 
-    bool found = false;
-    Region region;
+void TCPSACKRexmitQueue::rotateRight(Node *&node)
+{
+    Node *left = node->left;
+    node->left = left->right;
+    left->right = node;
+    update(node);
+    update(left);
+    node = left;
+}
 
-    tcpEV << "rexmitQ: " << str() << " enqueueSentData [" << fromSeqNum << ".." << toSeqNum << ")\n";
+void TCPSACKRexmitQueue::deleteSubtree(Node *node)
+{
+    while (node)
+    {
+        deleteSubtree(node->left);
+        Node *right = node->right;
+        delete node;
+        node = right;
+    }
+}
 
-    ASSERT(seqLess(fromSeqNum, toSeqNum));
+TCPSACKRexmitQueue::Node *TCPSACKRexmitQueue::createNode(const Region& region)
+{
+    // xorshift; priorities only need to be independent of the insertion order
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    Node *node = new Node();
+    node->region = region;
+    node->priority = seed;
+    node->left = node->right = NULL;
+    update(node);
+    return node;
+}
 
-    if (rexmitQueue.empty() || (end == fromSeqNum))
+void TCPSACKRexmitQueue::insertNode(Node *&subtree, Node *node)
+{
+    if (subtree == NULL)
     {
-        region.beginSeqNum = fromSeqNum;
-        region.endSeqNum = toSeqNum;
-        region.sacked = false;
-        region.rexmitted = false;
-        rexmitQueue.push_back(region);
-        found = true;
-        fromSeqNum = toSeqNum;
+        subtree = node;
+    }
+    else if (offset(node->region.beginSeqNum) < offset(subtree->region.beginSeqNum))
+    {
+        insertNode(subtree->left, node);
+
+        if (subtree->left->priority > subtree->priority)
+            rotateRight(subtree);
+        else
+            update(subtree);
     }
     else
     {
-        RexmitQueue::iterator i = rexmitQueue.begin();
+        insertNode(subtree->right, node);
 
-        while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum))
-            i++;
+        if (subtree->right->priority > subtree->priority)
+            rotateLeft(subtree);
+        else
+            update(subtree);
+    }
+}
 
-        ASSERT(i != rexmitQueue.end());
-        ASSERT(seqLE(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum));
+void TCPSACKRexmitQueue::updatePath(Node *subtree, uint32 seqNum)
+{
+    // recompute the summaries on the path to the region containing seqNum
+    if (offset(seqNum) < offset(subtree->region.beginSeqNum))
+        updatePath(subtree->left, seqNum);
+    else if (offset(seqNum) >= offset(subtree->region.endSeqNum))
+        updatePath(subtree->right, seqNum);
 
-        if (i->beginSeqNum != fromSeqNum)
-        {
-            // chunk item
-            region = *i;
-            region.endSeqNum = fromSeqNum;
-            rexmitQueue.insert(i, region);
-            i->beginSeqNum = fromSeqNum;
-        }
+    update(subtree);
+}
+
+TCPSACKRexmitQueue::Node *TCPSACKRexmitQueue::discardNodes(Node *subtree, uint32 seqNum)
+{
+    // deletes the regions ending at or before seqNum
+    while (subtree && offset(subtree->region.endSeqNum) <= offset(seqNum))
+    {
+        deleteSubtree(subtree->left);
+        Node *right = subtree->right;
+        delete subtree;
+        subtree = right;
+    }
 
-        while (i != rexmitQueue.end() && seqLE(i->endSeqNum, toSeqNum))
+    if (subtree)
+    {
+        subtree->left = discardNodes(subtree->left, seqNum);
+        update(subtree);
+    }
+
+    return subtree;
+}
+
+void TCPSACKRexmitQueue::resetFlag(Node *subtree, Flag flag)
+{
+    if (subtree == NULL || getCount(subtree->summary, flag) == 0)
+        return;
+
+    resetFlag(subtree->left, flag);
+    resetFlag(subtree->right, flag);
+
+    if (flag == SACKED)
+        subtree->region.sacked = false;
+    else
+        subtree->region.rexmitted = false;
+
+    update(subtree);
+}
+
+TCPSACKRexmitQueue::Node *TCPSACKRexmitQueue::findNode(uint32 seqNum) const
+{
+    // region containing seqNum, or NULL
+    Node *node = root;
+
+    while (node)
+    {
+        if (offset(seqNum) < offset(node->region.beginSeqNum))
+            node = node->left;
+        else if (offset(seqNum) >= offset(node->region.endSeqNum))
+            node = node->right;
+        else
+            break;
+    }
+
+    return node;
+}
+
+TCPSACKRexmitQueue::Node *TCPSACKRexmitQueue::findFirstWithout(Node *subtree, uint32 seqNum, Flag flag) const
+{
+    // first region ending after seqNum without the given flag, or NULL
+    while (subtree && offset(subtree->region.endSeqNum) <= offset(seqNum))
+        subtree = subtree->right;
+
+    if (subtree == NULL || getCount(subtree->summary, flag) == subtree->summary.numRegions)
+        return NULL;
+
+    // all regions of the right subtree end after seqNum
+    Node *node = findFirstWithout(subtree->left, seqNum, flag);
+
+    if (node == NULL && !hasFlag(subtree->region, flag))
+        node = subtree;
+
+    if (node == NULL)
+        node = findFirstWithout(subtree->right, seqNum, flag);
+
+    return node;
+}
+
+TCPSACKRexmitQueue::Node *TCPSACKRexmitQueue::findLastWith(Flag flag) const
+{
+    Node *node = root;
+
+    if (node == NULL || getCount(node->summary, flag) == 0)
+        return NULL;
+
+    while (true)
+    {
+        if (node->right && getCount(node->right->summary, flag) > 0)
+            node = node->right;
+        else if (hasFlag(node->region, flag))
+            return node;
+        else
+            node = node->left;
+    }
+}
+
+TCPSACKRexmitQueue::Summary TCPSACKRexmitQueue::getSummaryFrom(const Node *subtree, uint32 seqNum) const
+{
+    // summary of the regions ending after seqNum
+    Summary summary;
+
+    while (subtree)
+    {
+        if (offset(subtree->region.endSeqNum) <= offset(seqNum))
         {
-            i->rexmitted = true;
-            fromSeqNum = i->endSeqNum;
-            found = true;
-            i++;
+            subtree = subtree->right;
         }
-
-        if (fromSeqNum != toSeqNum)
+        else
         {
-            bool beforeEnd = (i != rexmitQueue.end());
+            Summary rest = summarize(subtree->region);
 
-            ASSERT(i == rexmitQueue.end() || seqLess(i->beginSeqNum, toSeqNum));
+            if (subtree->right)
+                rest = concat(rest, subtree->right->summary);
 
-            region.beginSeqNum = fromSeqNum;
-            region.endSeqNum = toSeqNum;
-            region.sacked = beforeEnd ? i->sacked : false;
-            region.rexmitted = beforeEnd;
-            rexmitQueue.insert(i, region);
-            found = true;
-            fromSeqNum = toSeqNum;
-
-            if (beforeEnd)
-                i->beginSeqNum = toSeqNum;
+            summary = concat(rest, summary);
+            subtree = subtree->left;
         }
     }
 
-    ASSERT(fromSeqNum == toSeqNum);
+    return summary;
+}
+
+void TCPSACKRexmitQueue::splitAt(uint32 seqNum)
+{
+    Node *node = findNode(seqNum);
+
+    if (node == NULL || node->region.beginSeqNum == seqNum)
+        return;
+
+    Region region = node->region;
+    region.beginSeqNum = seqNum;
+    node->region.endSeqNum = seqNum;
+    updatePath(root, node->region.beginSeqNum);
+    insertNode(root, createNode(region));
+}
+
+void TCPSACKRexmitQueue::setFlag(uint32 fromSeqNum, uint32 toSeqNum, Flag flag)
+{
+    // each region is visited only if its bit has to be set
+    Node *node = findFirstWithout(root, fromSeqNum, flag);
 
-    if (!found)
+    while (node && seqLess(node->region.beginSeqNum, toSeqNum))
     {
-        EV << "Not found enqueueSentData(" << fromSeqNum << ", " << toSeqNum << ")\nThe Queue is:\n";
-        info();
+        ASSERT(seqLE(node->region.endSeqNum, toSeqNum));
+
+        if (flag == SACKED)
+            node->region.sacked = true;
+        else
+            node->region.rexmitted = true;
+
+        updatePath(root, node->region.beginSeqNum);
+        node = findFirstWithout(root, node->region.endSeqNum, flag);
     }
+}
+
+void TCPSACKRexmitQueue::discardUpTo(uint32 seqNum)
+{
+    ASSERT(seqLE(begin, seqNum) && seqLE(seqNum, end));
+
+    // discard/delete regions from rexmit queue, which have been acked
+    root = discardNodes(root, seqNum);
+
+    Node *node = findNode(seqNum);
+
+    if (node != NULL)
+        node->region.beginSeqNum = seqNum;
+
+    begin = seqNum;
+
+    if (node != NULL)
+        updatePath(root, seqNum);
+
+    // TESTING queue:
+    ASSERT(checkQueue());
+}
+
+void TCPSACKRexmitQueue::enqueueSentData(uint32 fromSeqNum, uint32 toSeqNum)
+{
+    ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
+
+    tcpEV << "rexmitQ: " << str() << " enqueueSentData [" << fromSeqNum << ".." << toSeqNum << ")\n";
+
+    ASSERT(seqLess(fromSeqNum, toSeqNum));
+
+    Region region;
+    region.sacked = false;
+    region.rexmitted = false;
 
-    ASSERT(found);
+    if (root == NULL || (end == fromSeqNum))
+    {
+        if (root == NULL)
+            begin = fromSeqNum;
+
+        region.beginSeqNum = fromSeqNum;
+        region.endSeqNum = toSeqNum;
+        insertNode(root, createNode(region));
+        end = toSeqNum;
+    }
+    else
+    {
+        // retransmission: the regions in [fromSeqNum, toSeqNum) become rexmitted,
+        // new data beyond the end of the queue is appended
+        uint32 rexmitEndSeqNum = seqMin(toSeqNum, end);
 
-    begin = rexmitQueue.front().beginSeqNum;
-    end = rexmitQueue.back().endSeqNum;
+        splitAt(fromSeqNum);
+        splitAt(rexmitEndSeqNum);
+        setFlag(fromSeqNum, rexmitEndSeqNum, REXMITTED);
+
+        if (rexmitEndSeqNum != toSeqNum)
+        {
+            region.beginSeqNum = end;
+            region.endSeqNum = toSeqNum;
+            insertNode(root, createNode(region));
+            end = toSeqNum;
+        }
+    }
 
     // TESTING queue:
     ASSERT(checkQueue());
@@ -171,18 +432,51 @@ void TCPSACKRexmitQueue::enqueueSentData(uint32 fromSeqNum, uint32 toSeqNum)
     // tcpEV << "rexmitQ: rexmitQLength=" << getQueueLength() << "\n";
 }
 
-bool TCPSACKRexmitQueue::checkQueue() const
+bool TCPSACKRexmitQueue::checkSubtree(const Node *node, uint32& seqNum) const
 {
-    uint32 b = begin;
+    // in-order walk: regions must be contiguous, priorities form a heap
+    // and the summaries must be up to date
+    if (node == NULL)
+        return true;
+
     bool f = true;
 
-    for (RexmitQueue::const_iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
+    f = f && (node->left == NULL || node->left->priority <= node->priority);
+    f = f && (node->right == NULL || node->right->priority <= node->priority);
+    f = f && checkSubtree(node->left, seqNum);
+    f = f && (seqNum == node->region.beginSeqNum);
+    f = f && seqLess(node->region.beginSeqNum, node->region.endSeqNum);
+    seqNum = node->region.endSeqNum;
+    f = f && checkSubtree(node->right, seqNum);
+
+    if (f)
     {
-        f = f && (b == i->beginSeqNum);
-        f = f && seqLess(i->beginSeqNum, i->endSeqNum);
-        b = i->endSeqNum;
+        Summary summary = summarize(node->region);
+
+        if (node->left)
+            summary = concat(node->left->summary, summary);
+
+        if (node->right)
+            summary = concat(summary, node->right->summary);
+
+        f = summary.numRegions == node->summary.numRegions
+                && summary.numSacked == node->summary.numSacked
+                && summary.numRexmitted == node->summary.numRexmitted
+                && summary.numSackedOrRexmitted == node->summary.numSackedOrRexmitted
+                && summary.sackedBytes == node->summary.sackedBytes
+                && summary.numSackRuns == node->summary.numSackRuns
+                && summary.firstSacked == node->summary.firstSacked
+                && summary.lastSacked == node->summary.lastSacked;
     }
 
+    return f;
+}
+
+bool TCPSACKRexmitQueue::checkQueue() const
+{
+    uint32 b = begin;
+    bool f = checkSubtree(root, b);
+
     f = f && (b == end);
 
     if (!f)
@@ -203,49 +497,13 @@ void TCPSACKRexmitQueue::setSackedBit(uint32 fromSeqNum, uint32 toSeqNum)
     ASSERT(seqLess(begin, toSeqNum) && seqLE(toSeqNum, end));
     ASSERT(seqLess(fromSeqNum, toSeqNum));
 
-    bool found = false;
-
-    if (!rexmitQueue.empty())
+    if (root != NULL)
     {
-        RexmitQueue::iterator i = rexmitQueue.begin();
-
-        while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum))
-            i++;
-
-        ASSERT(i != rexmitQueue.end() && seqLE(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum));
-
-        if (i->beginSeqNum != fromSeqNum)
-        {
-            Region region = *i;
-
-            region.endSeqNum = fromSeqNum;
-            rexmitQueue.insert(i, region);
-            i->beginSeqNum = fromSeqNum;
-        }
-
-        while (i != rexmitQueue.end() && seqLE(i->endSeqNum, toSeqNum))
-        {
-            if (seqGE(i->beginSeqNum, fromSeqNum)) // Search region in queue!
-            {
-                found = true;
-                i->sacked = true; // set sacked bit
-            }
-
-            i++;
-        }
-
-        if (i != rexmitQueue.end() && seqLess(i->beginSeqNum, toSeqNum) && seqLess(toSeqNum, i->endSeqNum))
-        {
-            Region region = *i;
-
-            region.endSeqNum = toSeqNum;
-            region.sacked = true;
-            rexmitQueue.insert(i, region);
-            i->beginSeqNum = toSeqNum;
-        }
+        splitAt(fromSeqNum);
+        splitAt(toSeqNum);
+        setFlag(fromSeqNum, toSeqNum, SACKED);
     }
-
-    if (!found)
+    else
         tcpEV << "FAILED to set sacked bit for region: [" << fromSeqNum << ".." << toSeqNum << "). Not found in retransmission queue.\n";
 
     ASSERT(checkQueue());
@@ -255,109 +513,84 @@ bool TCPSACKRexmitQueue::getSackedBit(uint32 seqNum) const
 {
     ASSERT(seqLE(begin, seqNum) && seqLE(seqNum, end));
 
-    RexmitQueue::const_iterator i = rexmitQueue.begin();
-
     if (end == seqNum)
         return false;
 
-    while (i != rexmitQueue.end() && seqLE(i->endSeqNum, seqNum))
-        i++;
+    const Node *node = findNode(seqNum);
 
-    ASSERT((i != rexmitQueue.end()) && seqLE(i->beginSeqNum, seqNum) && seqLess(seqNum, i->endSeqNum));
+    ASSERT(node != NULL);
 
-    return i->sacked;
+    return node->region.sacked;
 }
 
 uint32 TCPSACKRexmitQueue::getHighestSackedSeqNum() const
 {
-    for (RexmitQueue::const_reverse_iterator i = rexmitQueue.rbegin(); i != rexmitQueue.rend(); i++)
-    {
-        if (i->sacked)
-            return i->endSeqNum;
-    }
+    const Node *node = findLastWith(SACKED);
 
-    return begin;
+    return node ? node->region.endSeqNum : begin;
 }
 
 uint32 TCPSACKRexmitQueue::getHighestRexmittedSeqNum() const
 {
-    for (RexmitQueue::const_reverse_iterator i = rexmitQueue.rbegin(); i != rexmitQueue.rend(); i++)
-    {
-        if (i->rexmitted)
-            return i->endSeqNum;
-    }
+    const Node *node = findLastWith(REXMITTED);
 
-    return begin;
+    return node ? node->region.endSeqNum : begin;
 }
 
-uint32 TCPSACKRexmitQueue::checkRexmitQueueForSackedOrRexmittedSegments(uint32 fromSeqNum) const
+uint32 TCPSACKRexmitQueue::getFirstUnsackedSeqNum(uint32 fromSeqNum) const
 {
     ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
 
-    if (rexmitQueue.empty() || (end == fromSeqNum))
-        return 0;
+    const Node *node = findFirstWithout(root, fromSeqNum, SACKED);
 
-    RexmitQueue::const_iterator i = rexmitQueue.begin();
-    uint32 bytes = 0;
+    if (node == NULL)
+        return end;
 
-    while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum))
-        i++;
+    return seqMax(node->region.beginSeqNum, fromSeqNum);
+}
 
-    while (i != rexmitQueue.end() && ((i->sacked || i->rexmitted)))
-    {
-        ASSERT(seqLE(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum));
+uint32 TCPSACKRexmitQueue::checkRexmitQueueForSackedOrRexmittedSegments(uint32 fromSeqNum) const
+{
+    ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
 
-        bytes += (i->endSeqNum - fromSeqNum);
-        fromSeqNum = i->endSeqNum;
-        i++;
-    }
+    if (root == NULL || (end == fromSeqNum))
+        return 0;
 
-    return bytes;
+    // length of the contiguous sacked or rexmitted regions starting at fromSeqNum
+    const Node *node = findFirstWithout(root, fromSeqNum, SACKED_OR_REXMITTED);
+    uint32 seqNum = node ? node->region.beginSeqNum : end;
+
+    return seqLE(seqNum, fromSeqNum) ? 0 : seqNum - fromSeqNum;
 }
 
 void TCPSACKRexmitQueue::resetSackedBit()
 {
-    for (RexmitQueue::iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
-        i->sacked = false; // reset sacked bit
+    resetFlag(root, SACKED); // reset sacked bit
 }
 
 void TCPSACKRexmitQueue::resetRexmittedBit()
 {
-    for (RexmitQueue::iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
-        i->rexmitted = false; // reset rexmitted bit
+    resetFlag(root, REXMITTED); // reset rexmitted bit
 }
 
 uint32 TCPSACKRexmitQueue::getTotalAmountOfSackedBytes() const
 {
-    uint32 bytes = 0;
-
-    for (RexmitQueue::const_iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
-    {
-        if (i->sacked)
-            bytes += (i->endSeqNum - i->beginSeqNum);
-    }
-
-    return bytes;
+    return root ? root->summary.sackedBytes : 0;
 }
 
 uint32 TCPSACKRexmitQueue::getAmountOfSackedBytes(uint32 fromSeqNum) const
 {
     ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
 
-    uint32 bytes = 0;
-    RexmitQueue::const_reverse_iterator i = rexmitQueue.rbegin();
+    if (root == NULL || (fromSeqNum == end))
+        return 0;
 
-    for (; i != rexmitQueue.rend() && seqLE(fromSeqNum, i->beginSeqNum); i++)
-    {
-        if (i->sacked)
-            bytes += (i->endSeqNum - i->beginSeqNum);
-    }
+    uint32 bytes = getSummaryFrom(root, fromSeqNum).sackedBytes;
+    const Node *node = findNode(fromSeqNum);
 
-    if ( i != rexmitQueue.rend()
-            && seqLess(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum) && i->sacked)
-    {
-        bytes += (i->endSeqNum - fromSeqNum);
-    }
+    // only the part of the first region above fromSeqNum
+    if (node->region.sacked)
+        bytes -= (fromSeqNum - node->region.beginSeqNum);
 
     return bytes;
 }
@@ -366,43 +599,22 @@ uint32 TCPSACKRexmitQueue::getNumOfDiscontiguousSacks(uint32 fromSeqNum) const
 {
     ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
 
-    if (rexmitQueue.empty() || (fromSeqNum == end))
+    if (root == NULL || (fromSeqNum == end))
         return 0;
 
-    RexmitQueue::const_iterator i = rexmitQueue.begin();
-    uint32 counter = 0;
-
-    while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum)) // search for seqNum
-        i++;
-
     // search for discontiguous sacked regions
-    bool prevSacked = false;
-
-    while (i != rexmitQueue.end())
-    {
-        if (i->sacked && !prevSacked)
-            counter++;
-
-        prevSacked = i->sacked;
-        i++;
-    }
-
-    return counter;
+    return getSummaryFrom(root, fromSeqNum).numSackRuns;
 }
 
 void TCPSACKRexmitQueue::checkSackBlock(uint32 fromSeqNum, uint32 &length, bool &sacked, bool &rexmitted) const
 {
     ASSERT(seqLE(begin, fromSeqNum) && seqLess(fromSeqNum, end));
 
-    RexmitQueue::const_iterator i = rexmitQueue.begin();
-
-    while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum)) // search for seqNum
-        i++;
+    const Node *node = findNode(fromSeqNum); // search for seqNum
 
-    ASSERT(i != rexmitQueue.end());
-    ASSERT(seqLE(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum));
+    ASSERT(node != NULL);
 
-    length = (i->endSeqNum - fromSeqNum);
-    sacked = i->sacked;
-    rexmitted = i->rexmitted;
+    length = (node->region.endSeqNum - fromSeqNum);
+    sacked = node->region.sacked;
+    rexmitted = node->region.rexmitted;
 }
@@ -26,6 +26,14 @@
 
 /**
  * Retransmission data for SACK.
+ *
+ * The queue is a sequence of contiguous regions covering [begin, end).
+ * The regions are kept in a treap ordered by sequence number, and each
+ * node also summarizes the regions of its subtree (sacked bytes, sacked
+ * and rexmitted region counts, runs of adjacent sacked regions). Lookups,
+ * the "highest sacked/rexmitted" and "next hole" queries and the sacked
+ * amounts above a sequence number are O(log n) in the number of regions,
+ * as needed for the scoreboard of RFC 3517 with large windows.
  */
 class INET_API TCPSACKRexmitQueue
 {
@@ -40,9 +48,39 @@ class INET_API TCPSACKRexmitQueue
         bool rexmitted;   // indicates whether region has already been retransmitted by data sender
     };
 
-    typedef std::list<Region> RexmitQueue;
-    RexmitQueue rexmitQueue; // rexmitQueue is ordered by seqnum, and doesn't have overlapped Regions
+  protected:
+    // summary of the regions of a subtree, in sequence number order
+    struct Summary
+    {
+        uint32 numRegions;
+        uint32 numSacked;             // regions with the sacked bit
+        uint32 numRexmitted;          // regions with the rexmitted bit
+        uint32 numSackedOrRexmitted;  // regions with either bit
+        uint32 sackedBytes;
+        uint32 numSackRuns;           // maximal runs of adjacent sacked regions
+        bool firstSacked;             // first region is sacked
+        bool lastSacked;              // last region is sacked
+
+        Summary() : numRegions(0), numSacked(0), numRexmitted(0), numSackedOrRexmitted(0),
+                    sackedBytes(0), numSackRuns(0), firstSacked(false), lastSacked(false) {}
+    };
 
+    struct Node
+    {
+        Region region;
+        uint32 priority;  // treap priority, a node has higher priority than its children
+        Node *left;
+        Node *right;
+        Summary summary;  // of the subtree rooted here
+    };
+
+    // region flags searched by findFirstWithout() and findLastWith()
+    enum Flag {SACKED, REXMITTED, SACKED_OR_REXMITTED};
+
+    Node *root;  // regions are ordered by seqnum, and don't overlap
+    uint32 seed; // for the treap priorities; the simulation RNGs are not used
+
+  public:
     uint32 begin;  // 1st sequence number stored
     uint32 end;    // last sequence number stored + 1
 
@@ -120,7 +158,7 @@ class INET_API TCPSACKRexmitQueue
     /**
      * Returns the number of blocks currently buffered in queue.
      */
-    virtual uint32 getQueueLength() const { return rexmitQueue.size(); }
+    virtual uint32 getQueueLength() const { return root ? root->summary.numRegions : 0; }
 
     /**
      * Returns the highest sequence number sacked by data receiver.
@@ -132,6 +170,12 @@ class INET_API TCPSACKRexmitQueue
      */
     virtual uint32 getHighestRexmittedSeqNum() const;
 
+    /**
+     * Returns the first sequence number at or above seqNum that has not been sacked
+     * (i.e. the beginning of the next hole), or the end of the queue if there is none.
+     */
+    virtual uint32 getFirstUnsackedSeqNum(uint32 seqNum) const;
+
     /**
      * Checks rexmit queue for sacked of rexmitted segments and returns a certain offset
      * (contiguous sacked or rexmitted region) to forward snd->nxt.
@@ -177,6 +221,38 @@ class INET_API TCPSACKRexmitQueue
      * Returns if TCPSACKRexmitQueue is valid or not.
      */
     bool checkQueue() const;
+    bool checkSubtree(const Node *node, uint32& seqNum) const;
+
+    uint32 offset(uint32 seqNum) const { return seqNum - begin; }
+    static bool hasFlag(const Region& region, Flag flag);
+    static uint32 getCount(const Summary& summary, Flag flag);
+    static Summary summarize(const Region& region);
+    static Summary concat(const Summary& a, const Summary& b);
+    static void update(Node *node);
+    static void rotateLeft(Node *&node);
+    static void rotateRight(Node *&node);
+    static void deleteSubtree(Node *node);
+
+    Node *createNode(const Region& region);
+    void insertNode(Node *&subtree, Node *node);
+    void updatePath(Node *subtree, uint32 seqNum);
+    Node *discardNodes(Node *subtree, uint32 seqNum);
+    void resetFlag(Node *subtree, Flag flag);
+    Node *findNode(uint32 seqNum) const;
+    Node *findFirstWithout(Node *subtree, uint32 seqNum, Flag flag) const;
+    Node *findLastWith(Flag flag) const;
+    Summary getSummaryFrom(const Node *subtree, uint32 seqNum) const;
+
+    /*
+     * Splits the region containing seqNum so that a region begins at seqNum.
+     */
+    void splitAt(uint32 seqNum);
+
+    /*
+     * Sets the sacked or rexmitted bit of the regions in [fromSeqNum, toSeqNum),
+     * which must begin and end at region boundaries.
+     */
+    void setFlag(uint32 fromSeqNum, uint32 toSeqNum, Flag flag);
 };
 
 #endif
@@ -0,0 +1,295 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+
+#include "TCPTimerWheel.h"
+
+
+TCPTimer::~TCPTimer()
+{
+    if (wheel)
+        wheel->cancel(this);
+}
+
+bool TCPTimerWheel::expiresBefore(const TCPTimer *a, const TCPTimer *b)
+{
+    if (a->expiry != b->expiry)
+        return a->expiry < b->expiry;
+    return a->insertionOrder < b->insertionOrder;
+}
+
+TCPTimerWheel::TCPTimerWheel()
+{
+    module = NULL;
+    tickMsg = NULL;
+    resolution = 0;
+    numSlots = 0;
+    baseTick = 0;
+    scheduledTick = 0;
+    expiring = false;
+    insertionCount = 0;
+    numTimers = 0;
+}
+
+TCPTimerWheel::~TCPTimerWheel()
+{
+    // timers are owned by the connections; just detach the remaining ones
+    for (int i = 0; i < numSlots; i++)
+        for (TCPTimer *timer = heads[i]; timer; timer = timer->next)
+            timer->wheel = NULL;
+
+    for (OverflowSet::iterator it = overflow.begin(); it != overflow.end(); ++it)
+        it->second->wheel = NULL;
+
+    if (tickMsg)
+        module->cancelAndDelete(tickMsg);
+}
+
+void TCPTimerWheel::initialize(cSimpleModule *module, simtime_t resolution, int numSlots)
+{
+    this->module = module;
+    this->resolution = resolution.raw();
+
+    if (this->resolution < 0)
+        throw cRuntimeError("TCPTimerWheel: negative tick resolution");
+
+    if (this->resolution == 0)
+        return;
+
+    if (numSlots < 64 || (numSlots & (numSlots - 1)) != 0)
+        throw cRuntimeError("TCPTimerWheel: the number of slots must be a power of two, at least 64 (%d given)", numSlots);
+
+    this->numSlots = numSlots;
+    heads.assign(numSlots, (TCPTimer *)NULL);
+    tails.assign(numSlots, (TCPTimer *)NULL);
+    occupied.assign(numSlots / 64, 0);
+    baseTick = getTick(simTime());
+    tickMsg = new cMessage("timerWheel");
+}
+
+int64 TCPTimerWheel::getTick(simtime_t t) const
+{
+    return (t.raw() + resolution - 1) / resolution;
+}
+
+simtime_t TCPTimerWheel::getTickTime(int64 tick) const
+{
+    simtime_t t;
+    t.setRaw(tick * resolution);
+    return t;
+}
+
+void TCPTimerWheel::addToSlot(TCPTimer *timer)
+{
+    int slot = timer->tick & (numSlots - 1);
+
+    // a slot only holds timers of one tick
+    ASSERT(heads[slot] == NULL || heads[slot]->tick == timer->tick);
+
+    timer->prev = tails[slot];
+    timer->next = NULL;
+
+    if (tails[slot])
+        tails[slot]->next = timer;
+    else
+        heads[slot] = timer;
+
+    tails[slot] = timer;
+    occupied[slot / 64] |= (uint64)1 << (slot % 64);
+}
+
+void TCPTimerWheel::removeFromSlot(TCPTimer *timer)
+{
+    int slot = timer->tick & (numSlots - 1);
+
+    if (timer->prev)
+        timer->prev->next = timer->next;
+    else
+        heads[slot] = timer->next;
+
+    if (timer->next)
+        timer->next->prev = timer->prev;
+    else
+        tails[slot] = timer->prev;
+
+    timer->prev = timer->next = NULL;
+
+    if (heads[slot] == NULL)
+        occupied[slot / 64] &= ~((uint64)1 << (slot % 64));
+}
+
+void TCPTimerWheel::advance(int64 tick)
+{
+    // the slots of the ticks passed are empty, they can be reused for later ticks
+    if (tick <= baseTick)
+        return;
+
+    baseTick = tick;
+
+    while (!overflow.empty() && overflow.begin()->first < baseTick + numSlots)
+    {
+        TCPTimer *timer = overflow.begin()->second;
+        overflow.erase(overflow.begin());
+        timer->inOverflow = false;
+        addToSlot(timer);
+    }
+}
+
+void TCPTimerWheel::sortSlot(int slot)
+{
+    if (heads[slot] == NULL || heads[slot] == tails[slot])
+        return;
+
+    std::vector<TCPTimer *> timers;
+    for (TCPTimer *timer = heads[slot]; timer; timer = timer->next)
+        timers.push_back(timer);
+
+    std::sort(timers.begin(), timers.end(), expiresBefore);
+
+    heads[slot] = tails[slot] = NULL;
+    for (unsigned int i = 0; i < timers.size(); i++)
+        addToSlot(timers[i]);
+}
+
+void TCPTimerWheel::scheduleTickMsg()
+{
+    ASSERT(!tickMsg->isScheduled());
+
+    int64 next = -1;
+
+    // first occupied slot from baseTick on
+    if (numTimers > (int)overflow.size())
+    {
+        int start = baseTick & (numSlots - 1);
+
+        for (int d = 0; d < numSlots; )
+        {
+            int i = (start + d) & (numSlots - 1);
+            uint64 word = occupied[i / 64] >> (i % 64);
+
+            if (word != 0)
+            {
+                int bit = 0;
+                while ((word & 0xffffffffu) == 0)
+                    word >>= 32, bit += 32;
+                while ((word & 1) == 0)
+                    word >>= 1, bit++;
+                next = baseTick + d + bit;
+                break;
+            }
+
+            d += 64 - i % 64;
+        }
+
+        ASSERT(next >= 0);
+    }
+    else if (!overflow.empty())
+    {
+        next = overflow.begin()->first;
+    }
+
+    if (next >= 0)
+    {
+        scheduledTick = next;
+        module->scheduleAt(getTickTime(next), tickMsg);
+    }
+}
+
+void TCPTimerWheel::schedule(TCPTimer *timer, simtime_t expiry)
+{
+    if (timer->wheel != NULL || timer->isScheduled())
+        throw cRuntimeError("TCPTimerWheel: timer (%s)%s is already scheduled", timer->getClassName(), timer->getFullName());
+
+    if (expiry < simTime())
+        throw cRuntimeError("TCPTimerWheel: cannot schedule timer (%s)%s to the past", timer->getClassName(), timer->getFullName());
+
+    if (!expiring)
+        advance(getTick(simTime()));
+
+    timer->wheel = this;
+    timer->expiry = expiry;
+    timer->tick = getTick(expiry);
+    timer->insertionOrder = insertionCount++;
+    numTimers++;
+
+    if (timer->tick < baseTick + numSlots)
+    {
+        addToSlot(timer);
+    }
+    else
+    {
+        timer->inOverflow = true;
+        timer->overflowPos = overflow.insert(std::make_pair(timer->tick, timer));
+    }
+
+    // while expiring, tickMsg is scheduled after the last expired timer
+    if (!expiring && (!tickMsg->isScheduled() || timer->tick < scheduledTick))
+    {
+        module->cancelEvent(tickMsg);
+        scheduledTick = timer->tick;
+        module->scheduleAt(getTickTime(scheduledTick), tickMsg);
+    }
+}
+
+TCPTimer *TCPTimerWheel::cancel(TCPTimer *timer)
+{
+    if (timer->wheel != this)
+        return timer;
+
+    // tickMsg is left alone: if nothing expires at its tick, it just gets rescheduled
+    if (timer->inOverflow)
+    {
+        overflow.erase(timer->overflowPos);
+        timer->inOverflow = false;
+    }
+    else
+    {
+        removeFromSlot(timer);
+    }
+
+    timer->wheel = NULL;
+    numTimers--;
+    return timer;
+}
+
+TCPTimer *TCPTimerWheel::getNextExpired()
+{
+    if (!expiring)
+    {
+        ASSERT(simTime() == getTickTime(scheduledTick));
+
+        expiring = true;
+        advance(scheduledTick);
+        sortSlot(baseTick & (numSlots - 1));
+    }
+
+    // timers scheduled to this tick while expiring are appended in order
+    TCPTimer *timer = heads[baseTick & (numSlots - 1)];
+
+    if (timer != NULL)
+    {
+        ASSERT(timer->tick == baseTick);
+
+        removeFromSlot(timer);
+        timer->wheel = NULL;
+        numTimers--;
+        return timer;
+    }
+
+    expiring = false;
+    scheduleTickMsg();
+    return NULL;
+}
@@ -0,0 +1,136 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_TCPTIMERWHEEL_H
+#define __INET_TCPTIMERWHEEL_H
+
+#include <map>
+#include <vector>
+
+#include "INETDefs.h"
+
+class TCPTimerWheel;
+
+/**
+ * A timer of a TCP connection. It is an ordinary self-message, except that
+ * the TCP module keeps it on its TCPTimerWheel instead of the future event
+ * set when a timer tick resolution is configured.
+ */
+class INET_API TCPTimer : public cMessage
+{
+    friend class TCPTimerWheel;
+
+  protected:
+    typedef std::multimap<int64, TCPTimer *> OverflowSet;
+
+    TCPTimerWheel *wheel;    // the wheel holding the timer, or NULL
+    TCPTimer *prev;          // in the list of the slot
+    TCPTimer *next;
+    bool inOverflow;         // in the overflow set instead of a slot
+    OverflowSet::iterator overflowPos;
+    int64 tick;              // expiry time rounded up to the tick resolution
+    simtime_t expiry;        // requested expiry time
+    uint64 insertionOrder;   // orders timers with equal expiry times, as in the FES
+
+  public:
+    explicit TCPTimer(const char *name = NULL) : cMessage(name),
+        wheel(NULL), prev(NULL), next(NULL), inOverflow(false), tick(0), insertionOrder(0) {}
+    TCPTimer(const TCPTimer& other) : cMessage(other),
+        wheel(NULL), prev(NULL), next(NULL), inOverflow(false), tick(0), insertionOrder(0) {}
+    virtual ~TCPTimer();
+    virtual TCPTimer *dup() const {return new TCPTimer(*this);}
+
+    /** Returns true if the timer is scheduled on a timer wheel */
+    bool isOnWheel() const {return wheel != NULL;}
+
+    /** Returns the requested expiry time, valid while the timer is on a wheel */
+    simtime_t getExpiryTime() const {return expiry;}
+};
+
+/**
+ * Hashed timing wheel for the connection timers of a TCP module.
+ *
+ * Expiry times are rounded up to a multiple of the tick resolution.
+ * Timers expiring within numSlots ticks are kept in the slot of their tick,
+ * in a doubly linked list, so scheduling and cancelling are O(1); later
+ * timers wait in an ordered overflow set until the wheel reaches them.
+ * Only one self-message is in the future event set, for the earliest
+ * occupied tick. Timers of the same tick expire in the order of their
+ * requested expiry times, then in the order they were scheduled, so
+ * the result is deterministic for a given tick resolution.
+ */
+class INET_API TCPTimerWheel
+{
+  protected:
+    typedef TCPTimer::OverflowSet OverflowSet;
+
+    cSimpleModule *module;   // schedules tickMsg
+    cMessage *tickMsg;       // the only FES event of the wheel
+    int64 resolution;        // tick length, in raw simtime units
+    int numSlots;            // power of two
+    std::vector<TCPTimer *> heads;   // list of each slot
+    std::vector<TCPTimer *> tails;
+    std::vector<uint64> occupied;    // one bit per slot, set if the list is not empty
+    OverflowSet overflow;    // timers with tick >= baseTick + numSlots
+    int64 baseTick;          // slots hold the ticks [baseTick, baseTick + numSlots)
+    int64 scheduledTick;     // tick of tickMsg, if scheduled
+    bool expiring;           // between the arrival of tickMsg and the last getNextExpired() call
+    uint64 insertionCount;
+    int numTimers;
+
+  protected:
+    static bool expiresBefore(const TCPTimer *a, const TCPTimer *b);
+    int64 getTick(simtime_t t) const;
+    simtime_t getTickTime(int64 tick) const;
+    void addToSlot(TCPTimer *timer);
+    void removeFromSlot(TCPTimer *timer);
+    void advance(int64 tick);
+    void sortSlot(int slot);
+    void scheduleTickMsg();
+
+  public:
+    TCPTimerWheel();
+    virtual ~TCPTimerWheel();
+
+    /**
+     * Enables the wheel. A zero resolution leaves it disabled, and then
+     * TCPTimers are scheduled directly in the future event set.
+     */
+    virtual void initialize(cSimpleModule *module, simtime_t resolution, int numSlots);
+
+    /** Returns true if a tick resolution has been set */
+    bool isEnabled() const {return resolution > 0;}
+
+    /** Returns true for the self-message of the wheel */
+    bool isTickMessage(cMessage *msg) const {return msg == tickMsg;}
+
+    /** Returns the number of timers on the wheel */
+    int getNumTimers() const {return numTimers;}
+
+    /** Schedules the timer to expire at the first tick at or after expiry */
+    virtual void schedule(TCPTimer *timer, simtime_t expiry);
+
+    /** Removes the timer from the wheel if it is there, and returns it */
+    virtual TCPTimer *cancel(TCPTimer *timer);
+
+    /**
+     * To be called repeatedly after the self-message of the wheel arrived:
+     * removes and returns the next expired timer, or returns NULL and
+     * schedules the self-message for the next occupied tick.
+     */
+    virtual TCPTimer *getNextExpired();
+};
+
+#endif
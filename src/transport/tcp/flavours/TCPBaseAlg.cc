@@ -123,10 +123,10 @@ void TCPBaseAlg::initialize()
 {
     TCPAlgorithm::initialize();
 
-    rexmitTimer = new cMessage("REXMIT");
-    persistTimer = new cMessage("PERSIST");
-    delayedAckTimer = new cMessage("DELAYEDACK");
-    keepAliveTimer = new cMessage("KEEPALIVE");
+    rexmitTimer = new TCPTimer("REXMIT");
+    persistTimer = new TCPTimer("PERSIST");
+    delayedAckTimer = new TCPTimer("DELAYEDACK");
+    keepAliveTimer = new TCPTimer("KEEPALIVE");
 
     rexmitTimer->setContextPointer(conn);
     persistTimer->setContextPointer(conn);
@@ -491,7 +491,7 @@ void TCPBaseAlg::receivedOutOfOrderSegment()
 void TCPBaseAlg::receiveSeqChanged()
 {
     // If we send a data segment already (with the updated seqNo) there is no need to send an additional ACK
-    if (state->full_sized_segment_counter == 0 && !state->ack_now && state->last_ack_sent == state->rcv_nxt && !delayedAckTimer->isScheduled()) // ackSent?
+    if (state->full_sized_segment_counter == 0 && !state->ack_now && state->last_ack_sent == state->rcv_nxt && !isScheduled(delayedAckTimer)) // ackSent?
     {
         // tcpEV << "ACK has already been sent (possibly piggybacked on data)\n";
     }
@@ -527,7 +527,7 @@ void TCPBaseAlg::receiveSeqChanged()
             else
             {
                 tcpEV << "rcv_nxt changed to " << state->rcv_nxt << ", (delayed ACK enabled and full_sized_segment_counter=" << state->full_sized_segment_counter << ") scheduling ACK\n";
-                if (!delayedAckTimer->isScheduled()) // schedule delayed ACK timer if not already running
+                if (!isScheduled(delayedAckTimer)) // schedule delayed ACK timer if not already running
                     conn->scheduleTimeout(delayedAckTimer, DELAYED_ACK_TIMEOUT);
             }
         }
@@ -559,7 +559,7 @@ void TCPBaseAlg::receivedDataAck(uint32 firstSeqAcked)
     //
     if (state->snd_una == state->snd_max)
     {
-        if (rexmitTimer->isScheduled())
+        if (isScheduled(rexmitTimer))
         {
             tcpEV << "ACK acks all outstanding segments, cancel REXMIT timer\n";
             cancelEvent(rexmitTimer);
@@ -587,9 +587,9 @@ void TCPBaseAlg::receivedDataAck(uint32 firstSeqAcked)
     //
     if (state->snd_wnd == 0) // received zero-sized window?
     {
-        if (rexmitTimer->isScheduled())
+        if (isScheduled(rexmitTimer))
         {
-            if (persistTimer->isScheduled())
+            if (isScheduled(persistTimer))
             {
                 tcpEV << "Received zero-sized window and REXMIT timer is running therefore PERSIST timer is canceled.\n";
                 cancelEvent(persistTimer);
@@ -600,7 +600,7 @@ void TCPBaseAlg::receivedDataAck(uint32 firstSeqAcked)
         }
         else
         {
-            if (!persistTimer->isScheduled())
+            if (!isScheduled(persistTimer))
             {
                 tcpEV << "Received zero-sized window therefore PERSIST timer is started.\n";
                 conn->scheduleTimeout(persistTimer, state->persist_timeout);
@@ -611,7 +611,7 @@ void TCPBaseAlg::receivedDataAck(uint32 firstSeqAcked)
     }
     else // received non zero-sized window?
     {
-        if (persistTimer->isScheduled())
+        if (isScheduled(persistTimer))
         {
             tcpEV << "Received non zero-sized window therefore PERSIST timer is canceled.\n";
             cancelEvent(persistTimer);
@@ -662,14 +662,14 @@ void TCPBaseAlg::ackSent()
     state->ack_now = false; // reset flag
     state->last_ack_sent = state->rcv_nxt; // update last_ack_sent, needed for TS option
     // if delayed ACK timer is running, cancel it
-    if (delayedAckTimer->isScheduled())
+    if (isScheduled(delayedAckTimer))
         cancelEvent(delayedAckTimer);
 }
 
 void TCPBaseAlg::dataSent(uint32 fromseq)
 {
     // if retransmission timer not running, schedule it
-    if (!rexmitTimer->isScheduled())
+    if (!isScheduled(rexmitTimer))
     {
         tcpEV << "Starting REXMIT timer\n";
         startRexmitTimer();
@@ -692,7 +692,7 @@ void TCPBaseAlg::dataSent(uint32 fromseq)
 
 void TCPBaseAlg::restartRexmitTimer()
 {
-    if (rexmitTimer->isScheduled())
+    if (isScheduled(rexmitTimer))
         cancelEvent(rexmitTimer);
 
     startRexmitTimer();
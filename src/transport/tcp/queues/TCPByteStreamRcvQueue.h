@@ -43,7 +43,7 @@ class INET_API TCPByteStreamRcvQueue : public TCPVirtualDataRcvQueue
 
       public:
         Region(uint32 _begin, uint32 _end) : TCPVirtualDataRcvQueue::Region(_begin, _end) {};
-        Region(uint32 _begin, uint32 _end, ByteArray _data)
+        Region(uint32 _begin, uint32 _end, const ByteArray& _data)
                 : TCPVirtualDataRcvQueue::Region(_begin, _end), data(_data) {};
 
         virtual ~Region() {};
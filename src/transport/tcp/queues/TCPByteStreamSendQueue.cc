@@ -76,12 +76,10 @@ TCPSegment *TCPByteStreamSendQueue::createSegmentWithBytes(uint32 fromSeq, ulong
     tcpseg->setSequenceNo(fromSeq);
     tcpseg->setPayloadLength(numBytes);
 
-    // add payload messages whose endSequenceNo is between fromSeq and fromSeq+numBytes
+    // the segment shares the bytes with the queue
     unsigned int fromOffs = (uint32)(fromSeq - begin);
-    char *buffer = new char[numBytes];
-    unsigned int bytes = dataBuffer.getBytesToBuffer(buffer, numBytes, fromOffs);
+    unsigned int bytes = dataBuffer.getBytesToByteArray(tcpseg->getByteArray(), numBytes, fromOffs);
     ASSERT(bytes == numBytes);
-    tcpseg->getByteArray().assignBuffer(buffer, bytes);
 
     // give segment a name
     char msgname[80];
@@ -151,10 +151,8 @@ cPacket* TcpLwipByteStreamReceiveQueue::extractBytesUpTo()
         dataMsg = new ByteArrayMessage("DATA");
         dataMsg->setKind(TCP_I_DATA);
         unsigned int extractBytes = bytesInQueue;
-        char *data = new char[extractBytes];
-        unsigned int extractedBytes = byteArrayBufferM.popBytesToBuffer(data, extractBytes);
+        unsigned int extractedBytes = byteArrayBufferM.popBytesToByteArray(dataMsg->getByteArray(), extractBytes);
         dataMsg->setByteLength(extractedBytes);
-        dataMsg->getByteArray().assignBuffer(data, extractedBytes);
     }
 
     return dataMsg;
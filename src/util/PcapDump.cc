@@ -21,6 +21,7 @@
 
 
 #include <errno.h>
+#include <algorithm>
 
 #include "PcapDump.h"
 
@@ -35,11 +36,43 @@
 #include "IPv4Serializer.h"
 #endif
 
+#ifdef WITH_IPv6
+#include "IPv6Datagram.h"
+#include "IPv6Serializer.h"
+#endif
+
+#ifdef WITH_ETHERNET
+#include "EtherFrame_m.h"
+#endif
+
+#ifdef WITH_IEEE80211
+#include "Ieee80211Frame_m.h"
+#endif
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 
 #define MAXBUFLENGTH 65536
 
 #define PCAP_MAGIC           0xa1b2c3d4
 
+#define PCAPNG_SECTION_HEADER_BLOCK     0x0a0d0d0a
+#define PCAPNG_INTERFACE_BLOCK          0x00000001
+#define PCAPNG_ENHANCED_PACKET_BLOCK    0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC         0x1a2b3c4d
+#define PCAPNG_OPT_ENDOFOPT             0
+#define PCAPNG_OPT_IF_NAME              2
+#define PCAPNG_OPT_IF_TSRESOL           9
+
+// address family values in LINKTYPE_NULL headers
+#define NULL_AF_INET         2
+#define NULL_AF_INET6        24  // BSD value; readers also accept the FreeBSD and Darwin ones
+
+#define ETHERTYPE_IP         0x0800
+#define ETHERTYPE_IPV6       0x86dd
+
 /* "libpcap" file header (minus magic number). */
 struct pcap_hdr {
      uint32 magic;      /* magic */
@@ -59,24 +92,70 @@ struct pcaprec_hdr {
      uint32 orig_len;   /* actual length of packet */
 };
 
+/* pcapng section header block, without options */
+struct pcapng_shb {
+     uint32 block_type;
+     uint32 block_total_length;
+     uint32 byte_order_magic;
+     uint16 major_version;
+     uint16 minor_version;
+     uint32 section_length_low;  /* -1: not specified */
+     uint32 section_length_high;
+     uint32 block_total_length2;
+};
+
+/* pcapng enhanced packet block, up to the packet data */
+struct pcapng_epb {
+     uint32 block_type;
+     uint32 block_total_length;
+     uint32 interface_id;
+     uint32 timestamp_high;  /* in units of if_tsresol */
+     uint32 timestamp_low;
+     uint32 captured_len;
+     uint32 packet_len;
+};
+
+static inline unsigned int pad4(unsigned int length)
+{
+    return (length + 3) & ~3U;
+}
+
+static void putMACAddress(unsigned char *buf, const MACAddress& address)
+{
+    address.getAddressBytes(buf);
+}
 
 
 PcapDump::PcapDump()
 {
      dumpfile = NULL;
+     snaplen = 0;
+     network = LINKTYPE_NULL;
+     pcapng = false;
+     numInterfaces = 0;
+     bufferUsed = 0;
+     serializeBufDirty = 0;
+     writerThread = NULL;
 }
 
 PcapDump::~PcapDump()
 {
-    closePcap();
+    try
+    {
+        closePcap();
+    }
+    catch (std::exception& e)
+    {
+        // write errors cannot be reported from here
+    }
 }
 
-void PcapDump::openPcap(const char* filename, unsigned int snaplen_par)
+void PcapDump::openPcap(const char* filename, unsigned int snaplen_par, uint32 network_par, bool pcapng_par, unsigned int bufferSize, bool backgroundWriter)
 {
-    struct pcap_hdr fh;
-
     if (!filename || !filename[0])
         throw cRuntimeError("Cannot open pcap file: file name is empty");
+    if (backgroundWriter && bufferSize == 0)
+        throw cRuntimeError("Cannot open pcap file [%s]: the background writer needs a write buffer", filename);
 
     dumpfile = fopen(filename, "wb");
 
@@ -84,50 +163,442 @@ void PcapDump::openPcap(const char* filename, unsigned int snaplen_par)
         throw cRuntimeError("Cannot open pcap file [%s] for writing: %s", filename, strerror(errno));
 
     snaplen = snaplen_par;
+    network = network_par;
+    pcapng = pcapng_par;
+    numInterfaces = 0;
+    buffer.resize(bufferSize);
+    bufferUsed = 0;
+    serializeBuf.assign(MAXBUFLENGTH, 0);
+    serializeBufDirty = 0;
+
+    if (backgroundWriter)
+    {
+        try
+        {
+            startWriterThread();
+        }
+        catch (std::exception&)
+        {
+            fclose(dumpfile);
+            dumpfile = NULL;
+            throw;
+        }
+    }
+
+    if (pcapng)
+    {
+        struct pcapng_shb shb;
+        shb.block_type = PCAPNG_SECTION_HEADER_BLOCK;
+        shb.block_total_length = shb.block_total_length2 = sizeof(shb);
+        shb.byte_order_magic = PCAPNG_BYTE_ORDER_MAGIC;
+        shb.major_version = 1;
+        shb.minor_version = 0;
+        shb.section_length_low = shb.section_length_high = 0xffffffff;
+        append(&shb, sizeof(shb));
+    }
+    else
+    {
+        struct pcap_hdr fh;
+        fh.magic = PCAP_MAGIC;
+        fh.version_major = 2;
+        fh.version_minor = 4;
+        fh.thiszone = 0;
+        fh.sigfigs = 0;
+        fh.snaplen = snaplen;
+        fh.network = network;
+        append(&fh, sizeof(fh));
+    }
+}
+
+int PcapDump::addInterface(const char *name)
+{
+    if (!dumpfile)
+        throw cRuntimeError("Cannot add interface: pcap output file is not open");
+
+    if (!pcapng)
+        return 0;
+
+    // interface description block, with if_name and if_tsresol (nanoseconds) options
+    unsigned int nameLength = strlen(name);
+    uint32 blockLength = 16 + (4 + pad4(nameLength)) + (4 + 4) + 4 + 4;
+    uint32 header[4];
+    header[0] = PCAPNG_INTERFACE_BLOCK;
+    header[1] = blockLength;
+    uint16 linkType[2] = {(uint16)network, 0};  // link type and reserved field
+    memcpy(&header[2], linkType, sizeof(linkType));
+    header[3] = snaplen;
+    append(header, sizeof(header));
+
+    uint16 option[2] = {PCAPNG_OPT_IF_NAME, (uint16)nameLength};
+    append(option, sizeof(option));
+    append(name, nameLength);
+    appendPadding(pad4(nameLength) - nameLength);
 
-    fh.magic = PCAP_MAGIC;
-    fh.version_major = 2;
-    fh.version_minor = 4;
-    fh.thiszone = 0;
-    fh.sigfigs = 0;
-    fh.snaplen = snaplen;
-    fh.network = 0;
-    fwrite(&fh, sizeof(fh), 1, dumpfile);
+    option[0] = PCAPNG_OPT_IF_TSRESOL;
+    option[1] = 1;
+    append(option, sizeof(option));
+    unsigned char tsresol[4] = {9, 0, 0, 0};
+    append(tsresol, sizeof(tsresol));
+
+    option[0] = PCAPNG_OPT_ENDOFOPT;
+    option[1] = 0;
+    append(option, sizeof(option));
+    append(&blockLength, sizeof(blockLength));
+
+    return numInterfaces++;
 }
 
 void PcapDump::writeFrame(simtime_t stime, const IPv4Datagram *ipPacket)
+{
+#ifdef WITH_IPv4
+    writePacket(stime, ipPacket);
+#else
+    throw cRuntimeError("Cannot write frame: INET compiled without IPv4 feature");
+#endif
+}
+
+bool PcapDump::writePacket(simtime_t stime, const cPacket *packet, int interfaceId)
 {
     if (!dumpfile)
         throw cRuntimeError("Cannot write frame: pcap output file is not open");
+    if (pcapng && (interfaceId < 0 || interfaceId >= numInterfaces))
+        throw cRuntimeError("Cannot write frame: no interface with id %d in pcap output file", interfaceId);
+
+    // the serializers leave the payload bytes untouched, so only the part
+    // written by the previous packet needs to be cleared
+    memset(&serializeBuf[0], 0, serializeBufDirty);
+    unsigned int length = serializeFrame(packet, &serializeBuf[0], serializeBuf.size());
+    serializeBufDirty = std::min(length, (unsigned int)serializeBuf.size());
+    if (length == 0)
+        return false;
+
+    writeRecord(stime, interfaceId, &serializeBuf[0], length);
+    return true;
+}
 
+unsigned int PcapDump::serializeFrame(const cPacket *packet, unsigned char *buf, unsigned int bufsize)
+{
+    // find the IP datagram, and the link layer frame if needed
+    const cPacket *frame = NULL;
+    const cPacket *datagram = NULL;
+    bool ipv6 = false;
+    for (const cPacket *p = packet; p && !datagram; p = p->getEncapsulatedPacket())
+    {
 #ifdef WITH_IPv4
-    uint8 buf[MAXBUFLENGTH];
-    memset((void*)&buf, 0, sizeof(buf));
-
-    struct pcaprec_hdr ph;
-    ph.ts_sec = (int32)stime.dbl();
-    ph.ts_usec = (uint32)((stime.dbl() - ph.ts_sec) * 1000000);
-     // Write Ethernet header
-    uint32 hdr = 2; //AF_INET
-
-    int32 serialized_ip = IPv4Serializer().serialize(ipPacket, buf, sizeof(buf), true);
-    ph.orig_len = serialized_ip + sizeof(uint32);
-
-    ph.incl_len = ph.orig_len > snaplen ? snaplen : ph.orig_len;
-    fwrite(&ph, sizeof(ph), 1, dumpfile);
-    fwrite(&hdr, sizeof(uint32), 1, dumpfile);
-    fwrite(buf, ph.incl_len - sizeof(uint32), 1, dumpfile);
-#else
-    throw cRuntimeError("Cannot write frame: INET compiled without IPv4 feature");
+        if (dynamic_cast<const IPv4Datagram *>(p))
+            datagram = p;
+#endif
+#ifdef WITH_IPv6
+        if (dynamic_cast<const IPv6Datagram *>(p))
+            datagram = p, ipv6 = true;
+#endif
+#ifdef WITH_ETHERNET
+        if (network == LINKTYPE_ETHERNET && !frame && dynamic_cast<const EtherFrame *>(p))
+            frame = p;
+#endif
+#ifdef WITH_IEEE80211
+        if (network == LINKTYPE_IEEE802_11 && !frame && dynamic_cast<const Ieee80211DataFrame *>(p))
+            frame = p;
+#endif
+    }
+    if (!datagram || ((network == LINKTYPE_ETHERNET || network == LINKTYPE_IEEE802_11) && !frame))
+        return 0;
+
+    // link layer header
+    unsigned int headerLength;
+    unsigned int etherType = ipv6 ? ETHERTYPE_IPV6 : ETHERTYPE_IP;
+    switch (network)
+    {
+        case LINKTYPE_NULL:
+        {
+            uint32 family = ipv6 ? NULL_AF_INET6 : NULL_AF_INET; // host byte order
+            memcpy(buf, &family, sizeof(family));
+            headerLength = sizeof(family);
+            break;
+        }
+
+        case LINKTYPE_RAW:
+            headerLength = 0;
+            break;
+
+#ifdef WITH_ETHERNET
+        case LINKTYPE_ETHERNET:
+        {
+            const EtherFrame *etherFrame = static_cast<const EtherFrame *>(frame);
+            putMACAddress(buf, etherFrame->getDest());
+            putMACAddress(buf + 6, etherFrame->getSrc());
+            buf[12] = etherType >> 8;
+            buf[13] = etherType;
+            headerLength = 14;
+            break;
+        }
+#endif
+
+#ifdef WITH_IEEE80211
+        case LINKTYPE_IEEE802_11:
+        {
+            // data frame header (little endian fields), then LLC/SNAP header
+            const Ieee80211DataFrame *dataFrame = static_cast<const Ieee80211DataFrame *>(frame);
+            buf[0] = 0x08;
+            buf[1] = (dataFrame->getToDS() ? 0x01 : 0) | (dataFrame->getFromDS() ? 0x02 : 0) |
+                     (dataFrame->getMoreFragments() ? 0x04 : 0) | (dataFrame->getRetry() ? 0x08 : 0);
+            uint16 duration = dataFrame->getDuration() < 0 ? 0 : (uint16)(dataFrame->getDuration().dbl() * 1e6);
+            buf[2] = duration;
+            buf[3] = duration >> 8;
+            putMACAddress(buf + 4, dataFrame->getReceiverAddress());
+            putMACAddress(buf + 10, dataFrame->getTransmitterAddress());
+            putMACAddress(buf + 16, dataFrame->getAddress3());
+            uint16 sequenceControl = (dataFrame->getSequenceNumber() << 4) | (dataFrame->getFragmentNumber() & 0x0f);
+            buf[22] = sequenceControl;
+            buf[23] = sequenceControl >> 8;
+            headerLength = 24;
+            if (dataFrame->getToDS() && dataFrame->getFromDS())
+            {
+                putMACAddress(buf + 24, dataFrame->getAddress4());
+                headerLength = 30;
+            }
+            const unsigned char snap[6] = {0xaa, 0xaa, 0x03, 0, 0, 0};
+            memcpy(buf + headerLength, snap, sizeof(snap));
+            buf[headerLength + 6] = etherType >> 8;
+            buf[headerLength + 7] = etherType;
+            headerLength += 8;
+            break;
+        }
+#endif
+
+        default:
+            throw cRuntimeError("PcapDump: unsupported link type %u", network);
+    }
+
+    // IP datagram
+#ifdef WITH_IPv6
+    if (ipv6)
+        return headerLength + IPv6Serializer().serialize(static_cast<const IPv6Datagram *>(datagram), buf + headerLength, bufsize - headerLength);
+#endif
+#ifdef WITH_IPv4
+    if (!ipv6)
+        return headerLength + IPv4Serializer().serialize(static_cast<const IPv4Datagram *>(datagram), buf + headerLength, bufsize - headerLength, true);
 #endif
+    return 0;
+}
+
+void PcapDump::writeRecord(simtime_t stime, int interfaceId, const unsigned char *data, uint32 length)
+{
+    uint32 capturedLength = std::min(length, snaplen);
+
+    if (pcapng)
+    {
+        uint64 timestamp = (uint64)(stime.dbl() * 1e9);
+        struct pcapng_epb epb;
+        epb.block_type = PCAPNG_ENHANCED_PACKET_BLOCK;
+        epb.block_total_length = sizeof(epb) + pad4(capturedLength) + 4;
+        epb.interface_id = interfaceId;
+        epb.timestamp_high = (uint32)(timestamp >> 32);
+        epb.timestamp_low = (uint32)timestamp;
+        epb.captured_len = capturedLength;
+        epb.packet_len = length;
+        append(&epb, sizeof(epb));
+        append(data, capturedLength);
+        appendPadding(pad4(capturedLength) - capturedLength);
+        append(&epb.block_total_length, sizeof(epb.block_total_length));
+    }
+    else
+    {
+        struct pcaprec_hdr ph;
+        ph.ts_sec = (int32)stime.dbl();
+        ph.ts_usec = (uint32)((stime.dbl() - ph.ts_sec) * 1000000);
+        ph.orig_len = length;
+        ph.incl_len = capturedLength;
+        append(&ph, sizeof(ph));
+        append(data, capturedLength);
+    }
+}
+
+void PcapDump::append(const void *data, unsigned int length)
+{
+    if (bufferUsed + length > buffer.size())
+    {
+        flush();
+        if (length > buffer.size())
+        {
+            if (writerThread)
+                waitForWriterThread();
+            if (fwrite(data, length, 1, dumpfile) != 1)
+                throw cRuntimeError("Cannot write pcap file: %s", strerror(errno));
+            return;
+        }
+    }
+    memcpy(&buffer[bufferUsed], data, length);
+    bufferUsed += length;
+}
+
+void PcapDump::appendPadding(unsigned int length)
+{
+    static const unsigned char zeros[4] = {0, 0, 0, 0};
+    ASSERT(length <= 4);
+    append(zeros, length);
+}
+
+void PcapDump::flush()
+{
+    if (dumpfile && bufferUsed > 0)
+    {
+        if (writerThread)
+        {
+            handOverBuffer();
+            return;
+        }
+        if (fwrite(&buffer[0], bufferUsed, 1, dumpfile) != 1)
+            throw cRuntimeError("Cannot write pcap file: %s", strerror(errno));
+        bufferUsed = 0;
+    }
 }
 
 void PcapDump::closePcap()
 {
     if (dumpfile)
     {
+        int error = writerThread ? stopWriterThread() : 0;
+        bool ok = error == 0;
+        if (ok && bufferUsed > 0 && fwrite(&buffer[0], bufferUsed, 1, dumpfile) != 1)
+        {
+            ok = false;
+            error = errno;
+        }
+        bufferUsed = 0;
         fclose(dumpfile);
         dumpfile = NULL;
+        if (!ok)
+            throw cRuntimeError("Cannot write pcap file: %s", strerror(error));
+    }
+}
+
+#ifdef HAVE_PTHREAD
+
+/**
+ * State shared with the writer thread. The thread writes the buffer handed
+ * over to it; all fields are protected by the mutex.
+ */
+struct PcapDump::WriterThread
+{
+    FILE *dumpfile;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t workCond;   // signalled when a buffer is handed over or the thread should stop
+    pthread_cond_t doneCond;   // signalled when the buffer has been written
+    std::vector<unsigned char> buffer;
+    unsigned int length;       // bytes to write in buffer, 0 if there are none
+    int error;                 // errno of the first failed write, or 0
+    bool stop;
+};
+
+void *PcapDump::runWriterThread(void *arg)
+{
+    WriterThread *writer = (WriterThread *)arg;
+    pthread_mutex_lock(&writer->mutex);
+    while (true)
+    {
+        while (writer->length == 0 && !writer->stop)
+            pthread_cond_wait(&writer->workCond, &writer->mutex);
+        if (writer->length == 0)
+            break;
+
+        // write without holding the lock, the simulation keeps filling the other buffer
+        unsigned int length = writer->length;
+        pthread_mutex_unlock(&writer->mutex);
+        bool ok = fwrite(&writer->buffer[0], length, 1, writer->dumpfile) == 1;
+        int error = errno;
+        pthread_mutex_lock(&writer->mutex);
+        if (!ok && writer->error == 0)
+            writer->error = error;
+        writer->length = 0;
+        pthread_cond_signal(&writer->doneCond);
+    }
+    pthread_mutex_unlock(&writer->mutex);
+    return NULL;
+}
+
+void PcapDump::startWriterThread()
+{
+    WriterThread *writer = new WriterThread();
+    writer->dumpfile = dumpfile;
+    writer->buffer.resize(buffer.size());
+    writer->length = 0;
+    writer->error = 0;
+    writer->stop = false;
+    pthread_mutex_init(&writer->mutex, NULL);
+    pthread_cond_init(&writer->workCond, NULL);
+    pthread_cond_init(&writer->doneCond, NULL);
+    if (pthread_create(&writer->thread, NULL, runWriterThread, writer) != 0)
+    {
+        pthread_cond_destroy(&writer->doneCond);
+        pthread_cond_destroy(&writer->workCond);
+        pthread_mutex_destroy(&writer->mutex);
+        delete writer;
+        throw cRuntimeError("Cannot start the pcap writer thread");
+    }
+    writerThread = writer;
+}
+
+void PcapDump::handOverBuffer()
+{
+    WriterThread *writer = writerThread;
+    pthread_mutex_lock(&writer->mutex);
+    while (writer->length != 0)
+        pthread_cond_wait(&writer->doneCond, &writer->mutex);
+    int error = writer->error;
+    if (error == 0)
+    {
+        buffer.swap(writer->buffer);
+        writer->length = bufferUsed;
+        pthread_cond_signal(&writer->workCond);
     }
+    pthread_mutex_unlock(&writer->mutex);
+    if (error != 0)
+        throw cRuntimeError("Cannot write pcap file: %s", strerror(error));
+    bufferUsed = 0;
+}
+
+void PcapDump::waitForWriterThread()
+{
+    WriterThread *writer = writerThread;
+    pthread_mutex_lock(&writer->mutex);
+    while (writer->length != 0)
+        pthread_cond_wait(&writer->doneCond, &writer->mutex);
+    int error = writer->error;
+    pthread_mutex_unlock(&writer->mutex);
+    if (error != 0)
+        throw cRuntimeError("Cannot write pcap file: %s", strerror(error));
+}
+
+int PcapDump::stopWriterThread()
+{
+    WriterThread *writer = writerThread;
+    pthread_mutex_lock(&writer->mutex);
+    writer->stop = true;
+    pthread_cond_signal(&writer->workCond);
+    pthread_mutex_unlock(&writer->mutex);
+    pthread_join(writer->thread, NULL);
+
+    int error = writer->error;
+    pthread_cond_destroy(&writer->doneCond);
+    pthread_cond_destroy(&writer->workCond);
+    pthread_mutex_destroy(&writer->mutex);
+    delete writer;
+    writerThread = NULL;
+    return error;
+}
+
+#else
+
+void PcapDump::startWriterThread()
+{
+    throw cRuntimeError("The pcap background writer needs POSIX threads: INET was built without HAVE_PTHREAD (see src/makefrag)");
 }
 
+// without POSIX threads there is no writer thread, so these are never called
+void PcapDump::handOverBuffer() {}
+void PcapDump::waitForWriterThread() {}
+int PcapDump::stopWriterThread() { return 0; }
+
+#endif
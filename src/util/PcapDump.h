@@ -22,23 +22,66 @@
 #define __INET_PCAPDUMP_H
 
 
+#include <vector>
+
 #include "INETDefs.h"
 
 // Foreign declarations:
 class IPv4Datagram;
 
 
+// link types (see http://www.tcpdump.org/linktypes.html)
+#define LINKTYPE_NULL           0   // IPv4/IPv6 packet after a 4-byte address family (BSD loopback)
+#define LINKTYPE_ETHERNET       1
+#define LINKTYPE_RAW            101 // IPv4/IPv6 packet without link layer header
+#define LINKTYPE_IEEE802_11     105
+
+
 /**
  * Dumps packets into a PCAP file; see the "pcap-savefile" man page or
- * http://www.tcpdump.org/ for details on the file format.
- * Note: The file is currently recorded in the "classic" format,
- * not in the "Next Generation" file format also on tcpdump.org.
+ * http://www.tcpdump.org/ for details on the file format. The file can be
+ * written in the "classic" format or in the "Next Generation" (pcapng)
+ * format, which has a separate interface description for each recorded
+ * interface and nanosecond timestamps.
+ *
+ * Records are collected in a memory buffer that is written to the file
+ * when it becomes full or the file is closed, so recording a packet costs
+ * no file operations in general. With the background writer (needs INET
+ * built with HAVE_PTHREAD), a full buffer is handed over to a writer
+ * thread and recording continues in a second buffer, so the simulation
+ * only waits for the file when both buffers are full.
  */
 class PcapDump
 {
     protected:
         FILE *dumpfile;         // pcap file
         unsigned int snaplen;   // max. length of packets in pcap file
+        uint32 network;         // link type
+        bool pcapng;            // file is in pcapng format
+        int numInterfaces;      // number of interface description blocks written (pcapng)
+
+        std::vector<unsigned char> buffer;  // records not yet written to the file
+        unsigned int bufferUsed;
+        std::vector<unsigned char> serializeBuf; // all zero except the first serializeBufDirty bytes
+        unsigned int serializeBufDirty;
+
+        struct WriterThread;
+        WriterThread *writerThread;  // background writer, or NULL
+
+    protected:
+        // serializes the packet according to the link type; returns the length, or 0 if the
+        // packet does not contain an IP datagram or the required link layer frame
+        virtual unsigned int serializeFrame(const cPacket *packet, unsigned char *buf, unsigned int bufsize);
+        virtual void writeRecord(simtime_t stime, int interfaceId, const unsigned char *data, uint32 length);
+        void append(const void *data, unsigned int length);
+        void appendPadding(unsigned int length);
+        void startWriterThread();
+        static void *runWriterThread(void *arg);
+        // hands the buffer over to the writer thread, after it has written the previous one
+        void handOverBuffer();
+        void waitForWriterThread();
+        // writes the buffer handed over, and stops the thread; returns 0 or the errno of a failed write
+        int stopWriterThread();
 
     public:
         /**
@@ -49,26 +92,54 @@ class PcapDump
         /**
          * Destructor. It closes the output file if it is open.
          */
-        ~PcapDump();
+        virtual ~PcapDump();
 
         /**
          * Opens a PCAP file with the given file name. The snaplen parameter
-         * is the length that packets will be truncated to. Throws an exception
-         * if the file cannot be opened.
+         * is the length that packets will be truncated to; network is one of
+         * the LINKTYPE_ constants. bufferSize is the size of the write buffer
+         * in bytes, 0 means writing every record immediately. If
+         * backgroundWriter is true, full buffers are written to the file
+         * on a separate thread (bufferSize must not be 0). Throws an
+         * exception if the file cannot be opened or the thread cannot be
+         * started.
          */
-        void openPcap(const char *filename, unsigned int snaplen);
+        void openPcap(const char *filename, unsigned int snaplen, uint32 network = LINKTYPE_NULL, bool pcapng = false, unsigned int bufferSize = 0, bool backgroundWriter = false);
 
         /**
          * Returns true if the pcap file is currently open.
          */
         bool isOpen() const { return dumpfile != NULL; }
 
+        /**
+         * Adds an interface, and returns its id for writePacket(). In the
+         * classic format there is only one, unnamed interface, and this
+         * method returns 0.
+         */
+        int addInterface(const char *name);
+
         /**
          * Records the given packet into the output file if it is open,
          * and throws an exception otherwise.
          */
         void writeFrame(simtime_t time, const IPv4Datagram *ipPacket);
 
+        /**
+         * Records the given packet into the output file, as a frame of the
+         * link type of the file. The packet may be a frame of any layer that
+         * contains an IPv4 or IPv6 datagram; with the Ethernet and 802.11 link
+         * types, it must also contain a frame of that type. Returns false if
+         * the packet could not be recorded for this reason. Throws an
+         * exception if the file is not open.
+         */
+        bool writePacket(simtime_t time, const cPacket *packet, int interfaceId = 0);
+
+        /**
+         * Writes the buffered records to the file; with the background
+         * writer, it only hands them over to the writer thread.
+         */
+        void flush();
+
         /**
          * Closes the output file if it is open.
          */
@@ -77,4 +148,3 @@ class PcapDump
 
 
 #endif // __INET_PCAPDUMP_H
-
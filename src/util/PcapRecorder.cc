@@ -22,10 +22,6 @@
 
 #include "PcapRecorder.h"
 
-#ifdef WITH_IPv4
-#include "IPv4Datagram.h"
-#endif
-
 
 //----
 
@@ -44,6 +40,9 @@ void PcapRecorder::initialize()
     const char* file = par("pcapFile");
     snaplen = this->par("snaplen");
     dumpBadFrames = par("dumpBadFrames").boolValue();
+    numRecorded = numSkipped = 0;
+    WATCH(numRecorded);
+    WATCH(numSkipped);
     packetDumper.setVerbose(par("verbose").boolValue());
     packetDumper.setOutStream(ev.getOStream());
     signalList.clear();
@@ -101,7 +100,22 @@ void PcapRecorder::initialize()
     }
 
     if (*file)
-        pcapDumper.openPcap(file, snaplen);
+    {
+        const char *linkType = par("linkType");
+        uint32 network;
+        if (!strcmp(linkType, "null"))
+            network = LINKTYPE_NULL;
+        else if (!strcmp(linkType, "raw"))
+            network = LINKTYPE_RAW;
+        else if (!strcmp(linkType, "ethernet"))
+            network = LINKTYPE_ETHERNET;
+        else if (!strcmp(linkType, "ieee80211"))
+            network = LINKTYPE_IEEE802_11;
+        else
+            throw cRuntimeError("Unknown linkType '%s'", linkType);
+
+        pcapDumper.openPcap(file, snaplen, network, par("pcapng").boolValue(), (int)par("bufferSize"), par("backgroundWriter").boolValue());
+    }
 }
 
 void PcapRecorder::handleMessage(cMessage *msg)
@@ -118,11 +132,22 @@ void PcapRecorder::receiveSignal(cComponent *source, simsignal_t signalID, cObje
     {
         SignalList::const_iterator i = signalList.find(signalID);
         bool l2r = (i != signalList.end()) ? i->second : true;
-        recordPacket(packet, l2r);
+        recordPacket(packet, l2r, source);
     }
 }
 
-void PcapRecorder::recordPacket(cPacket *msg, bool l2r)
+int PcapRecorder::getInterfaceId(cComponent *source)
+{
+    std::map<cComponent *, int>::iterator it = interfaceIds.find(source);
+    if (it != interfaceIds.end())
+        return it->second;
+
+    int id = pcapDumper.addInterface(source->getFullPath().c_str());
+    interfaceIds[source] = id;
+    return id;
+}
+
+void PcapRecorder::recordPacket(cPacket *msg, bool l2r, cComponent *source)
 {
     if (!ev.isDisabled())
     {
@@ -130,35 +155,34 @@ void PcapRecorder::recordPacket(cPacket *msg, bool l2r)
         packetDumper.dumpPacket(l2r, msg);
     }
 
-#ifdef WITH_IPv4
     if (!pcapDumper.isOpen())
         return;
 
     bool hasBitError = false;
-    IPv4Datagram *ipPacket = NULL;
-
-    while (msg)
+    for (cPacket *p = msg; p; p = p->getEncapsulatedPacket())
     {
-        if (msg->hasBitError())
+        if (p->hasBitError())
+        {
             hasBitError = true;
-
-        if (NULL != (ipPacket = dynamic_cast<IPv4Datagram *>(msg)))
             break;
-
-        msg = msg->getEncapsulatedPacket();
+        }
     }
 
-    if (ipPacket && (dumpBadFrames || !hasBitError))
+    if (dumpBadFrames || !hasBitError)
     {
         const simtime_t stime = simulation.getSimTime();
-        pcapDumper.writeFrame(stime, ipPacket);
+        if (pcapDumper.writePacket(stime, msg, getInterfaceId(source)))
+            numRecorded++;
+        else
+            numSkipped++;
     }
-#endif
 }
 
 void PcapRecorder::finish()
 {
      packetDumper.dump("", "pcapRecorder finished");
      pcapDumper.closePcap();
+     recordScalar("pcap frames recorded", numRecorded);
+     recordScalar("pcap frames skipped", numSkipped);
 }
 
@@ -41,6 +41,9 @@ class INET_API PcapRecorder : public cSimpleModule, protected cListener
         unsigned int snaplen;
         unsigned long first, last, space;
         bool dumpBadFrames;
+        std::map<cComponent *, int> interfaceIds; // pcap interface id of each signal source
+        unsigned long numRecorded;
+        unsigned long numSkipped;
     public:
         PcapRecorder();
         ~PcapRecorder();
@@ -49,7 +52,8 @@ class INET_API PcapRecorder : public cSimpleModule, protected cListener
         virtual void handleMessage(cMessage *msg);
         virtual void finish();
         virtual void receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj);
-        virtual void recordPacket(cPacket *msg, bool l2r);
+        virtual void recordPacket(cPacket *msg, bool l2r, cComponent *source);
+        virtual int getInterfaceId(cComponent *source);
 };
 
 #endif
@@ -16,29 +16,176 @@
 // along with this program; if not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <string.h>
+
 #include "TCPIPchecksum.h"
 
 //#if !defined(_WIN32) && !defined(__WIN32__) && !defined(WIN32) && !defined(__CYGWIN__) && !defined(_WIN64)
 //#include <netinet/in.h>  // htonl, ntohl, ...
 //#endif
 
-uint16_t TCPIPchecksum::_checksum(const void *addr, unsigned int count)
-{
-    uint32_t sum = 0;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHECKSUM_SSE2
+#include <emmintrin.h>
+#endif
 
-    while (count > 1)
+// AVX2 is compiled in with the target attribute, and selected at run time
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    ((defined(__clang__) && __clang_major__ >= 4) || \
+     (!defined(__clang__) && defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define CHECKSUM_AVX2
+#include <immintrin.h>
+#endif
+
+// The one's complement sum is independent of byte order as long as all
+// words are taken in the same order, and it can be computed in wider
+// words, folding the carries back in at the end: summing 32 bit words into
+// a 64 bit accumulator cannot overflow for any buffer below 4GB.
+
+static uint64 foldedSum(const unsigned char *p, unsigned int count, uint64 sum)
+{
+    // the tail after the wide loops
+    while (count >= 4)
     {
-        sum += *((const uint16_t *&)addr)++;
-        if (sum & 0x80000000)
-            sum = (sum & 0xFFFF) + (sum >> 16);
+        uint32_t w;
+        memcpy(&w, p, 4);
+        sum += w;
+        p += 4;
+        count -= 4;
+    }
+    if (count >= 2)
+    {
+        uint16_t w;
+        memcpy(&w, p, 2);
+        sum += w;
+        p += 2;
         count -= 2;
     }
-
     if (count)
-        sum += *(const uint8_t *)addr;
+        sum += *p;  // like the last byte padded with zero, on little endian machines
+
+    sum = (sum & 0xFFFFFFFFULL) + (sum >> 32);
+    sum = (sum & 0xFFFFFFFFULL) + (sum >> 32);
+    return sum;
+}
+
+static uint64 sumPortable(const unsigned char *p, unsigned int count)
+{
+    uint64 sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+    while (count >= 16)
+    {
+        uint32_t w[4];
+        memcpy(w, p, 16);
+        sum0 += w[0];
+        sum1 += w[1];
+        sum2 += w[2];
+        sum3 += w[3];
+        p += 16;
+        count -= 16;
+    }
+    return foldedSum(p, count, sum0 + sum1 + sum2 + sum3);
+}
+
+#ifdef CHECKSUM_SSE2
+static uint64 sumSSE2(const unsigned char *p, unsigned int count)
+{
+    // 32 bit words are zero extended into 64 bit lanes
+    __m128i zero = _mm_setzero_si128();
+    __m128i sum0 = zero, sum1 = zero;
+    while (count >= 32)
+    {
+        __m128i v0 = _mm_loadu_si128((const __m128i *)p);
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(p + 16));
+        sum0 = _mm_add_epi64(sum0, _mm_add_epi64(_mm_unpacklo_epi32(v0, zero), _mm_unpackhi_epi32(v0, zero)));
+        sum1 = _mm_add_epi64(sum1, _mm_add_epi64(_mm_unpacklo_epi32(v1, zero), _mm_unpackhi_epi32(v1, zero)));
+        p += 32;
+        count -= 32;
+    }
+    uint64 lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(sum0, sum1));
+    return foldedSum(p, count, lanes[0] + lanes[1]);
+}
+#endif
+
+#ifdef CHECKSUM_AVX2
+__attribute__((target("avx2")))
+static uint64 sumAVX2(const unsigned char *p, unsigned int count)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i sum0 = zero, sum1 = zero;
+    while (count >= 64)
+    {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *)p);
+        __m256i v1 = _mm256_loadu_si256((const __m256i *)(p + 32));
+        sum0 = _mm256_add_epi64(sum0, _mm256_add_epi64(_mm256_unpacklo_epi32(v0, zero), _mm256_unpackhi_epi32(v0, zero)));
+        sum1 = _mm256_add_epi64(sum1, _mm256_add_epi64(_mm256_unpacklo_epi32(v1, zero), _mm256_unpackhi_epi32(v1, zero)));
+        p += 64;
+        count -= 64;
+    }
+    uint64 lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(sum0, sum1));
+    return foldedSum(p, count, lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+#endif
+
+static uint64 sumSelect(const unsigned char *p, unsigned int count);
+
+static uint64 (*sumFunction)(const unsigned char *p, unsigned int count) = sumSelect;
+
+static uint64 sumSelect(const unsigned char *p, unsigned int count)
+{
+#if defined(CHECKSUM_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        sumFunction = sumAVX2;
+    else
+#endif
+#if defined(CHECKSUM_SSE2)
+        sumFunction = sumSSE2;
+#else
+        sumFunction = sumPortable;
+#endif
+    return sumFunction(p, count);
+}
+
+uint16_t TCPIPchecksum::_checksum(const void *addr, unsigned int count)
+{
+    // small buffers (headers) are not worth a vector setup
+    uint64 sum = count < 32 ? sumPortable((const unsigned char *)addr, count) : sumFunction((const unsigned char *)addr, count);
 
+    uint32_t sum32 = (uint32_t)sum;
+    sum32 = (sum32 & 0xFFFF) + (sum32 >> 16);
+    sum32 = (sum32 & 0xFFFF) + (sum32 >> 16);
+    return (uint16_t)sum32;
+}
+
+uint16_t TCPIPchecksum::updateChecksum(uint16_t checksum, uint16_t oldValue, uint16_t newValue)
+{
+    // HC' = ~(~HC + ~m + m'), RFC 1624 eqn. 3
+    uint32_t sum = (uint16_t)~checksum + (uint32_t)(uint16_t)~oldValue + newValue;
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+uint16_t TCPIPchecksum::updateChecksum32(uint16_t checksum, uint32_t oldValue, uint32_t newValue)
+{
+    checksum = updateChecksum(checksum, (uint16_t)oldValue, (uint16_t)newValue);
+    return updateChecksum(checksum, (uint16_t)(oldValue >> 16), (uint16_t)(newValue >> 16));
+}
+
+uint16_t TCPIPchecksum::updateChecksum(uint16_t checksum, const void *oldData, const void *newData, unsigned int count)
+{
+    ASSERT(count % 2 == 0);
+    const uint16_t *oldWords = (const uint16_t *)oldData;
+    const uint16_t *newWords = (const uint16_t *)newData;
+    uint32_t sum = (uint16_t)~checksum;
+    for (unsigned int i = 0; i < count / 2; i++)
+    {
+        sum += (uint16_t)~oldWords[i];
+        sum += newWords[i];
+    }
     while (sum >> 16)
         sum = (sum & 0xFFFF) + (sum >> 16);
-
-    return (uint16_t)sum;
+    return (uint16_t)~sum;
 }
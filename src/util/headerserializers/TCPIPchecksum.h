@@ -23,7 +23,12 @@
 #include "INETDefs.h"
 
 /**
- * Calculates checksum.
+ * Calculates the Internet checksum (RFC 1071), and updates it
+ * incrementally (RFC 1624).
+ *
+ * The sum is computed 32 bits at a time into a 64-bit accumulator, with
+ * SSE2 where available, and with AVX2 if the processor supports it
+ * (checked at run time).
  */
 class TCPIPchecksum
 {
@@ -42,7 +47,28 @@ class TCPIPchecksum
             return ~ _checksum(addr, count);
         }
 
+        /*
+         * the one's complement sum of all 16 bit words, in the byte order of the
+         * memory; does not take the complement
+         */
         static uint16_t _checksum(const void *addr, unsigned int count);
+
+        /*
+         * RFC 1624: returns the checksum after a 16 bit word of the checksummed data
+         * changed from oldValue to newValue. The values and the checksum are in the
+         * byte order as stored in the packet (i.e. loaded from it as uint16_t).
+         */
+        static uint16_t updateChecksum(uint16_t checksum, uint16_t oldValue, uint16_t newValue);
+
+        /*
+         * Same for a 32 bit aligned 32 bit field (e.g. an IPv4 address).
+         */
+        static uint16_t updateChecksum32(uint16_t checksum, uint32_t oldValue, uint32_t newValue);
+
+        /*
+         * Same for a field of count bytes (even, 16 bit aligned), e.g. an IPv6 address.
+         */
+        static uint16_t updateChecksum(uint16_t checksum, const void *oldData, const void *newData, unsigned int count);
 };
 
 #endif
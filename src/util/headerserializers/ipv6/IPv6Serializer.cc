@@ -0,0 +1,104 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm> // std::min
+
+#include "INETDefs.h"
+
+#ifdef WITH_IPv6
+
+#include "IPv6Serializer.h"
+
+#include "IPProtocolId_m.h"
+
+#ifdef WITH_UDP
+#include "UDPPacket.h"
+#include "UDPSerializer.h"
+#endif
+
+#ifdef WITH_SCTP
+#include "SCTPMessage.h"
+#include "SCTPSerializer.h"
+#endif
+
+#ifdef WITH_TCP_COMMON
+#include "TCPSegment.h"
+#include "TCPSerializer.h"
+#endif
+
+
+static void putUint32(unsigned char *buf, uint32 value)
+{
+    buf[0] = value >> 24;
+    buf[1] = value >> 16;
+    buf[2] = value >> 8;
+    buf[3] = value;
+}
+
+int IPv6Serializer::serialize(const IPv6Datagram *dgram, unsigned char *buf, unsigned int bufsize)
+{
+    if (bufsize < IPv6_HEADER_BYTES)
+        throw cRuntimeError(dgram, "IPv6Serializer: buffer too small for the header");
+
+    if (dgram->getExtensionHeaderArraySize() > 0)
+        EV << "Serializing an IPv6 packet with extension headers. Dropping the extension headers.\n";
+
+    unsigned char *payload = buf + IPv6_HEADER_BYTES;
+    unsigned int payloadBufsize = bufsize - IPv6_HEADER_BYTES;
+    int payloadLength;
+    cPacket *encapPacket = dgram->getEncapsulatedPacket();
+
+    switch (dgram->getTransportProtocol())
+    {
+#ifdef WITH_UDP
+      case IP_PROT_UDP:
+        payloadLength = UDPSerializer().serialize(check_and_cast<UDPPacket *>(encapPacket), payload, payloadBufsize);
+        break;
+#endif
+
+#ifdef WITH_SCTP
+      case IP_PROT_SCTP:
+        payloadLength = SCTPSerializer().serialize(check_and_cast<SCTPMessage *>(encapPacket), payload, payloadBufsize);
+        break;
+#endif
+
+#ifdef WITH_TCP_COMMON
+      case IP_PROT_TCP:
+        payloadLength = TCPSerializer().serialize(check_and_cast<TCPSegment *>(encapPacket), payload, payloadBufsize,
+                                                  dgram->getSrcAddress(), dgram->getDestAddress());
+        break;
+#endif
+
+      default:
+        payloadLength = encapPacket ? encapPacket->getByteLength() : 0;
+        memset(payload, 0, std::min((unsigned int)payloadLength, payloadBufsize));
+        break;
+    }
+
+    putUint32(buf, (6U << 28) | ((uint32)dgram->getTrafficClass() << 20) | (dgram->getFlowLabel() & 0xfffff));
+    buf[4] = payloadLength >> 8;
+    buf[5] = payloadLength;
+    buf[6] = dgram->getTransportProtocol();
+    buf[7] = dgram->getHopLimit();
+    for (int i = 0; i < 4; i++)
+    {
+        putUint32(buf + 8 + 4 * i, dgram->getSrcAddress().words()[i]);
+        putUint32(buf + 24 + 4 * i, dgram->getDestAddress().words()[i]);
+    }
+
+    return IPv6_HEADER_BYTES + payloadLength;
+}
+
+#endif // WITH_IPv6
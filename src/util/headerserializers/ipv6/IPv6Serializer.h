@@ -0,0 +1,45 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_IPV6SERIALIZER_H
+#define __INET_IPV6SERIALIZER_H
+
+
+#include "INETDefs.h"
+
+#include "IPv6Datagram.h"
+
+
+/**
+ * Converts an IPv6Datagram to binary (network byte order) IPv6 packet.
+ * Extension headers are not serialized. UDP, TCP and SCTP payloads are
+ * serialized with the corresponding serializers; other payloads are
+ * written as zero bytes of the payload's length.
+ */
+class IPv6Serializer
+{
+    public:
+        IPv6Serializer() {}
+
+        /**
+         * Serializes an IPv6Datagram. The part of the packet that does not fit
+         * into bufsize is not written (the transport serializers may still
+         * require the whole packet length). Returns the length of the packet.
+         */
+        int serialize(const IPv6Datagram *dgram, unsigned char *buf, unsigned int bufsize);
+};
+
+#endif
+
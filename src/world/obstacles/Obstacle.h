@@ -42,6 +42,7 @@ class Obstacle {
         double calculateReceivedPower(double pSend, double carrierFrequency, const Coord& senderPos, double senderAngle, const Coord& receiverPos, double receiverAngle) const;
 
         AnnotationManager::Annotation* visualRepresentation;
+        unsigned int visitEpoch; /**< used by ObstacleControl to process each obstacle only once per query */
 
     protected:
         std::string id;
@@ -0,0 +1,136 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+
+#include <string.h>
+
+#include "world/obstacles/ObstacleCache.h"
+
+
+namespace {
+
+    uint64 mix(uint64 h, double d) {
+        uint64 bits;
+        if (d == 0) d = 0; // +0 and -0 compare equal, so they must hash equal
+        memcpy(&bits, &d, sizeof(bits));
+        h ^= bits;
+        h *= 0x9e3779b97f4a7c15ULL;
+        return h ^ (h >> 32);
+    }
+
+}
+
+bool ObstacleCache::Key::operator==(const Key& o) const {
+    return senderPos.x == o.senderPos.x && senderPos.y == o.senderPos.y &&
+           receiverPos.x == o.receiverPos.x && receiverPos.y == o.receiverPos.y &&
+           pSend == o.pSend && senderAngle == o.senderAngle && receiverAngle == o.receiverAngle &&
+           carrierFrequency == o.carrierFrequency;
+}
+
+ObstacleCache::ObstacleCache() : numEntries(0), mostRecent(NULL), leastRecent(NULL), numHits(0), numMisses(0) {
+}
+
+uint32 ObstacleCache::hash(const Key& key) {
+    uint64 h = 0;
+    h = mix(h, key.senderPos.x);
+    h = mix(h, key.senderPos.y);
+    h = mix(h, key.receiverPos.x);
+    h = mix(h, key.receiverPos.y);
+    h = mix(h, key.pSend);
+    h = mix(h, key.senderAngle);
+    h = mix(h, key.receiverAngle);
+    h = mix(h, key.carrierFrequency);
+    return (uint32)h;
+}
+
+void ObstacleCache::setCapacity(int capacity) {
+    entries.assign(capacity, Entry());
+    size_t numBuckets = 1;
+    while (numBuckets < 2 * entries.size()) numBuckets *= 2;
+    buckets.resize(numBuckets);
+    clear();
+}
+
+void ObstacleCache::clear() {
+    buckets.assign(buckets.size(), (Entry*)NULL);
+    numEntries = 0;
+    mostRecent = leastRecent = NULL;
+}
+
+ObstacleCache::Entry** ObstacleCache::findLink(const Key& key) {
+    Entry** link = &buckets[hash(key) & (buckets.size() - 1)];
+    while (*link && !((*link)->key == key)) link = &(*link)->hashNext;
+    return link;
+}
+
+void ObstacleCache::unlink(Entry* entry) {
+    if (entry->prev) entry->prev->next = entry->next;
+    else mostRecent = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else leastRecent = entry->prev;
+}
+
+void ObstacleCache::pushMostRecent(Entry* entry) {
+    entry->prev = NULL;
+    entry->next = mostRecent;
+    if (mostRecent) mostRecent->prev = entry;
+    else leastRecent = entry;
+    mostRecent = entry;
+}
+
+bool ObstacleCache::lookup(const Key& key, double& value) {
+    Entry* entry = numEntries == 0 ? NULL : *findLink(key);
+    if (!entry) {
+        numMisses++;
+        return false;
+    }
+    numHits++;
+    if (entry != mostRecent) {
+        unlink(entry);
+        pushMostRecent(entry);
+    }
+    value = entry->value;
+    return true;
+}
+
+void ObstacleCache::insert(const Key& key, double value) {
+    if (entries.empty()) return;
+
+    Entry* entry;
+    if (numEntries < (int)entries.size()) {
+        entry = &entries[numEntries++];
+    }
+    else {
+        // reuse the least recently used entry
+        entry = leastRecent;
+        Entry** link = findLink(entry->key);
+        ASSERT(*link == entry);
+        *link = entry->hashNext;
+        unlink(entry);
+    }
+
+    Entry** link = findLink(key);
+    ASSERT(*link == NULL);
+    entry->key = key;
+    entry->value = value;
+    entry->hashNext = NULL;
+    *link = entry;
+    pushMostRecent(entry);
+}
+
+std::ostream& operator<<(std::ostream& os, const ObstacleCache& cache) {
+    return os << cache.size() << "/" << cache.getCapacity() << " entries, "
+              << cache.getNumHits() << " hits, " << cache.getNumMisses() << " misses";
+}
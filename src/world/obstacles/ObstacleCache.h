@@ -0,0 +1,110 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+
+
+#ifndef WORLD_OBSTACLE_OBSTACLECACHE_H
+#define WORLD_OBSTACLE_OBSTACLECACHE_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "Coord.h"
+
+/**
+ * Bounded cache of ObstacleControl::calculateReceivedPower() results.
+ *
+ * Entries are kept in a chained hash table, and in a list ordered by
+ * last use; when the cache is full, the least recently used entry is
+ * replaced. All entries are allocated up front.
+ */
+class INET_API ObstacleCache {
+    public:
+        struct Key {
+            double pSend;
+            double carrierFrequency;
+            Coord senderPos;
+            double senderAngle;
+            Coord receiverPos;
+            double receiverAngle;
+
+            Key(double pSend, double carrierFrequency, const Coord& senderPos, double senderAngle, const Coord& receiverPos, double receiverAngle) :
+                pSend(pSend),
+                carrierFrequency(carrierFrequency),
+                senderPos(senderPos),
+                senderAngle(senderAngle),
+                receiverPos(receiverPos),
+                receiverAngle(receiverAngle) {
+            }
+            /** positions are compared in the x-y plane only, as obstacles are 2D */
+            bool operator==(const Key& o) const;
+        };
+
+    protected:
+        struct Entry {
+            Key key;
+            double value;
+            Entry* hashNext; /**< next entry in the same hash bucket */
+            Entry* prev; /**< neighbours in the list ordered by last use */
+            Entry* next;
+
+            Entry() : key(0, 0, Coord(), 0, Coord(), 0), value(0), hashNext(NULL), prev(NULL), next(NULL) {
+            }
+        };
+
+        std::vector<Entry> entries; /**< storage of all entries; the first numEntries are in use */
+        std::vector<Entry*> buckets; /**< size is a power of two */
+        int numEntries;
+        Entry* mostRecent;
+        Entry* leastRecent;
+        long numHits;
+        long numMisses;
+
+    protected:
+        static uint32 hash(const Key& key);
+        Entry** findLink(const Key& key);
+        void unlink(Entry* entry);
+        void pushMostRecent(Entry* entry);
+
+    private:
+        // not copyable
+        ObstacleCache(const ObstacleCache&);
+        ObstacleCache& operator=(const ObstacleCache&);
+
+    public:
+        ObstacleCache();
+
+        /** Sets the max number of entries, and clears the cache. 0 disables caching */
+        void setCapacity(int capacity);
+        int getCapacity() const { return entries.size(); }
+
+        /** Returns true and sets value if the key is in the cache; counts a hit or a miss */
+        bool lookup(const Key& key, double& value);
+
+        /** Stores a value for a key that is not in the cache, replacing the least recently used entry if needed */
+        void insert(const Key& key, double value);
+
+        /** Removes all entries; statistics are kept */
+        void clear();
+
+        int size() const { return numEntries; }
+        long getNumHits() const { return numHits; }
+        long getNumMisses() const { return numMisses; }
+};
+
+std::ostream& operator<<(std::ostream& os, const ObstacleCache& cache);
+
+#endif
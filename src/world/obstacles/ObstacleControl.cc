@@ -18,8 +18,6 @@
 //
 
 #include <sstream>
-#include <map>
-#include <set>
 
 #include "world/obstacles/ObstacleControl.h"
 
@@ -35,7 +33,11 @@ void ObstacleControl::initialize(int stage) {
         debug = par("debug");
 
         obstacles.clear();
-        cacheEntries.clear();
+        int cacheSize = par("cacheSize");
+        if (cacheSize < 0) error("invalid cacheSize %d", cacheSize);
+        cache.setCapacity(cacheSize);
+        queryEpoch = 0;
+        WATCH(cache);
 
         annotations = AnnotationManagerAccess().getIfExists();
         if (annotations) annotationGroup = annotations->createGroup("obstacles");
@@ -47,6 +49,9 @@ void ObstacleControl::initialize(int stage) {
 }
 
 void ObstacleControl::finish() {
+    recordScalar("cache hits", cache.getNumHits());
+    recordScalar("cache misses", cache.getNumMisses());
+
     for (Obstacles::iterator i = obstacles.begin(); i != obstacles.end(); ++i) {
         for (ObstacleGridRow::iterator j = i->begin(); j != i->end(); ++j) {
             while (j->begin() != j->end()) erase(*j->begin());
@@ -126,7 +131,7 @@ void ObstacleControl::add(Obstacle obstacle) {
     // visualize using AnnotationManager
     if (annotations) o->visualRepresentation = annotations->drawPolygon(o->getShape(), "red", annotationGroup);
 
-    cacheEntries.clear();
+    cache.clear();
 }
 
 void ObstacleControl::erase(const Obstacle* obstacle) {
@@ -146,62 +151,104 @@ void ObstacleControl::erase(const Obstacle* obstacle) {
     if (annotations && obstacle->visualRepresentation) annotations->erase(obstacle->visualRepresentation);
     delete obstacle;
 
-    cacheEntries.clear();
+    cache.clear();
 }
 
-double ObstacleControl::calculateReceivedPower(double pSend, double carrierFrequency, const Coord& senderPos, double senderAngle, const Coord& receiverPos, double receiverAngle) const {
-    Enter_Method_Silent();
+void ObstacleControl::resetVisitEpochs() const {
+    for (Obstacles::const_iterator i = obstacles.begin(); i != obstacles.end(); ++i) {
+        for (ObstacleGridRow::const_iterator j = i->begin(); j != i->end(); ++j) {
+            for (ObstacleGridCell::const_iterator k = j->begin(); k != j->end(); ++k) (*k)->visitEpoch = 0;
+        }
+    }
+}
 
-    // return cached result, if available
-    CacheKey cacheKey(pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
-    CacheEntries::const_iterator cacheEntryIter = cacheEntries.find(cacheKey);
-    if (cacheEntryIter != cacheEntries.end()) return cacheEntryIter->second;
-
-    // calculate bounding box of transmission
-    Coord bboxP1 = Coord(std::min(senderPos.x, receiverPos.x), std::min(senderPos.y, receiverPos.y));
-    Coord bboxP2 = Coord(std::max(senderPos.x, receiverPos.x), std::max(senderPos.y, receiverPos.y));
-
-    size_t fromRow = std::max(0, int(bboxP1.x / GRIDCELL_SIZE));
-    size_t toRow = std::max(0, int(bboxP2.x / GRIDCELL_SIZE));
-    size_t fromCol = std::max(0, int(bboxP1.y / GRIDCELL_SIZE));
-    size_t toCol = std::max(0, int(bboxP2.y / GRIDCELL_SIZE));
-
-    std::set<Obstacle*> processedObstacles;
-    for (size_t col = fromCol; col <= toCol; ++col) {
-        if (col >= obstacles.size()) break;
-        for (size_t row = fromRow; row <= toRow; ++row) {
-            if (row >= obstacles[col].size()) break;
-            const ObstacleGridCell& cell = (obstacles[col])[row];
-            for (ObstacleGridCell::const_iterator k = cell.begin(); k != cell.end(); ++k) {
+double ObstacleControl::processGridCell(int x, int y, double pSend, double carrierFrequency, const Coord& senderPos, double senderAngle, const Coord& receiverPos, double receiverAngle) const {
+    // obstacles in negative coordinates are stored in the first row/column, see add()
+    size_t row = std::max(0, x);
+    size_t col = std::max(0, y);
+    if (col >= obstacles.size()) return pSend;
+    if (row >= obstacles[col].size()) return pSend;
 
-                Obstacle* o = *k;
+    const ObstacleGridCell& cell = (obstacles[col])[row];
+    for (ObstacleGridCell::const_iterator k = cell.begin(); k != cell.end(); ++k) {
 
-                if (processedObstacles.find(o) != processedObstacles.end()) continue;
-                processedObstacles.insert(o);
+        Obstacle* o = *k;
 
-                // bail if bounding boxes cannot overlap
-                if (o->getBboxP2().x < bboxP1.x) continue;
-                if (o->getBboxP1().x > bboxP2.x) continue;
-                if (o->getBboxP2().y < bboxP1.y) continue;
-                if (o->getBboxP1().y > bboxP2.y) continue;
+        if (o->visitEpoch == queryEpoch) continue;
+        o->visitEpoch = queryEpoch;
 
-                double pSendOld = pSend;
+        // bail if bounding boxes cannot overlap
+        if (o->getBboxP2().x < std::min(senderPos.x, receiverPos.x)) continue;
+        if (o->getBboxP1().x > std::max(senderPos.x, receiverPos.x)) continue;
+        if (o->getBboxP2().y < std::min(senderPos.y, receiverPos.y)) continue;
+        if (o->getBboxP1().y > std::max(senderPos.y, receiverPos.y)) continue;
 
-                pSend = o->calculateReceivedPower(pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
+        double pSendOld = pSend;
 
-                // draw a "hit!" bubble
-                if (annotations && (pSend < pSendOld)) annotations->drawBubble(o->getBboxP1(), "hit");
+        pSend = o->calculateReceivedPower(pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
 
-                // bail if attenuation is already extremely high
-                if (pSend < 1e-30) break;
+        // draw a "hit!" bubble
+        if (annotations && (pSend < pSendOld)) annotations->drawBubble(o->getBboxP1(), "hit");
 
-            }
+        // bail if attenuation is already extremely high
+        if (pSend < 1e-30) break;
+
+    }
+    return pSend;
+}
+
+double ObstacleControl::calculateReceivedPower(double pSend, double carrierFrequency, const Coord& senderPos, double senderAngle, const Coord& receiverPos, double receiverAngle) const {
+    Enter_Method_Silent();
+
+    // return cached result, if available
+    ObstacleCache::Key cacheKey(pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
+    double cachedValue;
+    if (cache.lookup(cacheKey, cachedValue)) return cachedValue;
+
+    // start a new query: obstacles stamped with an older epoch have not been processed yet
+    if (++queryEpoch == 0) {
+        resetVisitEpochs();
+        queryEpoch = 1;
+    }
+
+    // walk the grid cells along the line from sender to receiver (Amanatides-Woo traversal);
+    // an obstacle that the line crosses is registered in the cell where they meet
+    double x0 = senderPos.x / GRIDCELL_SIZE;
+    double y0 = senderPos.y / GRIDCELL_SIZE;
+    double dx = receiverPos.x / GRIDCELL_SIZE - x0;
+    double dy = receiverPos.y / GRIDCELL_SIZE - y0;
+    int x = (int)floor(x0);
+    int y = (int)floor(y0);
+    int toX = (int)floor(receiverPos.x / GRIDCELL_SIZE);
+    int toY = (int)floor(receiverPos.y / GRIDCELL_SIZE);
+    int stepX = toX >= x ? 1 : -1;
+    int stepY = toY >= y ? 1 : -1;
+    // line parameter (0 at sender, 1 at receiver) of the next vertical / horizontal cell boundary, and the distance between them
+    double tMaxX = dx > 0 ? (x + 1 - x0) / dx : dx < 0 ? (x - x0) / dx : 2;
+    double tMaxY = dy > 0 ? (y + 1 - y0) / dy : dy < 0 ? (y - y0) / dy : 2;
+    double tDeltaX = dx != 0 ? stepX / dx : 0;
+    double tDeltaY = dy != 0 ? stepY / dy : 0;
+
+    pSend = processGridCell(x, y, pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
+    while ((x != toX || y != toY) && pSend >= 1e-30) {
+        if (x != toX && (y == toY || tMaxX <= tMaxY)) {
+            // crossing (nearly) at a corner: also visit the cell that is only touched there
+            if (y != toY && tMaxY - tMaxX < 1e-9)
+                pSend = processGridCell(x, y + stepY, pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
+            x += stepX;
+            tMaxX += tDeltaX;
+        }
+        else {
+            if (x != toX && tMaxX - tMaxY < 1e-9)
+                pSend = processGridCell(x + stepX, y, pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
+            y += stepY;
+            tMaxY += tDeltaY;
         }
+        pSend = processGridCell(x, y, pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
     }
 
     // cache result
-    if (cacheEntries.size() >= 1000) cacheEntries.clear();
-    cacheEntries[cacheKey] = pSend;
+    cache.insert(cacheKey, pSend);
 
     return pSend;
 }
@@ -28,6 +28,7 @@
 #include "ModuleAccess.h"
 #include "Coord.h"
 #include "world/obstacles/Obstacle.h"
+#include "world/obstacles/ObstacleCache.h"
 #include "world/annotations/AnnotationManager.h"
 
 /**
@@ -57,49 +58,11 @@ class INET_API ObstacleControl : public cSimpleModule
         double calculateReceivedPower(double pSend, double carrierFrequency, const Coord& senderPos, double senderAngle, const Coord& receiverPos, double receiverAngle) const;
 
     protected:
-        struct CacheKey {
-            const double pSend;
-            const double carrierFrequency;
-            const Coord senderPos;
-            const double senderAngle;
-            const Coord receiverPos;
-            const double receiverAngle;
-
-            CacheKey(double pSend, double carrierFrequency, const Coord& senderPos, double senderAngle, const Coord& receiverPos, double receiverAngle) :
-                pSend(pSend),
-                carrierFrequency(carrierFrequency),
-                senderPos(senderPos),
-                senderAngle(senderAngle),
-                receiverPos(receiverPos),
-                receiverAngle(receiverAngle) {
-            }
-            bool operator<(const CacheKey& o) const {
-                if (senderPos.x < o.senderPos.x) return true;
-                if (senderPos.x > o.senderPos.x) return false;
-                if (senderPos.y < o.senderPos.y) return true;
-                if (senderPos.y > o.senderPos.y) return false;
-                if (receiverPos.x < o.receiverPos.x) return true;
-                if (receiverPos.x > o.receiverPos.x) return false;
-                if (receiverPos.y < o.receiverPos.y) return true;
-                if (receiverPos.y > o.receiverPos.y) return false;
-                if (pSend < o.pSend) return true;
-                if (pSend > o.pSend) return false;
-                if (senderAngle < o.senderAngle) return true;
-                if (senderAngle > o.senderAngle) return false;
-                if (receiverAngle < o.receiverAngle) return true;
-                if (receiverAngle > o.receiverAngle) return false;
-                if (carrierFrequency < o.carrierFrequency) return true;
-                if (carrierFrequency > o.carrierFrequency) return false;
-                return false;
-            }
-        };
-
         enum { GRIDCELL_SIZE = 1024 };
 
         typedef std::list<Obstacle*> ObstacleGridCell;
         typedef std::vector<ObstacleGridCell> ObstacleGridRow;
         typedef std::vector<ObstacleGridRow> Obstacles;
-        typedef std::map<CacheKey, double> CacheEntries;
 
         bool debug; /**< whether to emit debug messages */
         cXMLElement* obstaclesXml; /**< obstacles to add at startup */
@@ -107,7 +70,12 @@ class INET_API ObstacleControl : public cSimpleModule
         Obstacles obstacles;
         AnnotationManager* annotations;
         AnnotationManager::Group* annotationGroup;
-        mutable CacheEntries cacheEntries;
+        mutable ObstacleCache cache;
+        mutable unsigned int queryEpoch; /**< incremented for each query, to visit each obstacle only once */
+
+    protected:
+        void resetVisitEpochs() const;
+        double processGridCell(int x, int y, double pSend, double carrierFrequency, const Coord& senderPos, double senderAngle, const Coord& receiverPos, double receiverAngle) const;
 };
 
 class ObstacleControlAccess
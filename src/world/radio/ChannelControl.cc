@@ -18,6 +18,7 @@
 #include "ChannelControl.h"
 #include "FWMath.h"
 #include <cassert>
+#include <algorithm>
 
 #include "AirFrame_m.h"
 
@@ -42,10 +43,13 @@ std::ostream& operator<<(std::ostream& os, const ChannelControl::TransmissionLis
 
 ChannelControl::ChannelControl()
 {
+    useGrid = false;
 }
 
 ChannelControl::~ChannelControl()
 {
+    for (RadioRefVector::iterator it = radios.begin(); it != radios.end(); ++it)
+        delete *it;
     for (unsigned int i = 0; i < transmissions.size(); i++)
         for (TransmissionList::iterator it = transmissions[i].begin(); it != transmissions[i].end(); it++)
             delete *it;
@@ -69,8 +73,16 @@ void ChannelControl::initialize()
 
     maxInterferenceDistance = calcInterfDist();
 
+    const char *neighborUpdateMode = par("neighborUpdateMode");
+    if (!strcmp(neighborUpdateMode, "linear"))
+        useGrid = false;
+    else if (!strcmp(neighborUpdateMode, "grid"))
+        useGrid = true;
+    else
+        error("Invalid neighborUpdateMode '%s', must be 'linear' or 'grid'", neighborUpdateMode);
+
     WATCH(maxInterferenceDistance);
-    WATCH_LIST(radios);
+    WATCH_PTRVECTOR(radios);
     WATCH_VECTOR(transmissions);
 }
 
@@ -119,99 +131,185 @@ ChannelControl::RadioRef ChannelControl::registerRadio(cModule *radio, cGate *ra
     if (!radioInGate)
         radioInGate = radio->gate("radioIn");
 
-    RadioEntry re;
-    re.radioModule = radio;
-    re.radioInGate = radioInGate->getPathStartGate();
-    re.isNeighborListValid = false;
-    re.channel = 0;  // for now
-    re.isActive = true;
-    radios.push_back(re);
-    return &radios.back(); // last element
+    RadioRef newRadio = new RadioEntry();
+    newRadio->radioModule = radio;
+    newRadio->radioModuleId = radio->getId();
+    newRadio->radioInGate = radioInGate->getPathStartGate();
+    newRadio->index = radios.size();
+    newRadio->channel = 0;  // for now
+    newRadio->isActive = true;
+    radios.push_back(newRadio);
+    radioPositions.push_back(newRadio->pos);
+    if ((int)radiosByModuleId.size() <= newRadio->radioModuleId)
+        radiosByModuleId.resize(newRadio->radioModuleId + 1, NULL);
+    radiosByModuleId[newRadio->radioModuleId] = newRadio;
+    if (useGrid)
+        addToGrid(newRadio);
+    return newRadio;
 }
 
 void ChannelControl::unregisterRadio(RadioRef r)
 {
     Enter_Method_Silent();
-    for (RadioList::iterator it = radios.begin(); it != radios.end(); it++)
-    {
-        if (it->radioModule == r->radioModule)
-        {
-            RadioRef radioToRemove = &*it;
-            // erase radio from all registered radios' neighbor list
-            for (RadioList::iterator i2 = radios.begin(); i2 != radios.end(); ++i2)
-            {
-                RadioRef otherRadio = &*i2;
-                otherRadio->neighbors.erase(radioToRemove);
-                otherRadio->isNeighborListValid = false;
-                radioToRemove->isNeighborListValid = false;
-            }
-
-            // erase radio from registered radios
-            radios.erase(it);
-            return;
-        }
-    }
-
-    error("unregisterRadio failed: no such radio");
+    if (!r || r->radioModuleId >= (int)radiosByModuleId.size() || radiosByModuleId[r->radioModuleId] != r)
+        error("unregisterRadio failed: no such radio");
+
+    // erase radio from its neighbors' neighbor list (the relation is symmetric)
+    for (RadioRefVector::iterator it = r->neighbors.begin(); it != r->neighbors.end(); ++it)
+        eraseNeighbor((*it)->neighbors, r);
+
+    if (useGrid)
+        removeFromGrid(r);
+
+    // erase radio from registered radios, moving the last one into its slot
+    RadioRef lastRadio = radios.back();
+    radios[r->index] = lastRadio;
+    radioPositions[r->index] = lastRadio->pos;
+    lastRadio->index = r->index;
+    radios.pop_back();
+    radioPositions.pop_back();
+    radiosByModuleId[r->radioModuleId] = NULL;
+    delete r;
 }
 
 ChannelControl::RadioRef ChannelControl::lookupRadio(cModule *radio)
 {
     Enter_Method_Silent();
-    for (RadioList::iterator it = radios.begin(); it != radios.end(); it++)
-        if (it->radioModule == radio)
-            return &(*it);
-    return 0;
+    int id = radio->getId();
+    return id < (int)radiosByModuleId.size() ? radiosByModuleId[id] : NULL;
 }
 
 const ChannelControl::RadioRefVector& ChannelControl::getNeighbors(RadioRef h)
 {
     Enter_Method_Silent();
-    if (!h->isNeighborListValid)
-    {
-        h->neighborList.clear();
-        for (std::set<RadioRef,RadioEntry::Compare>::iterator it = h->neighbors.begin(); it != h->neighbors.end(); it++)
-            h->neighborList.push_back(*it);
-        h->isNeighborListValid = true;
-    }
-    return h->neighborList;
+    return h->neighbors;
+}
+
+bool ChannelControl::insertNeighbor(RadioRefVector& neighbors, RadioRef r)
+{
+    RadioRefVector::iterator it = std::lower_bound(neighbors.begin(), neighbors.end(), r, RadioEntry::Compare());
+    if (it != neighbors.end() && *it == r)
+        return false;
+    neighbors.insert(it, r);
+    return true;
+}
+
+bool ChannelControl::eraseNeighbor(RadioRefVector& neighbors, RadioRef r)
+{
+    RadioRefVector::iterator it = std::lower_bound(neighbors.begin(), neighbors.end(), r, RadioEntry::Compare());
+    if (it == neighbors.end() || *it != r)
+        return false;
+    neighbors.erase(it);
+    return true;
 }
 
 void ChannelControl::updateConnections(RadioRef h)
 {
+    if (useGrid)
+    {
+        updateConnectionsInGrid(h);
+        return;
+    }
+
     Coord& hpos = h->pos;
     double maxDistSquared = maxInterferenceDistance * maxInterferenceDistance;
-    for (RadioList::iterator it = radios.begin(); it != radios.end(); ++it)
+    int n = radios.size();
+    const Coord *positions = &radioPositions[0];
+    for (int i = 0; i < n; i++)
     {
-        RadioEntry *hi = &(*it);
-        if (hi == h)
+        if (i == h->index)
             continue;
 
         // get the distance between the two radios.
         // (omitting the square root (calling sqrdist() instead of distance()) saves about 5% CPU)
-        bool inRange = hpos.sqrdist(hi->pos) < maxDistSquared;
+        bool inRange = hpos.sqrdist(positions[i]) < maxDistSquared;
+        updateConnection(h, radios[i], inRange);
+    }
+}
 
-        if (inRange)
-        {
-            // nodes within communication range: connect
-            if (h->neighbors.insert(hi).second == true)
-            {
-                hi->neighbors.insert(h);
-                h->isNeighborListValid = hi->isNeighborListValid = false;
-            }
-        }
-        else
+void ChannelControl::updateConnection(RadioRef h, RadioRef hi, bool inRange)
+{
+    if (inRange)
+    {
+        // nodes within communication range: connect
+        if (insertNeighbor(h->neighbors, hi))
+            insertNeighbor(hi->neighbors, h);
+    }
+    else
+    {
+        // out of range: disconnect
+        if (eraseNeighbor(h->neighbors, hi))
+            eraseNeighbor(hi->neighbors, h);
+    }
+}
+
+void ChannelControl::updateConnectionsInGrid(RadioRef h)
+{
+    // move the radio to the cell of its new position
+    int cellX = (int)floor(h->pos.x / maxInterferenceDistance);
+    int cellY = (int)floor(h->pos.y / maxInterferenceDistance);
+    int cellZ = (int)floor(h->pos.z / maxInterferenceDistance);
+    if (cellX != h->cellX || cellY != h->cellY || cellZ != h->cellZ)
+    {
+        removeFromGrid(h);
+        addToGrid(h);
+    }
+
+    Coord& hpos = h->pos;
+    double maxDistSquared = maxInterferenceDistance * maxInterferenceDistance;
+
+    // drop neighbors that went out of range; radios outside the adjacent
+    // cells are farther than maxInterferenceDistance, so they are covered here too
+    RadioRefVector lostNeighbors;
+    for (RadioRefVector::iterator it = h->neighbors.begin(); it != h->neighbors.end(); ++it)
+        if (hpos.sqrdist((*it)->pos) >= maxDistSquared)
+            lostNeighbors.push_back(*it);
+    for (RadioRefVector::iterator it = lostNeighbors.begin(); it != lostNeighbors.end(); ++it)
+        updateConnection(h, *it, false);
+
+    // connect to radios in range in the adjacent cells
+    for (int x = cellX - 1; x <= cellX + 1; x++)
+    {
+        for (int y = cellY - 1; y <= cellY + 1; y++)
         {
-            // out of range: disconnect
-            if (h->neighbors.erase(hi))
+            for (int z = cellZ - 1; z <= cellZ + 1; z++)
             {
-                hi->neighbors.erase(h);
-                h->isNeighborListValid = hi->isNeighborListValid = false;
+                RadioGrid::iterator cell = grid.find(GridCell(x, y, z));
+                if (cell == grid.end())
+                    continue;
+                RadioRefVector& cellRadios = cell->second;
+                for (RadioRefVector::iterator it = cellRadios.begin(); it != cellRadios.end(); ++it)
+                {
+                    RadioRef hi = *it;
+                    if (hi != h && hpos.sqrdist(hi->pos) < maxDistSquared)
+                        updateConnection(h, hi, true);
+                }
             }
         }
     }
 }
 
+void ChannelControl::addToGrid(RadioRef h)
+{
+    h->cellX = (int)floor(h->pos.x / maxInterferenceDistance);
+    h->cellY = (int)floor(h->pos.y / maxInterferenceDistance);
+    h->cellZ = (int)floor(h->pos.z / maxInterferenceDistance);
+    grid[GridCell(h->cellX, h->cellY, h->cellZ)].push_back(h);
+}
+
+void ChannelControl::removeFromGrid(RadioRef h)
+{
+    RadioGrid::iterator cell = grid.find(GridCell(h->cellX, h->cellY, h->cellZ));
+    ASSERT(cell != grid.end());
+    RadioRefVector& cellRadios = cell->second;
+    RadioRefVector::iterator it = std::find(cellRadios.begin(), cellRadios.end(), h);
+    ASSERT(it != cellRadios.end());
+    *it = cellRadios.back();
+    cellRadios.pop_back();
+    if (cellRadios.empty())
+        grid.erase(cell);
+}
+
 void ChannelControl::checkChannel(int channel)
 {
     if (channel >= numChannels || channel < 0)
@@ -222,6 +320,7 @@ void ChannelControl::setRadioPosition(RadioRef r, const Coord& pos)
 {
     Enter_Method_Silent();
     r->pos = pos;
+    radioPositions[r->index] = pos;
     updateConnections(r);
 }
 
@@ -291,6 +390,16 @@ void ChannelControl::sendToChannel(RadioRef srcRadio, AirFrame *airFrame)
 {
     // NOTE: no Enter_Method()! We pretend this method is part of ChannelAccess
 
+    // Each receiver gets its own AirFrame, but these are shallow: cPacket::dup()
+    // shares the encapsulated packet between the copies (reference counting),
+    // and it is only copied when a receiver actually decapsulates it.
+    // The original frame is handed to the last receiver if we don't need
+    // to keep it as an ongoing transmission.
+    cSimpleModule *srcModule = check_and_cast<cSimpleModule*>(srcRadio->radioModule);
+    bool keepFrame = numChannels > 1;
+    RadioRef pendingRadio = NULL;
+    simtime_t pendingDelay;
+
     // loop through all radios in range
     const RadioRefVector& neighbors = getNeighbors(srcRadio);
     int n = neighbors.size();
@@ -306,15 +415,25 @@ void ChannelControl::sendToChannel(RadioRef srcRadio, AirFrame *airFrame)
         if (r->channel == channel)
         {
             coreEV << "sending message to radio listening on the same channel\n";
+            if (pendingRadio)
+                srcModule->sendDirect(airFrame->dup(), pendingDelay, airFrame->getDuration(), pendingRadio->radioInGate);
             // account for propagation delay, based on distance in meters
             // Over 300m, dt=1us=10 bit times @ 10Mbps
-            simtime_t delay = srcRadio->pos.distance(r->pos) / SPEED_OF_LIGHT;
-            check_and_cast<cSimpleModule*>(srcRadio->radioModule)->sendDirect(airFrame->dup(), delay, airFrame->getDuration(), r->radioInGate);
+            pendingRadio = r;
+            pendingDelay = srcRadio->pos.distance(r->pos) / SPEED_OF_LIGHT;
         }
         else
             coreEV << "skipping radio listening on a different channel\n";
     }
 
+    if (pendingRadio && !keepFrame)
+    {
+        srcModule->sendDirect(airFrame, pendingDelay, airFrame->getDuration(), pendingRadio->radioInGate);
+        return;
+    }
+    if (pendingRadio)
+        srcModule->sendDirect(airFrame->dup(), pendingDelay, airFrame->getDuration(), pendingRadio->radioInGate);
+
     // register transmission
     addOngoingTransmission(srcRadio, airFrame);
 }
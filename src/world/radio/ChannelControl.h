@@ -18,8 +18,7 @@
 #define CHANNELCONTROL_H
 
 #include <vector>
-#include <list>
-#include <set>
+#include <map>
 
 #include "INETDefs.h"
 #include "Coord.h"
@@ -37,22 +36,23 @@ class AirFrame;
  */
 struct IChannelControl::RadioEntry {
     cModule *radioModule;  // the module that registered this radio interface
+    int radioModuleId;  // cached radioModule->getId(), the sort key of neighbor lists
     cGate *radioInGate;  // gate on host module used to receive airframes
+    int index;  // index of this radio in ChannelControl's radio arrays
     int channel;
     Coord pos; // cached radio position
 
     struct Compare {
         bool operator() (const RadioRef &lhs, const RadioRef &rhs) const {
             ASSERT(lhs && rhs);
-            return lhs->radioModule->getId() < rhs->radioModule->getId();
+            return lhs->radioModuleId < rhs->radioModuleId;
         }
     };
-    // we cache neighbors set in an std::vector, because std::set iteration is slow;
-    // std::vector is created and updated on demand
-    std::set<RadioRef, Compare> neighbors; // cached neighbor list
-    std::vector<RadioRef> neighborList;
-    bool isNeighborListValid;
+    // neighbors are kept in a vector sorted by module id: sendToChannel() can walk
+    // it directly, and inserts/erases are cheap for typical neighbor counts
+    std::vector<RadioRef> neighbors; // cached neighbor list
     bool isActive;
+    int cellX, cellY, cellZ; // cell index in the spatial grid (only used with neighborUpdateMode="grid")
 };
 
 /**
@@ -64,10 +64,33 @@ struct IChannelControl::RadioEntry {
 class INET_API ChannelControl : public cSimpleModule, public IChannelControl
 {
   protected:
-    typedef std::list<RadioEntry> RadioList;
     typedef std::vector<RadioRef> RadioRefVector;
 
-    RadioList radios;
+    /** registered radios. Entries are allocated individually so that RadioRefs
+     * stay valid, while positions are also kept in a parallel array (indexed by
+     * RadioEntry::index) so that updateConnections() scans contiguous memory */
+    RadioRefVector radios;
+    std::vector<Coord> radioPositions;
+
+    /** radios indexed by the id of the registering module, for lookupRadio() */
+    RadioRefVector radiosByModuleId;
+
+    /** index of a cell in the uniform spatial grid */
+    struct GridCell {
+        int x, y, z;
+        GridCell(int x, int y, int z) : x(x), y(y), z(z) {}
+        bool operator<(const GridCell& other) const {
+            return x < other.x || (x == other.x && (y < other.y || (y == other.y && z < other.z)));
+        }
+    };
+    typedef std::map<GridCell, RadioRefVector> RadioGrid;
+
+    /** if true, neighbor maintenance uses a uniform grid with cell size maxInterferenceDistance,
+     * so that a position update only examines radios in the adjacent cells */
+    bool useGrid;
+
+    /** radios bucketed by grid cell (only used when useGrid is true) */
+    RadioGrid grid;
 
     /** keeps track of ongoing transmissions; this is needed when a radio
      * switches to another channel (then it needs to know whether the target channel
@@ -94,6 +117,24 @@ class INET_API ChannelControl : public cSimpleModule, public IChannelControl
   protected:
     virtual void updateConnections(RadioRef h);
 
+    /** Grid-based version of updateConnections(): only radios in the cells adjacent to h are examined */
+    virtual void updateConnectionsInGrid(RadioRef h);
+
+    /** Connects or disconnects the two radios, depending on whether they are in range */
+    virtual void updateConnection(RadioRef h, RadioRef hi, bool inRange);
+
+    /** Inserts r into the sorted neighbor vector; returns false if it was already there */
+    static bool insertNeighbor(RadioRefVector& neighbors, RadioRef r);
+
+    /** Removes r from the sorted neighbor vector; returns false if it was not there */
+    static bool eraseNeighbor(RadioRefVector& neighbors, RadioRef r);
+
+    /** Inserts the radio into the grid cell that corresponds to its position */
+    virtual void addToGrid(RadioRef h);
+
+    /** Removes the radio from its current grid cell */
+    virtual void removeFromGrid(RadioRef h);
+
     /** Calculate interference distance*/
     virtual double calcInterfDist();
 
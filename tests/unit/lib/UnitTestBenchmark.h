@@ -0,0 +1,28 @@
+#ifndef __TEST__UNITTESTBENCHMARK_H
+#define __TEST__UNITTESTBENCHMARK_H
+
+#include <stdlib.h>
+#include <time.h>
+
+//
+// Some unit tests can also time the code they check, on larger inputs than
+// needed for checking it. They do so only if the INET_UNITTEST_BENCHMARK
+// environment variable is set, and write the timings to stderr, e.g.:
+//
+//   INET_UNITTEST_BENCHMARK=1 ./runtest TCPConnTable_1.test
+//
+// Default runs stay quick, and their output does not depend on the host.
+//
+
+inline bool benchmarkEnabled()
+{
+    return getenv("INET_UNITTEST_BENCHMARK") != NULL;
+}
+
+// CPU time since start, in seconds
+inline double elapsed(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+#endif